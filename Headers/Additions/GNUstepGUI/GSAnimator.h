@@ -33,10 +33,56 @@
 
 @class NSArray;
 @class NSEvent;
+@class NSMutableArray;
+@class NSMutableSet;
+@class NSRecursiveLock;
 @class NSRunLoop;
 @class NSString;
 @class NSTimer;
 
+/**
+ * GSAnimationClock drives every animation of the process from a single
+ * timer on the main run loop. Clients register a target and selector
+ * together with the interval they want to be called at; the clock ticks
+ * at its own rate and calls each client whose interval has elapsed.
+ * Because all clients are called from the same tick, the views they
+ * mark as needing display are redrawn in one display pass per tick.
+ * The timer is removed when no client is registered, so an idle
+ * application does not wake up for animations.
+ */
+@interface GSAnimationClock : NSObject
+{
+  NSRecursiveLock *_lock;
+  NSMutableArray *_clients;
+  NSMutableSet *_modes;
+  NSTimer *_timer;
+  NSTimeInterval _tickInterval;
+  BOOL _ticking;
+}
+
+/** Returns the clock shared by all animations. Its initial rate is
+ * taken from the GSAnimationFrameRate user default (60 if not set). */
++ (GSAnimationClock*) sharedClock;
+
+/** Registers aTarget to receive aSelector (with the clock as argument)
+ * every interval seconds, or on every tick if interval is 0.
+ * The target is not retained and must be removed before it goes away. */
+- (void) addTarget: (id)aTarget
+          selector: (SEL)aSelector
+          interval: (NSTimeInterval)interval;
+
+/** Removes all registrations of aTarget. */
+- (void) removeTarget: (id)aTarget;
+
+/** Makes the clock also tick while the main run loop runs in modes. */
+- (void) addRunLoopModes: (NSArray*)modes;
+
+- (NSTimeInterval) tickInterval;
+- (void) setTickInterval: (NSTimeInterval)interval;
+- (BOOL) isRunning;
+
+@end
+
 /**
  * Protocol that needs to be adopted by classes that want to
  * be animated by a GSAnimator.
@@ -54,7 +100,9 @@
 
 /**
  * GSAnimator is the front of a class cluster. Instances of a subclass of 
- * GSAnimator manage the timing of an animation.
+ * GSAnimator manage the timing of an animation. Animators started on the
+ * main thread are driven by the shared GSAnimationClock, the others by a
+ * timer in the run loop of their thread.
  */
 @interface GSAnimator : NSObject
 {
@@ -67,7 +115,7 @@
 
   NSArray *_runLoopModes;
   
-  NSTimer *_timer;            // Timer used for looping
+  NSTimer *_timer;            // Timer used when not on the main thread
   NSTimeInterval _timerInterval;
 }
 
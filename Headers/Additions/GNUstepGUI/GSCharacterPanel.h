@@ -34,15 +34,16 @@
 
 @class NSTableView;
 @class NSSearchField;
-@class NSIndexSet;
+@class NSData;
 
 @interface GSCharacterPanel : NSPanel
 {
 	NSTableView *table;
 	NSSearchField *searchfield;
 
-	NSIndexSet *assignedCodepoints;
-	NSIndexSet *visibleCodepoints;
+	/* Sorted arrays of uint32_t code points */
+	NSData *assignedCodepoints;
+	NSData *visibleCodepoints;
 }
 
 + (GSCharacterPanel *) sharedCharacterPanel;
@@ -38,6 +38,7 @@
 
 @class NSArray;
 @class NSCountedSet;
+@class NSData;
 @class NSDictionary;
 @class NSMapTable;
 @class NSMutableArray;
@@ -61,6 +62,14 @@ APPKIT_EXPORT NSString *GSDisplayName;
 APPKIT_EXPORT NSString *GSDisplayNumber;
 APPKIT_EXPORT NSString *GSScreenNumber;
 
+/* One window of the on-screen window stack, see -onScreenWindowStack */
+typedef struct _GSWindowStackEntry
+{
+  NSRect	frame;		/* Frame in screen coordinates */
+  int		window;		/* GNUstep window number, 0 if foreign */
+  int		windowRef;	/* OS reference if drag and drop aware, else 0 */
+} GSWindowStackEntry;
+
 @interface GSDisplayServer : NSObject
 {
   NSMutableDictionary	*server_info;
@@ -95,6 +104,7 @@ APPKIT_EXPORT NSString *GSScreenNumber;
 - (int) findWindowAt: (NSPoint)screenLocation 
            windowRef: (int*)windowRef 
            excluding: (int)win;
+- (NSData *) onScreenWindowStack;
 
 
 /* Screen information */
@@ -112,6 +112,17 @@
 
   // Cache for cursors
   NSMutableDictionary	*cursors;
+
+  // Snapshot of the on-screen window stack, nil if the server has none
+  NSData	*windowStack;
+
+  // Time windowStack was taken, 0 when it must be taken again
+  NSTimeInterval windowStackTime;
+
+  // The last dragging update sent, to avoid repeating it
+  NSPoint	lastUpdatePosition;
+  NSDragOperation lastUpdateAction;
+  int		lastUpdateWindowRef;
 }
 
 + (id) sharedDragView;
@@ -29,6 +29,7 @@
 #define _GNUstep_H_GSServicesManager
 
 #import <Foundation/NSObject.h>
+#import <Foundation/NSDate.h>
 /* Forward declaring the NSMenuItem protocol here would be nicer, but older
    versions of gcc can't handle that.  Thus, we include the header
    instead. */
@@ -62,6 +63,13 @@
   NSMutableDictionary	*_allServices;
   NSTimer		*_timer;
   NSString		*_port;
+  NSMutableDictionary	*_title2types;	// Type pair keys of each service
+  NSMutableDictionary	*_typePairs;	// Send and return type of each key
+  NSMutableDictionary	*_validTypes;	// Type pair validity for responder
+  id			_validResponder;	// Not retained
+  id			_validEvent;
+  NSMutableDictionary	*_title2item;	// Menu item of each shown service
+  NSTimeInterval	_lastLoad;
 }
 + (GSServicesManager*) newWithApplication: (NSApplication*)app;
 + (GSServicesManager*) manager;
@@ -79,6 +79,20 @@
 - (BOOL)drawsBackground;
 #endif
 
+#if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+/** Sets how much of the document, above and below the visible area, the
+ * receiver keeps as pixels when scrolling vertically.  Areas scrolled out
+ * of view are copied from the window, and when a later scroll brings them
+ * back they are drawn from that copy instead of asking the document view
+ * to draw them again.  The copy is dropped as soon as the document view
+ * or one of its subviews is marked as needing display, or draws directly
+ * with -lockFocus or -displayRect:.<br />
+ * The default is 0, which keeps nothing.
+ */
+- (void)setOverdrawMargin:(CGFloat)margin;
+- (CGFloat)overdrawMargin;
+#endif
+
 @end
 
 #endif /* _GNUstep_H_NSClipView */
@@ -110,7 +110,10 @@ typedef enum _NSSaveOperationType {
         unsigned int has_undo_manager:1;
         unsigned int permanently_modified:1;
         unsigned int autosave_permanently_modified:1;
-        unsigned int RESERVED:28;
+        unsigned int autosave_in_progress:1;
+        unsigned int autosave_discarded:1;
+        unsigned int autosave_needs_snapshot:1;
+        unsigned int RESERVED:25;
     } _doc_flags;
     void 		*_reserved1;
 }
@@ -366,6 +369,42 @@ originalContentsURL:(NSURL *)orig
          contextInfo:(void *)context;
 - (NSError *)willPresentError:(NSError *)error;
 #endif
+
+#if OS_API_VERSION(MAC_OS_X_VERSION_10_7, GS_API_LATEST)
+/** Returns YES if the document may be written to url on a background
+ * thread once its contents have been captured on the main thread.<br />
+ * GNUstep only does this for NSAutosaveOperation.  The default
+ * implementation returns YES for autosaves to file URLs, provided
+ * the receiver writes itself through -fileWrapperOfType:error: (or
+ * -dataOfType:error:) and does not override any of the methods that
+ * write the file directly.
+ */
+- (BOOL)canAsynchronouslyWriteToURL:(NSURL *)url
+                             ofType:(NSString *)type
+                   forSaveOperation:(NSSaveOperationType)op;
+#endif
 @end
 
+#if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+@interface NSDocument (GNUstep)
+/** Returns YES if the receiver autosaves by appending the data returned
+ * by -autosaveDeltaOfType:error: to its existing autosave file, rather
+ * than rewriting the whole file.  The receiver's reading methods must
+ * then understand a file made of a full snapshot followed by deltas.
+ * The default is NO.
+ */
+- (BOOL)autosavesIncrementally;
+
+/** Returns the changes made since the previous call, in a form that can
+ * be appended to the autosave file.  This is called on the main thread
+ * before every background autosave of a document which
+ * -autosavesIncrementally, so each call starts a new delta even when
+ * the result is discarded in favour of a full snapshot.  Return nil to
+ * force a full snapshot.  The default returns nil.
+ */
+- (NSData *)autosaveDeltaOfType:(NSString *)type
+                          error:(NSError **)error;
+@end
+#endif
+
 #endif // _GNUstep_H_NSDocument
@@ -262,6 +262,21 @@ APPKIT_EXPORT const CGFloat *NSFontIdentityMatrix;
 @interface NSFont (GNUstep)
 - (GSFontInfo*) fontInfo;
 - (void *) fontRef;
+
+/** Sets how many of the most recently used fonts are kept alive by the
+ * font cache after the application has released them, so that asking
+ * for them again does not make the backend create a new font info.<br />
+ * The initial value is taken from the GSFontCacheSize user default,
+ * or 64 if that is not set.
+ */
++ (void) setFontCacheLimit: (NSUInteger)count;
++ (NSUInteger) fontCacheLimit;
+
+/** Returns counters for the font cache under the keys
+ * <code>Hits</code>, <code>Misses</code>, <code>FontInfoCreations</code>,
+ * <code>Evictions</code> and <code>FontsResident</code>.
+ */
++ (NSDictionary*) fontCacheStatistics;
 @end
 
 int NSConvertGlyphsToPackedGlyphs(NSGlyph*glBuf, 
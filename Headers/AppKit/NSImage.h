@@ -141,6 +141,7 @@ APPKIT_EXTERN NSString *const NSImageNameFolder;
     unsigned	cacheSeparately: 1;
     unsigned	unboundedCacheDepth: 1;
     unsigned	syncLoad: 1;
+    unsigned	purgeable: 1;
   } _flags;
   NSMutableArray	*_reps;
   NSColor		*_color;
@@ -500,6 +501,30 @@ APPKIT_EXTERN NSString *const NSImageNameFolder;
 @end
 
 #if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+// 
+// Methods that are GNUstep extensions
+//
+@interface NSImage (GNUstep)
+/** Sets the number of bytes of decoded image data that images created
+ * with -initByReferencingFile: (this includes images returned by
+ * +imageNamed:) may hold together. When the limit is exceeded, the
+ * least recently used of these images release their representations,
+ * as soon as the main thread is idle for images loaded on it, or else
+ * when the image is next used, and load them again from their file
+ * when needed. Images drawn into with -lockFocus are kept.<br />
+ * The initial value is taken from the GSImageDecodedCacheSize user
+ * default, or 128MB if that is not set.
+ */
++ (void) setDecodedImageCacheLimit: (NSUInteger)bytes;
++ (NSUInteger) decodedImageCacheLimit;
+
+/** Returns counters for the decoded image cache under the keys
+ * <code>Hits</code>, <code>Loads</code>, <code>Evictions</code>
+ * and <code>BytesResident</code>.
+ */
++ (NSDictionary*) decodedImageCacheStatistics;
+@end
+
 /*
  * A formal protocol that duplicates the informal protocol for delegates.
  */
@@ -71,7 +71,7 @@ typedef enum _NSProgressIndicatorStyle
   BOOL _isVertical;
   BOOL _isRunning;
   int _count;  
-  NSTimer *_timer;
+  id _reserved_timer;  // No longer used, kept for the instance layout
   id _reserved;
 }
 
@@ -64,6 +64,7 @@ enum
   int _position; 
   int _currentTag;
   BOOL _wrapFlag;
+  BOOL _serverFindsAllMisspellings;
 
   // GUI ...
   id _wordField;
@@ -141,6 +142,20 @@ enum
 
 @end
 
+#if OS_API_VERSION(GS_API_NONE, GS_API_NONE)
+@interface NSSpellChecker (GNUstep)
+/**
+ * Returns the ranges of all misspelled words of aString within aRange,
+ * as NSValue objects in ascending order.  The words are sent to the
+ * spell server in a single request when the server supports it.
+ */
+- (NSArray *) misspelledRangesInString: (NSString *)aString
+				 range: (NSRange)aRange
+			      language: (NSString *)language
+		inSpellDocumentWithTag: (int)tag;
+@end
+#endif
+
 typedef NSInteger NSCorrectionResponse;
 enum
 {
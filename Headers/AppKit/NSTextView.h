@@ -154,6 +154,7 @@ therefore be stored in the NSLayoutManager to avoid problems.
     unsigned uses_find_panel:1;
     unsigned accepts_glyph_info:1;
     unsigned allows_document_background_color_change:1;
+    unsigned uses_document_word_completion:1;
   } _tf;
 
 
@@ -318,6 +319,19 @@ and the typing attributed will be used.
 -(void) replaceCharactersInRange: (NSRange)aRange /* GNUstep extension. */
 	    withAttributedString: (NSAttributedString *)aString;
 
+/*
+Edit transactions (GNUstep extension). Between -beginEditTransaction and
+the matching -endEditTransaction, the changes approved by
+-shouldChangeTextInRange:replacementString: are recorded as a single undo
+action, -didChangeText is deferred so that NSTextDidChangeNotification is
+posted once, and the text storage processes all the edits (and the layout
+manager invalidates layout and display) once, over the union of the changed
+ranges. The selection is only updated when the transaction ends.
+Transactions may be nested; only the outermost one takes effect.
+*/
+-(void) beginEditTransaction;
+-(void) endEditTransaction;
+
 
 
 /*** Additional Font menu commands ***/
@@ -430,6 +444,17 @@ the text view is resizable. */
 #endif
 
 #ifdef GNUSTEP
+/** Returns whether -completionsForPartialWordRange:indexOfSelectedItem:
+ * offers the words of the document, most frequent first. */
+- (BOOL) usesDocumentWordCompletion;
+/** Sets whether -completionsForPartialWordRange:indexOfSelectedItem:
+ * offers the words of the document. The words are indexed once and the
+ * index is kept up to date with each edit of the text storage. If the
+ * delegate implements
+ * -textView:completions:forPartialWordRange:indexOfSelectedItem:, it
+ * receives these words as the proposed completions. */
+- (void) setUsesDocumentWordCompletion: (BOOL)flag;
+
 /*** Private, internal methods for (currently only) XIM support ***/
 
 /*
@@ -165,6 +165,8 @@ PACKAGE_SCOPE
     unsigned	has_tooltips:1;		/* The view has tooltips set.	*/
     unsigned	ignores_backing:1;      /* The view does not trigger    */
                                         /* backing flush when drawn     */
+    unsigned	caches_drawing:1;	/* The view keeps copies of its */
+					/* drawing or of its subviews.	*/
   } _rFlags;
 
   BOOL _is_rotated_from_base;
@@ -378,6 +380,14 @@ PACKAGE_SCOPE
 - (void) viewDidEndLiveResize;
 #endif
 #if OS_API_VERSION(MAC_OS_X_VERSION_10_4, GS_API_LATEST)
+/** Returns NO by default.  A view returning YES keeps its drawing while
+ * its window is live resized, as long as its bounds origin stays at the
+ * same place relative to the top left corner of the window, and only the
+ * areas returned by -getRectsExposedDuringLiveResize:count: are marked
+ * as needing display.  Views which draw a cheaper placeholder while
+ * -inLiveResize is YES should call -setNeedsDisplay: in
+ * -viewDidEndLiveResize.
+ */
 - (BOOL) preservesContentDuringLiveResize;
 - (void) getRectsExposedDuringLiveResize: (NSRect[4])exposedRects count: (NSInteger *)count;
 - (NSRect) rectPreservedDuringLiveResize;
@@ -323,6 +323,7 @@ PACKAGE_SCOPE
     unsigned autorecalculates_keyview_loop: 1;
     unsigned ignores_mouse_events: 1;
     unsigned preserves_content_during_live_resize: 1;
+    unsigned in_live_resize: 1;
   } _f;
 @protected 
   NSToolbar     *_toolbar;
@@ -485,6 +486,14 @@ PACKAGE_SCOPE
 - (BOOL) preservesContentDuringLiveResize;
 - (void) setPreservesContentDuringLiveResize: (BOOL)flag;
 #endif
+#if OS_API_VERSION(MAC_OS_X_VERSION_10_6, GS_API_LATEST)
+/** Returns YES while the user resizes the receiver interactively.
+ * During such a live resize the views of the window receive
+ * -viewWillStartLiveResize and -viewDidEndLiveResize, and views which
+ * preserve their content only have the newly exposed areas redrawn.
+ */
+- (BOOL) inLiveResize;
+#endif
 
 /*
  * Constraining size
@@ -1003,5 +1012,9 @@ APPKIT_EXPORT NSString *NSWindowWillBeginSheetNotification;
 APPKIT_EXPORT NSString *NSWindowWillCloseNotification;
 APPKIT_EXPORT NSString *NSWindowWillMiniaturizeNotification;
 APPKIT_EXPORT NSString *NSWindowWillMoveNotification;
+#if OS_API_VERSION(MAC_OS_X_VERSION_10_6, GS_API_LATEST)
+APPKIT_EXPORT NSString *NSWindowWillStartLiveResizeNotification;
+APPKIT_EXPORT NSString *NSWindowDidEndLiveResizeNotification;
+#endif
 
 #endif /* _GNUstep_H_NSWindow */
@@ -25,12 +25,18 @@
    Boston, MA 02110-1301, USA.
 */ 
 
+#import <Foundation/NSArray.h>
 #import <Foundation/NSDebug.h>
+#import <Foundation/NSEnumerator.h>
+#import <Foundation/NSLock.h>
 #import <Foundation/NSRunLoop.h>
 #import <Foundation/NSSet.h>
 #import <Foundation/NSString.h>
+#import <Foundation/NSThread.h>
 #import <Foundation/NSTimer.h>
+#import <Foundation/NSUserDefaults.h>
 
+#import "AppKit/NSApplication.h"
 #import "AppKit/NSEvent.h"
 #import "GNUstepGUI/GSAnimator.h"
 
@@ -171,74 +177,43 @@
 
 @end
 
-static NSTimer *_GSTimerBasedAnimator_timer = nil;
-static NSMutableSet *_GSTimerBasedAnimator_animators = nil;
-static GSAnimator *_GSTimerBasedAnimator_the_one_animator = nil;
-static int _GSTimerBasedAnimator_animator_count = 0;
-
 @implementation GSAnimator (private)
 
-+ (void) loopsAnimators
-{
-  switch (_GSTimerBasedAnimator_animator_count)
-    {
-    case 0:
-      break;
-    case 1:
-      [_GSTimerBasedAnimator_the_one_animator _animationLoop];
-      break;
-    default:
-      [_GSTimerBasedAnimator_animators 
-        makeObjectsPerform: @selector(_animationLoop)];
-    }
-}
-
 - (void) _animationBegin
 {
-  NSTimer *newTimer = nil;
+  GSAnimationClock *clock = [GSAnimationClock sharedClock];
 
-  if (_timerInterval == 0.0)
+  NSDebugMLLog(@"GSAnimator", @"Start with interval %f", _timerInterval);
+  if ([NSThread isMainThread])
     {
-      NSDebugMLLog(@"GSAnimator", @"AFAP start");
-      if (!_GSTimerBasedAnimator_animator_count++)
-        _GSTimerBasedAnimator_the_one_animator = self;
-
-      if (nil == _GSTimerBasedAnimator_animators)
-        _GSTimerBasedAnimator_animators = [[NSMutableSet alloc] initWithCapacity: 5];
-      [_GSTimerBasedAnimator_animators addObject: self];
-    
-      if (nil == _GSTimerBasedAnimator_timer)
-        {
-          newTimer = [NSTimer timerWithTimeInterval: 0.0
-                              target: [self class]
-                              selector: @selector(loopsAnimators)
-                              userInfo: nil
-                              repeats: YES];
-          ASSIGN(_GSTimerBasedAnimator_timer, newTimer);
-        }
+      [clock addRunLoopModes: _runLoopModes];
+      [clock addTarget: self
+              selector: @selector(_animationLoop)
+              interval: _timerInterval];
     }
   else
     {
-      NSDebugMLLog(@"GSAnimator", @"Fixed frame rate start");
-      newTimer = [NSTimer timerWithTimeInterval: _timerInterval
-                          target: self
-                          selector: @selector(_animationLoop)
-                          userInfo: nil
-                          repeats: YES];
-      ASSIGN(_timer, newTimer);
-    }
-
-  if (newTimer != nil)
-    {
-      unsigned i,c;
+      NSTimeInterval interval = _timerInterval;
+      NSUInteger i, c;
 
+      /* The thread may run its own loop while the main thread is busy
+       * or waiting for it, so it can not rely on the shared clock.
+       */
+      if (interval == 0.0)
+        {
+          interval = [clock tickInterval];
+        }
+      ASSIGN(_timer, [NSTimer timerWithTimeInterval: interval
+                                             target: self
+                                           selector: @selector(_animationLoop)
+                                           userInfo: nil
+                                            repeats: YES]);
       for (i = 0, c = [_runLoopModes count]; i < c; i++)
         {
           [[NSRunLoop currentRunLoop]
-              addTimer: newTimer
-              forMode: [_runLoopModes objectAtIndex:i]];
+            addTimer: _timer
+             forMode: [_runLoopModes objectAtIndex: i]];
         }
-      NSDebugMLLog(@"GSAnimator",@"addTimer in %d mode(s)", c);
     }
 }
 
@@ -250,31 +225,303 @@ static int _GSTimerBasedAnimator_animator_count = 0;
 
 - (void) _animationEnd
 {
-  if (_timerInterval == 0.0)
+  NSDebugMLLog(@"GSAnimator", @"End");
+  if (_timer != nil)
+    {
+      [_timer invalidate];
+      DESTROY(_timer);
+    }
+  else
+    {
+      [[GSAnimationClock sharedClock] removeTarget: self];
+    }
+}
+
+@end // implementation GSAnimator (private)
+
+
+@interface GSAnimationClockClient : NSObject
+{
+@public
+  id target;
+  SEL selector;
+  NSTimeInterval interval;
+  NSTimeInterval nextFire;
+}
+@end
+
+@implementation GSAnimationClockClient
+@end
+
+@interface GSAnimationClock (Private)
+- (void) _tick: (NSTimer*)timer;
+- (void) _updateTimer;
+@end
+
+static GSAnimationClock *sharedClock = nil;
+
+@implementation GSAnimationClock
+
++ (GSAnimationClock*) sharedClock
+{
+  if (sharedClock == nil)
     {
-      NSDebugMLLog(@"GSAnimator", @"AFAP end");
-      [_GSTimerBasedAnimator_animators removeObject: self];
-        
-      if (!--_GSTimerBasedAnimator_animator_count)
+      GSAnimationClock *clock = [[self alloc] init];
+
+      [gnustep_global_lock lock];
+      if (sharedClock == nil)
         {
-          [_GSTimerBasedAnimator_timer invalidate];
-          DESTROY(_GSTimerBasedAnimator_timer);
-          _GSTimerBasedAnimator_the_one_animator = nil;
+          sharedClock = clock;
         }
       else
-        if (_GSTimerBasedAnimator_the_one_animator == self)
-          _GSTimerBasedAnimator_the_one_animator
-            = [_GSTimerBasedAnimator_animators anyObject];
+        {
+          RELEASE(clock);
+        }
+      [gnustep_global_lock unlock];
     }
-  else
+  return sharedClock;
+}
+
+- (id) init
+{
+  if ((self = [super init]) != nil)
+    {
+      float fps;
+
+      fps = [[NSUserDefaults standardUserDefaults]
+              floatForKey: @"GSAnimationFrameRate"];
+      if (fps <= 0.0)
+        {
+          fps = 60.0;
+        }
+      _tickInterval = 1.0 / fps;
+      _lock = [NSRecursiveLock new];
+      _clients = [[NSMutableArray alloc] initWithCapacity: 8];
+      _modes = [[NSMutableSet alloc] initWithObjects: NSDefaultRunLoopMode,
+                                 NSModalPanelRunLoopMode,
+                                 NSEventTrackingRunLoopMode, nil];
+    }
+  return self;
+}
+
+- (void) dealloc
+{
+  [_timer invalidate];
+  TEST_RELEASE(_timer);
+  RELEASE(_clients);
+  RELEASE(_modes);
+  RELEASE(_lock);
+  [super dealloc];
+}
+
+- (void) addTarget: (id)aTarget
+          selector: (SEL)aSelector
+          interval: (NSTimeInterval)interval
+{
+  GSAnimationClockClient *client = [GSAnimationClockClient new];
+
+  client->target = aTarget;
+  client->selector = aSelector;
+  client->interval = interval;
+  client->nextFire = [NSDate timeIntervalSinceReferenceDate] + interval;
+
+  [_lock lock];
+  [_clients addObject: client];
+  [_lock unlock];
+  RELEASE(client);
+  [self _updateTimer];
+}
+
+- (void) removeTarget: (id)aTarget
+{
+  NSUInteger i;
+
+  [_lock lock];
+  i = [_clients count];
+  while (i-- > 0)
+    {
+      GSAnimationClockClient *client = [_clients objectAtIndex: i];
+
+      if (client->target == aTarget)
+        {
+          if (_ticking)
+            {
+              /* Removed from the array once the tick is over. */
+              client->target = nil;
+            }
+          else
+            {
+              [_clients removeObjectAtIndex: i];
+            }
+        }
+    }
+  [_lock unlock];
+  [self _updateTimer];
+}
+
+- (void) addRunLoopModes: (NSArray*)modes
+{
+  NSUInteger i;
+  NSUInteger c = [modes count];
+
+  if (_timer != nil && ![NSThread isMainThread])
+    {
+      [self performSelectorOnMainThread: @selector(addRunLoopModes:)
+                             withObject: modes
+                          waitUntilDone: NO];
+      return;
+    }
+
+  [_lock lock];
+  for (i = 0; i < c; i++)
+    {
+      NSString *mode = [modes objectAtIndex: i];
+
+      if ([_modes member: mode] == nil)
+        {
+          [_modes addObject: mode];
+          if (_timer != nil)
+            {
+              [[NSRunLoop mainRunLoop] addTimer: _timer forMode: mode];
+            }
+        }
+    }
+  [_lock unlock];
+}
+
+- (NSTimeInterval) tickInterval
+{
+  return _tickInterval;
+}
+
+- (void) setTickInterval: (NSTimeInterval)interval
+{
+  [_lock lock];
+  if (interval != _tickInterval && interval > 0.0)
     {
-      NSDebugMLLog(@"GSAnimator", @"Fixed frame rate end");
+      _tickInterval = interval;
       if (_timer != nil)
         {
           [_timer invalidate];
           DESTROY(_timer);
         }
     }
+  [_lock unlock];
+  [self _updateTimer];
 }
 
-@end // implementation GSAnimator (private)
+- (BOOL) isRunning
+{
+  return _timer != nil;
+}
+
+@end
+
+@implementation GSAnimationClock (Private)
+
+- (void) _tick: (NSTimer*)timer
+{
+  NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+  NSMutableArray *due = [NSMutableArray arrayWithCapacity: [_clients count]];
+  NSUInteger count;
+  NSUInteger i;
+
+  [_lock lock];
+  _ticking = YES;
+  count = [_clients count];
+  for (i = 0; i < count; i++)
+    {
+      GSAnimationClockClient *client = [_clients objectAtIndex: i];
+
+      if (client->target != nil && now >= client->nextFire)
+        {
+          client->nextFire += client->interval;
+          if (client->nextFire < now)
+            {
+              client->nextFire = now + client->interval;
+            }
+          [due addObject: client];
+        }
+    }
+  [_lock unlock];
+
+  /* The callbacks run without the lock, so they may block on other
+   * threads using the clock. Clients removed meanwhile just lose
+   * their target.
+   */
+  count = [due count];
+  for (i = 0; i < count; i++)
+    {
+      GSAnimationClockClient *client = [due objectAtIndex: i];
+      id target;
+
+      [_lock lock];
+      target = client->target;
+      [_lock unlock];
+      if (target != nil)
+        {
+          [target performSelector: client->selector withObject: self];
+        }
+    }
+
+  [_lock lock];
+  _ticking = NO;
+  i = [_clients count];
+  while (i-- > 0)
+    {
+      if (((GSAnimationClockClient*)[_clients objectAtIndex: i])->target == nil)
+        {
+          [_clients removeObjectAtIndex: i];
+        }
+    }
+  [_lock unlock];
+  [self _updateTimer];
+}
+
+/* Installs the timer while there are clients and removes it when there
+ * are none. The timer always lives in the main run loop.
+ */
+- (void) _updateTimer
+{
+  if (![NSThread isMainThread])
+    {
+      [self performSelectorOnMainThread: @selector(_updateTimer)
+                             withObject: nil
+                          waitUntilDone: NO];
+      return;
+    }
+
+  [_lock lock];
+  if (_ticking == NO)
+    {
+      if ([_clients count] == 0)
+        {
+          if (_timer != nil)
+            {
+              NSDebugMLLog(@"GSAnimator", @"Clock stops");
+              [_timer invalidate];
+              DESTROY(_timer);
+            }
+        }
+      else if (_timer == nil)
+        {
+          NSEnumerator *e = [_modes objectEnumerator];
+          NSRunLoop *loop = [NSRunLoop currentRunLoop];
+          NSString *mode;
+
+          NSDebugMLLog(@"GSAnimator", @"Clock starts");
+          _timer = RETAIN([NSTimer timerWithTimeInterval: _tickInterval
+                                                  target: self
+                                                selector: @selector(_tick:)
+                                                userInfo: nil
+                                                 repeats: YES]);
+          while ((mode = [e nextObject]) != nil)
+            {
+              [loop addTimer: _timer forMode: mode];
+            }
+        }
+    }
+  [_lock unlock];
+}
+
+@end
@@ -35,6 +35,20 @@
 @class NSDictionary;
 @class NSMutableDictionary;
 @class NSArray;
+@class NSValueTransformer;
+
+/* The binding options which matter when a value goes through the
+ * binding, looked up once from the options dictionary.  */
+typedef struct _GSBindingOptions
+{
+  NSValueTransformer *transformer;
+  NSString *transformerName;	/* Looked up on use.  */
+  id multipleValuesPlaceholder;
+  id noSelectionPlaceholder;
+  id notApplicablePlaceholder;
+  id nullPlaceholder;
+  BOOL raisesForNotApplicable;
+} GSBindingOptions;
 
 @interface GSKeyValueBinding : NSObject
 {
@@ -42,6 +56,12 @@
   NSDictionary *info;
   id src;
   BOOL inReverseSet;
+@protected
+  /* Taken from info when the binding is made.  */
+  id observedObject;
+  NSString *observedKeyPath;
+  NSDictionary *bindingOptions;
+  GSBindingOptions resolved;
 }
 
 + (void) exposeBinding: (NSString *)binding forClass: (Class)clazz;
@@ -66,7 +86,8 @@
 - (id) sourceValueFor: (NSString *)binding;
 
 /* Transforms the value with a value transformer, if specified and available,
- * and takes care of any placeholders
+ * and takes care of any placeholders.  When options are the options of the
+ * binding, the transformer and placeholders found at bind time are used.
  */
 - (id) transformValue: (id)value withOptions: (NSDictionary *)options;
 - (id) reverseTransformValue: (id)value withOptions: (NSDictionary *)options;
@@ -31,6 +31,9 @@
 #import <Foundation/NSIndexSet.h>
 #import <Foundation/NSBundle.h>
 #import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSFileManager.h>
+#import <Foundation/NSPathUtilities.h>
 #import "AppKit/NSApplication.h"
 #import "AppKit/NSStringDrawing.h"
 #import "AppKit/NSPasteboard.h"
@@ -52,6 +55,8 @@
 @end
 
 #if defined(HAVE_UNICODE_UCHAR_H) && defined(HAVE_UNICODE_USTRING_H)
+#include <stdlib.h>
+#include <string.h>
 #include <unicode/uchar.h>
 #include <unicode/ustring.h>
 
@@ -85,56 +90,521 @@
 
 @end
 
-// Enumerating assigned codepoints
+// Index of character names
 
-static UBool enumCharNamesFn(void *context, UChar32 code, UCharNameChoice nameChoice, const char *name, int32_t length)
+/*
+ * The names of all assigned code points are kept in one table, sorted by
+ * code point, together with a trigram index over the names. Each of the
+ * trigram buckets holds the (delta and varint encoded) table positions
+ * of the names containing that trigram. A substring search only needs
+ * to look at the names in the smallest bucket of the search string.
+ *
+ * Building the table takes a while, so it is written to the user's
+ * caches directory and mapped from there by later processes.
+ */
+
+#define NAME_INDEX_MAGIC	0x4e435347	/* "GSCN" */
+#define NAME_INDEX_VERSION	1
+#define NAME_INDEX_SYMBOLS	39
+#define NAME_INDEX_BUCKETS	(NAME_INDEX_SYMBOLS * NAME_INDEX_SYMBOLS \
+                                 * NAME_INDEX_SYMBOLS)
+#define NAME_INDEX_HEADER	8
+
+typedef struct {
+  NSData *data;
+  uint32_t count;
+  const uint32_t *codepoints;
+  const uint32_t *nameOffsets;
+  const uint32_t *bucketOffsets;
+  const uint32_t *bucketCounts;
+  const char *names;
+  const uint8_t *postings;
+} GSCharacterNameIndex;
+
+/* Character names only use upper case letters, digits, space and hyphen.
+ */
+static inline uint32_t symbolForChar(unsigned char c)
 {
-  [(NSMutableIndexSet*)context addIndex: (NSUInteger)code];
-  return TRUE;
+  if (c >= 'A' && c <= 'Z')
+    return c - 'A';
+  if (c >= '0' && c <= '9')
+    return 26 + c - '0';
+  if (c == ' ')
+    return 36;
+  if (c == '-')
+    return 37;
+  return 38;
 }
 
-static NSIndexSet *AssignedCodepoints()
+static inline uint32_t trigramAt(const char *s)
 {
-  UErrorCode err = U_ZERO_ERROR;
-  NSMutableIndexSet *set = [NSMutableIndexSet indexSet];
-  u_enumCharNames(UCHAR_MIN_VALUE, UCHAR_MAX_VALUE + 1, enumCharNamesFn, set, U_UNICODE_CHAR_NAME, &err);
-  return set;
+  return (symbolForChar(s[0]) * NAME_INDEX_SYMBOLS + symbolForChar(s[1]))
+    * NAME_INDEX_SYMBOLS + symbolForChar(s[2]);
 }
 
-// Searching for codepoints
+static inline uint32_t varintLength(uint32_t v)
+{
+  uint32_t l = 1;
 
-struct searchContext {
-  const char *searchString;
-  NSMutableIndexSet *set;
-};
+  while (v >= 0x80)
+    {
+      v >>= 7;
+      l++;
+    }
+  return l;
+}
 
-static UBool searchCharNamesFn(void *context, UChar32 code, UCharNameChoice nameChoice, const char *name, int32_t length)
+static inline uint8_t *writeVarint(uint8_t *p, uint32_t v)
 {
-  struct searchContext *ctx = (struct searchContext *)context;
-  if (strstr(name, ctx->searchString) != NULL)
+  while (v >= 0x80)
     {
-      [ctx->set addIndex: (NSUInteger)code];
+      *p++ = (uint8_t)(v | 0x80);
+      v >>= 7;
     }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+static inline uint32_t readVarint(const uint8_t **p)
+{
+  uint32_t v = 0;
+  int shift = 0;
+  uint8_t b;
+
+  do
+    {
+      b = *(*p)++;
+      v |= (uint32_t)(b & 0x7f) << shift;
+      shift += 7;
+    }
+  while (b & 0x80);
+  return v;
+}
+
+static int compareTrigrams(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/* Fills trigrams with the distinct trigrams of name, returns their number.
+ */
+static uint32_t distinctTrigrams(const char *name, uint32_t *trigrams)
+{
+  size_t len = strlen(name);
+  uint32_t count = 0;
+  uint32_t i, j;
+
+  if (len < 3)
+    {
+      return 0;
+    }
+  for (i = 0; i + 2 < len; i++)
+    {
+      trigrams[count++] = trigramAt(name + i);
+    }
+  qsort(trigrams, count, sizeof(uint32_t), compareTrigrams);
+  for (i = 1, j = 1; i < count; i++)
+    {
+      if (trigrams[i] != trigrams[j - 1])
+        {
+          trigrams[j++] = trigrams[i];
+        }
+    }
+  return j;
+}
+
+struct nameCollector {
+  NSMutableData *codepoints;
+  NSMutableData *offsets;
+  NSMutableData *names;
+};
+
+static UBool collectCharNamesFn(void *context, UChar32 code, UCharNameChoice nameChoice, const char *name, int32_t length)
+{
+  struct nameCollector *c = (struct nameCollector *)context;
+  uint32_t cp = (uint32_t)code;
+  uint32_t offset = (uint32_t)[c->names length];
+
+  [c->codepoints appendBytes: &cp length: sizeof(cp)];
+  [c->offsets appendBytes: &offset length: sizeof(offset)];
+  [c->names appendBytes: name length: length];
+  [c->names appendBytes: "" length: 1];
   return TRUE;
 }
 
-static NSIndexSet *CodepointsWithNameContainingSubstring(NSString *str)
+static NSData *BuildCharacterNameIndex(void)
 {
   UErrorCode err = U_ZERO_ERROR;
-  struct searchContext ctx;
-	
-  ctx.set = [NSMutableIndexSet indexSet];
-  ctx.searchString = [[str uppercaseString] UTF8String];
+  struct nameCollector c;
+  NSMutableData *data;
+  const uint32_t *offsets;
+  const char *names;
+  uint32_t header[NAME_INDEX_HEADER];
+  uint32_t trigrams[512];
+  uint32_t *counts;
+  uint32_t *bucketOffsets;
+  uint32_t *last;
+  uint8_t *postings;
+  uint32_t count, namesLength, paddedLength, i, j;
+
+  c.codepoints = [NSMutableData data];
+  c.offsets = [NSMutableData data];
+  c.names = [NSMutableData data];
+  u_enumCharNames(UCHAR_MIN_VALUE, UCHAR_MAX_VALUE + 1, collectCharNamesFn,
+                  &c, U_UNICODE_CHAR_NAME, &err);
+  count = [c.codepoints length] / sizeof(uint32_t);
+  namesLength = [c.names length];
+  [c.offsets appendBytes: &namesLength length: sizeof(namesLength)];
+  paddedLength = (namesLength + 3) & ~3;
+  [c.names setLength: paddedLength];
+  offsets = [c.offsets bytes];
+  names = [c.names bytes];
+
+  /* Count the entries and their encoded size in each bucket.
+   */
+  counts = calloc(NAME_INDEX_BUCKETS, sizeof(uint32_t));
+  bucketOffsets = calloc(NAME_INDEX_BUCKETS + 1, sizeof(uint32_t));
+  last = calloc(NAME_INDEX_BUCKETS, sizeof(uint32_t));
+  for (i = 0; i < count; i++)
+    {
+      uint32_t n = distinctTrigrams(names + offsets[i], trigrams);
+
+      for (j = 0; j < n; j++)
+        {
+          uint32_t b = trigrams[j];
+
+          counts[b]++;
+          bucketOffsets[b + 1] += varintLength(i - last[b]);
+          last[b] = i;
+        }
+    }
+  for (i = 0; i < NAME_INDEX_BUCKETS; i++)
+    {
+      bucketOffsets[i + 1] += bucketOffsets[i];
+    }
+
+  header[0] = NAME_INDEX_MAGIC;
+  header[1] = NAME_INDEX_VERSION;
+  header[2] = count;
+  header[3] = paddedLength;
+  header[4] = NAME_INDEX_BUCKETS;
+  header[5] = bucketOffsets[NAME_INDEX_BUCKETS];
+  header[6] = 0;
+  header[7] = 0;
+
+  data = [NSMutableData dataWithCapacity: sizeof(header)
+    + sizeof(uint32_t) * (2 * count + 2 * NAME_INDEX_BUCKETS + 2)
+    + paddedLength + header[5]];
+  [data appendBytes: header length: sizeof(header)];
+  [data appendData: c.codepoints];
+  [data appendData: c.offsets];
+  [data appendBytes: bucketOffsets
+             length: sizeof(uint32_t) * (NAME_INDEX_BUCKETS + 1)];
+  [data appendBytes: counts length: sizeof(uint32_t) * NAME_INDEX_BUCKETS];
+  [data appendData: c.names];
+  [data setLength: [data length] + header[5]];
+
+  /* Now fill in the buckets.
+   */
+  postings = (uint8_t *)[data mutableBytes] + [data length] - header[5];
+  memset(last, 0, sizeof(uint32_t) * NAME_INDEX_BUCKETS);
+  for (i = 0; i < count; i++)
+    {
+      uint32_t n = distinctTrigrams(names + offsets[i], trigrams);
+
+      for (j = 0; j < n; j++)
+        {
+          uint32_t b = trigrams[j];
+          uint8_t *p = postings + bucketOffsets[b];
+
+          bucketOffsets[b] = writeVarint(p, i - last[b]) - postings;
+          last[b] = i;
+        }
+    }
+
+  free(counts);
+  free(bucketOffsets);
+  free(last);
+  return data;
+}
+
+/* Returns YES if the postings of a bucket decode within their bytes to
+ * exactly entries increasing table positions below count.
+ */
+static BOOL ValidPostings(const uint8_t *p, const uint8_t *end,
+                          uint32_t entries, uint32_t count)
+{
+  uint64_t entry = 0;
+  uint32_t n = 0;
+
+  while (p < end)
+    {
+      uint64_t delta = 0;
+      int shift = 0;
+      uint8_t b;
+
+      do
+        {
+          if (p == end || shift > 28)
+            {
+              return NO;
+            }
+          b = *p++;
+          delta |= (uint64_t)(b & 0x7f) << shift;
+          shift += 7;
+        }
+      while (b & 0x80);
+      if (n > 0 && delta == 0)
+        {
+          return NO;
+        }
+      entry += delta;
+      if (entry >= count)
+        {
+          return NO;
+        }
+      n++;
+    }
+  return n == entries;
+}
+
+/* Sets up idx to use the index in data. The data may come from a file
+ * written by another (or a broken) process, so every offset and length
+ * in it is checked before anything is read through it.
+ */
+static BOOL ParseCharacterNameIndex(NSData *data, GSCharacterNameIndex *idx)
+{
+  const uint32_t *header = [data bytes];
+  NSUInteger length = [data length];
+  const uint32_t *codepoints;
+  const uint32_t *nameOffsets;
+  const uint32_t *bucketOffsets;
+  const uint32_t *bucketCounts;
+  const char *names;
+  const uint8_t *postings;
+  uint32_t count, namesLength, buckets, postingsLength, i;
+  uint64_t expected;
+
+  if (length < sizeof(uint32_t) * NAME_INDEX_HEADER
+    || header[0] != NAME_INDEX_MAGIC || header[1] != NAME_INDEX_VERSION
+    || header[4] != NAME_INDEX_BUCKETS)
+    {
+      return NO;
+    }
+  count = header[2];
+  namesLength = header[3];
+  buckets = header[4];
+  postingsLength = header[5];
+  expected = sizeof(uint32_t) * ((uint64_t)NAME_INDEX_HEADER + 2 * (uint64_t)count
+    + 2 * (uint64_t)buckets + 2) + namesLength + postingsLength;
+  if ((uint64_t)length != expected || (namesLength & 3) != 0)
+    {
+      return NO;
+    }
+
+  codepoints = header + NAME_INDEX_HEADER;
+  nameOffsets = codepoints + count;
+  bucketOffsets = nameOffsets + count + 1;
+  bucketCounts = bucketOffsets + buckets + 1;
+  names = (const char *)(bucketCounts + buckets);
+  postings = (const uint8_t *)names + namesLength;
+
+  /* Code points are sorted, and each name ends with a nul before the
+   * next one starts.
+   */
+  if (nameOffsets[0] != 0 || nameOffsets[count] > namesLength)
+    {
+      return NO;
+    }
+  for (i = 0; i < count; i++)
+    {
+      if ((i > 0 && codepoints[i] <= codepoints[i - 1])
+        || codepoints[i] > UCHAR_MAX_VALUE
+        || nameOffsets[i + 1] <= nameOffsets[i]
+        || names[nameOffsets[i + 1] - 1] != '\0')
+        {
+          return NO;
+        }
+    }
+
+  /* Buckets follow each other in the postings and decode to as many
+   * entries as they claim to hold.
+   */
+  if (bucketOffsets[0] != 0 || bucketOffsets[buckets] != postingsLength)
+    {
+      return NO;
+    }
+  for (i = 0; i < buckets; i++)
+    {
+      if (bucketOffsets[i + 1] < bucketOffsets[i]
+        || !ValidPostings(postings + bucketOffsets[i],
+                          postings + bucketOffsets[i + 1],
+                          bucketCounts[i], count))
+        {
+          return NO;
+        }
+    }
+
+  idx->data = RETAIN(data);
+  idx->count = count;
+  idx->codepoints = codepoints;
+  idx->nameOffsets = nameOffsets;
+  idx->bucketOffsets = bucketOffsets;
+  idx->bucketCounts = bucketCounts;
+  idx->names = names;
+  idx->postings = postings;
+  return YES;
+}
+
+static GSCharacterNameIndex *SharedCharacterNameIndex(void)
+{
+  static GSCharacterNameIndex idx;
+  static BOOL loaded = NO;
+
+  if (!loaded)
+    {
+      NSArray *dirs;
+      NSString *path = nil;
+      NSData *data = nil;
+
+      dirs = NSSearchPathForDirectoriesInDomains(NSCachesDirectory,
+                                                 NSUserDomainMask, YES);
+      if ([dirs count] > 0)
+        {
+          path = [[dirs objectAtIndex: 0] stringByAppendingPathComponent:
+            [NSString stringWithFormat: @"GSCharacterNames-%s.index",
+                      U_ICU_VERSION]];
+          data = [NSData dataWithContentsOfMappedFile: path];
+        }
+      if (data == nil || !ParseCharacterNameIndex(data, &idx))
+        {
+          data = BuildCharacterNameIndex();
+          if (path != nil)
+            {
+              [[NSFileManager defaultManager]
+                createDirectoryAtPath: [path stringByDeletingLastPathComponent]
+                withIntermediateDirectories: YES
+                attributes: nil
+                error: NULL];
+              [data writeToFile: path atomically: YES];
+            }
+          ParseCharacterNameIndex(data, &idx);
+        }
+      loaded = YES;
+    }
+  return &idx;
+}
+
+// Lists of code points
+
+/*
+ * Sets of code points are kept as sorted arrays of uint32_t in an NSData,
+ * so the code point shown in a row (select) is found by indexing and the
+ * row of a code point (rank) by binary search.
+ */
+
+static NSData *AssignedCodepoints()
+{
+  GSCharacterNameIndex *idx = SharedCharacterNameIndex();
+
+  return [NSData dataWithBytesNoCopy: (void *)idx->codepoints
+                              length: idx->count * sizeof(uint32_t)
+                        freeWhenDone: NO];
+}
+
+static NSUInteger CodepointCount(NSData *list)
+{
+  return [list length] / sizeof(uint32_t);
+}
+
+static NSUInteger RowOfCodepoint(NSData *list, uint32_t cp)
+{
+  const uint32_t *codepoints = [list bytes];
+  NSUInteger low = 0;
+  NSUInteger high = CodepointCount(list);
 
-  u_enumCharNames(UCHAR_MIN_VALUE, UCHAR_MAX_VALUE + 1, searchCharNamesFn, &ctx, U_UNICODE_CHAR_NAME, &err);
+  while (low < high)
+    {
+      NSUInteger mid = (low + high) / 2;
+
+      if (codepoints[mid] < cp)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+  if (low < CodepointCount(list) && codepoints[low] == cp)
+    {
+      return low;
+    }
+  return NSNotFound;
+}
+
+// Searching for codepoints
+
+static NSData *CodepointsWithNameContainingSubstring(NSString *str)
+{
+  GSCharacterNameIndex *idx = SharedCharacterNameIndex();
+  NSMutableData *set = [NSMutableData data];
+  const char *query = [[str uppercaseString] UTF8String];
+  size_t len = strlen(query);
+  uint32_t i;
+
+  if (idx->data == nil)
+    {
+      return set;
+    }
+  if (len < 3)
+    {
+      for (i = 0; i < idx->count; i++)
+        {
+          if (strstr(idx->names + idx->nameOffsets[i], query) != NULL)
+            {
+              [set appendBytes: &idx->codepoints[i] length: sizeof(uint32_t)];
+            }
+        }
+    }
+  else
+    {
+      uint32_t best = trigramAt(query);
+      const uint8_t *p;
+      const uint8_t *end;
+      uint32_t entry = 0;
+
+      /* Every match contains all trigrams of the query, so checking the
+       * names in the smallest bucket is enough.
+       */
+      for (i = 1; i + 2 < len; i++)
+        {
+          uint32_t b = trigramAt(query + i);
+
+          if (idx->bucketCounts[b] < idx->bucketCounts[best])
+            {
+              best = b;
+            }
+        }
+      p = idx->postings + idx->bucketOffsets[best];
+      end = idx->postings + idx->bucketOffsets[best + 1];
+      while (p < end)
+        {
+          entry += readVarint(&p);
+          if (strstr(idx->names + idx->nameOffsets[entry], query) != NULL)
+            {
+              [set appendBytes: &idx->codepoints[entry]
+                        length: sizeof(uint32_t)];
+            }
+        }
+    }
 	
-  return ctx.set;
+  return set;
 }
 
 
 @implementation GSCharacterPanel 
 
-- (void)setVisibleCodepoints: (NSIndexSet*)set
+- (void)setVisibleCodepoints: (NSData*)set
 {
   ASSIGN(visibleCodepoints, set);
 }
@@ -249,6 +719,13 @@ static NSIndexSet *CodepointsWithNameContainingSubstring(NSString *str)
 - (void)search: (id)sender
 {
   NSString *str = [searchfield stringValue];
+  NSInteger selected = [table selectedRow];
+  NSUInteger selectedCodepoint = NSNotFound;
+
+  if (selected >= 0)
+    {
+      selectedCodepoint = [self codepointAtVisibleRow: selected];
+    }
 	
   if ([str length] == 0)
     {
@@ -256,34 +733,38 @@ static NSIndexSet *CodepointsWithNameContainingSubstring(NSString *str)
     }
   else
     {
-      NSIndexSet *set = CodepointsWithNameContainingSubstring(str);
+      NSData *set = CodepointsWithNameContainingSubstring(str);
       [self setVisibleCodepoints: set];
     }
 	
   [table reloadData];
+
+  // Keep the selected character selected if it is still visible
+  if (selectedCodepoint != NSNotFound)
+    {
+      NSUInteger row = RowOfCodepoint(visibleCodepoints, selectedCodepoint);
+
+      if (row != NSNotFound)
+	{
+	  [table selectRowIndexes: [NSIndexSet indexSetWithIndex: row]
+	     byExtendingSelection: NO];
+	  [table scrollRowToVisible: row];
+	}
+    }
 }
 
 - (NSUInteger) codepointAtVisibleRow:(NSUInteger)row
 {
-  //FIXME: Use a binary search
-  NSUInteger curr = 0;
-  NSUInteger currValue = [visibleCodepoints firstIndex];
-	
-  while (currValue != NSNotFound)
+  if (row < CodepointCount(visibleCodepoints))
     {
-      if (curr == row)
-	{
-	  return currValue;
-	}
-      currValue = [visibleCodepoints indexGreaterThanIndex: currValue];
-      curr++;
+      return ((const uint32_t *)[visibleCodepoints bytes])[row];
     }
   return NSNotFound;
 }
 
 - (NSString *)characterForRow: (NSInteger)row
 {
-  if (row >= 0 && row < [visibleCodepoints count])
+  if (row >= 0 && row < CodepointCount(visibleCodepoints))
     {
       UChar32 utf32 = [self codepointAtVisibleRow: row];
       UChar utf16buf[2];
@@ -315,7 +796,7 @@ static NSIndexSet *CodepointsWithNameContainingSubstring(NSString *str)
 
 - (NSInteger)numberOfRowsInTableView:(NSTableView *)tableView
 {
-  return [visibleCodepoints count];
+  return CodepointCount(visibleCodepoints);
 }
 
 - (id)tableView:(NSTableView *)tableView objectValueForTableColumn:(NSTableColumn *)tableColumn row:(NSInteger)row
@@ -417,6 +417,19 @@ GSCurrentServer(void)
   return 0;
 }
 
+/** Backends can override this method to return the windows on the screen,
+    including those of other applications, as GSWindowStackEntry records
+    ordered front to back.  The drag view hit tests this snapshot locally
+    instead of calling -findWindowAt:windowRef:excluding: for every mouse
+    motion.
+    The default implementation returns nil, meaning no snapshot is
+    available.
+ */
+- (NSData *) onScreenWindowStack
+{
+  return nil;
+}
+
 /* Screen information */
 /** Returns the resolution, in points, for the indicated screen of the
     display. */
@@ -31,6 +31,7 @@
    Boston, MA 02110-1301, USA.
 */
 
+#import <Foundation/NSData.h>
 #import <Foundation/NSDebug.h>
 #import <Foundation/NSDictionary.h>
 #import <Foundation/NSThread.h>
@@ -52,6 +53,10 @@
 /* Size of the dragged window */
 #define	DWZ	48
 
+/* Longest time a window stack snapshot is trusted, in seconds.  We see
+   our own windows move, but not those of other applications.  */
+#define WINDOW_STACK_LIFETIME 0.5
+
 #define SLIDE_TIME_STEP   .02   /* in seconds */
 #define SLIDE_NR_OF_STEPS 20  
 
@@ -62,6 +67,10 @@
 - (void) _postAndSendEvent: (NSEvent *)anEvent;
 @end
 
+@interface NSWindow (GNUstepPrivate)
+- (BOOL) _wantsPeriodicDraggingUpdates;
+@end
+
 @interface NSCursor (BackendPrivate)
 - (void *)_cid;
 - (void) _setCid: (void *)val;
@@ -79,6 +88,10 @@
 	position: (NSPoint)eventLocation
        timestamp: (NSTimeInterval)time
 	toWindow: (NSWindow*)dWindow;
+- (void) _sendUpdateWithAction: (NSDragOperation)action
+		       position: (NSPoint)eventLocation
+		      timestamp: (NSTimeInterval)time
+			  force: (BOOL)force;
 - (void) _handleDrag: (NSEvent*)theEvent slidePoint: (NSPoint)slidePoint;
 - (void) _handleEventDuringDragging: (NSEvent *)theEvent;
 - (void) _updateAndMoveImageToCorrectPosition;
@@ -261,6 +274,8 @@ static	GSDragView *sharedDragView = nil;
   targetWindowRef = 0;
   targetMask = NSDragOperationEvery;
   destExternal = NO;
+  lastUpdateWindowRef = 0;
+  windowStackTime = 0;
 
   NSDebugLLog(@"NSDragging", @"Start drag with %@", [pboard types]);
 
@@ -290,6 +305,7 @@ static	GSDragView *sharedDragView = nil;
   isDragging = NO;
   DESTROY(dragSource);
   DESTROY(dragPasteboard);
+  DESTROY(windowStack);
 }
 
 - (void) slideDraggedImageTo:  (NSPoint)point
@@ -358,12 +374,42 @@ static	GSDragView *sharedDragView = nil;
 - (NSWindow*) windowAcceptingDnDunder: (NSPoint)mouseLocation
                             windowRef: (int*)mouseWindowRef
 {
+  GSDisplayServer *server = GSServerForWindow(_window);
+  NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
   NSInteger win;
 
+  if (windowStackTime == 0 || now - windowStackTime > WINDOW_STACK_LIFETIME)
+    {
+      ASSIGN(windowStack, [server onScreenWindowStack]);
+      windowStackTime = now;
+    }
+
   *mouseWindowRef = 0;
-  win = [GSServerForWindow(_window) findWindowAt: mouseLocation
-				       windowRef: mouseWindowRef
-				       excluding: [_window windowNumber]];
+  if (windowStack != nil)
+    {
+      const GSWindowStackEntry *entries = [windowStack bytes];
+      NSUInteger count = [windowStack length] / sizeof(GSWindowStackEntry);
+      int dragWindow = [_window windowNumber];
+      NSUInteger i;
+
+      win = 0;
+      for (i = 0; i < count; i++)
+        {
+          if (entries[i].window != dragWindow
+            && NSPointInRect(mouseLocation, entries[i].frame))
+            {
+              win = entries[i].window;
+              *mouseWindowRef = entries[i].windowRef;
+              break;
+            }
+        }
+    }
+  else
+    {
+      win = [server findWindowAt: mouseLocation
+                       windowRef: mouseWindowRef
+                       excluding: [_window windowNumber]];
+    }
 
   return GSWindowWithNumber(win);
 }
@@ -553,6 +599,48 @@ static	GSDragView *sharedDragView = nil;
   [NSApp _postAndSendEvent: e];
 }
 
+/*
+  Send a dragging update to the current target, unless it would repeat
+  the last one sent.  Set force to send it regardless, as a periodic update.
+*/
+- (void) _sendUpdateWithAction: (NSDragOperation)action
+		       position: (NSPoint)eventLocation
+		      timestamp: (NSTimeInterval)time
+			  force: (BOOL)force
+{
+  if (targetWindowRef == 0)
+    {
+      return;
+    }
+  if (!force
+    && lastUpdateWindowRef == targetWindowRef
+    && lastUpdateAction == action
+    && NSEqualPoints(lastUpdatePosition, eventLocation))
+    {
+      return;
+    }
+
+  lastUpdateWindowRef = targetWindowRef;
+  lastUpdateAction = action;
+  lastUpdatePosition = eventLocation;
+  if (destWindow != nil)
+    {
+      [self _sendLocalEvent: GSAppKitDraggingUpdate
+                     action: action
+                   position: eventLocation
+                  timestamp: time
+                   toWindow: destWindow];
+    }
+  else
+    {
+      [self sendExternalEvent: GSAppKitDraggingUpdate
+                       action: action
+                     position: eventLocation
+                    timestamp: time
+                     toWindow: targetWindowRef];
+    }
+}
+
 /*
   The dragging support works by hijacking the NSApp event loop.
 
@@ -743,6 +831,11 @@ static	GSDragView *sharedDragView = nil;
         {
         case GSAppKitWindowMoved:
         case GSAppKitWindowResized:
+          /*
+           * The window stack snapshot no longer matches the screen.
+           */
+          windowStackTime = 0;
+          /* Fall through */
         case GSAppKitRegionExposed:
           /*
            * Keep window up-to-date with its current position.
@@ -793,22 +886,10 @@ static	GSDragView *sharedDragView = nil;
         {
           // If flags change, send update to allow
           // destination to take note.
-          if (destWindow)
-            {
-              [self _sendLocalEvent: GSAppKitDraggingUpdate
-                             action: dragMask & operationMask
-                           position: newPosition
-                          timestamp: [theEvent timestamp]
-                           toWindow: destWindow];
-            }
-          else
-            {
-              [self sendExternalEvent: GSAppKitDraggingUpdate
-                               action: dragMask & operationMask
+          [self _sendUpdateWithAction: dragMask & operationMask
                              position: newPosition
                             timestamp: [theEvent timestamp]
-                             toWindow: targetWindowRef];
-            }
+                                force: NO];
           [self _setCursor];
         }
       break;
@@ -818,21 +899,15 @@ static	GSDragView *sharedDragView = nil;
         {
           [self _updateAndMoveImageToCorrectPosition];
         }
-      else if (destWindow)
-        {
-	  [self _sendLocalEvent: GSAppKitDraggingUpdate
-                         action: dragMask & operationMask
-                       position: newPosition
-                      timestamp: [theEvent timestamp]
-                       toWindow: destWindow];
-	}
       else
         {
-          [self sendExternalEvent: GSAppKitDraggingUpdate
-                           action: dragMask & operationMask
-                         position: newPosition
-                        timestamp: [theEvent timestamp]
-                         toWindow: targetWindowRef];
+          /* Nothing has changed, so only destinations that want
+           * periodic updates (e.g. to autoscroll) get one.
+           */
+          [self _sendUpdateWithAction: dragMask & operationMask
+                             position: newPosition
+                            timestamp: [theEvent timestamp]
+                                force: [destWindow _wantsPeriodicDraggingUpdates]];
         }
       break;
     default:
@@ -929,23 +1004,10 @@ static	GSDragView *sharedDragView = nil;
       // same window, sending update
       NSDebugLLog(@"NSDragging", @"sending dnd pos\n");
 
-      // FIXME: We should only send this when the destination wantsPeriodicDraggingUpdates
-      if (destWindow != nil)
-        {
-          [self _sendLocalEvent: GSAppKitDraggingUpdate
-                         action: dragMask & operationMask
-                       position: dragPosition
-                      timestamp: dragSequence
-                       toWindow: destWindow];
-        }
-      else 
-        {
-          [self sendExternalEvent: GSAppKitDraggingUpdate 
-                           action: dragMask & operationMask
+      [self _sendUpdateWithAction: dragMask & operationMask
                          position: dragPosition
                         timestamp: dragSequence
-                         toWindow: targetWindowRef];
-        }
+                            force: NO];
     }
   else if (mouseWindowRef != 0)
     {
@@ -969,6 +1031,9 @@ static	GSDragView *sharedDragView = nil;
                         timestamp: dragSequence
                          toWindow: mouseWindowRef];
         }
+      lastUpdateWindowRef = mouseWindowRef;
+      lastUpdateAction = dragMask;
+      lastUpdatePosition = dragPosition;
     }
 
   if (targetWindowRef != mouseWindowRef)
@@ -42,6 +42,12 @@
  */
 NSBundle *GSGuiBundle (void);
 
+/*
+ * Invalidate the device colours cached by named colours, because a colour
+ * list or the theme changed.  Implemented in Source/NSColor.m
+ */
+void GSInvalidateColorCaches (void);
+
 /*
  * Localize a message of the gnustep-gui library.  
  */
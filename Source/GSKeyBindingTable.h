@@ -80,6 +80,12 @@ struct _GSKeyBinding
   
   /* The length of the array of bindings.  */
   int _bindingsCount;
+
+  /* Open addressing hash table of the bindings, keyed by character
+   * and modifiers.  Each slot holds an index into _bindings plus one,
+   * or 0 if it is free.  The number of slots is _slotsMask + 1.  */
+  int *_slots;
+  unsigned int _slotsMask;
 }
 /* Load all the bindings from this dictionary.  The dictionary binds
    keys to actions, as described below under bindKey:toAction:.  The
@@ -97,6 +103,17 @@ struct _GSKeyBinding
  */
 - (void) bindKey: (id)key  toAction: (id)action;
 
+/* Parse the keys of a dictionary of bindings, as accepted by
+ * loadBindingsFromDictionary:, and return the bindings as an array
+ * which only contains property list objects, so that it can be
+ * stored.  Loading the array with loadCompiledBindings: has the same
+ * effect as loading the dictionary, without parsing the keys again.
+ */
++ (NSArray *) compileBindingsFromDictionary: (NSDictionary *)dict;
+
+/* Load bindings returned by compileBindingsFromDictionary:.  */
+- (void) loadCompiledBindings: (NSArray *)bindings;
+
 /* The input manager calls this when it wants to look up a keybinding
  * in the table.  The method returns YES if the keybinding is in the
  * table, or NO if it's not.  If it is in the table, it returns the
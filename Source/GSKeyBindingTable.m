@@ -24,107 +24,269 @@
    Boston, MA 02110-1301, USA.
 */ 
 
+
 #import "AppKit/NSEvent.h"
 #import "AppKit/NSInputManager.h"
 #import "GSKeyBindingAction.h"
 #import "GSKeyBindingTable.h"
 
-@implementation GSKeyBindingTable : NSObject
-
-- (void) loadBindingsFromDictionary: (NSDictionary *)dict
+/* The kinds of action in a compiled binding.  */
+enum
 {
-  NSEnumerator *e;
-  id key;
-  
-  e = [dict keyEnumerator];
-  while ((key = [e nextObject]) != nil)
-    {
-      [self bindKey: key  toAction: [dict objectForKey: key]];
-    }
-}
+  GSCompiledSelector = 0,	/* A selector name, or "" to disable.  */
+  GSCompiledSelectorArray = 1,	/* An array of selector names.  */
+  GSCompiledTable = 2		/* An array of compiled bindings.  */
+};
 
-- (void) bindKey: (id)key  toAction: (id)action
+/* Turns a key which is an array of keystrokes into its first keystroke,
+ * and the action into a dictionary of bindings for the other ones.  Eg,
+ * key ("Control-x", "Control-s", "Control-k") action "moveUp:" gets
+ * converted into: key "Control-x" action { "Control-s" = {
+ * "Control-k" = "moveUp:"; }; }.  Returns NO if key should be ignored.
+ */
+static BOOL
+splitKeySequence(id *key, id *action)
 {
-  unichar character;
-  unsigned int modifiers;
-  GSKeyBindingAction *a = nil;
-  GSKeyBindingTable *t = nil;
-  BOOL isTable = NO;
-  int i;
-
-  /* First, try to determine what exactly is key :-) ... it might
-     either be a simple string, "Control-f", or an array,
-     ("Control-x", "Control-s").  We implement the case of arrays in
-     terms of the case of strings.  */
-  if ([key isKindOfClass: [NSArray class]])
+  if ([*key isKindOfClass: [NSArray class]])
     {
-      if ([(NSArray *)key count] == 0)
+      NSArray *keys = *key;
+      id value = *action;
+      int j;
+
+      if ([keys count] == 0)
 	{
 	  /* Ignore them.  */
-	  return;
+	  return NO;
 	}
-      else if ([(NSArray *)key count] == 1)
+
+      /* Start from the end of the array, and build the temporary
+	 dictionary structure going backwards.  */
+      for (j = [keys count] - 1; j > 0; j--)
 	{
-	  key = [key objectAtIndex: 0];
-	}
-      else
-	{
-	  /* Ok - simply convert that into a temporary dictionary
-	     representation and store that.  Eg, key ("Control-x",
-	     "Control-s", "Control-k") action "moveUp:" gets converted
-	     into: key "Control-x" action { "Control-s" = {
-	     "Control-k" = "moveUp:"; }; }.  */
-
-	  /* Now start from the end of the array, and start building
-	     the temporary dictionary structure going backwards.  */
-	  id value = action;
-	  int j;
-
-	  for (j = [key count] - 1; j > 0; j--)
-	    {
-	      NSMutableDictionary *tmp = [NSMutableDictionary dictionary];
-	      [tmp setObject: value  forKey: [key objectAtIndex: j]];
-	      value = tmp;
-	    }
-	  key = [key objectAtIndex: 0];
-	  action = value;
+	  NSMutableDictionary *tmp = [NSMutableDictionary dictionary];
+	  [tmp setObject: value  forKey: [keys objectAtIndex: j]];
+	  value = tmp;
 	}
+      *key = [keys objectAtIndex: 0];
+      *action = value;
     }
-  
 
-  if (![key isKindOfClass: [NSString class]])
+  if (![*key isKindOfClass: [NSString class]])
     {
-      NSLog (@"GSKeyBindingTable - key %@ is not a NSString!", key);
-      return;
+      NSLog (@"GSKeyBindingTable - key %@ is not a NSString!", *key);
+      return NO;
     }
-  
-  if (![NSInputManager parseKey: (NSString *)key 
-		       intoCharacter: &character
-		       andModifiers: &modifiers])
+  return YES;
+}
+
+/* Parses a keystroke, keeping only the modifiers bindings are looked
+ * up with.  */
+static BOOL
+parseKeyStroke(NSString *key, unichar *character, unsigned int *modifiers)
+{
+  if (![NSInputManager parseKey: key
+		  intoCharacter: character
+		   andModifiers: modifiers])
     {
       NSLog (@"GSKeyBindingTable - Could not bind key %@", key);
-      return;
+      return NO;
     }
 
   /* If it is not a function key, we automatically ignore the Shift
    * modifier.  You shouldn't use it unless you are describing a modification
    * of a function key.  The NSInputManager will ignore Shift modifiers
    * as well for non-function keys.  */
-  if (modifiers & NSFunctionKeyMask)
+  if (*modifiers & NSFunctionKeyMask)
     {
       /* Ignore all other modifiers when storing the keystroke modifiers.  */
-      modifiers = modifiers & (NSShiftKeyMask 
-			       | NSAlternateKeyMask 
-			       | NSControlKeyMask 
-			       | NSNumericPadKeyMask);
+      *modifiers = *modifiers & (NSShiftKeyMask 
+				 | NSAlternateKeyMask 
+				 | NSControlKeyMask 
+				 | NSNumericPadKeyMask);
     }
   else
     {
-      modifiers = modifiers & (NSAlternateKeyMask 
-			       | NSControlKeyMask 
-			       | NSNumericPadKeyMask);
+      *modifiers = *modifiers & (NSAlternateKeyMask 
+				 | NSControlKeyMask 
+				 | NSNumericPadKeyMask);
+    }
+  return YES;
+}
+
+/* The hash of a keystroke.  Modifier masks only use the high bits, so
+ * they are folded in with the character before mixing.  */
+static inline unsigned int
+keyStrokeHash(unichar character, int modifiers)
+{
+  unsigned int h = (unsigned int)character ^ (unsigned int)modifiers;
+
+  h *= 2654435761U;
+  return h ^ (h >> 16);
+}
+
+@interface GSKeyBindingTable (Private)
+- (void) _bindCharacter: (unichar)character
+	      modifiers: (unsigned int)modifiers
+		 action: (GSKeyBindingAction *)a
+	       bindings: (id)bindings;
+- (void) _rehash;
+@end
+
+@implementation GSKeyBindingTable : NSObject
+
+/* Returns the index in _bindings of the binding for the keystroke, or
+ * -1 if there is none.  */
+static inline int
+bindingIndex(GSKeyBindingTable *t, unichar character, int modifiers)
+{
+  unsigned int i;
+  int b;
+
+  if (t->_slots == NULL)
+    {
+      return -1;
+    }
+  i = keyStrokeHash(character, modifiers) & t->_slotsMask;
+  while ((b = t->_slots[i]) != 0)
+    {
+      struct _GSKeyBinding *binding = &t->_bindings[b - 1];
+
+      if (binding->character == character && binding->modifiers == modifiers)
+	{
+	  return b - 1;
+	}
+      i = (i + 1) & t->_slotsMask;
+    }
+  return -1;
+}
+
++ (NSArray *) compileBindingsFromDictionary: (NSDictionary *)dict
+{
+  NSMutableArray *compiled;
+  NSEnumerator *e;
+  id key;
+
+  compiled = [NSMutableArray arrayWithCapacity: [dict count]];
+  e = [dict keyEnumerator];
+  while ((key = [e nextObject]) != nil)
+    {
+      id action = [dict objectForKey: key];
+      unichar character;
+      unsigned int modifiers;
+      int kind;
+
+      if (!splitKeySequence(&key, &action)
+	|| !parseKeyStroke(key, &character, &modifiers))
+	{
+	  continue;
+	}
+
+      if ([action isKindOfClass: [NSString class]])
+	{
+	  kind = GSCompiledSelector;
+	}
+      else if ([action isKindOfClass: [NSArray class]])
+	{
+	  kind = GSCompiledSelectorArray;
+	}
+      else if ([action isKindOfClass: [NSDictionary class]])
+	{
+	  kind = GSCompiledTable;
+	  action = [self compileBindingsFromDictionary: action];
+	}
+      else
+	{
+	  /* Action objects can't be compiled ... only property lists
+	     can.  */
+	  NSLog (@"GSKeyBindingTable - Could not compile action %@", action);
+	  continue;
+	}
+      [compiled addObject: [NSArray arrayWithObjects:
+	[NSNumber numberWithUnsignedInt: character],
+	[NSNumber numberWithUnsignedInt: modifiers],
+	[NSNumber numberWithInt: kind],
+	action, nil]];
     }
+  return compiled;
+}
 
+- (void) loadCompiledBindings: (NSArray *)bindings
+{
+  NSEnumerator *e;
+  NSArray *binding;
+
+  e = [bindings objectEnumerator];
+  while ((binding = [e nextObject]) != nil)
+    {
+      unichar character;
+      unsigned int modifiers;
+      id action;
+      GSKeyBindingAction *a = nil;
+
+      if (![binding isKindOfClass: [NSArray class]] || [binding count] != 4)
+	{
+	  continue;
+	}
+      character = [[binding objectAtIndex: 0] unsignedIntValue];
+      modifiers = [[binding objectAtIndex: 1] unsignedIntValue];
+      action = [binding objectAtIndex: 3];
+
+      switch ([[binding objectAtIndex: 2] intValue])
+	{
+	  case GSCompiledSelector:
+	    if (![(NSString *)action isEqualToString: @""])
+	      {
+		a = [[GSKeyBindingActionSelector alloc] 
+		      initWithSelectorName: (NSString *)action];
+		AUTORELEASE (a);
+	      }
+	    [self _bindCharacter: character  modifiers: modifiers
+			  action: a  bindings: nil];
+	    break;
+
+	  case GSCompiledSelectorArray:
+	    a = [[GSKeyBindingActionSelectorArray alloc]
+		  initWithSelectorNames: (NSArray *)action];
+	    AUTORELEASE (a);
+	    [self _bindCharacter: character  modifiers: modifiers
+			  action: a  bindings: nil];
+	    break;
+
+	  case GSCompiledTable:
+	    [self _bindCharacter: character  modifiers: modifiers
+			  action: nil  bindings: action];
+	    break;
+	}
+    }
+}
+
+- (void) loadBindingsFromDictionary: (NSDictionary *)dict
+{
+  NSEnumerator *e;
+  id key;
+  
+  e = [dict keyEnumerator];
+  while ((key = [e nextObject]) != nil)
+    {
+      [self bindKey: key  toAction: [dict objectForKey: key]];
+    }
+}
+
+- (void) bindKey: (id)key  toAction: (id)action
+{
+  unichar character;
+  unsigned int modifiers;
+  GSKeyBindingAction *a = nil;
+
+  /* First, try to determine what exactly is key :-) ... it might
+     either be a simple string, "Control-f", or an array,
+     ("Control-x", "Control-s").  We implement the case of arrays in
+     terms of the case of strings.  */
+  if (!splitKeySequence(&key, &action)
+    || !parseKeyStroke((NSString *)key, &character, &modifiers))
+    {
+      return;
+    }
 
   /* Now build the associated action/table.  */
   if ([action isKindOfClass: [NSString class]])
@@ -154,122 +316,167 @@
 	 later on when we know if we need to create a new
 	 GSKeyBindingTable or if we need to merge them into an
 	 existing one.  */
-      isTable = YES;
+      [self _bindCharacter: character  modifiers: modifiers
+		    action: nil  bindings: action];
+      return;
     }
   else if ([action isKindOfClass: [GSKeyBindingAction class]])
     {
       a = action;
     }
 
-  /* Ok - at this point, we have all the elements ready, we just need
-     to insert into the table.  */
-    
-  /* Check if there are already some bindings for this keystroke.  */
-  for (i = 0; i < _bindingsCount; i++)
-    {
-      if ((_bindings[i].character == character)  
-	  &&  (_bindings[i].modifiers == modifiers))
-	{
-	  /* Replace/override the existing action with the new one if
-	     it's an action, or load the bindings into a (new or
-	     existing) table if it's a table.  */
-	  if (isTable)
-	    {
-	      /* If there was already a table, add keybindings to that
-		 table.  */
-	      if (_bindings[i].table != nil)
-		{
-		  t = _bindings[i].table;
-		}
-	      else
-		{
-		  /* Else, create a new one.  */
-		  t = [[GSKeyBindingTable alloc] init];
-		  AUTORELEASE (t);
-		}
-	      [t loadBindingsFromDictionary: (NSDictionary *)action];
-	    }
+  [self _bindCharacter: character  modifiers: modifiers
+		action: a  bindings: nil];
+}
 
-	  ASSIGN (_bindings[i].action, a);
-	  ASSIGN (_bindings[i].table, t);
-	  return;
-	}
-    }
+- (BOOL) lookupKeyStroke: (unichar)character
+	       modifiers: (int)flags
+       returningActionIn: (GSKeyBindingAction **)action
+		 tableIn: (GSKeyBindingTable **)table
+{
+  int i = bindingIndex(self, character, flags);
 
-  /* Ok - new keystroke.  Create the table if needed.  */
-  if (isTable)
+  if (i < 0)
     {
-      t = [[GSKeyBindingTable alloc] init];
-      AUTORELEASE (t);
-      [t loadBindingsFromDictionary: (NSDictionary *)action];
+      return NO;
     }
-
-  /* Allocate memory for the new binding.  */
-  if (_bindingsCount == 0)
+  if (_bindings[i].action == nil  &&  _bindings[i].table == nil)
     {
-      _bindingsCount = 1;
-      _bindings = malloc (sizeof (struct _GSKeyBinding));
+      /* Found the keybinding, but it is disabled!  */
+      return NO;
     }
-  else
+  *action = _bindings[i].action;
+  *table = _bindings[i].table;
+  return YES;
+}
+
+- (void) dealloc
+{
+  int i;
+
+  for (i = 0; i < _bindingsCount; i++)
     {
-      _bindingsCount++;
-      _bindings = realloc (_bindings, sizeof (struct _GSKeyBinding) 
-				* _bindingsCount);
+      RELEASE (_bindings[i].action);
+      RELEASE (_bindings[i].table);
     }
-  _bindings[_bindingsCount - 1].character = character;
-  _bindings[_bindingsCount - 1].modifiers = modifiers;
-
-  /* Don't use ASSIGN here because that uses the previous value of
-     _bindings[_bindingsCount - 1] ... which is undefined.  */
-  _bindings[_bindingsCount - 1].action = a;
-  RETAIN (a);
-  _bindings[_bindingsCount - 1].table = t;
-  RETAIN (t);
+  free (_bindings);
+  free (_slots);
+  [super dealloc];
 }
 
-- (BOOL) lookupKeyStroke: (unichar)character
-	       modifiers: (int)flags
-       returningActionIn: (GSKeyBindingAction **)action
-		 tableIn: (GSKeyBindingTable **)table
+@end
+
+@implementation GSKeyBindingTable (Private)
+
+/* Binds the keystroke to the action a, or, if bindings is not nil, to
+ * a table holding bindings (either a dictionary, or an array of
+ * compiled bindings).
+ */
+- (void) _bindCharacter: (unichar)character
+	      modifiers: (unsigned int)modifiers
+		 action: (GSKeyBindingAction *)a
+	       bindings: (id)bindings
 {
+  GSKeyBindingTable *t = nil;
   int i;
-  
-  for (i = 0; i < _bindingsCount; i++)
+
+  /* Check if there are already some bindings for this keystroke.  */
+  i = bindingIndex(self, character, modifiers);
+  if (i >= 0)
     {
-      if (_bindings[i].character == character)
+      /* Replace/override the existing action with the new one if
+	 it's an action, or load the bindings into a (new or
+	 existing) table if it's a table.  */
+      if (bindings != nil)
 	{
-	  if (_bindings[i].modifiers == flags)
+	  /* If there was already a table, add keybindings to that
+	     table.  */
+	  if (_bindings[i].table != nil)
 	    {
-	      if (_bindings[i].action == nil  &&  _bindings[i].table == nil)
-		{
-		  /* Found the keybinding, but it is disabled!  */
-		  return NO;
-		}
-	      else
-		{
-		  *action = _bindings[i].action;
-		  *table = _bindings[i].table;
-		  return YES;
-		}
+	      t = _bindings[i].table;
+	    }
+	  else
+	    {
+	      /* Else, create a new one.  */
+	      t = [[GSKeyBindingTable alloc] init];
+	      AUTORELEASE (t);
 	    }
 	}
     }
-  return NO;
+  else
+    {
+      /* Ok - new keystroke.  Create the table if needed.  */
+      if (bindings != nil)
+	{
+	  t = [[GSKeyBindingTable alloc] init];
+	  AUTORELEASE (t);
+	}
+
+      _bindings = realloc (_bindings, sizeof (struct _GSKeyBinding) 
+				* (_bindingsCount + 1));
+      i = _bindingsCount++;
+      _bindings[i].character = character;
+      _bindings[i].modifiers = modifiers;
+      _bindings[i].action = nil;
+      _bindings[i].table = nil;
+
+      /* Keep the hash table at most half full.  */
+      if ((unsigned int)_bindingsCount * 2 > (_slots ? _slotsMask + 1 : 0))
+	{
+	  [self _rehash];
+	}
+      else
+	{
+	  unsigned int s = keyStrokeHash(character, modifiers) & _slotsMask;
+
+	  while (_slots[s] != 0)
+	    {
+	      s = (s + 1) & _slotsMask;
+	    }
+	  _slots[s] = i + 1;
+	}
+    }
+
+  if ([bindings isKindOfClass: [NSDictionary class]])
+    {
+      [t loadBindingsFromDictionary: (NSDictionary *)bindings];
+    }
+  else if (bindings != nil)
+    {
+      [t loadCompiledBindings: (NSArray *)bindings];
+    }
+
+  ASSIGN (_bindings[i].action, a);
+  ASSIGN (_bindings[i].table, t);
 }
 
-- (void) dealloc
+/* Rebuilds the hash table of _bindings, with room for twice as many
+ * bindings as there are.  */
+- (void) _rehash
 {
+  unsigned int size = 16;
   int i;
 
+  while (size < (unsigned int)_bindingsCount * 4)
+    {
+      size *= 2;
+    }
+  free (_slots);
+  _slots = calloc (size, sizeof (int));
+  _slotsMask = size - 1;
+
   for (i = 0; i < _bindingsCount; i++)
     {
-      RELEASE (_bindings[i].action);
-      RELEASE (_bindings[i].table);
+      unsigned int s;
+
+      s = keyStrokeHash(_bindings[i].character, _bindings[i].modifiers)
+	& _slotsMask;
+      while (_slots[s] != 0)
+	{
+	  s = (s + 1) & _slotsMask;
+	}
+      _slots[s] = i + 1;
     }
-  free (_bindings);
-  [super dealloc];
 }
 
 @end
-
-
@@ -36,6 +36,7 @@
 #import <Foundation/NSRunLoop.h>
 #import <Foundation/NSAutoreleasePool.h>
 #import <Foundation/NSTimer.h>
+#import <Foundation/NSValue.h>
 #import <Foundation/NSProcessInfo.h>
 #import <Foundation/NSFileManager.h>
 #import <Foundation/NSConnection.h>
@@ -501,6 +502,16 @@ NSRegisterServicesProvider(id provider, NSString *name)
 static NSString         *servicesName = @".GNUstepServices";
 static NSString         *disabledName = @".GNUstepDisabled";
 
+/* The key under which a combination of send and return type is indexed.
+ */
+static NSString *
+typesKey(NSString *sendType, NSString *returnType)
+{
+  return [NSString stringWithFormat: @"%@\n%@",
+    (sendType == nil) ? (id)@"" : (id)sendType,
+    (returnType == nil) ? (id)@"" : (id)returnType];
+}
+
 /**
  *      Create a new listener for this application.
  *      Uses NSRegisterServicesProvider() to register itsself as a service
@@ -709,6 +720,11 @@ static NSString         *disabledName = @".GNUstepDisabled";
   RELEASE(_servicesStamp);
   RELEASE(_allDisabled);
   RELEASE(_allServices);
+  RELEASE(_title2types);
+  RELEASE(_typePairs);
+  RELEASE(_validTypes);
+  RELEASE(_validEvent);
+  RELEASE(_title2item);
   [super dealloc];
 }
 
@@ -856,6 +872,8 @@ static NSString         *disabledName = @".GNUstepDisabled";
   NSFileManager         *mgr = [NSFileManager defaultManager];
   BOOL			changed = NO;
 
+  _lastLoad = [NSDate timeIntervalSinceReferenceDate];
+
   if ([mgr fileExistsAtPath: _disabledPath])
     {
       NSDictionary	*attr;
@@ -920,9 +938,10 @@ static NSString         *disabledName = @".GNUstepDisabled";
       /* If we have changed the enabled/disabled services,
        * or there have been services added/removed
        * then we must rebuild the services menu to add/remove
-       * items as appropriate.
+       * items as appropriate.  Only the items of services whose
+       * availability changed are touched.
        */
-      [self rebuildServicesMenu];
+      [self rebuildServices];
     }
 }
 
@@ -945,6 +964,62 @@ static NSString         *disabledName = @".GNUstepDisabled";
   return _port;
 }
 
+/**
+ * Records the combinations of send and return types of each usable
+ * service.  Services sharing a combination share its key, so validating
+ * the services menu asks the responder chain once per combination.
+ */
+- (void) _indexTypes
+{
+  NSEnumerator  *enumerator = [_title2info keyEnumerator];
+  NSString      *title;
+
+  if (_title2types == nil)
+    {
+      _title2types = [[NSMutableDictionary alloc] initWithCapacity: 16];
+      _typePairs = [[NSMutableDictionary alloc] initWithCapacity: 16];
+      _validTypes = [[NSMutableDictionary alloc] initWithCapacity: 16];
+    }
+  [_title2types removeAllObjects];
+  [_validTypes removeAllObjects];
+
+  while ((title = [enumerator nextObject]) != nil)
+    {
+      NSDictionary      *info = [_title2info objectForKey: title];
+      NSArray           *sendTypes = [info objectForKey: @"NSSendTypes"];
+      NSArray           *returnTypes = [info objectForKey: @"NSReturnTypes"];
+      unsigned          es = [sendTypes count];
+      unsigned          er = [returnTypes count];
+      NSMutableArray    *keys;
+      unsigned          i, j;
+
+      keys = [NSMutableArray arrayWithCapacity: MAX(es, 1) * MAX(er, 1)];
+      for (i = 0; i < MAX(es, 1); i++)
+        {
+          NSString      *sendType;
+
+          sendType = (es == 0) ? nil : [sendTypes objectAtIndex: i];
+          for (j = 0; j < MAX(er, 1); j++)
+            {
+              NSString  *returnType;
+              NSString  *key;
+
+              returnType = (er == 0) ? nil : [returnTypes objectAtIndex: j];
+              key = typesKey(sendType, returnType);
+              if ([_typePairs objectForKey: key] == nil)
+                {
+                  [_typePairs setObject: [NSArray arrayWithObjects:
+                    (sendType == nil) ? (id)@"" : (id)sendType,
+                    (returnType == nil) ? (id)@"" : (id)returnType, nil]
+                                 forKey: key];
+                }
+              [keys addObject: key];
+            }
+        }
+      [_title2types setObject: keys forKey: title];
+    }
+}
+
 /**
  * Makes the current set of usable services consistent with the
  * data types currently available.
@@ -1020,44 +1095,92 @@ static NSString         *disabledName = @".GNUstepDisabled";
       titles = [_title2info allKeys];
       titles = [titles sortedArrayUsingSelector: @selector(compare:)];
       ASSIGN(_menuTitles, titles);
+      [self _indexTypes];
       [self rebuildServicesMenu];
     }
 }
 
 /** Adds or removes items in the services menu in response to a change
- * in the services which are available to the app.
+ * in the services which are available to the app.  Items of services
+ * which are still available are kept.
  */
 - (void) rebuildServicesMenu
 {
   if (_servicesMenu != nil)
     {
       NSMutableSet      *keyEquivalents;
+      NSMutableSet      *shown;
+      NSEnumerator      *enumerator;
+      NSString          *title;
       unsigned          pos;
-      unsigned          loc0;
+      unsigned          loc0 = 0;
       unsigned          loc1 = 0;
       SEL               sel = @selector(doService:);
       NSMenu            *submenu = nil;
 
       [_servicesMenu setAutoenablesItems: NO];
-      for (pos = [_servicesMenu numberOfItems]; pos > 0; pos--)
+      if (_title2item == nil)
         {
-          [_servicesMenu removeItemAtIndex: 0];
+          /* A new menu, so start from scratch. */
+          for (pos = [_servicesMenu numberOfItems]; pos > 0; pos--)
+            {
+              [_servicesMenu removeItemAtIndex: 0];
+            }
+          _title2item = [[NSMutableDictionary alloc] initWithCapacity: 16];
+        }
+
+      /*
+       *    Remove the items of services which are no longer shown, or
+       *    whose definition has changed, and the submenus left empty.
+       */
+      shown = [NSMutableSet setWithCapacity: [_menuTitles count]];
+      for (pos = 0; pos < [_menuTitles count]; pos++)
+        {
+          title = [_menuTitles objectAtIndex: pos];
+          if ([_allDisabled member: title] == nil)
+            {
+              [shown addObject: title];
+            }
+        }
+      enumerator = [[_title2item allKeys] objectEnumerator];
+      while ((title = [enumerator nextObject]) != nil)
+        {
+          NSMenuItem    *item = [_title2item objectForKey: title];
+
+          if ([shown member: title] == nil
+            || [[item representedObject] isEqual:
+              [_title2info objectForKey: title]] == NO)
+            {
+              NSMenu    *menu = [item menu];
+
+              [menu removeItem: item];
+              if (menu != _servicesMenu && [menu numberOfItems] == 0)
+                {
+                  [_servicesMenu removeItemAtIndex:
+                    [_servicesMenu indexOfItemWithSubmenu: menu]];
+                }
+              [_title2item removeObjectForKey: title];
+            }
         }
       [_servicesMenu setAutoenablesItems: YES];
 
+      /*
+       *    The remaining items are in the order of their titles, so we
+       *    insert the new ones between them as we go.
+       */
       keyEquivalents = [NSMutableSet setWithCapacity: 4];
-      for (loc0 = pos = 0; pos < [_menuTitles count]; pos++)
+      for (pos = 0; pos < [_menuTitles count]; pos++)
         {
-          NSString      *title = [_menuTitles objectAtIndex: pos];
           NSString      *equiv = @"";
           NSDictionary  *info;
           NSDictionary  *titles;
           NSDictionary  *equivs;
           NSRange       r;
           unsigned      lang;
-          id<NSMenuItem>        item;
+          NSMenuItem    *item;
 
-          if (NSShowsServicesMenuItem(title) == NO)
+          title = [_menuTitles objectAtIndex: pos];
+          if ([shown member: title] == nil)
             {
               continue; // We don't want to show this one.
             }
@@ -1099,52 +1222,75 @@ static NSString         *disabledName = @".GNUstepDisabled";
                   equiv = @"";
                 }
             }
+          else
+            {
+              equiv = @"";
+            }
 
+          item = [_title2item objectForKey: title];
           r = [title rangeOfString: @"/"];
           if (r.length > 0)
             {
               NSString  *subtitle = [title substringFromIndex: r.location+1];
               NSString  *parentTitle = [title substringToIndex: r.location];
+              NSMenuItem *parent;
               NSMenu    *menu;
 
-              item = [_servicesMenu itemWithTitle: parentTitle];
-              if (item == nil)
+              parent = (NSMenuItem*)[_servicesMenu itemWithTitle: parentTitle];
+              if (parent == nil)
                 {
-                  loc1 = 0;
-                  item = [_servicesMenu insertItemWithTitle: parentTitle
-                                                    action: 0
-                                             keyEquivalent: @""
-                                                   atIndex: loc0++];
+                  parent = (NSMenuItem*)[_servicesMenu
+                    insertItemWithTitle: parentTitle
+                                 action: 0
+                          keyEquivalent: @""
+                                atIndex: loc0++];
                   menu = [[NSMenu alloc] initWithTitle: parentTitle];
                   [_servicesMenu setSubmenu: menu
-                                   forItem: item];
+                                   forItem: parent];
                   RELEASE(menu);
                 }
               else
                 {
-                  menu = (NSMenu*)[item submenu];
+                  menu = (NSMenu*)[parent submenu];
                 }
               if (menu != submenu)
                 {
                   [submenu sizeToFit];
                   submenu = menu;
+                  loc0 = [_servicesMenu indexOfItem: parent] + 1;
+                  loc1 = 0;
                 }
-              item = [submenu insertItemWithTitle: subtitle
-                                           action: sel
-                                    keyEquivalent: equiv
-                                          atIndex: loc1++];
-              [item setTarget: self];
-              [item setTag: pos];
+              if (item == nil)
+                {
+                  item = (NSMenuItem*)[submenu insertItemWithTitle: subtitle
+                                                            action: sel
+                                                     keyEquivalent: equiv
+                                                           atIndex: loc1];
+                }
+              loc1++;
             }
           else
             {
-              item = [_servicesMenu insertItemWithTitle: title
-                                                action: sel
-                                         keyEquivalent: equiv
-                                               atIndex: loc0++];
+              if (item == nil)
+                {
+                  item = (NSMenuItem*)[_servicesMenu insertItemWithTitle: title
+                                                                  action: sel
+                                                           keyEquivalent: equiv
+                                                                 atIndex: loc0];
+                }
+              loc0++;
+            }
+          if ([_title2item objectForKey: title] == nil)
+            {
               [item setTarget: self];
-              [item setTag: pos];
+              [item setRepresentedObject: info];
+              [_title2item setObject: item forKey: title];
             }
+          else if ([[item keyEquivalent] isEqual: equiv] == NO)
+            {
+              [item setKeyEquivalent: equiv];
+            }
+          [item setTag: pos];
         }
       [submenu update];
 //      [submenu sizeToFit];
@@ -1315,6 +1461,7 @@ static NSString         *disabledName = @".GNUstepDisabled";
 - (void) setServicesMenu: (NSMenu*)aMenu
 {
   ASSIGN(_servicesMenu, aMenu);
+  DESTROY(_title2item);
   [self rebuildServicesMenu];
 }
 
@@ -1350,7 +1497,14 @@ static NSString         *disabledName = @".GNUstepDisabled";
 
 - (BOOL) showsServicesMenuItem: (NSString*)item
 {
-  [self loadServices];
+  /* This is called for every menu item shown, so don't look at the
+   * files more than once a second.
+   */
+  if (_allServices == nil
+    || [NSDate timeIntervalSinceReferenceDate] - _lastLoad >= 1.0)
+    {
+      [self loadServices];
+    }
   if ([_allDisabled member: item] == nil)
     return YES;
   return NO;
@@ -1359,13 +1513,10 @@ static NSString         *disabledName = @".GNUstepDisabled";
 - (BOOL) validateMenuItem: (id<NSMenuItem>)item
 {
   NSString      *title = [self item2title: item];
-  NSDictionary  *info = [_title2info objectForKey: title];
-  NSArray       *sendTypes = [info objectForKey: @"NSSendTypes"];
-  NSArray       *returnTypes = [info objectForKey: @"NSReturnTypes"];
-  unsigned      i, j;
-  unsigned      es = [sendTypes count];
-  unsigned      er = [returnTypes count];
+  NSArray       *keys = [_title2types objectForKey: title];
   NSResponder	*resp = [[_application keyWindow] firstResponder];
+  NSEvent       *event = [_application currentEvent];
+  unsigned      i;
 
   /*
    *    If the menu item is not in our map, it must be the item containing
@@ -1397,62 +1548,54 @@ static NSString         *disabledName = @".GNUstepDisabled";
 
   /*
    *    The item corresponds to one of our services - so we check to see if
-   *    there is anything that can deal with it.
+   *    there is anything that can deal with one of its combinations of
+   *    types.  What the responder chain said about a combination is kept
+   *    until the responder or the event changes, as all the services
+   *    menu items are validated in a row.  The responder is not retained,
+   *    it is only compared with and forgotten after each event.
    */
-  if (es == 0)
+  if (resp != _validResponder || event != _validEvent)
     {
-      if (er == 0)
-	{
-	  if ([resp validRequestorForSendType: nil
-				   returnType: nil] != nil)
-	    return YES;
-	}
-      else
-	{
-	  for (j = 0; j < er; j++)
-	    {
-	      NSString      *returnType;
-
-	      returnType = [returnTypes objectAtIndex: j];
-	      if ([resp validRequestorForSendType: nil
-				       returnType: returnType] != nil)
-		return YES;
-	    }
-	}
+      [_validTypes removeAllObjects];
+      _validResponder = resp;
+      ASSIGN(_validEvent, event);
     }
-  else
+  for (i = 0; i < [keys count]; i++)
     {
-      for (i = 0; i < es; i++)
-	{
-	  NSString  *sendType;
-
-	  sendType = [sendTypes objectAtIndex: i];
+      NSString  *key = [keys objectAtIndex: i];
+      NSNumber  *valid = [_validTypes objectForKey: key];
 
-	  if (er == 0)
-	    {
-	      if ([resp validRequestorForSendType: sendType
-				       returnType: nil] != nil)
-		return YES;
-	    }
-	  else
-	    {
-	      for (j = 0; j < er; j++)
-		{
-		  NSString      *returnType;
-
-		  returnType = [returnTypes objectAtIndex: j];
-		  if ([resp validRequestorForSendType: sendType
-					   returnType: returnType] != nil)
-		    return YES;
-		}
-	    }
-	}
+      if (valid == nil)
+        {
+          NSArray       *types = [_typePairs objectForKey: key];
+          NSString      *sendType = [types objectAtIndex: 0];
+          NSString      *returnType = [types objectAtIndex: 1];
+          id            requestor;
+
+          requestor = [resp validRequestorForSendType:
+                              ([sendType length] > 0) ? sendType : nil
+                                           returnType:
+                              ([returnType length] > 0) ? returnType : nil];
+          valid = [NSNumber numberWithBool: requestor != nil];
+          [_validTypes setObject: valid forKey: key];
+        }
+      if ([valid boolValue] == YES)
+        {
+          return YES;
+        }
     }
   return NO;
 }
 
 - (void) updateServicesMenu
 {
+  /* Called after each event, which may have changed what the responders
+   * accept, so ask them again.
+   */
+  [_validTypes removeAllObjects];
+  _validResponder = nil;
+  DESTROY(_validEvent);
+
   if (_servicesMenu && [[_application mainMenu] autoenablesItems])
     {
       NSArray   	*a;
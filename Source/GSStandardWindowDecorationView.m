@@ -42,6 +42,11 @@
 
 #import <GNUstepGUI/GSWindowDecorationView.h>
 
+@interface NSWindow (GNUstepPrivate)
+- (void) _startLiveResize;
+- (void) _endLiveResize;
+@end
+
 @interface GSStandardWindowDecorationView (GSTheme)
 - (void) _themeDidActivate: (NSNotification*)notification;
 @end
@@ -306,7 +311,8 @@ calc_new_frame(NSRect frame, NSPoint point, NSPoint firstPoint,
 
 - (void) resizeWindowStartingWithEvent: (NSEvent *)event
 {
-  NSUInteger mask = NSLeftMouseDraggedMask | NSLeftMouseUpMask | NSPeriodicMask;
+  NSUInteger mask = NSLeftMouseDraggedMask | NSLeftMouseUpMask | NSPeriodicMask
+    | NSAppKitDefinedMask;
   NSEvent *currentEvent = event;
   NSDate *distantPast = [NSDate distantPast];
   NSDate *distantFuture = [NSDate distantFuture];
@@ -338,6 +344,7 @@ calc_new_frame(NSRect frame, NSPoint point, NSPoint firstPoint,
   maxSize = [window maxSize];
 
   [window _captureMouse: nil];
+  [window _startLiveResize];
   [NSEvent startPeriodicEventsAfterDelay: 0.1 withPeriod: 0.1];
   do
     {
@@ -347,6 +354,12 @@ calc_new_frame(NSRect frame, NSPoint point, NSPoint firstPoint,
 			   untilDate: distantPast
 			   inMode: NSEventTrackingRunLoopMode
 			   dequeue: YES];
+	  /* Let the window see the resize events of the backend while
+	     the live resize is going on.  */
+	  if (currentEvent && [currentEvent type] == NSAppKitDefined)
+	    {
+	      [NSApp sendEvent: currentEvent];
+	    }
 	}
 
       point = [self mouseLocationOnScreenOutsideOfEventStream];
@@ -367,11 +380,16 @@ calc_new_frame(NSRect frame, NSPoint point, NSPoint firstPoint,
 			untilDate: distantFuture
 			inMode: NSEventTrackingRunLoopMode
 			dequeue: YES];
+      if ([currentEvent type] == NSAppKitDefined)
+	{
+	  [NSApp sendEvent: currentEvent];
+	}
     } while ([currentEvent type] != NSLeftMouseUp);
   [NSEvent stopPeriodicEvents];
   [window _releaseMouse: nil];
 
   [window setFrame: newFrame  display: YES];
+  [window _endLiveResize];
 }
 
 - (BOOL) acceptsFirstMouse: (NSEvent*)theEvent
@@ -410,6 +428,31 @@ calc_new_frame(NSRect frame, NSPoint point, NSPoint firstPoint,
   [self updateRects];
 }
 
+- (void) getRectsExposedDuringLiveResize: (NSRect[4])exposedRects
+                                   count: (NSInteger *)count
+{
+  NSInteger n;
+
+  [super getRectsExposedDuringLiveResize: exposedRects count: &n];
+
+  // The bars span the whole width, so they change with every step
+  if (!NSIsEmptyRect([self rectPreservedDuringLiveResize]))
+    {
+      if (hasTitleBar)
+        {
+          exposedRects[n++] = titleBarRect;
+        }
+      if (hasResizeBar)
+        {
+          exposedRects[n++] = resizeBarRect;
+        }
+    }
+  if (count != NULL)
+    {
+      *count = n;
+    }
+}
+
 @end
 
 @implementation GSStandardWindowDecorationView (GSTheme)
@@ -0,0 +1,69 @@
+/*                                                    -*-objc-*-
+   GSTextWordIndex.h
+
+   The private word index used by NSTextView for completion
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep GUI Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/ 
+
+#ifndef _GS_TEXT_WORD_INDEX_H
+#define _GS_TEXT_WORD_INDEX_H
+
+#import <Foundation/NSObject.h>
+#import <Foundation/NSMapTable.h>
+
+@class NSArray;
+@class NSMutableArray;
+@class NSMutableString;
+@class NSString;
+@class NSTextStorage;
+
+/*
+ * GSTextWordIndex keeps the words of a text storage in a sorted array,
+ * together with the number of times each word occurs. It follows the
+ * edits of the text storage, only looking at the words around each
+ * edited range, and answers prefix queries by binary search.
+ */
+@interface GSTextWordIndex : NSObject
+{
+  NSTextStorage *_textStorage;	// Not retained, the owner releases us first
+  NSMutableString *_text;	// The text as of the last edit we saw
+  NSMutableArray *_words;	// Distinct words, sorted
+  NSMapTable *_counts;		// Word -> number of occurrences
+  NSString *_lastPrefix;	// Prefix of the last query
+  NSArray *_lastMatches;	// Its result, most frequent first
+}
+
+- (id) initWithTextStorage: (NSTextStorage *)textStorage;
+- (NSTextStorage *) textStorage;
+
+/* Returns the words starting with, but longer than, prefix, the most
+ * frequent ones first. The result of the last query is kept until the
+ * count of a word it matches changes, and is filtered rather than sorted
+ * again when the next query extends its prefix. */
+- (NSArray *) wordsWithPrefix: (NSString *)prefix;
+
+/* Returns the number of occurrences of word in the text. */
+- (NSUInteger) countOfWord: (NSString *)word;
+
+@end
+
+#endif /* _GS_TEXT_WORD_INDEX_H */
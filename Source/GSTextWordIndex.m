@@ -0,0 +1,331 @@
+/* 
+   GSTextWordIndex.m
+
+   The private word index used by NSTextView for completion
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep GUI Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/ 
+
+#import "config.h"
+#import <Foundation/NSArray.h>
+#import <Foundation/NSCharacterSet.h>
+#import <Foundation/NSNotification.h>
+#import <Foundation/NSString.h>
+#import "AppKit/NSTextStorage.h"
+#import "GSTextWordIndex.h"
+
+/* Shorter words are not worth completing. */
+#define MIN_WORD_LENGTH 3
+
+static NSCharacterSet *wordCharacters = nil;
+
+static inline BOOL
+isWordCharacter(unichar c)
+{
+  return c == '_' || [wordCharacters characterIsMember: c];
+}
+
+@interface GSTextWordIndex (Private)
+- (void) _rebuild;
+- (void) _countWordsInRange: (NSRange)range by: (NSInteger)delta;
+- (void) _textStorageDidProcessEditing: (NSNotification *)notification;
+@end
+
+@implementation GSTextWordIndex
+
++ (void) initialize
+{
+  if (self == [GSTextWordIndex class])
+    {
+      wordCharacters = RETAIN([NSCharacterSet alphanumericCharacterSet]);
+    }
+}
+
+- (id) initWithTextStorage: (NSTextStorage *)textStorage
+{
+  if ((self = [super init]) != nil)
+    {
+      _textStorage = textStorage;
+      _text = [NSMutableString new];
+      _words = [NSMutableArray new];
+      _counts = NSCreateMapTable(NSObjectMapKeyCallBacks,
+                                 NSIntegerMapValueCallBacks, 1024);
+      [[NSNotificationCenter defaultCenter]
+        addObserver: self
+           selector: @selector(_textStorageDidProcessEditing:)
+               name: NSTextStorageDidProcessEditingNotification
+             object: _textStorage];
+      [self _rebuild];
+    }
+  return self;
+}
+
+- (void) dealloc
+{
+  [[NSNotificationCenter defaultCenter] removeObserver: self];
+  RELEASE(_text);
+  RELEASE(_words);
+  NSFreeMapTable(_counts);
+  RELEASE(_lastPrefix);
+  RELEASE(_lastMatches);
+  [super dealloc];
+}
+
+- (NSTextStorage *) textStorage
+{
+  return _textStorage;
+}
+
+- (NSUInteger) countOfWord: (NSString *)word
+{
+  return (NSUInteger)NSMapGet(_counts, word);
+}
+
+static NSComparisonResult
+compareFrequency(id a, id b, void *context)
+{
+  NSMapTable *counts = (NSMapTable *)context;
+  NSUInteger ca = (NSUInteger)NSMapGet(counts, a);
+  NSUInteger cb = (NSUInteger)NSMapGet(counts, b);
+
+  if (ca > cb)
+    return NSOrderedAscending;
+  if (ca < cb)
+    return NSOrderedDescending;
+  return [a compare: b];
+}
+
+- (NSArray *) wordsWithPrefix: (NSString *)prefix
+{
+  NSMutableArray *result;
+  NSUInteger count = [_words count];
+  NSUInteger prefixLength = [prefix length];
+  NSUInteger low = 0;
+  NSUInteger high = count;
+
+  if (prefixLength == 0)
+    {
+      return [NSArray array];
+    }
+
+  if (_lastPrefix != nil && [prefix hasPrefix: _lastPrefix])
+    {
+      NSUInteger n = [_lastMatches count];
+      NSUInteger i;
+
+      if (prefixLength == [_lastPrefix length])
+        {
+          return AUTORELEASE(RETAIN(_lastMatches));
+        }
+
+      /* Every match of a longer prefix is a match of the last one, and
+       * dropping some of those keeps them in frequency order.
+       */
+      result = [NSMutableArray arrayWithCapacity: n];
+      for (i = 0; i < n; i++)
+        {
+          NSString *word = [_lastMatches objectAtIndex: i];
+
+          if ([word length] > prefixLength && [word hasPrefix: prefix])
+            [result addObject: word];
+        }
+      ASSIGNCOPY(_lastPrefix, prefix);
+      ASSIGNCOPY(_lastMatches, result);
+      return result;
+    }
+
+  result = [NSMutableArray array];
+
+  // Find the first word not sorting before the prefix
+  while (low < high)
+    {
+      NSUInteger mid = (low + high) / 2;
+
+      if ([[_words objectAtIndex: mid] compare: prefix] == NSOrderedAscending)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  // All words with the prefix follow it directly
+  for (; low < count; low++)
+    {
+      NSString *word = [_words objectAtIndex: low];
+
+      if (![word hasPrefix: prefix])
+        break;
+      if ([word length] > prefixLength)
+        [result addObject: word];
+    }
+
+  [result sortUsingFunction: compareFrequency context: _counts];
+  ASSIGNCOPY(_lastPrefix, prefix);
+  ASSIGNCOPY(_lastMatches, result);
+  return result;
+}
+
+@end
+
+@implementation GSTextWordIndex (Private)
+
+- (void) _rebuild
+{
+  [_words removeAllObjects];
+  NSResetMapTable(_counts);
+  DESTROY(_lastPrefix);
+  DESTROY(_lastMatches);
+  [_text setString: [_textStorage string]];
+  [self _countWordsInRange: NSMakeRange(0, [_text length]) by: 1];
+}
+
+/* Adds delta to the count of every word in range of _text, keeping
+ * _words in step with the words that have a count.
+ */
+- (void) _countWordsInRange: (NSRange)range by: (NSInteger)delta
+{
+  unichar *buffer;
+  NSUInteger i = 0;
+
+  if (range.length == 0)
+    {
+      return;
+    }
+  buffer = NSZoneMalloc(NSDefaultMallocZone(), sizeof(unichar) * range.length);
+  [_text getCharacters: buffer range: range];
+
+  while (i < range.length)
+    {
+      NSUInteger start;
+
+      while (i < range.length && !isWordCharacter(buffer[i]))
+        i++;
+      start = i;
+      while (i < range.length && isWordCharacter(buffer[i]))
+        i++;
+
+      if (i - start >= MIN_WORD_LENGTH)
+        {
+          NSString *word;
+          NSInteger old;
+          NSInteger new;
+          NSUInteger low = 0;
+          NSUInteger high = [_words count];
+
+          word = [[NSString alloc] initWithCharacters: buffer + start
+                                               length: i - start];
+          old = (NSInteger)NSMapGet(_counts, word);
+          new = old + delta;
+          if (new < 0)
+            {
+              new = 0;
+            }
+          if (new != old && _lastPrefix != nil && [word hasPrefix: _lastPrefix])
+            {
+              // The last result may now be in the wrong order
+              DESTROY(_lastPrefix);
+              DESTROY(_lastMatches);
+            }
+          if (new > 0)
+            {
+              NSMapInsert(_counts, word, (void *)new);
+            }
+          else
+            {
+              NSMapRemove(_counts, word);
+            }
+
+          if ((old == 0) != (new == 0))
+            {
+              while (low < high)
+                {
+                  NSUInteger mid = (low + high) / 2;
+
+                  if ([[_words objectAtIndex: mid] compare: word]
+                    == NSOrderedAscending)
+                    low = mid + 1;
+                  else
+                    high = mid;
+                }
+              if (old == 0)
+                {
+                  [_words insertObject: word atIndex: low];
+                }
+              else
+                {
+                  [_words removeObjectAtIndex: low];
+                }
+            }
+          RELEASE(word);
+        }
+    }
+
+  NSZoneFree(NSDefaultMallocZone(), buffer);
+}
+
+- (void) _textStorageDidProcessEditing: (NSNotification *)notification
+{
+  NSString *string;
+  NSRange edited;
+  NSInteger delta;
+  NSUInteger length;
+  NSUInteger start;
+  NSUInteger end;
+  NSUInteger oldLength = [_text length];
+
+  if (([_textStorage editedMask] & NSTextStorageEditedCharacters) == 0)
+    {
+      return;
+    }
+
+  string = [_textStorage string];
+  length = [string length];
+  edited = [_textStorage editedRange];
+  delta = [_textStorage changeInLength];
+  if (NSMaxRange(edited) > length)
+    {
+      edited.length = length - edited.location;
+    }
+  if ((NSInteger)oldLength + delta != (NSInteger)length
+    || (NSInteger)edited.length < delta)
+    {
+      // We lost track of the text somehow, start over
+      [self _rebuild];
+      return;
+    }
+
+  /* Take back the words touching the old text of the edited range, then
+   * count the words in the same stretch of the new text.
+   */
+  start = edited.location;
+  end = NSMaxRange(edited) - delta;
+  while (start > 0 && isWordCharacter([_text characterAtIndex: start - 1]))
+    start--;
+  while (end < oldLength && isWordCharacter([_text characterAtIndex: end]))
+    end++;
+
+  [self _countWordsInRange: NSMakeRange(start, end - start) by: -1];
+  [_text replaceCharactersInRange:
+           NSMakeRange(edited.location, edited.length - delta)
+                       withString: [string substringWithRange: edited]];
+  [self _countWordsInRange: NSMakeRange(start, end + delta - start) by: 1];
+}
+
+@end
@@ -28,14 +28,28 @@
 #import <Foundation/NSObject.h>
 #import "GNUstepGUI/GSTrackingRect.h"
 
+@class	NSMapTable;
+@class	NSMutableArray;
 @class	NSTimer;
 @class	NSView;
 @class	NSWindow;
 
+/* Tooltip regions are kept by the GSToolTips object rather than in the
+ * tracking rectangle list of the view.  The view only carries a single
+ * tracking rectangle enclosing all the regions, and the region under the
+ * mouse is found using an index of horizontal bands.
+ */
 @interface	GSToolTips : NSObject
 {
   NSView		*view;
   NSTrackingRectTag	toolTipTag;
+  NSToolTipTag		nextTag;
+  NSMapTable		*regions;
+  NSMapTable		*bands;
+  NSMutableArray	*tallRegions;
+  NSRect		envelope;
+  GSTrackingRect	*envelopeRect;
+  BOOL			envelopeStale;
 }
 
 /** Destroy object handling tips for aView.
@@ -25,7 +25,13 @@
    Boston, MA 02110-1301, USA.
 */
 
+#include <math.h>
+
+#import <Foundation/NSArray.h>
+#import <Foundation/NSDate.h>
+#import <Foundation/NSDictionary.h>
 #import <Foundation/NSGeometry.h>
+#import <Foundation/NSMapTable.h>
 #import <Foundation/NSRunLoop.h>
 #import <Foundation/NSString.h>
 #import <Foundation/NSTimer.h>
@@ -59,12 +65,15 @@
 
 /* A trivial class to hold information about the provider of the tooltip
  * string.  Instance allocation/deallocation is managed by GSToolTip and
- * our instances are stored in the user data field of tracking rectangles.
+ * each instance describes one tooltip region of a view.
  */
 @interface	GSTTProvider : NSObject
 {
   id		object;
   void		*data;
+@public
+  NSRect	rect;
+  NSToolTipTag	tag;
 }
 - (void*) data;
 - (id) initWithObject: (id)o userData: (void*)d;
@@ -138,11 +147,17 @@
 
 - (void) setText: (NSAttributedString *)text
 {
-  if (_text != text)
-    {
-      ASSIGN(_text, text);
-      [self setNeedsDisplay: YES];
-    }
+  /* The same (cached) text may be shown again after the panel has been
+   * shrunk to nothing, so always redraw.
+   */
+  ASSIGN(_text, text);
+  [self setNeedsDisplay: YES];
+}
+
+- (void) dealloc
+{
+  RELEASE(_text);
+  [super dealloc];
 }
  	  	 
 - (void) drawRect: (NSRect)dirtyRect
@@ -162,6 +177,25 @@
 }
 @end
 
+/* Another trivial class holding the laid out text of a tooltip string
+ * and its size, so that repeated strings need not be measured again.
+ */
+@interface	GSTTLayout : NSObject
+{
+@public
+  NSAttributedString	*text;
+  NSSize		size;
+}
+@end
+
+@implementation	GSTTLayout
+- (void) dealloc
+{
+  RELEASE(text);
+  [super dealloc];
+}
+@end
+
 @interface GSTTPanel : NSPanel
 // Tooltip panel that will not try to become main or key
 - (BOOL) canBecomeKeyWindow;
@@ -201,9 +235,21 @@
 
 
 @interface	GSToolTips (Private)
++ (GSTTLayout*) _layoutForString: (NSString*)aString;
++ (void) _timedOut: (NSTimer*)aTimer;
+- (NSToolTipTag) _addRegion: (NSRect)aRect
+		      owner: (id)anObject
+		   userData: (void*)data;
+- (void) _buildIndex;
 - (void) _endDisplay;
-- (void) _endDisplay: (NSTrackingRectTag)tag;
-- (void) _timedOut: (NSTimer *)timer;
+- (void) _hoverAt: (NSPoint)aPoint;
+- (void) _indexRegion: (GSTTProvider*)region;
+- (void) _invalidateIndex;
+- (void) _regionsRemoved;
+- (GSTTProvider*) _regionAtPoint: (NSPoint)aPoint;
+- (void) _removeRegion: (GSTTProvider*)region;
+- (void) _setEnvelope: (NSRect)aRect;
+- (void) _showTip;
 @end
 /*
 typedef struct NSView_struct
@@ -213,12 +259,46 @@ typedef struct NSView_struct
 */
 typedef NSView* NSViewPtr;
 
+/* Height of the horizontal bands used to index the tooltip regions of a
+ * view, and the number of bands above which a region is considered tall
+ * and is kept in a separate list rather than in every band it covers.
+ */
+#define	BAND_HEIGHT	64.0
+#define	TALL_BANDS	32
+/* Delay before a tooltip appears, and maximum number of cached layouts.
+ */
+#define	HOVER_DELAY	0.5
+#define	MAX_LAYOUTS	64
+
+static inline NSInteger
+bandForY(CGFloat y)
+{
+  return (NSInteger)floor(y / BAND_HEIGHT);
+}
+
+static NSComparisonResult
+compareTags(GSTTProvider *a, GSTTProvider *b, void *context)
+{
+  if (a->tag < b->tag)
+    return NSOrderedAscending;
+  if (a->tag > b->tag)
+    return NSOrderedDescending;
+  return NSOrderedSame;
+}
+
 @implementation GSToolTips
 
 static NSMapTable	*viewsMap = 0;
+/* A single timer is shared by all tooltips.  It is created the first time
+ * the mouse hovers over a tooltip region and is then only rescheduled.
+ */
 static NSTimer		*timer = nil;
-static GSToolTips       *timedObject = nil;
-static NSTrackingRectTag timedTag = NSNotFound;
+static GSToolTips       *hoverObject = nil;
+static GSTTProvider	*hoverRegion = nil;
+static NSPoint		hoverPoint;
+static NSMutableDictionary	*layouts = nil;
+static NSDictionary	*textAttributes = nil;
+static CGFloat		layoutFontSize = 0.0;
 // Having a single stored panel for tooltips greatly reduces callback interaction from MS-Windows
 static GSTTPanel	*window = nil;
 // Prevent Windows callback API from attempting to dismiss tooltip as its in the process of appearing
@@ -226,16 +306,62 @@ static BOOL   isOpening = NO;
 static NSSize		offset;
 static BOOL		restoreMouseMoved;
 
+static void
+startTimer(void)
+{
+  NSDate	*when = [NSDate dateWithTimeIntervalSinceNow: HOVER_DELAY];
+
+  if (timer == nil)
+    {
+      NSRunLoop	*loop = [NSRunLoop currentRunLoop];
+
+      /* A repeating timer with a huge interval stays valid after firing,
+       * so it can simply be given a new fire date for the next hover.
+       */
+      timer = [[NSTimer alloc] initWithFireDate: when
+				       interval: 1.0e7
+					 target: [GSToolTips class]
+				       selector: @selector(_timedOut:)
+				       userInfo: nil
+					repeats: YES];
+      [loop addTimer: timer forMode: NSDefaultRunLoopMode];
+      [loop addTimer: timer forMode: NSModalPanelRunLoopMode];
+    }
+  else
+    {
+      [timer setFireDate: when];
+    }
+}
+
+static void
+stopTimer(void)
+{
+  if (timer != nil)
+    {
+      [timer setFireDate: [NSDate distantFuture]];
+    }
+}
+
+static void
+hidePanel(void)
+{
+  if (window != nil && [window isVisible])
+    {
+      [window setFrame: NSZeroRect display: NO];
+      [window orderOut: nil];
+    }
+}
+
 + (void) initialize
 {
   viewsMap = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
 			     NSObjectMapValueCallBacks, 8);
-           
+
   window = [[GSTTPanel alloc] initWithContentRect: NSMakeRect(0,0,100,25)
 				       styleMask: NSBorderlessWindowMask
 					 backing: NSBackingStoreRetained
 					   defer: YES];
-    
+
   [window setBackgroundColor: [NSColor toolTipColor]];
   [window setReleasedWhenClosed: NO];
   [window setExcludedFromWindowsMenu: YES];
@@ -273,13 +399,6 @@ static BOOL		restoreMouseMoved;
                           owner: (id)anObject
                        userData: (void *)data
 {
-  NSTrackingRectTag	tag;
-  GSTTProvider		*provider;
-
-  if (timer != nil)
-    {
-      return -1;	// A tip is already in progress.
-    }
   aRect = NSIntersectionRect(aRect, [view bounds]);
   if (NSEqualRects(aRect, NSZeroRect))
     {
@@ -289,37 +408,20 @@ static BOOL		restoreMouseMoved;
     {
       return -1;	// No provider object.
     }
-
-  provider = [[GSTTProvider alloc] initWithObject: anObject
-					 userData: data];
-  tag = [view addTrackingRect: aRect
-                        owner: self
-                     userData: provider
-                 assumeInside: NO];
-  return tag;
+  return [self _addRegion: aRect owner: anObject userData: data];
 }
 
 - (unsigned) count
 {
-  NSEnumerator		*enumerator;
-  GSTrackingRect	*rect;
-  unsigned		count = 0;
-
-  enumerator = [((NSViewPtr)view)->_tracking_rects objectEnumerator];
-  while ((rect = [enumerator nextObject]) != nil)
-    {
-      if (rect->owner == self)
-        {
-	  count++;
-	}
-    }
-  return count;
+  return NSCountMapTable(regions);
 }
 
 - (void) dealloc
 {
   [self _endDisplay];
   [self removeAllToolTips];
+  [self _invalidateIndex];
+  NSFreeMapTable(regions);
   [super dealloc];
 }
 
@@ -327,51 +429,14 @@ static BOOL		restoreMouseMoved;
 {
   view = aView;
   toolTipTag = -1;
+  nextTag = 1;
+  regions = NSCreateMapTable(NSIntegerMapKeyCallBacks,
+			     NSObjectMapValueCallBacks, 8);
   return self;
 }
 
 - (void) mouseEntered: (NSEvent *)theEvent
 {
-  GSTTProvider	*provider;
-  NSString	*toolTipString;
-
-  if (timer != nil)
-    {
-      /* Moved from one tooltip view to another, so reset the timer.
-       */
-      [timer invalidate];
-      timer = nil;
-      timedObject = nil;
-      timedTag = NSNotFound;
-    }
-
-  provider = (GSTTProvider*)[theEvent userData];
-  if ([[provider object] respondsToSelector:
-    @selector(view:stringForToolTip:point:userData:)] == YES)
-    {
-      // From testing on OS X, point is in the view's coordinate system
-      // The locationInWindow has been converted to this in
-      // [NSWindow _checkTrackingRectangles:forEvent:]
-      NSPoint p = [theEvent locationInWindow];
-
-      toolTipString = [[provider object] view: view
-			     stringForToolTip: [theEvent trackingNumber]
-					point: p
-				     userData: [provider data]];
-    }
-  else
-    {
-      toolTipString = [provider object];
-    }
-
-  timer = [NSTimer scheduledTimerWithTimeInterval: 0.5
-                                           target: self
-                                         selector: @selector(_timedOut:)
-                                         userInfo: toolTipString
-                                          repeats: YES];
-  [[NSRunLoop currentRunLoop] addTimer: timer forMode: NSModalPanelRunLoopMode];
-  timedObject = self;
-  timedTag = [theEvent trackingNumber];
   if ([[view window] acceptsMouseMovedEvents] == YES)
     {
       restoreMouseMoved = NO;
@@ -382,16 +447,46 @@ static BOOL		restoreMouseMoved;
       [[view window] setAcceptsMouseMovedEvents: YES];
     }
   [NSWindow _setToolTipVisible: self];
+
+  /* Shrink the tracking rectangle if regions on its edge went away.
+   */
+  if (envelopeStale == YES)
+    {
+      NSMapEnumerator	enumerator = NSEnumerateMapTable(regions);
+      GSTTProvider	*region;
+      void		*tag;
+      NSRect		r = NSZeroRect;
+
+      while (NSNextMapEnumeratorPair(&enumerator, &tag, (void**)&region))
+	{
+	  r = NSUnionRect(r, region->rect);
+	}
+      NSEndMapTableEnumeration(&enumerator);
+      envelopeStale = NO;
+      [self _setEnvelope: r];
+    }
+
+  // From testing on OS X, point is in the view's coordinate system
+  // The locationInWindow has been converted to this in
+  // [NSWindow _checkTrackingRectangles:forEvent:]
+  [self _hoverAt: [theEvent locationInWindow]];
 }
 
 - (void) mouseExited: (NSEvent *)theEvent
 {
-  [self _endDisplay:[theEvent trackingNumber]];
+  [self _endDisplay];
 }
 
 - (void) mouseDown: (NSEvent *)theEvent
 {
-  [self _endDisplay];
+  /* Keep tracking the mouse, but do not show the tip again until the
+   * mouse moves to another region.
+   */
+  if (hoverObject == self)
+    {
+      stopTimer();
+    }
+  hidePanel();
 }
 
 - (void) mouseMoved: (NSEvent *)theEvent
@@ -399,8 +494,23 @@ static BOOL		restoreMouseMoved;
   NSPoint mouseLocation;
   NSPoint origin;
 
-  if (window == nil)
+  [self _hoverAt: [view convertPoint: [theEvent locationInWindow]
+			    fromView: nil]];
+
+  if (window == nil || [window isVisible] == NO)
     {
+      NSView	*top = [[view window] contentView];
+      NSView	*v;
+
+      /* No tip is displayed, so the movement belongs to the view under
+       * the mouse, which would have received it if we were not tracking.
+       */
+      if ([top superview] != nil)
+	{
+	  top = [top superview];
+	}
+      v = [top hitTest: [theEvent locationInWindow]];
+      [v mouseMoved: theEvent];
       return;
     }
 
@@ -414,62 +524,57 @@ static BOOL		restoreMouseMoved;
 
 - (void) removeAllToolTips
 {
-  NSEnumerator		*enumerator;
-  GSTrackingRect	*rect;
-
   [self _endDisplay];
 
-  enumerator = [((NSViewPtr)view)->_tracking_rects objectEnumerator];
-  while ((rect = [enumerator nextObject]) != nil)
-    {
-      if (rect->owner == self)
-        {
-	  RELEASE((GSTTProvider*)rect->user_data);
-	  rect->user_data = 0;
-          [view removeTrackingRect: rect->tag];
-	}
-    }
+  [self _invalidateIndex];
+  NSResetMapTable(regions);
+  [self _regionsRemoved];
   toolTipTag = -1;
 }
 
 - (void)removeToolTipsInRect: (NSRect)aRect
 {
-  NSUInteger idx = 0;
-  NSMutableIndexSet *indexes = [NSMutableIndexSet new];
-  id tracking_rects = ((NSViewPtr)view)->_tracking_rects;
-  FOR_IN(GSTrackingRect*, rect, tracking_rects)
-    if ((rect->owner == self) && NSContainsRect(aRect, rect->rectangle))
-      {
-        RELEASE((GSTTProvider*)rect->user_data);
-        rect->user_data = 0;
-        [indexes addIndex: idx];
-        [rect invalidate];
-      }
-      idx++;
-  END_FOR_IN(tracking_rects)
-  [((NSViewPtr)view)->_tracking_rects removeObjectsAtIndexes: indexes];
-  if ([((NSViewPtr)view)->_tracking_rects count] == 0)
+  NSMapEnumerator	enumerator = NSEnumerateMapTable(regions);
+  NSMutableArray	*removed = nil;
+  GSTTProvider		*region;
+  void			*tag;
+
+  while (NSNextMapEnumeratorPair(&enumerator, &tag, (void**)&region))
     {
-      ((NSViewPtr)view)->_rFlags.has_trkrects = 0;
+      if (NSContainsRect(aRect, region->rect))
+	{
+	  if (removed == nil)
+	    {
+	      removed = [NSMutableArray array];
+	    }
+	  [removed addObject: region];
+	}
+    }
+  NSEndMapTableEnumeration(&enumerator);
+  if (removed != nil)
+    {
+      NSEnumerator	*e = [removed objectEnumerator];
+
+      while ((region = [e nextObject]) != nil)
+	{
+	  if (region->tag == toolTipTag)
+	    {
+	      toolTipTag = -1;
+	    }
+	  [self _removeRegion: region];
+	}
+      [self _regionsRemoved];
     }
-  [indexes release];
 }
 
 - (void) removeToolTip: (NSToolTipTag)tag
 {
-  NSEnumerator   	*enumerator;
-  GSTrackingRect	*rect;
+  GSTTProvider	*region = NSMapGet(regions, (void*)tag);
 
-  enumerator = [((NSViewPtr)view)->_tracking_rects objectEnumerator];
-  while ((rect = [enumerator nextObject]) != nil)
+  if (region != nil)
     {
-      if (rect->tag == tag && rect->owner == self)
-	{
-	  RELEASE((GSTTProvider*)rect->user_data);
-	  rect->user_data = 0;
-	  [view removeTrackingRect: tag];
-          return;
-	}
+      [self _removeRegion: region];
+      [self _regionsRemoved];
     }
 }
 
@@ -486,63 +591,147 @@ static BOOL		restoreMouseMoved;
     }
   else
     {
-      GSTTProvider	*provider;
-
       if (toolTipTag == -1)
         {
-	  NSRect	rect;
-
-	  rect = [view bounds];
-	  provider = [[GSTTProvider alloc] initWithObject: string
-						 userData: nil];
-	  toolTipTag = [view addTrackingRect: rect
-				       owner: self
-				    userData: provider
-				assumeInside: NO];
+	  toolTipTag = [self _addRegion: [view bounds]
+				  owner: string
+			       userData: nil];
 	}
       else
         {
-	  NSEnumerator   	*enumerator;
-	  GSTrackingRect	*rect;
+	  GSTTProvider	*region = NSMapGet(regions, (void*)toolTipTag);
 
-	  enumerator = [((NSViewPtr)view)->_tracking_rects objectEnumerator];
-	  while ((rect = [enumerator nextObject]) != nil)
-	    {
-	      if (rect->tag == toolTipTag && rect->owner == self)
-		{
-		  [((GSTTProvider*)rect->user_data) setObject: string];
-		}
-	    }
+	  [region setObject: string];
 	}
     }
 }
 
 - (NSString *) toolTip
 {
-  NSEnumerator		*enumerator;
-  GSTrackingRect	*rect;
+  GSTTProvider	*region;
 
-  enumerator = [((NSViewPtr)view)->_tracking_rects objectEnumerator];
-  while ((rect = [enumerator nextObject]) != nil)
+  if (toolTipTag == -1)
     {
-      if (rect->tag == toolTipTag)
-	{
-	  return [((GSTTProvider*)rect->user_data) object];
-	}
+      return nil;
     }
-  return nil;
+  region = NSMapGet(regions, (void*)toolTipTag);
+  return [region object];
 }
 
 @end
 
 @implementation	GSToolTips (Private)
 
-- (void) _endDisplay
+/* Return the laid out text for aString, using the cache when the same
+ * string has been shown before with the current font size.
+ */
++ (GSTTLayout*) _layoutForString: (NSString*)aString
+{
+  GSTTLayout	*layout;
+  CGFloat	size;
+
+  size = [[NSUserDefaults standardUserDefaults]
+	   floatForKey: @"NSToolTipsFontSize"];
+  if (size <= 0)
+    {
+      size = 10.0;
+    }
+  if (textAttributes == nil || size != layoutFontSize)
+    {
+      NSMutableDictionary	*attributes;
+
+      attributes = [NSMutableDictionary dictionary];
+      [attributes setObject: [NSFont toolTipsFontOfSize: size]
+		     forKey: NSFontAttributeName];
+      [attributes setObject: [NSColor toolTipTextColor]
+		     forKey: NSForegroundColorAttributeName];
+      ASSIGNCOPY(textAttributes, attributes);
+      layoutFontSize = size;
+      [layouts removeAllObjects];
+    }
+
+  layout = [layouts objectForKey: aString];
+  if (layout != nil)
+    {
+      return layout;
+    }
+
+  layout = AUTORELEASE([GSTTLayout new]);
+  layout->text = [[NSAttributedString alloc] initWithString: aString
+						 attributes: textAttributes];
+  layout->size = [layout->text size];
+  if (layout->size.width > 300)
+    {
+      NSRect rect;
+      rect = [layout->text boundingRectWithSize: NSMakeSize(300, 1e7)
+					options: 0];
+      layout->size = rect.size;
+      // This extra pixel is needed, otherwise the last line gets cut off.
+      layout->size.height += 1;
+    }
+
+  if (layouts == nil)
+    {
+      layouts = [NSMutableDictionary new];
+    }
+  else if ([layouts count] >= MAX_LAYOUTS)
+    {
+      [layouts removeAllObjects];
+    }
+  [layouts setObject: layout forKey: aString];
+  return layout;
+}
+
+/* The delay timed out -- display the tooltip */
++ (void) _timedOut: (NSTimer*)aTimer
+{
+  stopTimer();
+  [hoverObject _showTip];
+}
+
+- (NSToolTipTag) _addRegion: (NSRect)aRect
+		      owner: (id)anObject
+		   userData: (void*)data
+{
+  GSTTProvider		*provider;
+  NSToolTipTag		tag = nextTag++;
+
+  provider = [[GSTTProvider alloc] initWithObject: anObject
+					 userData: data];
+  provider->rect = aRect;
+  provider->tag = tag;
+  NSMapInsert(regions, (void*)tag, (void*)provider);
+  if (bands != 0)
+    {
+      [self _indexRegion: provider];
+    }
+  RELEASE(provider);
+  [self _setEnvelope: NSUnionRect(envelope, aRect)];
+  return tag;
+}
+
+- (void) _buildIndex
 {
-  [self _endDisplay:NSNotFound];
+  NSEnumerator	*enumerator;
+  GSTTProvider	*region;
+  NSArray	*sorted;
+
+  [self _invalidateIndex];
+  bands = NSCreateMapTable(NSIntegerMapKeyCallBacks,
+			   NSObjectMapValueCallBacks, 64);
+  tallRegions = [NSMutableArray new];
+  /* The index keeps regions in order of increasing tag.
+   */
+  sorted = [NSAllMapTableValues(regions)
+	     sortedArrayUsingFunction: compareTags context: 0];
+  enumerator = [sorted objectEnumerator];
+  while ((region = [enumerator nextObject]) != nil)
+    {
+      [self _indexRegion: region];
+    }
 }
 
-- (void) _endDisplay: (NSTrackingRectTag)tag
+- (void) _endDisplay
 {
   if (isOpening)
     return;
@@ -550,18 +739,13 @@ static BOOL		restoreMouseMoved;
     {
       [NSWindow _setToolTipVisible: nil];
     }
-  /* If there is currently a timer running for this object and it is the target tag,
-   * cancel it. Always remove if the target tag is NSNotFound
+  /* If the hover timer is running for this object, cancel it.
    */
-  if (timer != nil && timedObject == self && (timedTag == tag || tag == NSNotFound))
+  if (hoverObject == self)
     {
-      if ([timer isValid])
-	{
-	  [timer invalidate];
-	}
-      timer = nil;
-      timedObject = nil;
-      timedTag = NSNotFound;
+      stopTimer();
+      hoverObject = nil;
+      DESTROY(hoverRegion);
     }
   if (window != nil)
     {
@@ -575,83 +759,249 @@ static BOOL		restoreMouseMoved;
     }
 }
 
-/* The delay timed out -- display the tooltip */
-- (void) _timedOut: (NSTimer *)aTimer
+/* The mouse is at aPoint (in view coordinates) inside our tracking
+ * rectangle.  Restart the hover timer if it moved to another region.
+ */
+- (void) _hoverAt: (NSPoint)aPoint
 {
-  CGFloat               size;
-  NSString		*toolTipString;
-  NSAttributedString	*toolTipText = nil;
-  NSSize		textSize;
-  NSPoint		mouseLocation = [NSEvent mouseLocation];
-  NSRect		visible;
-  NSRect		rect;
-  NSMutableDictionary	*attributes;
+  GSTTProvider	*region = [self _regionAtPoint: aPoint];
 
-  // retain and autorelease the timer's userinfo because we
-  // may  invalidate the timer (which releases the userinfo),
-  // but need the userinfo object to remain valid for the
-  // remainder of this method.
-  toolTipString = [[[aTimer userInfo] retain] autorelease];
-  if ( (nil == toolTipString) ||
-       ([toolTipString isEqualToString: @""]) )
+  if (hoverObject == self && hoverRegion == region)
     {
+      return;	// Still over the same region.
+    }
+  hidePanel();
+  if (region == nil)
+    {
+      if (hoverObject == self)
+	{
+	  stopTimer();
+	  hoverObject = nil;
+	  DESTROY(hoverRegion);
+	}
       return;
     }
+  hoverObject = self;
+  ASSIGN(hoverRegion, region);
+  hoverPoint = aPoint;
+  startTimer();
+}
 
-  if (timer != nil)
+- (void) _indexRegion: (GSTTProvider*)region
+{
+  NSInteger	first = bandForY(NSMinY(region->rect));
+  NSInteger	last = bandForY(NSMaxY(region->rect));
+  NSInteger	band;
+
+  if (last - first >= TALL_BANDS)
     {
-      if ([timer isValid])
+      [tallRegions addObject: region];
+      return;
+    }
+  for (band = first; band <= last; band++)
+    {
+      NSMutableArray	*a = NSMapGet(bands, (void*)band);
+
+      if (a == nil)
 	{
-	  [timer invalidate];
+	  a = [NSMutableArray new];
+	  NSMapInsert(bands, (void*)band, (void*)a);
+	  RELEASE(a);
 	}
-      timer = nil;
-      timedObject = nil;
-      timedTag = NSNotFound;
-    }
-
-  if ([window isVisible])
-    {
-      /* Moved from one tooltip view to another ... so stop displaying
-       * the old tool tip before we start the new one.
-       * This is similar to the case in -mouseEntered: where we cancel
-       * the timer for one tooltip view because we have entered another
-       * one.
-       * To think about ... if we entered a tooltip rectangle without
-       * having left the previous one, then when we leave this rectangle
-       * we are probably back in the other one and should really restart
-       * the timer for the original view.  However, this is a rare case
-       * so it's probably better to ignore it than add a lot of code to
-       * keep track of all entry and exit.
-       */
-      [self _endDisplay];
+      [a addObject: region];
     }
+}
 
-  size = [[NSUserDefaults standardUserDefaults]
-	   floatForKey: @"NSToolTipsFontSize"];
+- (void) _invalidateIndex
+{
+  if (bands != 0)
+    {
+      NSFreeMapTable(bands);
+      bands = 0;
+    }
+  DESTROY(tallRegions);
+}
 
-  if (size <= 0)
+/* Called after regions have been removed, to cancel a hover over a
+ * removed region and drop the tracking rectangle once there are none.
+ * A smaller tracking rectangle is only worked out when the mouse next
+ * enters it.
+ */
+- (void) _regionsRemoved
+{
+  if (hoverObject == self
+    && NSMapGet(regions, (void*)hoverRegion->tag) != hoverRegion)
     {
-      size = 10.0;
+      stopTimer();
+      hoverObject = nil;
+      DESTROY(hoverRegion);
+    }
+  if (NSCountMapTable(regions) == 0)
+    {
+      envelopeStale = NO;
+      [self _setEnvelope: NSZeroRect];
+    }
+}
+
+/* Return the most recently added region containing aPoint.  Regions
+ * are stored in order of increasing tag in both the bands and the list
+ * of tall regions, so searching backwards finds the latest first.
+ */
+- (GSTTProvider*) _regionAtPoint: (NSPoint)aPoint
+{
+  BOOL		flipped = [view isFlipped];
+  GSTTProvider	*found = nil;
+  NSArray	*a;
+  NSUInteger	i;
+
+  if (NSCountMapTable(regions) == 0)
+    {
+      return nil;
+    }
+  if (bands == 0)
+    {
+      [self _buildIndex];
     }
 
-  attributes = [NSMutableDictionary dictionary];
-  [attributes setObject: [NSFont toolTipsFontOfSize: size]
-		 forKey: NSFontAttributeName];
-  [attributes setObject: [NSColor toolTipTextColor]
-                  forKey: NSForegroundColorAttributeName];
-  toolTipText =
-    [[NSAttributedString alloc] initWithString: toolTipString
-				    attributes: attributes];
-  textSize = [toolTipText size];
-  if (textSize.width > 300)
+  a = NSMapGet(bands, (void*)bandForY(aPoint.y));
+  i = [a count];
+  while (i-- > 0)
     {
-      NSRect rect;
-      rect = [toolTipText boundingRectWithSize: NSMakeSize(300, 1e7)
-                                       options: 0];
-      textSize = rect.size;
-      // This extra pixel is needed, otherwise the last line gets cut off.
-      textSize.height += 1;
+      GSTTProvider	*region = [a objectAtIndex: i];
+
+      if (NSMouseInRect(aPoint, region->rect, flipped))
+	{
+	  found = region;
+	  break;
+	}
+    }
+  i = [tallRegions count];
+  while (i-- > 0)
+    {
+      GSTTProvider	*region = [tallRegions objectAtIndex: i];
+
+      if (found != nil && region->tag < found->tag)
+	{
+	  break;
+	}
+      if (NSMouseInRect(aPoint, region->rect, flipped))
+	{
+	  found = region;
+	  break;
+	}
+    }
+  return found;
+}
+
+/* Take region out of the index and the regions.  The tracking rectangle
+ * only needs working out again if region was on its edge.
+ */
+- (void) _removeRegion: (GSTTProvider*)region
+{
+  NSRect	r = region->rect;
+
+  if (NSMinX(r) <= NSMinX(envelope) || NSMaxX(r) >= NSMaxX(envelope)
+    || NSMinY(r) <= NSMinY(envelope) || NSMaxY(r) >= NSMaxY(envelope))
+    {
+      envelopeStale = YES;
+    }
+  if (bands != 0)
+    {
+      NSInteger	first = bandForY(NSMinY(r));
+      NSInteger	last = bandForY(NSMaxY(r));
+      NSInteger	band;
+
+      if (last - first >= TALL_BANDS)
+	{
+	  [tallRegions removeObjectIdenticalTo: region];
+	}
+      else
+	{
+	  for (band = first; band <= last; band++)
+	    {
+	      NSMutableArray	*a = NSMapGet(bands, (void*)band);
+
+	      [a removeObjectIdenticalTo: region];
+	      if (a != nil && [a count] == 0)
+		{
+		  NSMapRemove(bands, (void*)band);
+		}
+	    }
+	}
     }
+  NSMapRemove(regions, (void*)region->tag);
+}
+
+/* Make the single tracking rectangle we keep in the view cover aRect,
+ * adding it to or removing it from the view as needed.
+ */
+- (void) _setEnvelope: (NSRect)aRect
+{
+  envelope = aRect;
+  if (NSIsEmptyRect(aRect))
+    {
+      if (envelopeRect != nil)
+	{
+	  [view removeTrackingRect: envelopeRect->tag];
+	  DESTROY(envelopeRect);
+	}
+    }
+  else if (envelopeRect != nil)
+    {
+      envelopeRect->rectangle = aRect;
+    }
+  else
+    {
+      NSEnumerator	*enumerator;
+      GSTrackingRect	*rect;
+      NSTrackingRectTag	tag;
+
+      tag = [view addTrackingRect: aRect
+			    owner: self
+			 userData: 0
+		     assumeInside: NO];
+      enumerator = [((NSViewPtr)view)->_tracking_rects objectEnumerator];
+      while ((rect = [enumerator nextObject]) != nil)
+	{
+	  if (rect->tag == tag)
+	    {
+	      ASSIGN(envelopeRect, rect);
+	      break;
+	    }
+	}
+    }
+}
+
+- (void) _showTip
+{
+  GSTTProvider		*provider = AUTORELEASE(RETAIN(hoverRegion));
+  NSString		*toolTipString;
+  GSTTLayout		*layout;
+  NSSize		textSize;
+  NSPoint		mouseLocation = [NSEvent mouseLocation];
+  NSRect		visible;
+  NSRect		rect;
+
+  if ([[provider object] respondsToSelector:
+    @selector(view:stringForToolTip:point:userData:)] == YES)
+    {
+      toolTipString = [[provider object] view: view
+			     stringForToolTip: provider->tag
+					point: hoverPoint
+				     userData: [provider data]];
+    }
+  else
+    {
+      toolTipString = [provider object];
+    }
+  if ( (nil == toolTipString) ||
+       ([toolTipString isEqualToString: @""]) )
+    {
+      return;
+    }
+
+  layout = [GSToolTips _layoutForString: toolTipString];
+  textSize = layout->size;
 
   /* Create window just off the current mouse position
    * Constrain it to be on screen, shrinking if necessary.
@@ -673,7 +1023,7 @@ static BOOL		restoreMouseMoved;
       rect.origin.y = visible.origin.y;
       rect.size.height = visible.size.height;
     }
-    
+
   if (NSMaxX(rect) > NSMaxX(visible))
     {
       rect.origin.x -= (NSMaxX(rect) - NSMaxX(visible));
@@ -691,13 +1041,10 @@ static BOOL		restoreMouseMoved;
   offset.width = rect.origin.x - mouseLocation.x;
 
   isOpening = YES;
-  [(GSTTView*)([window contentView]) setText: toolTipText];
+  [(GSTTView*)([window contentView]) setText: layout->text];
   [window setFrame: rect display: NO];
   [window orderFront: nil];
   isOpening = NO;
-
-  RELEASE(toolTipText);
 }
 
 @end
-
@@ -454,6 +454,63 @@ static inline NSRect RectWithSizeScaledByFactor(NSRect aRect, CGFloat factor)
     }
 }
 
+/*
+ * The window keeps its top left corner in place during a live resize and
+ * the background does not depend on its position, so the old area stays
+ * valid at the top left and only the strips on the right and at the
+ * bottom are new.
+ */
+- (BOOL) preservesContentDuringLiveResize
+{
+  return YES;
+}
+
+- (NSRect) rectPreservedDuringLiveResize
+{
+  NSRect kept;
+
+  if (_in_live_resize == NO
+    || [window preservesContentDuringLiveResize] == NO)
+    {
+      return NSZeroRect;
+    }
+  kept = [self _liveResizeBounds];
+  kept.origin.x = NSMinX(_bounds);
+  kept.origin.y = NSMaxY(_bounds) - NSHeight(kept);
+  return NSIntersectionRect(_bounds, kept);
+}
+
+- (void) getRectsExposedDuringLiveResize: (NSRect[4])exposedRects
+                                   count: (NSInteger *)count
+{
+  NSRect kept = [self rectPreservedDuringLiveResize];
+  NSInteger n = 0;
+
+  if (NSIsEmptyRect(kept))
+    {
+      exposedRects[n++] = _bounds;
+    }
+  else
+    {
+      if (NSMaxX(_bounds) > NSMaxX(kept))
+        {
+          exposedRects[n++] = NSMakeRect(NSMaxX(kept), NSMinY(_bounds),
+                                         NSMaxX(_bounds) - NSMaxX(kept),
+                                         NSHeight(_bounds));
+        }
+      if (NSMinY(kept) > NSMinY(_bounds))
+        {
+          exposedRects[n++] = NSMakeRect(NSMinX(_bounds), NSMinY(_bounds),
+                                         NSWidth(kept),
+                                         NSMinY(kept) - NSMinY(_bounds));
+        }
+    }
+  if (count != NULL)
+    {
+      *count = n;
+    }
+}
+
 - (id) initWithCoder: (NSCoder*)aCoder
 {
   NSAssert(NO, @"The top-level window view should never be encoded.");
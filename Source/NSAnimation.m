@@ -159,7 +159,6 @@ _gs_animationValueForCurve(_NSAnimationCurveDesc *c, float t, float t0)
 @interface NSAnimation (Private)
 - (void) _gs_didReachProgressMark: (NSAnimationProgress)progress;
 - (void) _gs_startAnimationInOwnLoop;
-- (void) _gs_startThreadedAnimation;
 - (_NSAnimationCurveDesc*) _gs_curveDesc;
 - (NSAnimationProgress) _gs_curveShift;
 @end
@@ -854,11 +853,33 @@ nsanimation_progressMarkSorter(NSAnimationProgress first, NSAnimationProgress se
         [_animator startAnimation];
         break;
       case NSAnimationNonblockingThreaded:
+        /* The shared animation clock drives threaded animations too,
+         * we only keep the locking so the animation may still be
+         * controlled from any thread while it runs.
+         */
         _isThreaded = YES;
-        [NSThread
-          detachNewThreadSelector: @selector (_gs_startThreadedAnimation)
-                         toTarget: self 
-                       withObject: nil];
+        {
+          NSArray *runLoopModes;
+
+          runLoopModes = [self runLoopModesForAnimating];
+          if (runLoopModes == nil)
+            runLoopModes = _NSAnimationDefaultRunLoopModes;
+          [_animator setRunLoopModesForAnimating: runLoopModes];
+        }
+        if ([NSThread isMainThread])
+          {
+            [_animator startAnimation];
+          }
+        else
+          {
+            /* Animators started on other threads tick in the run loop
+             * of that thread, which need not be running.
+             */
+            [_animator performSelectorOnMainThread: @selector(startAnimation)
+                                        withObject: nil
+                                     waitUntilDone: NO];
+          }
+        break;
     }
 }
 
@@ -1007,6 +1028,7 @@ nsanimation_progressMarkSorter(NSAnimationProgress first, NSAnimationProgress se
           _delegate_animationDidEnd (delegate,@selector(animationDidEnd:),self);
         }
     }
+  _isThreaded = NO;
   RELEASE (self);
 
   _NSANIMATION_UNLOCK;
@@ -1147,20 +1169,11 @@ nsanimation_progressMarkSorter(NSAnimationProgress first, NSAnimationProgress se
                _nextMark, GSIArrayItemAtIndex(_progressMarks, _nextMark - 1));
 }
 
-- (void) _gs_startThreadedAnimation
-{
-  // NSAssert(_isThreaded);
-  CREATE_AUTORELEASE_POOL(pool);
-  NSDebugMLLog(@"NSAnimationThread",
-               @"Start of %@", [NSThread currentThread]);
-  [self _gs_startAnimationInOwnLoop];
-  NSDebugMLLog(@"NSAnimationThread",
-               @"End of %@", [NSThread currentThread]);
-  [pool drain];
-  _isThreaded = NO;
-}
-
-
+/* Runs the run loop of the current thread in
+ * NSAnimationBlockingRunLoopMode until the animation is over. The
+ * animator ticks in that mode, from the shared animation clock on the
+ * main thread and from its own timer on other threads.
+ */
 - (void) _gs_startAnimationInOwnLoop
 {
   NSRunLoop	*loop;
@@ -1171,22 +1184,17 @@ nsanimation_progressMarkSorter(NSAnimationProgress first, NSAnimationProgress se
   [_animator startAnimation];
   loop = [NSRunLoop currentRunLoop];
   end = [NSDate distantFuture];
-  for (;;)
+  while ([_animator isAnimationRunning])
     {
-      if ([loop runMode: NSAnimationBlockingRunLoopMode beforeDate: end] == NO)
-        {
-          NSDate	*d;
-          CREATE_AUTORELEASE_POOL(pool);
+      CREATE_AUTORELEASE_POOL(pool);
 
-          d = [loop limitDateForMode: NSAnimationBlockingRunLoopMode];
-          if (d == nil)
-            {
-              [pool drain];
-              break;	// No inputs and no timers.
-            }
-          [NSThread sleepUntilDate: d];
+      if ([loop runMode: NSAnimationBlockingRunLoopMode
+             beforeDate: end] == NO)
+        {
           [pool drain];
+          break;	// No inputs and no timers.
         }
+      [pool drain];
     }
 }
 
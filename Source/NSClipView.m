@@ -29,23 +29,30 @@
 #import "config.h"
 #import <Foundation/NSNotification.h>
 #import <Foundation/NSException.h>
+#import <Foundation/NSMapTable.h>
 
 #import "AppKit/NSClipView.h"
 #import "AppKit/NSCursor.h"
 #import "AppKit/NSColor.h"
 #import "AppKit/NSEvent.h"
 #import "AppKit/NSGraphics.h"
+#import "AppKit/NSBitmapImageRep.h"
+#import "AppKit/NSImage.h"
 #import "AppKit/NSTableView.h"
 #import "AppKit/NSWindow.h"
 #import "AppKit/PSOperators.h"
 
 #import <GNUstepGUI/GSNibLoading.h>
 #import "GSGuiPrivate.h"
+#import "NSViewPrivate.h"
 
 #include <math.h>
 
 @interface NSClipView (Private)
 - (void) _scrollToPoint: (NSPoint)aPoint;
+- (void) _cacheScrolledOutRect: (NSRect)rect
+                 aroundBounds: (NSRect)newBounds;
+- (void) _redisplayScrolledInRect: (NSRect)rect;
 @end
 
 /*
@@ -87,6 +94,60 @@ static inline NSRect integralRect (NSRect rect, NSView *view)
   return [view convertRect: output  fromView: nil];
 }
 
+/*
+ * Return the part of the overdraw image holding rect, which is given in
+ * the coordinates of the clip view.  The image itself is never flipped.
+ */
+static inline NSRect overdrawImageRect (NSRect rect, NSRect cacheRect,
+                                        BOOL flipped)
+{
+  rect.origin.x -= NSMinX(cacheRect);
+  if (flipped)
+    {
+      rect.origin.y = NSMaxY(cacheRect) - NSMaxY(rect);
+    }
+  else
+    {
+      rect.origin.y -= NSMinY(cacheRect);
+    }
+  return rect;
+}
+
+/*
+ * The pixels a clip view keeps around its bounds when it has an overdraw
+ * margin.  Only clip views with a margin have one, and they have the
+ * caches_drawing flag set.
+ */
+@interface GSOverdrawCache : NSObject
+{
+@public
+  CGFloat margin;
+  NSImage *image;
+  NSRect rect;		// What the image covers, in clip view coordinates
+  NSRect valid;		// The part of rect holding pixels
+}
+@end
+
+@implementation GSOverdrawCache
+- (void) dealloc
+{
+  RELEASE(image);
+  [super dealloc];
+}
+@end
+
+static NSMapTable *overdrawCaches = 0;
+
+static inline GSOverdrawCache *
+overdrawCacheForClipView(NSClipView *view)
+{
+  if (overdrawCaches == 0)
+    {
+      return nil;
+    }
+  return (GSOverdrawCache *)NSMapGet(overdrawCaches, view);
+}
+
 
 /* Note that the ivar _documentView is really just a convienience
    variable. The actual document view is stored in NSClipView's
@@ -113,6 +174,10 @@ static inline NSRect integralRect (NSRect rect, NSView *view)
   [self setDocumentView: nil];
   RELEASE(_cursor);
   RELEASE(_backgroundColor);
+  if (_rFlags.caches_drawing)
+    {
+      NSMapRemove(overdrawCaches, self);
+    }
 
   [super dealloc];
 }
@@ -300,6 +365,27 @@ static inline NSRect integralRect (NSRect rect, NSView *view)
           CGFloat dx = newBounds.origin.x - originalBounds.origin.x;
           CGFloat dy = newBounds.origin.y - originalBounds.origin.y;
           NSRect redrawRect;
+
+          /* Keep the part scrolled out of view for later, unless it
+             is waiting to be redrawn anyway. */
+          if (_rFlags.caches_drawing && dx == 0 && ![self needsDisplay])
+            {
+              if (dy > 0)
+                {
+                  redrawRect = NSMakeRect(NSMinX(originalBounds),
+                                          NSMinY(originalBounds),
+                                          NSWidth(originalBounds), dy);
+                }
+              else
+                {
+                  redrawRect = NSMakeRect(NSMinX(originalBounds),
+                                          NSMaxY(originalBounds) + dy,
+                                          NSWidth(originalBounds), -dy);
+                }
+              redrawRect = NSIntersectionRect(redrawRect, [self visibleRect]);
+              [self _cacheScrolledOutRect: integralRect(redrawRect, self)
+                            aroundBounds: newBounds];
+            }
                     
           /* Copy the intersection to the new position */
           [self scrollRect: intersection by: NSMakeSize(-dx, -dy)];
@@ -323,45 +409,25 @@ static inline NSRect integralRect (NSRect rect, NSView *view)
           redrawRect = NSMakeRect(NSMinX(_bounds), _bounds.origin.y,
                                   NSMinX(intersection) - NSMinX(_bounds),
                                   _bounds.size.height);
-          if (NSIsEmptyRect(redrawRect) == NO)
-            {
-              [_documentView setNeedsDisplayInRect: 
-                                 [self convertRect: redrawRect 
-                                       toView: _documentView]];
-            }
+          [self _redisplayScrolledInRect: redrawRect];
           
           /* Right */
           redrawRect = NSMakeRect(NSMaxX(intersection), _bounds.origin.y,
                                   NSMaxX(_bounds) - NSMaxX(intersection),
                                   _bounds.size.height);
-          if (NSIsEmptyRect(redrawRect) == NO)
-            {
-              [_documentView setNeedsDisplayInRect: 
-                                 [self convertRect: redrawRect 
-                                       toView: _documentView]];
-            }
+          [self _redisplayScrolledInRect: redrawRect];
           
           /* Up (or Down according to whether it's flipped or not) */
           redrawRect = NSMakeRect(_bounds.origin.x, NSMinY(_bounds),
                                   _bounds.size.width, 
                                   NSMinY(intersection) - NSMinY(_bounds));
-          if (NSIsEmptyRect(redrawRect) == NO)
-            {
-              [_documentView setNeedsDisplayInRect: 
-                                 [self convertRect: redrawRect 
-                                       toView: _documentView]];
-            }
+          [self _redisplayScrolledInRect: redrawRect];
           
           /* Down (or Up) */
           redrawRect = NSMakeRect(_bounds.origin.x, NSMaxY(intersection),
                                   _bounds.size.width, 
                                   NSMaxY(_bounds) - NSMaxY(intersection));
-          if (NSIsEmptyRect(redrawRect) == NO)
-            {
-              [_documentView setNeedsDisplayInRect: 
-                                 [self convertRect: redrawRect 
-                                       toView: _documentView]];
-            }
+          [self _redisplayScrolledInRect: redrawRect];
         }
     }
   else
@@ -546,6 +612,8 @@ static inline NSRect integralRect (NSRect rect, NSView *view)
 - (void) scaleUnitSquareToSize: (NSSize)newUnitSize
 {
   [super scaleUnitSquareToSize: newUnitSize];
+  // Pixels kept at the old scale can not be reused
+  [self _discardDrawingCache];
   [_super_view reflectScrolledClipView: self];
 }
 
@@ -675,6 +743,36 @@ static inline NSRect integralRect (NSRect rect, NSView *view)
   return _drawsBackground;
 }
 
+- (void) setOverdrawMargin: (CGFloat)margin
+{
+  if (margin > 0)
+    {
+      GSOverdrawCache *cache = [GSOverdrawCache new];
+
+      cache->margin = margin;
+      if (overdrawCaches == 0)
+        {
+          overdrawCaches = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                                            NSObjectMapValueCallBacks, 0);
+        }
+      NSMapInsert(overdrawCaches, self, cache);
+      RELEASE(cache);
+      _rFlags.caches_drawing = YES;
+    }
+  else if (_rFlags.caches_drawing)
+    {
+      NSMapRemove(overdrawCaches, self);
+      _rFlags.caches_drawing = NO;
+    }
+}
+
+- (CGFloat) overdrawMargin
+{
+  GSOverdrawCache *cache = overdrawCacheForClipView(self);
+
+  return (cache == nil) ? 0.0 : cache->margin;
+}
+
 - (BOOL) isOpaque
 {
   return _isOpaque;
@@ -846,5 +944,132 @@ static inline NSRect integralRect (NSRect rect, NSView *view)
   [self scrollToPoint: newBounds.origin]; 
 }
 
+/*
+ * Copies rect, which is about to be scrolled out of view, from the
+ * window into the overdraw image.  The image covers newBounds and the
+ * overdraw margin above and below it, and is moved along when rect is
+ * outside of it.  The valid part of the image is kept as one rectangle.
+ */
+- (void) _cacheScrolledOutRect: (NSRect)rect
+                 aroundBounds: (NSRect)newBounds
+{
+  GSOverdrawCache *cache = overdrawCacheForClipView(self);
+  NSBitmapImageRep *rep;
+  BOOL flipped = [self isFlipped];
+
+  if (cache == nil || NSIsEmptyRect(rect))
+    {
+      return;
+    }
+
+  if (cache->image == nil
+    || NSMinX(cache->rect) != NSMinX(newBounds)
+    || NSWidth(cache->rect) != NSWidth(newBounds)
+    || NSContainsRect(cache->rect, rect) == NO)
+    {
+      NSRect cacheRect = NSInsetRect(newBounds, 0, -cache->margin);
+      NSRect keep = NSIntersectionRect(cache->valid, cacheRect);
+      NSImage *image;
+
+      image = [[NSImage alloc] initWithSize: cacheRect.size];
+      if (cache->image != nil
+        && NSMinX(cache->rect) == NSMinX(cacheRect)
+        && NSWidth(cache->rect) == NSWidth(cacheRect)
+        && NSIsEmptyRect(keep) == NO)
+        {
+          [image lockFocus];
+          [cache->image drawInRect: overdrawImageRect(keep, cacheRect,
+                                                      flipped)
+                          fromRect: overdrawImageRect(keep, cache->rect,
+                                                      flipped)
+                         operation: NSCompositeCopy
+                          fraction: 1.0];
+          [image unlockFocus];
+        }
+      else
+        {
+          keep = NSZeroRect;
+        }
+      RELEASE(cache->image);
+      cache->image = image;
+      cache->rect = cacheRect;
+      cache->valid = keep;
+    }
+
+  rect = NSIntersectionRect(rect, cache->rect);
+  if (NSIsEmptyRect(rect))
+    {
+      return;
+    }
+  [self lockFocus];
+  rep = [[NSBitmapImageRep alloc] initWithFocusedViewRect: rect];
+  [self unlockFocus];
+  if (rep == nil)
+    {
+      return;
+    }
+  [cache->image lockFocus];
+  [rep drawInRect: overdrawImageRect(rect, cache->rect, flipped)];
+  [cache->image unlockFocus];
+  RELEASE(rep);
+
+  if (NSMaxY(cache->valid) < NSMinY(rect)
+    || NSMaxY(rect) < NSMinY(cache->valid)
+    || NSIsEmptyRect(cache->valid))
+    {
+      cache->valid = rect;
+    }
+  else
+    {
+      cache->valid = NSUnionRect(cache->valid, rect);
+    }
+}
+
+/*
+ * Gets rect, which has just been scrolled into view, drawn: from the
+ * overdraw image when it holds all of rect, else by the document view.
+ */
+- (void) _redisplayScrolledInRect: (NSRect)rect
+{
+  GSOverdrawCache *cache = overdrawCacheForClipView(self);
+  BOOL caches = _rFlags.caches_drawing;
+
+  if (NSIsEmptyRect(rect))
+    {
+      return;
+    }
+
+  if (cache != nil && cache->image != nil
+    && NSContainsRect(cache->valid, rect))
+    {
+      [self lockFocus];
+      [cache->image drawInRect: rect
+                      fromRect: overdrawImageRect(rect, cache->rect,
+                                                  [self isFlipped])
+                     operation: NSCompositeCopy
+                      fraction: 1.0
+                respectFlipped: YES
+                         hints: nil];
+      [self unlockFocus];
+      return;
+    }
+
+  // Marking our own document view must not drop the overdraw image
+  _rFlags.caches_drawing = 0;
+  [_documentView setNeedsDisplayInRect: 
+                     [self convertRect: rect toView: _documentView]];
+  _rFlags.caches_drawing = caches;
+}
+
+- (void) _discardDrawingCache
+{
+  GSOverdrawCache *cache = overdrawCacheForClipView(self);
+
+  if (cache != nil)
+    {
+      cache->valid = NSZeroRect;
+    }
+}
+
 @end
 
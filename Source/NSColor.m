@@ -69,8 +69,11 @@ static Class	NSColorClass;
   NSString *_color_name;
   NSString *_cached_name_space;
   NSColor *_cached_color;
+  unsigned _cached_generation;
 }
 
++ (NSColor*) colorWithCatalogName: (NSString *)listName
+			colorName: (NSString *)colorName;
 - (NSColor*) initWithCatalogName: (NSString *)listName
 		       colorName: (NSString *)colorName;
 - (void) recache;
@@ -179,6 +182,17 @@ static NSColorList		*defaultSystemColors = nil;
 static NSMutableDictionary	*colorStrings = nil;
 static NSMutableDictionary	*systemDict = nil;
 
+/* Bumped whenever a colour list or the theme changes, so that named
+ * colours know their cached device colour may be out of date.
+ */
+static unsigned			colorGeneration = 1;
+
+void
+GSInvalidateColorCaches(void)
+{
+  __sync_fetch_and_add(&colorGeneration, 1);
+}
+
 static
 void initSystemColors(void)
 {
@@ -431,13 +445,8 @@ systemColorWithName(NSString *name)
 + (NSColor*) colorWithCatalogName: (NSString *)listName
 			colorName: (NSString *)colorName
 {
-  id color;
-
-  color = [GSNamedColor allocWithZone: NSDefaultMallocZone()] ;
-  color = [color initWithCatalogName: listName
-		 colorName: colorName];
-
-  return AUTORELEASE(color);
+  return [GSNamedColor colorWithCatalogName: listName
+				  colorName: colorName];
 }
 
 /**<p>Creates and returns a new NSColor in a NSDeviceCMYKColorSpace space
@@ -2021,9 +2030,8 @@ systemColorWithName(NSString *name)
 	    {
 	      didChange = YES;
 	      [colorStrings setObject: def forKey: key];
+	      // Setting the colour refreshes the cached named colours
 	      [systemColors setColor: color forKey: key];
-	      // Refresh the cache for this named colour
-	      [[systemDict objectForKey: key] recache];
 	    }
 	}
     }
@@ -2045,7 +2053,6 @@ systemColorWithName(NSString *name)
   GSTheme	*theme = [notification object];
   NSColorList	*list = [theme colors];
   NSEnumerator	*enumerator;
-  NSString	*name;
   NSString	*key;
 
   if (list == nil)
@@ -2061,11 +2068,7 @@ systemColorWithName(NSString *name)
    */
   list = [NSColorList colorListNamed: @"System"];
   ASSIGN(systemColors, list);
-  enumerator = [systemDict keyEnumerator];
-  while ((name = [enumerator nextObject]) != nil)
-    {
-      [[systemDict objectForKey: name] recache];
-    }
+  GSInvalidateColorCaches();
 
   if (list != defaultSystemColors)
     {
@@ -2101,6 +2104,26 @@ static	NSRecursiveLock		*namedColorLock = nil;
   namedColors = [NSMutableDictionary new];
 }
 
++ (NSColor*) colorWithCatalogName: (NSString *)listName
+			colorName: (NSString *)colorName
+{
+  NSColor	*c;
+
+  /* Named colours are interned, so look for an existing one before
+   * creating a new instance.
+   */
+  [namedColorLock lock];
+  c = [[namedColors objectForKey: listName] objectForKey: colorName];
+  RETAIN(c);
+  [namedColorLock unlock];
+  if (c == nil)
+    {
+      c = [[self allocWithZone: NSDefaultMallocZone()]
+	    initWithCatalogName: listName colorName: colorName];
+    }
+  return AUTORELEASE(c);
+}
+
 - (NSColor*) initWithCatalogName: (NSString *)listName
 		       colorName: (NSString *)colorName
 {
@@ -2231,12 +2254,13 @@ static	NSRecursiveLock		*namedColorLock = nil;
       return self;
     }
 
-  // Is there a cache hit?
-  // FIXME How would we detect that the cache has become invalid by a
-  // change to the colour list?
+  // Is there a cache hit?  The cache is invalid once any colour list
+  // has changed since it was filled.
   [namedColorLock lock];
-  if (NO == [colorSpace isEqualToString: _cached_name_space])
+  if (_cached_generation != colorGeneration
+    || NO == [colorSpace isEqualToString: _cached_name_space])
     {
+      _cached_generation = colorGeneration;
       list = [NSColorList colorListNamed: _catalog_name];
       real = [list colorWithKey: _color_name];
       if (real == nil)
@@ -2448,6 +2472,31 @@ static	NSRecursiveLock		*namedColorLock = nil;
   PSsetalpha(_alpha_component);
 }
 
+/* Pass the equivalent device RGB components straight to the context,
+ * rather than allocating a converted colour as NSColor would.
+ */
+- (void) setFill
+{
+  CGFloat values[4];
+  NSGraphicsContext *ctxt = GSCurrentContext();
+
+  values[0] = values[1] = values[2] = _white_component;
+  values[3] = _alpha_component;
+  [ctxt GSSetFillColorspace: [NSColorSpace deviceRGBColorSpace]];
+  [ctxt GSSetFillColor: values];
+}
+
+- (void) setStroke
+{
+  CGFloat values[4];
+  NSGraphicsContext *ctxt = GSCurrentContext();
+
+  values[0] = values[1] = values[2] = _white_component;
+  values[3] = _alpha_component;
+  [ctxt GSSetStrokeColorspace: [NSColorSpace deviceRGBColorSpace]];
+  [ctxt GSSetStrokeColor: values];
+}
+
 //
 // NSCoding protocol
 //
@@ -2774,6 +2823,43 @@ static	NSRecursiveLock		*namedColorLock = nil;
   PSsetalpha(_alpha_component);
 }
 
+/* Same conversion as -colorUsingColorSpaceName:device: to device RGB,
+ * but without allocating an intermediate colour.
+ */
+static inline void
+cmykToDeviceRGB(CGFloat c, CGFloat m, CGFloat y, CGFloat k, CGFloat *values)
+{
+  CGFloat white = 1 - k;
+
+  values[0] = (c > white ? 0 : white - c);
+  values[1] = (m > white ? 0 : white - m);
+  values[2] = (y > white ? 0 : white - y);
+}
+
+- (void) setFill
+{
+  CGFloat values[4];
+  NSGraphicsContext *ctxt = GSCurrentContext();
+
+  cmykToDeviceRGB(_cyan_component, _magenta_component,
+    _yellow_component, _black_component, values);
+  values[3] = _alpha_component;
+  [ctxt GSSetFillColorspace: [NSColorSpace deviceRGBColorSpace]];
+  [ctxt GSSetFillColor: values];
+}
+
+- (void) setStroke
+{
+  CGFloat values[4];
+  NSGraphicsContext *ctxt = GSCurrentContext();
+
+  cmykToDeviceRGB(_cyan_component, _magenta_component,
+    _yellow_component, _black_component, values);
+  values[3] = _alpha_component;
+  [ctxt GSSetStrokeColorspace: [NSColorSpace deviceRGBColorSpace]];
+  [ctxt GSSetStrokeColor: values];
+}
+
 //
 // NSCoding protocol
 //
@@ -44,6 +44,7 @@
 #import "AppKit/NSColorList.h"
 #import "AppKit/NSColor.h"
 #import "AppKit/AppKitExceptions.h"
+#import "GSGuiPrivate.h"
 
 // The list of available color lists is cached and re-loaded only
 // after a time.
@@ -343,6 +344,7 @@ static NSColorList *themeColorList = nil;
   [_orderedColorKeys removeObject: key];
   [_orderedColorKeys insertObject: key atIndex: location];
   
+  GSInvalidateColorCaches();
   n = [NSNotification notificationWithName: NSColorListDidChangeNotification
 				    object: self
 				  userInfo: nil];
@@ -364,6 +366,7 @@ static NSColorList *themeColorList = nil;
   [_colorDictionary removeObjectForKey: key];
   [_orderedColorKeys removeObject: key];
 
+  GSInvalidateColorCaches();
   n = [NSNotification notificationWithName: NSColorListDidChangeNotification
 				    object: self
 				  userInfo: nil];
@@ -388,6 +391,7 @@ static NSColorList *themeColorList = nil;
   if ([_orderedColorKeys containsObject: key] == NO)
     [_orderedColorKeys addObject: key];
 
+  GSInvalidateColorCaches();
   n = [NSNotification notificationWithName: NSColorListDidChangeNotification
 				    object: self
 				  userInfo: nil];
@@ -525,6 +529,7 @@ static NSColorList *themeColorList = nil;
       [_colorListLock lock];
       [_availableColorLists removeObject: self];
       [_colorListLock unlock];
+      GSInvalidateColorCaches();
 
       // Reset file name
       _fullFileName = nil;
@@ -672,6 +677,7 @@ static NSColorList *themeColorList = nil;
 	  [_availableColorLists removeLastObject];
 	}
       ASSIGN(defaultSystemColorList, aList);
+      GSInvalidateColorCaches();
       [_availableColorLists addObject: aList];
     }
   [_colorListLock unlock];
@@ -688,6 +694,7 @@ static NSColorList *themeColorList = nil;
 	  [_availableColorLists removeObjectAtIndex: 0];
 	}
       ASSIGN(themeColorList, aList);
+      GSInvalidateColorCaches();
       [_availableColorLists insertObject: aList atIndex: 0];
     }
   [_colorListLock unlock];
@@ -31,6 +31,7 @@
 #import <Foundation/NSArray.h>
 #import <Foundation/NSRunLoop.h>
 #import <Foundation/NSException.h>
+#import <Foundation/NSMapTable.h>
 #import <Foundation/NSAutoreleasePool.h>
 #import <Foundation/NSValue.h>
 #import "AppKit/NSApplication.h"
@@ -87,6 +88,7 @@ static NSNotificationCenter *nc;
 - (void) clickItem: (id)sender;
 - (void) reloadData;
 - (void) noteNumberOfItemsChanged;
+- (void) noteItemsChangedFromIndex: (NSInteger)index;
 - (void) scrollItemAtIndexToTop: (NSInteger)index;
 - (void) scrollItemAtIndexToVisible: (NSInteger)index;
 - (void) selectItemAtIndex: (NSInteger)index;
@@ -97,6 +99,8 @@ static NSNotificationCenter *nc;
 
 @end
 
+@class GSComboBoxItemIndex;
+
 @interface NSComboBoxCell (GNUstepPrivate)
 - (NSString *) _stringValueAtIndex: (NSInteger)index;
 - (void) _performClickWithFrame: (NSRect)cellFrame inView: (NSView *)controlView;
@@ -107,12 +111,30 @@ static NSNotificationCenter *nc;
 - (void) _setSelectedItem: (NSInteger)index;
 - (void) _loadButtonCell;
 - (void) _selectCompleted;
+- (GSComboBoxItemIndex *) _itemIndex;
 @end
 
 // ---
 
 static GSComboWindow *gsWindow = nil;
 
+/* The indexes of the default lists of the cells, which are only built
+ * for the cells whose list is searched, so they are kept here rather
+ * than in every cell.  */
+static NSMapTable *itemIndexes = 0;
+
+static inline GSComboBoxItemIndex *
+existingItemIndex(NSComboBoxCell *cell)
+{
+  return (GSComboBoxItemIndex *)NSMapGet(itemIndexes, cell);
+}
+
+static inline void
+discardItemIndex(NSComboBoxCell *cell)
+{
+  NSMapRemove(itemIndexes, cell);
+}
+
 @implementation GSComboWindow
 
 + (GSComboWindow *) defaultPopUp
@@ -460,8 +482,27 @@ static GSComboWindow *gsWindow = nil;
 
 - (void) noteNumberOfItemsChanged
 {
-  // FIXME: Probably should only load the additional items
-  [self reloadData];
+  [_tableView noteNumberOfRowsChanged];
+  [self selectItemAtIndex: [_cell indexOfSelectedItem]];
+}
+
+/* Items were inserted or removed at index, so the rows from there on
+ * show other items, while those before it are still right.  */
+- (void) noteItemsChangedFromIndex: (NSInteger)index
+{
+  NSRect rect = [_tableView bounds];
+  CGFloat top;
+
+  [_tableView noteNumberOfRowsChanged];
+  rect = NSUnionRect(rect, [_tableView bounds]);
+  top = index * ([_tableView rowHeight] + [_tableView intercellSpacing].height);
+  if (top < NSMaxY(rect))
+    {
+      rect.size.height = NSMaxY(rect) - top;
+      rect.origin.y = top;
+      [_tableView setNeedsDisplayInRect: rect];
+    }
+  [self selectItemAtIndex: [_cell indexOfSelectedItem]];
 }
 
 - (void) scrollItemAtIndexToTop: (NSInteger)index
@@ -609,6 +650,181 @@ static GSComboWindow *gsWindow = nil;
 
 // ---
 
+/* An item of the default list of a combo box cell, in the list of
+ * descriptions sorted for completion.  */
+typedef struct
+{
+  NSString *string;
+  NSUInteger index;
+} GSComboBoxSortedItem;
+
+static int
+compareSortedItems(const void *a, const void *b)
+{
+  const GSComboBoxSortedItem *i1 = a;
+  const GSComboBoxSortedItem *i2 = b;
+  NSComparisonResult r;
+
+  r = [i1->string compare: i2->string options: NSLiteralSearch];
+  if (r != NSOrderedSame)
+    return r;
+  if (i1->index != i2->index)
+    return i1->index < i2->index ? -1 : 1;
+  return 0;
+}
+
+/* Indexes the default list of a combo box cell by value, for the lowest
+ * index of each value, and by description, sorted so that items with a
+ * common prefix are next to each other.  Items added at the end of the
+ * list are added to the index, other changes of the list discard it.
+ */
+@interface GSComboBoxItemIndex : NSObject
+{
+  NSMapTable *_indexes;
+  GSComboBoxSortedItem *_sorted;
+  NSUInteger _count;
+  NSUInteger _capacity;
+}
+- (id) initWithItems: (NSArray *)items;
+- (NSUInteger) count;
+- (void) addItems: (NSArray *)items;
+- (NSUInteger) indexOfObject: (id)object;
+- (NSString *) completedString: (NSString *)substring;
+@end
+
+@implementation GSComboBoxItemIndex
+
+- (id) initWithItems: (NSArray *)items
+{
+  if ((self = [super init]) != nil)
+    {
+      _indexes = NSCreateMapTable(NSObjectMapKeyCallBacks,
+        NSIntegerMapValueCallBacks, [items count]);
+      [self addItems: items];
+    }
+  return self;
+}
+
+- (void) dealloc
+{
+  NSUInteger i;
+
+  for (i = 0; i < _count; i++)
+    {
+      RELEASE(_sorted[i].string);
+    }
+  free(_sorted);
+  NSFreeMapTable(_indexes);
+  [super dealloc];
+}
+
+- (NSUInteger) count
+{
+  return _count;
+}
+
+/* Returns the position in _sorted of the first item whose description
+ * is not before string.  */
+- (NSUInteger) _lowerBound: (NSString *)string
+{
+  NSUInteger lo = 0;
+  NSUInteger hi = _count;
+
+  while (lo < hi)
+    {
+      NSUInteger mid = (lo + hi) / 2;
+
+      if ([_sorted[mid].string compare: string options: NSLiteralSearch]
+        == NSOrderedAscending)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+- (void) addItems: (NSArray *)items
+{
+  NSUInteger n = [items count];
+  NSUInteger first = _count;
+  NSUInteger i;
+
+  if (_count + n > _capacity)
+    {
+      _capacity = MAX(_capacity * 2, _count + n);
+      _sorted = realloc(_sorted, _capacity * sizeof(GSComboBoxSortedItem));
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      id object = [items objectAtIndex: i];
+      GSComboBoxSortedItem item;
+
+      /* Keep the lowest index of equal values.  */
+      NSMapInsertIfAbsent(_indexes, object, (void *)(uintptr_t)(first + i));
+
+      item.string = RETAIN([object description]);
+      item.index = first + i;
+      if (n > 16)
+        {
+          _sorted[_count++] = item;
+        }
+      else
+        {
+          /* Items added later have higher indexes, so they go after
+             those with the same description.  */
+          NSUInteger pos = [self _lowerBound: item.string];
+
+          while (pos < _count
+            && [_sorted[pos].string isEqualToString: item.string])
+            pos++;
+          memmove(&_sorted[pos + 1], &_sorted[pos],
+            (_count - pos) * sizeof(GSComboBoxSortedItem));
+          _sorted[pos] = item;
+          _count++;
+        }
+    }
+  if (n > 16)
+    {
+      qsort(_sorted, _count, sizeof(GSComboBoxSortedItem), compareSortedItems);
+    }
+}
+
+- (NSUInteger) indexOfObject: (id)object
+{
+  void *index;
+
+  if (object != nil && NSMapMember(_indexes, object, NULL, &index))
+    {
+      return (NSUInteger)(uintptr_t)index;
+    }
+  return NSNotFound;
+}
+
+/* Returns the description of the first item in the list which is
+ * longer than substring and starts with it, or nil.  */
+- (NSString *) completedString: (NSString *)substring
+{
+  NSUInteger length = [substring length];
+  NSUInteger pos = [self _lowerBound: substring];
+  NSString *best = nil;
+  NSUInteger bestIndex = NSNotFound;
+
+  for (; pos < _count && [_sorted[pos].string hasPrefix: substring]; pos++)
+    {
+      if (_sorted[pos].index < bestIndex && [_sorted[pos].string length] > length)
+        {
+          best = _sorted[pos].string;
+          bestIndex = _sorted[pos].index;
+        }
+    }
+  return best;
+}
+
+@end
+
+// ---
+
 /**
  <unit>
  <heading>Class Description</heading> 
@@ -639,6 +855,8 @@ static GSComboWindow *gsWindow = nil;
     {
       [NSComboBoxCell setVersion: 2];
       nc = [NSNotificationCenter defaultCenter];
+      itemIndexes = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                                     NSObjectMapValueCallBacks, 0);
     }
 }
 
@@ -668,6 +886,7 @@ static GSComboWindow *gsWindow = nil;
 {
   RELEASE(_buttonCell);
   RELEASE(_popUpList);
+  discardItemIndex(self);
   
   [super dealloc];
 }
@@ -772,6 +991,7 @@ static GSComboWindow *gsWindow = nil;
  */
 - (void) reloadData
 {
+  discardItemIndex(self);
   [_popup reloadData];
 }
 
@@ -788,6 +1008,7 @@ static GSComboWindow *gsWindow = nil;
  */
 - (void) noteNumberOfItemsChanged
 {
+  discardItemIndex(self);
   [_popup noteNumberOfItemsChanged];
 }
 
@@ -973,9 +1194,10 @@ static GSComboWindow *gsWindow = nil;
   else
     {
       [_popUpList addObject: object];
+      [existingItemIndex(self) addItems: [NSArray arrayWithObject: object]];
     }
     
-  [self reloadData];
+  [_popup noteNumberOfItemsChanged];
 }
 
 /**
@@ -993,9 +1215,10 @@ static GSComboWindow *gsWindow = nil;
   else
     {
       [_popUpList addObjectsFromArray: objects];
+      [existingItemIndex(self) addItems: objects];
     }
     
-  [self reloadData];
+  [_popup noteNumberOfItemsChanged];
 }
 
 /**
@@ -1013,9 +1236,11 @@ static GSComboWindow *gsWindow = nil;
   else
     {
       [_popUpList insertObject: object atIndex: index];
+      /* Every item after index moves, which costs the index as much as
+         building it again when it is next used.  */
+      discardItemIndex(self);
+      [_popup noteItemsChangedFromIndex: index];
     }
-    
-  [self reloadData];
 }
 
 /**
@@ -1032,10 +1257,15 @@ static GSComboWindow *gsWindow = nil;
     }
   else
     {
-      [_popUpList removeObject: object];
+      NSInteger index = [self indexOfItemWithObjectValue: object];
+
+      if (index != NSNotFound)
+        {
+          [_popUpList removeObject: object];
+          discardItemIndex(self);
+          [_popup noteItemsChangedFromIndex: index];
+        }
     }
-    
-  [self reloadData];
 }
 
 /**
@@ -1053,9 +1283,9 @@ static GSComboWindow *gsWindow = nil;
   else
     {
       [_popUpList removeObjectAtIndex: index];
+      discardItemIndex(self);
+      [_popup noteItemsChangedFromIndex: index];
     }
-    
-  [self reloadData];
 }
 
 /**
@@ -1073,6 +1303,7 @@ static GSComboWindow *gsWindow = nil;
   else
     {
       [_popUpList removeAllObjects];
+      discardItemIndex(self);
     }
     
   [self reloadData];
@@ -1096,7 +1327,7 @@ static GSComboWindow *gsWindow = nil;
    }
  else
    {
-     NSInteger i = [_popUpList indexOfObject: object];
+     NSInteger i = [[self _itemIndex] indexOfObject: object];
 
      if (i == NSNotFound)
        i = -1;
@@ -1211,7 +1442,7 @@ static GSComboWindow *gsWindow = nil;
       return 0;
     }
     
-  return [_popUpList indexOfObject: object];
+  return [[self _itemIndex] indexOfObject: object];
 }
 
 /** 
@@ -1282,15 +1513,10 @@ static GSComboWindow *gsWindow = nil;
     }
   else
     {
-      NSUInteger i;
-
-      for (i = 0; i < [_popUpList count]; i++)
-        {
-	  NSString *str = [[_popUpList objectAtIndex: i] description];
+      NSString *str = [[self _itemIndex] completedString: substring];
 
-	  if ([str length] > [substring length] && [str hasPrefix: substring])
-	    return str;
-        }
+      if (str != nil)
+        return str;
     }
   
   return substring;
@@ -1630,6 +1856,7 @@ static inline NSRect buttonCellFrameFromRect(NSRect cellRect)
       if ([aDecoder containsValueForKey: @"NSPopUpListData"])
         {
           ASSIGN(_popUpList, [aDecoder decodeObjectForKey: @"NSPopUpListData"]);
+          discardItemIndex(self);
         }
     }
   else
@@ -1767,6 +1994,23 @@ static inline NSRect buttonCellFrameFromRect(NSRect cellRect)
 
 @implementation NSComboBoxCell (GNUstepPrivate)
 
+/* Returns the index of the default list, building it if the list was
+ * changed by other means than adding items since it was last used.  The
+ * list may also be changed through -objectValues, after which the owner
+ * calls -reloadData or -noteNumberOfItemsChanged.  */
+- (GSComboBoxItemIndex *) _itemIndex
+{
+  GSComboBoxItemIndex *index = existingItemIndex(self);
+
+  if (index == nil)
+    {
+      index = [[GSComboBoxItemIndex alloc] initWithItems: _popUpList];
+      NSMapInsert(itemIndexes, self, index);
+      RELEASE(index);
+    }
+  return index;
+}
+
 - (NSString *) _stringValueAtIndex: (NSInteger)index
 {
   if (_usesDataSource == NO)
@@ -31,9 +31,12 @@
 #import <Foundation/NSData.h>
 #import <Foundation/NSError.h>
 #import <Foundation/NSException.h>
+#import <Foundation/NSFileHandle.h>
 #import <Foundation/NSFileManager.h>
 #import <Foundation/NSNotification.h>
+#import <Foundation/NSOperation.h>
 #import <Foundation/NSProcessInfo.h>
+#import <Foundation/NSThread.h>
 #import <Foundation/NSUndoManager.h>
 #import <Foundation/NSURL.h>
 #import "AppKit/NSBox.h"
@@ -59,6 +62,97 @@ create_error(int code, NSString* desc)
                                 NSLocalizedDescriptionKey, nil]];
 }
 
+/*
+ * A background autosave.  The document contents are captured on the
+ * main thread, either as a complete file wrapper or as a delta to append
+ * to the existing autosave file, and written by -main on a serial
+ * operation queue.  The result is handed back to the document on the
+ * main thread.
+ */
+@interface GSDocumentAutosave : NSOperation
+{
+@public
+  NSDocument	*document;
+  NSURL		*url;
+  NSFileWrapper	*wrapper;
+  NSData	*delta;
+  NSDictionary	*attributes;
+  long		changeCount;
+  id		delegate;
+  SEL		didAutosaveSelector;
+  void		*contextInfo;
+  BOOL		saved;
+  NSError	*error;
+}
+@end
+
+@implementation GSDocumentAutosave
+
+- (void) dealloc
+{
+  RELEASE(document);
+  RELEASE(url);
+  RELEASE(wrapper);
+  RELEASE(delta);
+  RELEASE(attributes);
+  RELEASE(error);
+  [super dealloc];
+}
+
+- (void) main
+{
+  NSAutoreleasePool *pool = [NSAutoreleasePool new];
+  NSString *path = [url path];
+
+  if (delta != nil)
+    {
+      NSFileHandle *handle;
+
+      handle = [NSFileHandle fileHandleForUpdatingAtPath: path];
+      NS_DURING
+        {
+          [handle seekToEndOfFile];
+          [handle writeData: delta];
+          [handle synchronizeFile];
+          saved = (handle != nil);
+        }
+      NS_HANDLER
+        {
+          saved = NO;
+        }
+      NS_ENDHANDLER
+      [handle closeFile];
+    }
+  else
+    {
+      /* The wrapper is written to a temporary file and renamed into
+       * place, so a crash never leaves a truncated autosave behind.
+       */
+      saved = [wrapper writeToFile: path atomically: YES updateFilenames: NO];
+    }
+
+  if (saved)
+    {
+      if (attributes != nil)
+        {
+          [[NSFileManager defaultManager] changeFileAttributes: attributes
+                                                        atPath: path];
+        }
+    }
+  else
+    {
+      error = RETAIN(create_error(0, NSLocalizedString(@"Could not write autosave file.",
+                                                       @"Error description")));
+    }
+
+  [document performSelectorOnMainThread: @selector(_autosaveDidFinish:)
+                             withObject: self
+                          waitUntilDone: NO];
+  [pool release];
+}
+
+@end
+
 @implementation NSDocument
 
 + (NSArray *) readableTypes
@@ -1847,6 +1941,32 @@ originalContentsURL: (NSURL *)orig
       _recordAutosavedDocument: self];
 }
 
+- (BOOL) canAsynchronouslyWriteToURL: (NSURL *)url
+                               ofType: (NSString *)type
+                     forSaveOperation: (NSSaveOperationType)op
+{
+  if (op != NSAutosaveOperation || ![url isFileURL]
+      || ![[self class] isNativeType: type])
+    {
+      return NO;
+    }
+
+  /* Only the default writing path can be split into a snapshot taken
+   * here and a write done elsewhere.
+   */
+  if (OVERRIDDEN(saveToURL:ofType:forSaveOperation:error:)
+      || OVERRIDDEN(writeSafelyToURL:ofType:forSaveOperation:error:)
+      || OVERRIDDEN(writeWithBackupToFile:ofType:saveOperation:)
+      || OVERRIDDEN(writeToURL:ofType:forSaveOperation:originalContentsURL:error:)
+      || OVERRIDDEN(writeToFile:ofType:originalFile:saveOperation:)
+      || OVERRIDDEN(writeToURL:ofType:error:)
+      || OVERRIDDEN(writeToFile:ofType:))
+    {
+      return NO;
+    }
+  return YES;
+}
+
 - (void) autosaveDocumentWithDelegate: (id)delegate
                   didAutosaveSelector: (SEL)didAutosaveSelector
                           contextInfo: (void *)context
@@ -1873,6 +1993,18 @@ originalContentsURL: (NSURL *)orig
       url = [NSURL fileURLWithPath: path];
     }
 
+  if ([self canAsynchronouslyWriteToURL: url
+                                 ofType: type
+                       forSaveOperation: NSAutosaveOperation])
+    {
+      [self _autosaveInBackgroundToURL: url
+                                ofType: type
+                              delegate: delegate
+                   didAutosaveSelector: didAutosaveSelector
+                           contextInfo: context];
+      return;
+    }
+
   [self saveToURL: url
         ofType: type
         forSaveOperation: NSAutosaveOperation
@@ -1893,6 +2025,23 @@ originalContentsURL: (NSURL *)orig
 
 @end
 
+@implementation NSDocument (GNUstep)
+
+- (BOOL) autosavesIncrementally
+{
+  return NO;
+}
+
+- (NSData *) autosaveDeltaOfType: (NSString *)type
+                           error: (NSError **)error
+{
+  if (error)
+    *error = nil;
+  return nil;
+}
+
+@end
+
 @implementation NSDocument(Private)
 
 /*
@@ -1928,6 +2077,13 @@ originalContentsURL: (NSURL *)orig
 {
   NSURL *url = [self autosavedContentsFileURL];
 
+  /* A background autosave still in flight must not bring the file back.
+   */
+  if (_doc_flags.autosave_in_progress)
+    {
+      _doc_flags.autosave_discarded = 1;
+    }
+
   if (url)
     {
       NSString *path = [[url path] retain];
@@ -1938,6 +2094,148 @@ originalContentsURL: (NSURL *)orig
     }
 }
 
+- (void) _autosaveInBackgroundToURL: (NSURL *)url
+                              ofType: (NSString *)type
+                            delegate: (id)delegate
+                 didAutosaveSelector: (SEL)didAutosaveSelector
+                         contextInfo: (void *)context
+{
+  static NSOperationQueue *autosaveQueue = nil;
+  GSDocumentAutosave *job;
+  NSFileWrapper *wrapper = nil;
+  NSData *delta = nil;
+  NSError *error = nil;
+
+  /* One autosave per document at a time; changes made meanwhile are
+   * picked up by the next one.  The delegate still hears that this one
+   * did not happen.
+   */
+  if (_doc_flags.autosave_in_progress)
+    {
+      if (delegate != nil && didAutosaveSelector != NULL)
+        {
+          void (*meth)(id, SEL, id, BOOL, void*);
+          meth = (void (*)(id, SEL, id, BOOL, void*))
+            [delegate methodForSelector: didAutosaveSelector];
+          if (meth)
+            meth(delegate, didAutosaveSelector, self, NO, context);
+        }
+      return;
+    }
+
+  if ([self autosavesIncrementally])
+    {
+      delta = [self autosaveDeltaOfType: type error: &error];
+      if (_doc_flags.autosave_needs_snapshot
+          || ![url isEqual: _autosaved_file_url]
+          || ![[NSFileManager defaultManager] fileExistsAtPath: [url path]])
+        {
+          delta = nil;
+        }
+    }
+  if (delta == nil)
+    {
+      wrapper = [self fileWrapperOfType: type error: &error];
+      if (wrapper == nil)
+        {
+          if (error == nil)
+            {
+              error = create_error(0, NSLocalizedString(@"Could not write file wrapper.",
+                                                        @"Error description"));
+            }
+          [self presentError: error];
+          if (delegate != nil && didAutosaveSelector != NULL)
+            {
+              void (*meth)(id, SEL, id, BOOL, void*);
+              meth = (void (*)(id, SEL, id, BOOL, void*))
+                [delegate methodForSelector: didAutosaveSelector];
+              if (meth)
+                meth(delegate, didAutosaveSelector, self, NO, context);
+            }
+          return;
+        }
+    }
+
+  if (autosaveQueue == nil)
+    {
+      autosaveQueue = [[NSOperationQueue alloc] init];
+      [autosaveQueue setMaxConcurrentOperationCount: 1];
+    }
+
+  job = [[GSDocumentAutosave alloc] init];
+  job->document = RETAIN(self);
+  job->url = RETAIN(url);
+  job->wrapper = RETAIN(wrapper);
+  job->delta = RETAIN(delta);
+  job->attributes = RETAIN([self fileAttributesToWriteToURL: url
+                                                     ofType: type
+                                           forSaveOperation: NSAutosaveOperation
+                                        originalContentsURL: [self fileURL]
+                                                      error: NULL]);
+  job->changeCount = _autosave_change_count;
+  job->delegate = delegate;
+  job->didAutosaveSelector = didAutosaveSelector;
+  job->contextInfo = context;
+
+  _doc_flags.autosave_in_progress = 1;
+  _doc_flags.autosave_discarded = 0;
+  _doc_flags.autosave_needs_snapshot = 0;
+  [autosaveQueue addOperation: job];
+  RELEASE(job);
+}
+
+- (void) _autosaveDidFinish: (GSDocumentAutosave *)job
+{
+  BOOL saved = job->saved;
+
+  _doc_flags.autosave_in_progress = 0;
+  if (_doc_flags.autosave_discarded)
+    {
+      /* The document was saved or closed while the autosave was being
+       * written, so the file is stale.
+       */
+      _doc_flags.autosave_discarded = 0;
+      if (saved && ![job->url isEqual: _autosaved_file_url])
+        {
+          [[NSFileManager defaultManager] removeFileAtPath: [job->url path]
+                                                   handler: nil];
+        }
+      saved = NO;
+    }
+  else if (saved)
+    {
+      if (![job->url isEqual: _autosaved_file_url])
+        {
+          [self setAutosavedContentsFileURL: job->url];
+        }
+      /* Only the changes captured in the snapshot have been autosaved.
+       */
+      _autosave_change_count -= job->changeCount;
+      if (_autosave_change_count == 0)
+        {
+          [self updateChangeCount: NSChangeAutosaved];
+        }
+    }
+  else
+    {
+      /* A partial append may have been written; start again from a
+       * complete snapshot.
+       */
+      _doc_flags.autosave_needs_snapshot = 1;
+      [self presentError: job->error];
+    }
+
+  if (job->delegate != nil && job->didAutosaveSelector != NULL)
+    {
+      void (*meth)(id, SEL, id, BOOL, void*);
+      meth = (void (*)(id, SEL, id, BOOL, void*))
+        [job->delegate methodForSelector: job->didAutosaveSelector];
+      if (meth)
+        meth(job->delegate, job->didAutosaveSelector, self, saved,
+             job->contextInfo);
+    }
+}
+
 - (void) _changeWasDone: (NSNotification *)notification
 {
   /* Prevent a document from appearing unmodified after saving the
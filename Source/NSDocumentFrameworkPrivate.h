@@ -35,6 +35,7 @@
 #import "AppKit/NSWindowController.h"
 
 @class NSTimer;
+@class GSDocumentAutosave;
 
 @interface NSDocumentController (Private)
 - (NSArray *)_readableTypesForClass:(Class)documentClass;
@@ -58,6 +59,12 @@
 - (void)_removeWindowController:(NSWindowController *)controller;
 - (NSWindow *)_transferWindowOwnership;
 - (void)_removeAutosavedContentsFile;
+- (void)_autosaveInBackgroundToURL: (NSURL *)url
+                            ofType: (NSString *)type
+                          delegate: (id)delegate
+               didAutosaveSelector: (SEL)didAutosaveSelector
+                       contextInfo: (void *)context;
+- (void)_autosaveDidFinish: (GSDocumentAutosave *)job;
 @end
 
 @interface NSWindowController (Private)
@@ -34,6 +34,7 @@
 #import <Foundation/NSString.h>
 #import <Foundation/NSUserDefaults.h>
 #import <Foundation/NSSet.h>
+#import <Foundation/NSLock.h>
 #import <Foundation/NSMapTable.h>
 #import <Foundation/NSException.h>
 #import <Foundation/NSDebug.h>
@@ -61,81 +62,86 @@ static int currentVersion = 3;
 
 
 /*
-Instances of GSFontMapKey are used to find cached font instances in
-globalFontMap.
+GSFontMapKey describes a font in globalFontMap.  Lookups use a key on the
+stack; only the keys stored in the map are copied to the heap, and they
+are freed by the map's release callback.
 */
-@interface GSFontMapKey : NSObject
-{
-@public
+typedef struct {
   NSString *name;
   BOOL screenFont;
   int role;
   int matrix[6];
+  NSUInteger hash;
+} GSFontMapKey;
 
-  unsigned int hash;
+static void
+setKeyForFont(GSFontMapKey *d, NSString *name, const CGFloat *matrix, 
+              BOOL screenFont, int role)
+{
+  d->name = name;
+  d->screenFont = screenFont;
+  d->role = role;
+  d->matrix[0] = matrix[0] * 1000;
+  d->matrix[1] = matrix[1] * 1000;
+  d->matrix[2] = matrix[2] * 1000;
+  d->matrix[3] = matrix[3] * 1000;
+  d->matrix[4] = matrix[4] * 1000;
+  d->matrix[5] = matrix[5] * 1000;
+  d->hash = [name hash] + screenFont + role * 4
+            + d->matrix[0] + d->matrix[1] + d->matrix[2] + d->matrix[3];
 }
-@end
-@implementation GSFontMapKey
--(NSUInteger) hash
+
+static NSUInteger
+fontKeyHash(NSMapTable *t, const void *k)
 {
-  return hash;
+  return ((const GSFontMapKey *)k)->hash;
 }
 
--(BOOL) isEqual: (id)other
+static BOOL
+fontKeyIsEqual(NSMapTable *t, const void *k1, const void *k2)
 {
-  GSFontMapKey *o;
-  if (![other isKindOfClass: object_getClass(self)])
-    return NO;
-  o = other;
-  if (hash != o->hash || screenFont != o->screenFont || role != o->role)
-    return NO;
-  if (![name isEqualToString: o->name])
+  const GSFontMapKey *a = k1;
+  const GSFontMapKey *b = k2;
+
+  if (a->hash != b->hash || a->screenFont != b->screenFont
+    || a->role != b->role)
     return NO;
-  if (matrix[0] != o->matrix[0]
-      || matrix[1] != o->matrix[1]
-      || matrix[2] != o->matrix[2]
-      || matrix[3] != o->matrix[3]
-      || matrix[4] != o->matrix[4]
-      || matrix[5] != o->matrix[5])
+  if (memcmp(a->matrix, b->matrix, sizeof(a->matrix)) != 0)
     return NO;
-  return YES;
+  return [a->name isEqualToString: b->name];
 }
 
--(void) dealloc
+static void
+fontKeyRetain(NSMapTable *t, const void *k)
 {
-  DESTROY(name);
-  [super dealloc];
 }
 
-- (NSString *) description
+static void
+fontKeyRelease(NSMapTable *t, void *k)
 {
-  return [NSString stringWithFormat: @"%@ %d %d [%d %d %d %d %d %d]",
-                   name, screenFont, role,
-                   matrix[0], matrix[1], matrix[2],
-                   matrix[3], matrix[4], matrix[5]];
+  RELEASE(((GSFontMapKey *)k)->name);
+  free(k);
 }
 
-@end
-
-static GSFontMapKey *
-keyForFont(NSString *name, const CGFloat *matrix, 
-           BOOL screenFont, int role)
+static NSString *
+fontKeyDescribe(NSMapTable *t, const void *k)
 {
-  GSFontMapKey *d;
-  d=[GSFontMapKey alloc];
-  d->name = [name copy];
-  d->screenFont = screenFont;
-  d->role = role;
-  d->matrix[0] = matrix[0] * 1000;
-  d->matrix[1] = matrix[1] * 1000;
-  d->matrix[2] = matrix[2] * 1000;
-  d->matrix[3] = matrix[3] * 1000;
-  d->matrix[4] = matrix[4] * 1000;
-  d->matrix[5] = matrix[5] * 1000;
-  d->hash = [d->name hash] + screenFont + role * 4
-            + d->matrix[0] + d->matrix[1] + d->matrix[2] + d->matrix[3];
-  return d;
-}
+  const GSFontMapKey *d = k;
+
+  return [NSString stringWithFormat: @"%@ %d %d [%d %d %d %d %d %d]",
+                   d->name, d->screenFont, d->role,
+                   d->matrix[0], d->matrix[1], d->matrix[2],
+                   d->matrix[3], d->matrix[4], d->matrix[5]];
+}
+
+static const NSMapTableKeyCallBacks fontKeyCallBacks = {
+  fontKeyHash,
+  fontKeyIsEqual,
+  fontKeyRetain,
+  fontKeyRelease,
+  fontKeyDescribe,
+  NULL
+};
 
 /**
   <unit>
@@ -208,6 +214,63 @@ static Class NSFontClass = 0;
 /* Cache all created fonts for reuse. */
 static NSMapTable* globalFontMap = 0;
 
+/*
+ * fontLock protects globalFontMap, the recently used fonts and the counters
+ * below, so that fonts can be created and released from any thread.  It
+ * is recursive since releasing a font can release others.
+ */
+static NSRecursiveLock *fontLock = nil;
+
+/*
+ * The most recently used fonts, most recent first, are retained here so
+ * that transient fonts (eg. from -convertFont:toSize: during layout) and
+ * their font infos survive until they are requested again.
+ */
+static NSFont **recentFonts = 0;
+static NSUInteger recentCount = 0;
+static NSUInteger recentLimit = 0;
+
+/* Counters reported by +fontCacheStatistics */
+static NSUInteger fontHits = 0;
+static NSUInteger fontMisses = 0;
+static NSUInteger fontInfoCreations = 0;
+static NSUInteger fontEvictions = 0;
+
+/* Moves font to the front of recentFonts.  Called with fontLock held. */
+static void
+touchFont(NSFont *font)
+{
+  NSUInteger i;
+
+  if (recentLimit == 0)
+    return;
+  if (recentCount > 0 && recentFonts[0] == font)
+    return;
+  for (i = 1; i < recentCount; i++)
+    {
+      if (recentFonts[i] == font)
+        {
+          memmove(recentFonts + 1, recentFonts, i * sizeof(NSFont*));
+          recentFonts[0] = font;
+          return;
+        }
+    }
+  if (recentCount == recentLimit)
+    {
+      NSFont *old = recentFonts[--recentCount];
+
+      fontEvictions++;
+      memmove(recentFonts + 1, recentFonts, recentCount * sizeof(NSFont*));
+      recentFonts[0] = RETAIN(font);
+      recentCount++;
+      RELEASE(old);
+      return;
+    }
+  memmove(recentFonts + 1, recentFonts, recentCount * sizeof(NSFont*));
+  recentFonts[0] = RETAIN(font);
+  recentCount++;
+}
+
 static NSUserDefaults *defaults = nil;
 
 
@@ -454,7 +517,8 @@ static void setNSFont(NSString *key, NSFont *font)
        * a cache object.
        */
       placeHolder = [self alloc];
-      globalFontMap = NSCreateMapTable(NSObjectMapKeyCallBacks,
+      fontLock = [NSRecursiveLock new];
+      globalFontMap = NSCreateMapTable(fontKeyCallBacks,
                                        NSNonRetainedObjectMapValueCallBacks, 64);
 
       if (defaults == nil)
@@ -462,6 +526,13 @@ static void setNSFont(NSString *key, NSFont *font)
           defaults = RETAIN([NSUserDefaults standardUserDefaults]);
         }
 
+      recentLimit = [defaults integerForKey: @"GSFontCacheSize"];
+      if (recentLimit == 0)
+        {
+          recentLimit = 64;
+        }
+      recentFonts = malloc(recentLimit * sizeof(NSFont*));
+
       _preferredFonts = [defaults objectForKey: @"NSPreferredFonts"];
       [self setVersion: currentVersion];
     }
@@ -830,18 +901,21 @@ static void setNSFont(NSString *key, NSFont *font)
          screenFont: (BOOL)screen
                role: (int)aRole
 {
-  GSFontMapKey *key;
+  GSFontMapKey key;
+  GSFontMapKey *stored;
   NSFont *font;
 
   /* Should never be called on an initialised font! */
   NSAssert(fontName == nil, NSInternalInconsistencyException);
 
   /* Check whether the font is cached */
-  key = keyForFont(name, fontMatrix,
-                   screen, aRole);
-  font = (id)NSMapGet(globalFontMap, (void *)key);
+  setKeyForFont(&key, name, fontMatrix,
+                screen, aRole);
+  [fontLock lock];
+  font = (id)NSMapGet(globalFontMap, (void *)&key);
   if (font == nil)
     {
+      fontMisses++;
       if (self == placeHolder)
         {
           /*
@@ -858,6 +932,7 @@ static void setNSFont(NSString *key, NSFont *font)
       fontInfo = RETAIN([GSFontInfo fontInfoForFontName: fontName
                                                  matrix: fontMatrix
                                              screenFont: screen]);
+      fontInfoCreations++;
       if ((fontInfo == nil) && (aRole == RoleExplicit))
         {
           NSString *replacementFontName = [self _replacementFontName];
@@ -867,44 +942,69 @@ static void setNSFont(NSString *key, NSFont *font)
               fontInfo = RETAIN([GSFontInfo fontInfoForFontName: replacementFontName
                                                          matrix: fontMatrix
                                                      screenFont: screen]);
+              fontInfoCreations++;
             }
         }
       if (fontInfo == nil)
         {
           DESTROY(fontName);
-          DESTROY(key);
+          [fontLock unlock];
           RELEASE(self);
           return nil;
         }
       
       /* Cache the font for later use */
-      NSMapInsert(globalFontMap, (void *)key, (void *)self);
+      stored = malloc(sizeof(GSFontMapKey));
+      *stored = key;
+      stored->name = RETAIN(fontName);
+      NSMapInsert(globalFontMap, (void *)stored, (void *)self);
     }
   else
     {
+      fontHits++;
       if (self != placeHolder)
         {
           RELEASE(self);
         }
       self = RETAIN(font);
     }
-  RELEASE(key);
+  touchFont(self);
+  [fontLock unlock];
 
   return self;
 }
 
-- (void) dealloc
+/*
+ * A font must leave globalFontMap in the same critical section in which
+ * its last reference goes away, otherwise another thread could find and
+ * retain it while it is being deallocated.
+ */
+- (oneway void) release
 {
-  if (fontName != nil)
+  [fontLock lock];
+  if (NSDecrementExtraRefCountWasZero(self))
     {
-      GSFontMapKey *key;
+      if (fontName != nil)
+        {
+          GSFontMapKey key;
 
-      key = keyForFont(fontName, matrix,
-                       screenFont, role);
-      NSMapRemove(globalFontMap, (void *)key);
-      RELEASE(key);
-      RELEASE(fontName);
+          setKeyForFont(&key, fontName, matrix,
+                        screenFont, role);
+          if (NSMapGet(globalFontMap, (void *)&key) == self)
+            {
+              NSMapRemove(globalFontMap, (void *)&key);
+            }
+        }
+      [fontLock unlock];
+      [self dealloc];
+      return;
     }
+  [fontLock unlock];
+}
+
+- (void) dealloc
+{
+  RELEASE(fontName);
   TEST_RELEASE(fontInfo);
   DESTROY(cachedFlippedFont);
   DESTROY(cachedScreenFont);
@@ -961,6 +1061,9 @@ static void setNSFont(NSString *key, NSFont *font)
 
 - (NSFont *)_flippedViewFont
 {
+  NSFont *font;
+
+  [fontLock lock];
   if (cachedFlippedFont == nil)
     {
       CGFloat fontMatrix[6];
@@ -971,7 +1074,9 @@ static void setNSFont(NSString *key, NSFont *font)
                                          screenFont: screenFont
                                                role: role];
     }
-  return AUTORELEASE(RETAIN(cachedFlippedFont));
+  font = RETAIN(cachedFlippedFont);
+  [fontLock unlock];
+  return AUTORELEASE(font);
 }
 
 static BOOL flip_hack;
@@ -1091,6 +1196,8 @@ static BOOL flip_hack;
 
 - (NSFont*) screenFont
 {
+  NSFont *font;
+
   if (screenFont)
     return self;
   /*
@@ -1098,12 +1205,15 @@ static BOOL flip_hack;
   Note that if the font has no corresponding screen font, cachedScreenFont
   will be set to nil.
   */
+  [fontLock lock];
   if (cachedScreenFont == nil)
     cachedScreenFont = [placeHolder initWithName: fontName
                             matrix: matrix
                         screenFont: YES
                               role: role];
-  return AUTORELEASE(RETAIN(cachedScreenFont));
+  font = RETAIN(cachedScreenFont);
+  [fontLock unlock];
+  return AUTORELEASE(font);
 }
 
 - (NSFont*) screenFontWithRenderingMode: (NSFontRenderingMode)mode
@@ -1519,6 +1629,43 @@ static BOOL flip_hack;
 @end /* NSFont */
 
 @implementation NSFont (GNUstep)
+
++ (void) setFontCacheLimit: (NSUInteger)count
+{
+  [fontLock lock];
+  while (recentCount > count)
+    {
+      RELEASE(recentFonts[--recentCount]);
+      fontEvictions++;
+    }
+  recentFonts = realloc(recentFonts, (count ? count : 1) * sizeof(NSFont*));
+  recentLimit = count;
+  [fontLock unlock];
+}
+
++ (NSUInteger) fontCacheLimit
+{
+  return recentLimit;
+}
+
++ (NSDictionary*) fontCacheStatistics
+{
+  NSDictionary *stats;
+
+  [fontLock lock];
+  stats = [NSDictionary dictionaryWithObjectsAndKeys:
+    [NSNumber numberWithUnsignedInteger: fontHits], @"Hits",
+    [NSNumber numberWithUnsignedInteger: fontMisses], @"Misses",
+    [NSNumber numberWithUnsignedInteger: fontInfoCreations],
+    @"FontInfoCreations",
+    [NSNumber numberWithUnsignedInteger: fontEvictions], @"Evictions",
+    [NSNumber numberWithUnsignedInteger: NSCountMapTable(globalFontMap)],
+    @"FontsResident",
+    nil];
+  [fontLock unlock];
+  return stats;
+}
+
 //
 // Private method for NSFontManager and backend
 //
@@ -30,6 +30,7 @@
 #include "config.h"
 #import <Foundation/NSArray.h>
 #import <Foundation/NSDictionary.h>
+#import <Foundation/NSMapTable.h>
 #import <Foundation/NSSet.h>
 #import <Foundation/NSString.h>
 #import <Foundation/NSValue.h>
@@ -52,6 +53,138 @@ static NSFontPanel   *fontPanel = nil;
 static Class         fontManagerClass = Nil;
 static Class         fontPanelClass = Nil;
 
+/* Map table callbacks retaining fonts but comparing them by identity,
+ * since equal screen and printer fonts are different objects.
+ */
+static NSMapTableKeyCallBacks fontKeyCallBacks;
+
+/* Trait flags ignored when looking for a close match in a family */
+#define IGNORED_TRAITS	(NSNonStandardCharacterSetFontMask \
+  | NSFixedPitchFontMask | NSUnitalicFontMask | NSUnboldFontMask)
+
+/* Keys of the memoized font conversions */
+#define CONVERT_TO_HAVE_TRAIT		0
+#define CONVERT_TO_NOT_HAVE_TRAIT	1
+#define CONVERT_WEIGHT			2
+#define CONVERSION_KEY(op, arg)	((((NSUInteger)(arg)) << 2) | (op))
+
+/* Upper limit of memoized conversions before they are all discarded */
+#define MAX_CONVERSIONS	1024
+
+typedef struct {
+  NSString *name;
+  int weight;
+  NSFontTraitMask traits;
+} GSFontMember;
+
+/*
+ * The members of a font family, with weights and traits unboxed from the
+ * font enumerator's arrays.
+ */
+@interface GSFontFamilyTable : NSObject
+{
+@public
+  NSArray *defs;
+  NSUInteger count;
+  GSFontMember *members;
+}
+- (id) initWithMembers: (NSArray*)fontDefs;
+@end
+
+@implementation GSFontFamilyTable
+
+- (id) initWithMembers: (NSArray*)fontDefs
+{
+  if ((self = [super init]) != nil)
+    {
+      NSUInteger i;
+
+      /* The names are retained by the font definitions */
+      ASSIGN(defs, fontDefs);
+      count = [defs count];
+      members = malloc((count ? count : 1) * sizeof(GSFontMember));
+      for (i = 0; i < count; i++)
+        {
+          NSArray *fontDef = [defs objectAtIndex: i];
+
+          members[i].name = [fontDef objectAtIndex: 0];
+          members[i].weight = [[fontDef objectAtIndex: 2] intValue];
+          members[i].traits = [[fontDef objectAtIndex: 3] unsignedIntValue];
+        }
+    }
+  return self;
+}
+
+- (void) dealloc
+{
+  free(members);
+  RELEASE(defs);
+  [super dealloc];
+}
+
+@end
+
+/*
+ * Everything the font manager derives from the available fonts.  It is
+ * discarded as a whole when the font enumerator's set of fonts changes.
+ */
+@interface GSFontTables : NSObject
+{
+@public
+  NSArray *fonts;			// The fonts the tables were built for
+  NSMutableDictionary *families;	// Family name -> GSFontFamilyTable
+  NSMutableDictionary *namesWithTraits;	// Trait mask -> font names
+  NSMapTable *traitsByName;		// Font name -> traits
+  NSMapTable *conversions;		// Conversion key -> (font -> font)
+  NSUInteger conversionCount;
+}
+- (id) initWithFonts: (NSArray*)availableFonts;
+@end
+
+@implementation GSFontTables
+
+- (id) initWithFonts: (NSArray*)availableFonts
+{
+  if ((self = [super init]) != nil)
+    {
+      ASSIGN(fonts, availableFonts);
+      families = [NSMutableDictionary new];
+      namesWithTraits = [NSMutableDictionary new];
+      conversions = NSCreateMapTable(NSIntegerMapKeyCallBacks,
+                                     NSObjectMapValueCallBacks, 8);
+    }
+  return self;
+}
+
+- (void) dealloc
+{
+  RELEASE(fonts);
+  RELEASE(families);
+  RELEASE(namesWithTraits);
+  if (traitsByName != 0)
+    {
+      NSFreeMapTable(traitsByName);
+    }
+  NSFreeMapTable(conversions);
+  [super dealloc];
+}
+
+@end
+
+/* The tables of each font manager, kept out of its instance variables
+ * as subclasses are compiled against their layout.
+ */
+static NSMapTable *fontTables = 0;
+
+@interface NSFontManager (Private)
+- (GSFontTables*) _fontTables;
+- (GSFontFamilyTable*) _membersOfFamily: (NSString*)family;
+- (NSFont*) _conversionOfFont: (NSFont*)fontObject key: (NSUInteger)key;
+- (NSFont*) _setConversion: (NSFont*)newFont
+                    ofFont: (NSFont*)fontObject
+                       key: (NSUInteger)key;
+@end
+
 
 @implementation NSFontManager
 
@@ -65,6 +198,11 @@ static Class         fontPanelClass = Nil;
       // Initial version
       [self setVersion: 1];
 
+      fontKeyCallBacks = NSObjectMapKeyCallBacks;
+      fontKeyCallBacks.isEqual = NSOwnedPointerMapKeyCallBacks.isEqual;
+      fontTables = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                                    NSObjectMapValueCallBacks, 0);
+
       // Set the factories
       [self setFontManagerFactory: [NSFontManager class]];
       [self setFontPanelFactory: [NSFontPanel class]];
@@ -131,6 +269,7 @@ static Class         fontPanelClass = Nil;
   TEST_RELEASE(_fontMenu);
   TEST_RELEASE(_fontEnumerator);
   RELEASE(_collections);
+  NSMapRemove(fontTables, self);
   [super dealloc];
 }
 
@@ -148,33 +287,41 @@ static Class         fontPanelClass = Nil;
 
 - (NSArray*) availableFontNamesWithTraits: (NSFontTraitMask)fontTraitMask
 {
-  unsigned int i, j;
-  NSArray *fontFamilies = [self availableFontFamilies];
-  NSMutableArray *fontNames = [NSMutableArray array];
-  NSFontTraitMask traits;
+  GSFontTables *tables = [self _fontTables];
+  NSNumber *mask;
+  NSMutableArray *fontNames;
+  NSArray *fontFamilies;
+  NSUInteger i, j;
 
   if (fontTraitMask == (NSUnitalicFontMask | NSUnboldFontMask))
     {
       fontTraitMask = 0;
     }
 
+  mask = [NSNumber numberWithUnsignedInt: fontTraitMask];
+  fontNames = [tables->namesWithTraits objectForKey: mask];
+  if (fontNames != nil)
+    {
+      return AUTORELEASE([fontNames copy]);
+    }
+
+  fontNames = [NSMutableArray array];
+  fontFamilies = [self availableFontFamilies];
   for (i = 0; i < [fontFamilies count]; i++)
     {
-      NSArray *fontDefs = [self availableMembersOfFontFamily: 
-                                 [fontFamilies objectAtIndex: i]];
-      
-      for (j = 0; j < [fontDefs count]; j++)
-        {
-          NSArray *fontDef = [fontDefs objectAtIndex: j];
+      GSFontFamilyTable *family;
 
-          traits = [[fontDef objectAtIndex: 3] unsignedIntValue];
+      family = [self _membersOfFamily: [fontFamilies objectAtIndex: i]];
+      for (j = 0; j < family->count; j++)
+        {
           // Check if the font has exactly the given mask
-          if (traits == fontTraitMask)
-            [fontNames addObject: [fontDef objectAtIndex: 0]];
+          if (family->members[j].traits == fontTraitMask)
+            [fontNames addObject: family->members[j].name];
         }
     }
+  [tables->namesWithTraits setObject: fontNames forKey: mask];
 
-  return fontNames;
+  return AUTORELEASE([fontNames copy]);
 }
 
 - (NSArray*) availableMembersOfFontFamily: (NSString*)family
@@ -495,12 +642,19 @@ static Class         fontPanelClass = Nil;
     }
   else
     {
-      // Else convert it
-      NSFont *newFont;
+      // Else convert it, unless that was done before
+      NSUInteger key = CONVERSION_KEY(CONVERT_TO_HAVE_TRAIT, trait);
+      NSFont *newFont = [self _conversionOfFont: fontObject key: key];
+      int weight;
+      float size;
+      NSString *family;
 
-      int weight = [self weightOfFont: fontObject];
-      float size = [fontObject pointSize];
-      NSString *family = [fontObject familyName];
+      if (newFont != nil)
+        return newFont;
+
+      weight = [self weightOfFont: fontObject];
+      size = [fontObject pointSize];
+      family = [fontObject familyName];
 
       if (trait & NSBoldFontMask)
         {
@@ -531,9 +685,8 @@ static Class         fontPanelClass = Nil;
                                 size: size];
 
       if (newFont == nil)
-        return fontObject;
-      else 
-        return newFont;
+        newFont = fontObject;
+      return [self _setConversion: newFont ofFont: fontObject key: key];
     }
 }
 
@@ -549,12 +702,19 @@ static Class         fontPanelClass = Nil;
     }
   else
     {
-      // Else convert it
-      NSFont *newFont;
+      // Else convert it, unless that was done before
+      NSUInteger key = CONVERSION_KEY(CONVERT_TO_NOT_HAVE_TRAIT, trait);
+      NSFont *newFont = [self _conversionOfFont: fontObject key: key];
+      int weight;
+      float size;
+      NSString *family;
 
-      int weight = [self weightOfFont: fontObject];
-      float size = [fontObject pointSize];
-      NSString *family = [fontObject familyName];
+      if (newFont != nil)
+        return newFont;
+
+      weight = [self weightOfFont: fontObject];
+      size = [fontObject pointSize];
+      family = [fontObject familyName];
 
       if (trait & NSBoldFontMask)
         {
@@ -583,9 +743,8 @@ static Class         fontPanelClass = Nil;
                               weight: weight
                                 size: size];
       if (newFont == nil)
-        return fontObject;
-      else 
-        return newFont;
+        newFont = fontObject;
+      return [self _setConversion: newFont ofFont: fontObject key: key];
     }
 }
 
@@ -614,88 +773,66 @@ static Class         fontPanelClass = Nil;
 - (NSFont*) convertWeight: (BOOL)upFlag
                    ofFont: (NSFont*)fontObject
 {
-  NSFont *newFont = nil;
+  NSUInteger key = CONVERSION_KEY(CONVERT_WEIGHT, upFlag ? 1 : 0);
+  NSFont *newFont = [self _conversionOfFont: fontObject key: key];
   NSString *fontName = nil;
-  NSFontTraitMask trait = [self traitsOfFont: fontObject];
-  float size = [fontObject pointSize];
-  NSString *family = [fontObject familyName];
-  int w = [self weightOfFont: fontObject];
+  NSFontTraitMask trait;
+  float size;
+  int w;
+  GSFontFamilyTable *table;
+  GSFontMember *m;
+  NSUInteger i;
+  int pass;
+
+  if (newFont != nil)
+    return newFont;
+
+  trait = [self traitsOfFont: fontObject];
+  size = [fontObject pointSize];
+  w = [self weightOfFont: fontObject];
   // We check what weights we have for this family. We must
   // also check to see if that font has the correct traits!
-  NSArray *fontDefs = [self availableMembersOfFontFamily: family];
+  table = [self _membersOfFamily: [fontObject familyName]];
+  m = table->members;
 
   if (upFlag)
     {
-      unsigned int i;
       // The documentation is a bit unclear about the range of weights
       // sometimes it says 0 to 9 and sometimes 0 to 15
       int next_w = 15;
 
-      for (i = 0; i < [fontDefs count]; i++)
+      // If not found, try again with changed trait
+      for (pass = 0; pass < 2 && fontName == nil; pass++)
         {
-          NSArray *fontDef = [fontDefs objectAtIndex: i];
-          int w1 = [[fontDef objectAtIndex: 2] intValue];
-
-          if (w1 > w && w1 < next_w && 
-              [[fontDef objectAtIndex: 3] unsignedIntValue] == trait)
+          if (pass == 1)
+            trait |= NSBoldFontMask;
+          for (i = 0; i < table->count; i++)
             {
-              next_w = w1;
-              fontName = [fontDef objectAtIndex: 0];
-            }
-        }
-
-      if (fontName == nil)
-        {
-          // Not found, try again with changed trait
-          trait |= NSBoldFontMask;
-          
-          for (i = 0; i < [fontDefs count]; i++)
-            { 
-              NSArray *fontDef = [fontDefs objectAtIndex: i];
-              int w1 = [[fontDef objectAtIndex: 2] intValue];
-
-              if (w1 > w && w1 < next_w && 
-                  [[fontDef objectAtIndex: 3] unsignedIntValue] == trait)
+              if (m[i].weight > w && m[i].weight < next_w
+                && m[i].traits == trait)
                 {
-                  next_w = w1;
-                  fontName = [fontDef objectAtIndex: 0];
+                  next_w = m[i].weight;
+                  fontName = m[i].name;
                 }
             }
         }
     }
   else
     {
-      unsigned int i;
       int next_w = 0;
 
-      for (i = 0; i < [fontDefs count]; i++)
+      // If not found, try again with changed trait
+      for (pass = 0; pass < 2 && fontName == nil; pass++)
         {
-          NSArray *fontDef = [fontDefs objectAtIndex: i];
-          int w1 = [[fontDef objectAtIndex: 2] intValue];
-
-          if (w1 < w && w1 > next_w
-            && [[fontDef objectAtIndex: 3] unsignedIntValue] == trait)
+          if (pass == 1)
+            trait &= ~NSBoldFontMask;
+          for (i = 0; i < table->count; i++)
             {
-              next_w = w1;
-              fontName = [fontDef objectAtIndex: 0];
-            }
-        }
-
-      if (fontName == nil)
-        {
-          // Not found, try again with changed trait
-          trait &= ~NSBoldFontMask;
-
-          for (i = 0; i < [fontDefs count]; i++)
-            {
-              NSArray *fontDef = [fontDefs objectAtIndex: i];
-              int w1 = [[fontDef objectAtIndex: 2] intValue];
-              
-              if (w1 < w && w1 > next_w
-                && [[fontDef objectAtIndex: 3] unsignedIntValue] == trait)
+              if (m[i].weight < w && m[i].weight > next_w
+                && m[i].traits == trait)
                 {
-                  next_w = w1;
-                  fontName = [fontDef objectAtIndex: 0];
+                  next_w = m[i].weight;
+                  fontName = m[i].name;
                 }
             }
         }
@@ -707,9 +844,8 @@ static Class         fontPanelClass = Nil;
                                 size: size];
     }
   if (newFont == nil)
-    return fontObject;
-  else 
-    return newFont;
+    newFont = fontObject;
+  return [self _setConversion: newFont ofFont: fontObject key: key];
 }
 
 /*
@@ -720,62 +856,40 @@ static Class         fontPanelClass = Nil;
                     weight: (int)weight
                       size: (float)size
 {
-  NSArray *fontDefs = [self availableMembersOfFontFamily: family];
-  unsigned int i;
+  GSFontFamilyTable *table = [self _membersOfFamily: family];
+  GSFontMember *m = table->members;
+  NSUInteger count = table->count;
+  NSUInteger i;
 
   //NSLog(@"Searching font %@: %i: %i size %.0f", family, weight, traits, size);
 
   // First do an exact match search
-  for (i = 0; i < [fontDefs count]; i++)
+  for (i = 0; i < count; i++)
     {
-      NSArray *fontDef = [fontDefs objectAtIndex: i];
-
-      //NSLog(@"Testing font %@: %i: %i", [fontDef objectAtIndex: 0], 
-      //          [[fontDef objectAtIndex: 2] intValue], 
-      //          [[fontDef objectAtIndex: 3] unsignedIntValue]);  
-      if (([[fontDef objectAtIndex: 2] intValue] == weight) &&
-          ([[fontDef objectAtIndex: 3] unsignedIntValue] == traits))
+      if (m[i].weight == weight && m[i].traits == traits)
         {
-            //NSLog(@"Found font");
-          return [NSFont fontWithName: [fontDef objectAtIndex: 0] 
-                         size: size];
+          return [NSFont fontWithName: m[i].name size: size];
         }
     }
 
   // Try to find something close by ignoring some trait flags
-  traits &= ~(NSNonStandardCharacterSetFontMask | NSFixedPitchFontMask
-              | NSUnitalicFontMask | NSUnboldFontMask);
-  for (i = 0; i < [fontDefs count]; i++)
+  traits &= ~IGNORED_TRAITS;
+  for (i = 0; i < count; i++)
     {
-      NSArray *fontDef = [fontDefs objectAtIndex: i];
-      NSFontTraitMask t = [[fontDef objectAtIndex: 3] unsignedIntValue];
-
-      t &= ~(NSNonStandardCharacterSetFontMask | NSFixedPitchFontMask
-             | NSUnitalicFontMask | NSUnboldFontMask);
-      if (([[fontDef objectAtIndex: 2] intValue] == weight) &&
-          (t == traits))
+      if (m[i].weight == weight && (m[i].traits & ~IGNORED_TRAITS) == traits)
         {
-            //NSLog(@"Found font");
-          return [NSFont fontWithName: [fontDef objectAtIndex: 0] 
-                         size: size];
+          return [NSFont fontWithName: m[i].name size: size];
         }
     }
 
   if (traits & NSBoldFontMask)
     {
       //NSLog(@"Trying ignore weights for bold font");
-      for (i = 0; i < [fontDefs count]; i++)
+      for (i = 0; i < count; i++)
         {
-          NSArray *fontDef = [fontDefs objectAtIndex: i];
-          NSFontTraitMask t = [[fontDef objectAtIndex: 3] unsignedIntValue];
-
-          t &= ~(NSNonStandardCharacterSetFontMask | NSFixedPitchFontMask
-                 | NSUnitalicFontMask | NSUnboldFontMask);
-          if (t == traits)
+          if ((m[i].traits & ~IGNORED_TRAITS) == traits)
             {
-              //NSLog(@"Found font");
-              return [NSFont fontWithName: [fontDef objectAtIndex: 0] 
-                             size: size];
+              return [NSFont fontWithName: m[i].name size: size];
             }
         }
     }
@@ -783,20 +897,12 @@ static Class         fontPanelClass = Nil;
   if (weight == 5 || weight == 6)
     {
       //NSLog(@"Trying alternate non-bold weights for non-bold font");
-      for (i = 0; i < [fontDefs count]; i++)
+      for (i = 0; i < count; i++)
         {
-          NSArray *fontDef = [fontDefs objectAtIndex: i];
-          NSFontTraitMask t = [[fontDef objectAtIndex: 3] unsignedIntValue];
-
-          t &= ~(NSNonStandardCharacterSetFontMask | NSFixedPitchFontMask
-                 | NSUnitalicFontMask | NSUnboldFontMask);
-          if ((([[fontDef objectAtIndex: 2] intValue] == 5) ||
-               ([[fontDef objectAtIndex: 2] intValue] == 6)) &&
-              (t == traits))
+          if ((m[i].weight == 5 || m[i].weight == 6)
+            && (m[i].traits & ~IGNORED_TRAITS) == traits)
             {
-              //NSLog(@"Found font");
-              return [NSFont fontWithName: [fontDef objectAtIndex: 0] 
-                             size: size];
+              return [NSFont fontWithName: m[i].name size: size];
             }
         }
     }
@@ -823,36 +929,39 @@ static Class         fontPanelClass = Nil;
 - (BOOL) fontNamed: (NSString*)typeface 
          hasTraits: (NSFontTraitMask)fontTraitMask
 {
-  // TODO: This method is implemented very slow, but I dont 
-  // see any use for it, so why change it?
-  unsigned int i, j;
-  NSArray *fontFamilies = [self availableFontFamilies];
-  NSFontTraitMask traits;
-  
-  for (i = 0; i < [fontFamilies count]; i++)
+  GSFontTables *tables = [self _fontTables];
+  void *name;
+  void *traits;
+
+  if (tables->traitsByName == 0)
     {
-      NSArray *fontDefs = [self availableMembersOfFontFamily: 
-                                  [fontFamilies objectAtIndex: i]];
-      
-      for (j = 0; j < [fontDefs count]; j++)
+      NSArray *fontFamilies = [self availableFontFamilies];
+      NSUInteger i, j;
+
+      tables->traitsByName = NSCreateMapTable(NSObjectMapKeyCallBacks,
+        NSIntegerMapValueCallBacks, [tables->fonts count]);
+      for (i = 0; i < [fontFamilies count]; i++)
         {
-          NSArray *fontDef = [fontDefs objectAtIndex: j];
-          
-          if ([[fontDef objectAtIndex: 0] isEqualToString: typeface])
+          GSFontFamilyTable *family;
+
+          family = [self _membersOfFamily: [fontFamilies objectAtIndex: i]];
+          for (j = 0; j < family->count; j++)
             {
-              traits = [[fontDef objectAtIndex: 3] unsignedIntValue];
-              // FIXME: This is not exactly the right condition
-              if ((traits & fontTraitMask) == fontTraitMask)
-                {
-                  return YES;
-                }
-              else
-                return NO;
+              // The first definition of a name wins
+              NSMapInsertIfAbsent(tables->traitsByName,
+                family->members[j].name,
+                (void*)(uintptr_t)family->members[j].traits);
             }
         }
     }
-  
-  return NO;
+
+  if (NSMapMember(tables->traitsByName, typeface, &name, &traits) == NO)
+    {
+      return NO;
+    }
+  // FIXME: This is not exactly the right condition
+  return (((NSFontTraitMask)(uintptr_t)traits & fontTraitMask)
+    == fontTraitMask);
 }
 
 /**<p>Returns whether the NSFontPanel is enabled ( if exists )</p> 
@@ -1193,6 +1302,89 @@ static Class         fontPanelClass = Nil;
 
 @end
 
+@implementation NSFontManager (Private)
+
+/* Returns the tables derived from the available fonts, rebuilding them
+ * when the font enumerator has produced a new set of fonts.
+ */
+- (GSFontTables*) _fontTables
+{
+  NSArray *fonts = [_fontEnumerator availableFonts];
+  GSFontTables *tables = (GSFontTables*)NSMapGet(fontTables, self);
+
+  if (tables == nil || tables->fonts != fonts)
+    {
+      tables = [[GSFontTables alloc] initWithFonts: fonts];
+      NSMapInsert(fontTables, self, tables);
+      RELEASE(tables);
+    }
+  return tables;
+}
+
+- (GSFontFamilyTable*) _membersOfFamily: (NSString*)family
+{
+  GSFontTables *tables = [self _fontTables];
+  GSFontFamilyTable *table;
+
+  if (family == nil)
+    {
+      family = @"";
+    }
+  table = [tables->families objectForKey: family];
+  if (table == nil)
+    {
+      table = [[GSFontFamilyTable alloc]
+        initWithMembers: [self availableMembersOfFontFamily: family]];
+      [tables->families setObject: table forKey: family];
+      RELEASE(table);
+    }
+  return table;
+}
+
+- (NSFont*) _conversionOfFont: (NSFont*)fontObject key: (NSUInteger)key
+{
+  NSMapTable *results;
+
+  results = NSMapGet([self _fontTables]->conversions, (void*)key);
+  if (results == 0 || fontObject == nil)
+    {
+      return nil;
+    }
+  return NSMapGet(results, fontObject);
+}
+
+- (NSFont*) _setConversion: (NSFont*)newFont
+                    ofFont: (NSFont*)fontObject
+                       key: (NSUInteger)key
+{
+  GSFontTables *tables = [self _fontTables];
+  NSMapTable *results;
+
+  if (fontObject == nil || newFont == nil)
+    {
+      return newFont;
+    }
+  if (tables->conversionCount >= MAX_CONVERSIONS)
+    {
+      NSResetMapTable(tables->conversions);
+      tables->conversionCount = 0;
+    }
+  results = NSMapGet(tables->conversions, (void*)key);
+  if (results == 0)
+    {
+      results = NSCreateMapTable(fontKeyCallBacks,
+                                 NSObjectMapValueCallBacks, 16);
+      NSMapInsert(tables->conversions, (void*)key, results);
+      RELEASE(results);
+    }
+  NSMapInsert(results, fontObject, newFont);
+  tables->conversionCount++;
+  return newFont;
+}
+
+@end
+
+
 @implementation NSApplication(NSFontPanel)
 
 - (void) orderFrontFontPanel: (id)sender
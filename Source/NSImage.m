@@ -38,6 +38,8 @@
 #import <Foundation/NSLock.h>
 #import <Foundation/NSNotification.h>
 #import <Foundation/NSString.h>
+#import <Foundation/NSThread.h>
+#import <Foundation/NSUserDefaults.h>
 #import <Foundation/NSValue.h>
 
 #import "AppKit/NSImage.h"
@@ -351,12 +353,19 @@ fixupImageNameAndType(NSString **name, NSString **type)
 
 @end
 
+@class GSRepData;
+static void drop_levels(GSRepData *repd);
+
 @interface GSRepData : NSObject
 {
 @public
   NSImageRep *rep;
   NSImageRep *original;
   NSColor *bg;
+  NSMutableArray *levels; // Reductions of rep, each half the previous size
+  GSRepData *levelPrev;   // Position in the list of reps with reductions
+  GSRepData *levelNext;
+  BOOL drawn;             // rep is a cache drawn into with -lockFocus
 }
 @end
 
@@ -369,11 +378,18 @@ fixupImageNameAndType(NSString **name, NSString **type)
     c->rep = [c->rep copyWithZone: z];
   if (c->bg)
     c->bg = [c->bg copyWithZone: z];
+  c->levels = nil;
+  c->levelPrev = nil;
+  c->levelNext = nil;
   return c;
 }
 
 - (void) dealloc
 {
+  if (levels != nil)
+    {
+      drop_levels(self);
+    }
   TEST_RELEASE(rep);
   TEST_RELEASE(bg);
   [super dealloc];
@@ -392,8 +408,334 @@ static NSArray *imageFileTypes = nil;
 static NSArray *imageUnfilteredPasteboardTypes = nil;
 static NSArray *imagePasteboardTypes = nil;
 
+/* State kept for an image outside of the instance, so that it does
+ * not change the layout of NSImage for subclasses. Created on first
+ * use, found through imageStates and protected by imageLock.
+ */
+typedef struct _GSImageState {
+  /* Memoized result of -bestRepresentationForRect:context:hints:,
+   * not retained as it is dropped whenever the representations change.
+   */
+  NSImageRep *bestRep;
+  NSDictionary *bestRepDevice;
+  NSSize bestRepSize;
+  /* Decoded data of images loaded by reference, in the list of images
+   * which may be purged while purgeRequested is NO. Other threads only
+   * set purgeRequested; the image purges itself on its next use or,
+   * if it was loaded on the main thread, once that thread is idle.
+   */
+  struct _GSImageState *lruPrev;
+  struct _GSImageState *lruNext;
+  NSUInteger decodedBytes;
+  BOOL purgeRequested;
+  BOOL mainThread;
+} GSImageState;
+
+static NSMapTable *imageStates = NULL;
+
+/* Images loaded by reference with decoded data, most recently used
+ * first, the bytes held by those asked to purge their data, and the
+ * counters reported by +decodedImageCacheStatistics.
+ * All protected by imageLock.
+ */
+static GSImageState *lruHead = NULL;
+static GSImageState *lruTail = NULL;
+static NSUInteger decodedBytes = 0;
+static NSUInteger decodedBytesLimit = 0;
+static NSUInteger purgeBytes = 0;
+static NSUInteger decodedHits = 0;
+static NSUInteger decodedLoads = 0;
+static NSUInteger decodedEvictions = 0;
+static BOOL purgeScheduled = NO;
+
+static void
+lru_unlink(GSImageState *state)
+{
+  if (state->lruPrev != NULL)
+    {
+      state->lruPrev->lruNext = state->lruNext;
+    }
+  else
+    {
+      lruHead = state->lruNext;
+    }
+  if (state->lruNext != NULL)
+    {
+      state->lruNext->lruPrev = state->lruPrev;
+    }
+  else
+    {
+      lruTail = state->lruPrev;
+    }
+  state->lruPrev = NULL;
+  state->lruNext = NULL;
+}
+
+static void
+lru_push(GSImageState *state)
+{
+  state->lruNext = lruHead;
+  if (lruHead != NULL)
+    {
+      lruHead->lruPrev = state;
+    }
+  lruHead = state;
+  if (lruTail == NULL)
+    {
+      lruTail = state;
+    }
+}
+
+/* Stops accounting for the decoded data of an image. The caller holds
+ * imageLock.
+ */
+static void
+forget_decoded_data(GSImageState *state)
+{
+  if (state->decodedBytes == 0)
+    {
+      return;
+    }
+  if (state->purgeRequested)
+    {
+      purgeBytes -= state->decodedBytes;
+      state->purgeRequested = NO;
+    }
+  else
+    {
+      lru_unlink(state);
+    }
+  decodedBytes -= state->decodedBytes;
+  state->decodedBytes = 0;
+}
+
+/* Asks the least recently used images to purge their decoded data on
+ * their next use, until what remains is within the limit. They are
+ * not purged here, as they may be in use by another thread. The caller
+ * holds imageLock.
+ */
+static void
+request_purges(void)
+{
+  while (decodedBytes - purgeBytes > decodedBytesLimit && lruTail != NULL)
+    {
+      GSImageState *state = lruTail;
+
+      lru_unlink(state);
+      state->purgeRequested = YES;
+      purgeBytes += state->decodedBytes;
+      decodedEvictions++;
+      if (state->mainThread && purgeScheduled == NO)
+        {
+          purgeScheduled = YES;
+          [NSImage performSelectorOnMainThread:
+                     @selector(_purgeRequestedImages)
+                                    withObject: nil
+                                 waitUntilDone: NO];
+        }
+    }
+}
+
+/* Returns the state of an image, creating it if create is YES.
+ * The caller holds imageLock.
+ */
+static GSImageState *
+image_state(NSImage *image, BOOL create)
+{
+  GSImageState *state = NSMapGet(imageStates, image);
+
+  if (state == NULL && create)
+    {
+      state = NSZoneCalloc(NSDefaultMallocZone(), 1, sizeof(GSImageState));
+      NSMapInsert(imageStates, image, state);
+    }
+  return state;
+}
+
+/* Releases the state of a deallocated image.
+ */
+static void
+destroy_image_state(NSImage *image)
+{
+  GSImageState *state;
+
+  [imageLock lock];
+  state = NSMapGet(imageStates, image);
+  if (state != NULL)
+    {
+      NSMapRemove(imageStates, image);
+      forget_decoded_data(state);
+      TEST_RELEASE(state->bestRepDevice);
+      NSZoneFree(NSDefaultMallocZone(), state);
+    }
+  [imageLock unlock];
+}
+
+/* Bytes held by reduced bitmaps built for drawing images small, and
+ * the representations they belong to, most recently drawn first.
+ * All protected by imageLock.
+ */
+static NSUInteger levelBytes = 0;
+static NSUInteger levelBytesLimit = 0;
+static GSRepData *levelHead = nil;
+static GSRepData *levelTail = nil;
+
 static NSArray *iterate_reps_for_types(NSArray *imageReps, SEL method);
 
+static NSUInteger
+bitmap_bytes(NSBitmapImageRep *bitmap)
+{
+  return [bitmap bytesPerRow] * [bitmap pixelsHigh];
+}
+
+/* Releases the reductions of a representation. */
+static void
+drop_levels(GSRepData *repd)
+{
+  NSUInteger count;
+  NSUInteger i;
+
+  [imageLock lock];
+  count = [repd->levels count];
+  for (i = 0; i < count; i++)
+    {
+      levelBytes -= bitmap_bytes([repd->levels objectAtIndex: i]);
+    }
+  if (repd->levelPrev != nil)
+    {
+      repd->levelPrev->levelNext = repd->levelNext;
+    }
+  else
+    {
+      levelHead = repd->levelNext;
+    }
+  if (repd->levelNext != nil)
+    {
+      repd->levelNext->levelPrev = repd->levelPrev;
+    }
+  else
+    {
+      levelTail = repd->levelPrev;
+    }
+  repd->levelPrev = nil;
+  repd->levelNext = nil;
+  DESTROY(repd->levels);
+  [imageLock unlock];
+}
+
+/* Makes the reductions of a representation the most recently drawn
+ * ones, adding them to the list if needed. The caller holds imageLock.
+ */
+static void
+touch_levels(GSRepData *repd)
+{
+  if (levelHead == repd)
+    {
+      return;
+    }
+  if (repd->levelPrev != nil)
+    {
+      repd->levelPrev->levelNext = repd->levelNext;
+      if (repd->levelNext != nil)
+        {
+          repd->levelNext->levelPrev = repd->levelPrev;
+        }
+      else
+        {
+          levelTail = repd->levelPrev;
+        }
+    }
+  repd->levelPrev = nil;
+  repd->levelNext = levelHead;
+  if (levelHead != nil)
+    {
+      levelHead->levelPrev = repd;
+    }
+  levelHead = repd;
+  if (levelTail == nil)
+    {
+      levelTail = repd;
+    }
+}
+
+/* Returns YES if the bitmap can be reduced by halve_bitmap(), that is
+ * if it is meshed with 8 bits for each sample and no padding.
+ */
+static BOOL
+can_halve_bitmap(NSBitmapImageRep *bitmap)
+{
+  return [bitmap bitsPerSample] == 8
+    && [bitmap isPlanar] == NO
+    && [bitmap bitsPerPixel] == 8 * [bitmap samplesPerPixel]
+    && [bitmap bitmapData] != NULL;
+}
+
+/* Reduce a bitmap to half its pixel size using a 2x2 box filter.
+ * An odd last row or column is dropped. The result keeps the size
+ * (in points) of the source, so it can be drawn in its place.
+ */
+static NSBitmapImageRep *
+halve_bitmap(NSBitmapImageRep *src)
+{
+  const NSInteger sw = [src pixelsWide];
+  const NSInteger sh = [src pixelsHigh];
+  const NSInteger dw = sw / 2;
+  const NSInteger dh = sh / 2;
+  const NSInteger spp = [src samplesPerPixel];
+  const NSInteger sbpr = [src bytesPerRow];
+  const unsigned char *sdata = [src bitmapData];
+  NSBitmapImageRep *dst;
+  unsigned char *ddata;
+  NSInteger dbpr;
+  NSInteger x, y;
+
+  if (dw < 1 || dh < 1)
+    {
+      return nil;
+    }
+  dst = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes: NULL
+                                                pixelsWide: dw
+                                                pixelsHigh: dh
+                                             bitsPerSample: 8
+                                           samplesPerPixel: spp
+                                                  hasAlpha: [src hasAlpha]
+                                                  isPlanar: NO
+                                            colorSpaceName: [src colorSpaceName]
+                                              bitmapFormat: [src bitmapFormat]
+                                               bytesPerRow: 0
+                                              bitsPerPixel: 0];
+  if (dst == nil)
+    {
+      return nil;
+    }
+  [dst setSize: [src size]];
+  ddata = [dst bitmapData];
+  dbpr = [dst bytesPerRow];
+
+  for (y = 0; y < dh; y++)
+    {
+      const unsigned char *r0 = sdata + 2 * y * sbpr;
+      const unsigned char *r1 = r0 + sbpr;
+      unsigned char *d = ddata + y * dbpr;
+
+      /* Samples are averaged independently of their meaning, so this
+       * works for any order of color and alpha components.
+       */
+      for (x = 0; x < dw; x++)
+        {
+          const unsigned char *a = r0 + 2 * x * spp;
+          const unsigned char *b = r1 + 2 * x * spp;
+          NSInteger c;
+
+          for (c = 0; c < spp; c++)
+            {
+              *d++ = (a[c] + a[c + spp] + b[c] + b[c + spp] + 2) >> 2;
+            }
+        }
+    }
+  return AUTORELEASE(dst);
+}
+
 /* Find the GSRepData object holding a representation */
 static GSRepData*
 repd_for_rep(NSArray *_reps, NSImageRep *rep)
@@ -418,12 +760,19 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
 @interface NSImage (Private)
 + (void) _clearFileTypeCaches: (NSNotification*)notif;
 + (void) _reloadCachedImages;
++ (void) _purgeRequestedImages;
 - (BOOL) _useFromFile: (NSString *)fileName;
 - (BOOL) _loadFromData: (NSData *)data;
 - (BOOL) _loadFromFile: (NSString *)fileName;
 - (BOOL) _resetAndUseFromFile: (NSString *)fileName;
 - (GSRepData*) _cacheForRep: (NSImageRep*)rep;
 - (NSCachedImageRep*) _doImageCache: (NSImageRep *)rep;
+- (void) _invalidateBestRep;
+- (NSImageRep *) _reducedRep: (NSImageRep *)rep forSize: (NSSize)pixelSize;
+- (BOOL) _loadReferencedFile;
+- (void) _touchDecodedData;
+- (void) _forgetDecodedData;
+- (void) _purgeDecodedData;
 @end
 
 @implementation NSImage
@@ -449,6 +798,20 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
         nsmapping = RETAIN([[NSString stringWithContentsOfFile: path]
                                propertyListFromStringsFileFormat]);
       clearColor = RETAIN([NSColor clearColor]);
+      imageStates = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                                     NSNonOwnedPointerMapValueCallBacks, 0);
+      levelBytesLimit = [[NSUserDefaults standardUserDefaults]
+                          integerForKey: @"GSImageReductionCacheSize"];
+      if (levelBytesLimit == 0)
+        {
+          levelBytesLimit = 32 * 1024 * 1024;
+        }
+      decodedBytesLimit = [[NSUserDefaults standardUserDefaults]
+                            integerForKey: @"GSImageDecodedCacheSize"];
+      if (decodedBytesLimit == 0)
+        {
+          decodedBytesLimit = 128 * 1024 * 1024;
+        }
       cachedClass = [NSCachedImageRep class];
       bitmapClass = [NSBitmapImageRep class];
       [[NSNotificationCenter defaultCenter]
@@ -549,6 +912,7 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
       return nil;
     }
   _flags.archiveByName = YES;
+  _flags.purgeable = YES;
 
   return self;
 }
@@ -672,6 +1036,10 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
 {
   if (_name == nil)
     {
+      /* First take the image out of the shared lists, so other threads
+       * no longer find it.
+       */
+      destroy_image_state(self);
       RELEASE(_reps);
       TEST_RELEASE(_fileName);
       RELEASE(_color);
@@ -697,6 +1065,7 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
   RETAIN(_fileName);
   RETAIN(_color);
   copy->_lockedView = nil;
+  copy->_flags.purgeable = NO;
   // FIXME: maybe we should retain if _flags.dataRetained = NO
   copy->_reps = [[NSMutableArray alloc] initWithCapacity: [_reps count]];
 
@@ -796,6 +1165,7 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
 
 - (void) setSize: (NSSize)aSize
 {
+  [self _invalidateBestRep];
   _size = aSize;
   _flags.sizeWasExplicitlySet = YES;
 }
@@ -827,7 +1197,11 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
 // Choosing Which Image Representation to Use 
 - (void) setUsesEPSOnResolutionMismatch: (BOOL)flag
 {
-  _flags.useEPSOnResolutionMismatch = flag;
+  if (_flags.useEPSOnResolutionMismatch != flag)
+    {
+      [self _invalidateBestRep];
+      _flags.useEPSOnResolutionMismatch = flag;
+    }
 }
 
 - (BOOL) usesEPSOnResolutionMismatch
@@ -837,7 +1211,11 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
 
 - (void) setPrefersColorMatch: (BOOL)flag
 {
-  _flags.colorMatchPreferred = flag;
+  if (_flags.colorMatchPreferred != flag)
+    {
+      [self _invalidateBestRep];
+      _flags.colorMatchPreferred = flag;
+    }
 }
 
 - (BOOL) prefersColorMatch
@@ -847,7 +1225,11 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
 
 - (void) setMatchesOnMultipleResolution: (BOOL)flag
 {
-  _flags.multipleResolutionMatching = flag;
+  if (_flags.multipleResolutionMatching != flag)
+    {
+      [self _invalidateBestRep];
+      _flags.multipleResolutionMatching = flag;
+    }
 }
 
 - (BOOL) matchesOnMultipleResolution
@@ -903,11 +1285,15 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
   BOOL valid = NO;
   NSUInteger i, count;
 
+  if (_flags.purgeable && !_flags.syncLoad)
+    {
+      [self _touchDecodedData];
+    }
   if (_flags.syncLoad)
     {
       /* Make sure any images that were added with _useFromFile: are loaded
          in and added to the representation list. */
-      if (![self _loadFromFile: _fileName])
+      if (![self _loadReferencedFile])
         return NO;
       _flags.syncLoad = NO;
     }
@@ -940,6 +1326,11 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
       GSRepData *repd;
 
       repd = (GSRepData*)[_reps objectAtIndex: i];
+      // The reductions are made from the old pixels
+      if (repd->levels != nil)
+        {
+          drop_levels(repd);
+        }
       if (repd->original != nil)
         {
           [_reps removeObjectAtIndex: i];
@@ -1138,6 +1529,7 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
   NSGraphicsContext *ctxt;
   NSSize imgSize, repSize;
   NSRect repSrcRect;
+  BOOL reducedRep = NO;
 
   ctxt = GSCurrentContext();
   imgSize = [self size];
@@ -1164,13 +1556,43 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
   if (rep == nil)
     return;
 
+  /* A bitmap drawn much smaller than its pixel size is replaced by
+   * a reduced copy, so the backend does not have to filter all of
+   * its pixels on every draw.
+   */
+  if ([rep isKindOfClass: bitmapClass] && [ctxt isDrawingToScreen]
+    && srcRect.size.width > 0 && srcRect.size.height > 0)
+    {
+      NSView *view = [NSView focusView];
+      NSSize pixelSize = dstRect.size;
+      NSImageRep *reduced;
+
+      if (view != nil)
+        {
+          pixelSize = [view convertSizeToBase: pixelSize];
+        }
+      /* Only srcRect is drawn into dstRect, so the whole image needs
+       * proportionally more pixels.
+       */
+      pixelSize.width = fabs(pixelSize.width) * imgSize.width
+        / srcRect.size.width;
+      pixelSize.height = fabs(pixelSize.height) * imgSize.height
+        / srcRect.size.height;
+      reduced = [self _reducedRep: rep forSize: pixelSize];
+      if (reduced != rep)
+        {
+          rep = reduced;
+          reducedRep = YES;
+        }
+    }
+
   // Try to cache / get a cached version of the best rep
   
   /** 
    * We only use caching on backends that can efficiently draw a rect from the cache
    * onto the current graphics context respecting the CTM, which is currently cairo.
    */
-  if (_cacheMode != NSImageCacheNever &&
+  if (_cacheMode != NSImageCacheNever && reducedRep == NO &&
       [ctxt supportsDrawGState])
     {
       NSCachedImageRep *cache = [self _doImageCache: rep];
@@ -1213,6 +1635,14 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
       repd->rep = RETAIN(imageRep);
       [_reps addObject: repd]; 
       RELEASE(repd);
+      [self _invalidateBestRep];
+      if (_flags.purgeable && !_flags.syncLoad)
+        {
+          /* The representations no longer all come from the file.
+           */
+          _flags.purgeable = NO;
+          [self _forgetDecodedData];
+        }
     }
 }
 
@@ -1229,6 +1659,15 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
       [_reps addObject: repd]; 
       RELEASE(repd);
     }
+  if (count > 0)
+    {
+      [self _invalidateBestRep];
+      if (_flags.purgeable && !_flags.syncLoad)
+        {
+          _flags.purgeable = NO;
+          [self _forgetDecodedData];
+        }
+    }
 }
 
 - (void) removeRepresentation: (NSImageRep *)imageRep
@@ -1236,6 +1675,7 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
   NSUInteger i;
   GSRepData *repd;
 
+  [self _invalidateBestRep];
   i = [_reps count];
   while (i-- > 0)
     {
@@ -1278,6 +1718,7 @@ repd_for_rep(NSArray *_reps, NSImageRep *rep)
 	return;
 
       imageRep = repd->rep;
+      repd->drawn = YES;
 
       window = [(NSCachedImageRep *)imageRep window];
       _lockedView = [window contentView];
@@ -1630,11 +2071,15 @@ static NSSize GSResolutionOfImageRep(NSImageRep *rep)
 {
   NSUInteger count;
 
+  if (_flags.purgeable && !_flags.syncLoad)
+    {
+      [self _touchDecodedData];
+    }
   if (_flags.syncLoad)
     {
       /* Make sure any images that were added with _useFromFile: are loaded
          in and added to the representation list. */
-      [self _loadFromFile: _fileName];
+      [self _loadReferencedFile];
       _flags.syncLoad = NO;
     }
 
@@ -1662,10 +2107,8 @@ static NSSize GSResolutionOfImageRep(NSImageRep *rep)
     }
 }
 
-- (NSArray *) _bestRepresentationsForDevice: (NSDictionary*)deviceDescription
+- (NSDictionary *) _deviceDescriptionForDevice: (NSDictionary*)deviceDescription
 {
-  NSMutableArray *reps = [self _representationsWithCachedImages: NO];
-  
   if (deviceDescription == nil)
     {
       if ([GSCurrentContext() isDrawingToScreen] == YES)
@@ -1682,6 +2125,14 @@ static NSSize GSResolutionOfImageRep(NSImageRep *rep)
              not be printing (EPS, PDF, etc) to a specific device */
         }
     }
+  return deviceDescription;
+}
+
+- (NSArray *) _bestRepresentationsForDevice: (NSDictionary*)deviceDescription
+{
+  NSMutableArray *reps = [self _representationsWithCachedImages: NO];
+  
+  deviceDescription = [self _deviceDescriptionForDevice: deviceDescription];
 
   if (_flags.colorMatchPreferred == YES)
     {
@@ -1734,9 +2185,41 @@ static NSSize GSResolutionOfImageRep(NSImageRep *rep)
 				   context: (NSGraphicsContext *)context
 				     hints: (NSDictionary *)deviceDescription
 {
-  NSArray *reps = [self _bestRepresentationsForDevice: deviceDescription];
+  NSArray *reps;
   const NSSize desiredSize = rect.size;
   NSImageRep *bestRep = nil;
+  GSImageState *state;
+
+  /* The selection below only depends on the device description, the
+   * destination size and our own settings, so drawing the same image
+   * repeatedly into the same kind of rect can reuse the last answer.
+   * Device descriptions are compared by identity; screens and windows
+   * hand out the same dictionary on every call.
+   */
+  deviceDescription = [self _deviceDescriptionForDevice: deviceDescription];
+  if (_flags.syncLoad == NO)
+    {
+      [imageLock lock];
+      state = image_state(self, NO);
+      if (state != NULL && state->bestRep != nil
+        && state->purgeRequested == NO
+        && state->bestRepDevice == deviceDescription
+        && NSEqualSizes(state->bestRepSize, desiredSize))
+        {
+          bestRep = state->bestRep;
+          if (state->decodedBytes > 0)
+            {
+              [self _touchDecodedData];
+            }
+        }
+      [imageLock unlock];
+      if (bestRep != nil)
+        {
+          return bestRep;
+        }
+    }
+
+  reps = [self _bestRepresentationsForDevice: deviceDescription];
 
   // Pick the smallest rep that is greater than or equal to the
   // desired size.
@@ -1763,7 +2246,14 @@ static NSSize GSResolutionOfImageRep(NSImageRep *rep)
     {
       bestRep = [reps lastObject];
     }
-  
+
+  [imageLock lock];
+  state = image_state(self, YES);
+  state->bestRep = bestRep;
+  ASSIGN(state->bestRepDevice, deviceDescription);
+  state->bestRepSize = desiredSize;
+  [imageLock unlock];
+
   return bestRep;
 }
 
@@ -2252,6 +2742,37 @@ iterate_reps_for_types(NSArray* imageReps, SEL method)
   [imageLock unlock];
 }
 
+/* Purges the images loaded on the main thread which were asked to,
+ * while that thread is not drawing any of them. The lock is held
+ * throughout, so none of them can be deallocated meanwhile.
+ */
++ (void) _purgeRequestedImages
+{
+  NSMapEnumerator e;
+  NSImage *image;
+  GSImageState *state;
+  NSMutableArray *images;
+
+  images = [NSMutableArray array];
+  [imageLock lock];
+  purgeScheduled = NO;
+  e = NSEnumerateMapTable(imageStates);
+  while (NSNextMapEnumeratorPair(&e, (void**)&image, (void**)&state))
+    {
+      if (state->purgeRequested && state->mainThread)
+        {
+          [images addObject: [NSValue valueWithNonretainedObject: image]];
+        }
+    }
+  NSEndMapTableEnumeration(&e);
+  while ([images count] > 0)
+    {
+      image = [[images lastObject] nonretainedObjectValue];
+      [image _touchDecodedData];
+      [images removeLastObject];
+    }
+  [imageLock unlock];
+}
 
 + (NSString *) _resourceNameForImageNamed: (NSString *)aName 
                                      type: (NSString **)aType
@@ -2339,11 +2860,265 @@ iterate_reps_for_types(NSArray* imageReps, SEL method)
 
   ASSIGN(_fileName, fileName);
   _flags.syncLoad = YES;
+  [self _invalidateBestRep];
   return YES;
 }
 
+/* Returns the smallest reduction of the bitmap rep that still has at
+ * least pixelSize pixels, building missing reductions on demand. When
+ * the memory used for reductions would exceed the limit set by the
+ * GSImageReductionCacheSize default, those of the least recently drawn
+ * representations are released first. Returns rep itself if no
+ * reduction is suitable.
+ */
+- (NSImageRep *) _reducedRep: (NSImageRep *)rep forSize: (NSSize)pixelSize
+{
+  NSBitmapImageRep *level = (NSBitmapImageRep *)rep;
+  NSUInteger count = [_reps count];
+  GSRepData *repd = nil;
+  NSUInteger i;
+
+  if ([level pixelsWide] < 2 * pixelSize.width
+    || [level pixelsHigh] < 2 * pixelSize.height
+    || !can_halve_bitmap(level))
+    {
+      return rep;
+    }
+
+  {
+    GSRepData *reps[count];
+
+    [_reps getObjects: reps];
+    for (i = 0; i < count; i++)
+      {
+        if (reps[i]->rep == rep)
+          {
+            repd = reps[i];
+            break;
+          }
+      }
+  }
+  if (repd == nil)
+    {
+      return rep;
+    }
+
+  /* Reductions of other images may be released by other threads, so
+   * all of this happens under the lock and the result is retained
+   * until the caller is done with it.
+   */
+  [imageLock lock];
+  for (i = 0; ; i++)
+    {
+      NSBitmapImageRep *next;
+
+      if (repd->levels != nil && i < [repd->levels count])
+        {
+          next = [repd->levels objectAtIndex: i];
+        }
+      else
+        {
+          /* A reduction needs a quarter of the memory of its source.
+           */
+          NSUInteger bytes = bitmap_bytes(level) / 4;
+
+          if (bytes > levelBytesLimit)
+            {
+              break;
+            }
+          while (levelBytes + bytes > levelBytesLimit
+            && levelTail != nil && levelTail != repd)
+            {
+              drop_levels(levelTail);
+            }
+          if (levelBytes + bytes > levelBytesLimit)
+            {
+              break;
+            }
+
+          next = halve_bitmap(level);
+          if (next == nil)
+            {
+              break;
+            }
+          if (repd->levels == nil)
+            {
+              repd->levels = [[NSMutableArray alloc] initWithCapacity: 4];
+            }
+          [repd->levels addObject: next];
+          levelBytes += bitmap_bytes(next);
+        }
+
+      if ([next pixelsWide] < pixelSize.width
+        || [next pixelsHigh] < pixelSize.height)
+        {
+          break;
+        }
+      level = next;
+      if ([level pixelsWide] < 2 * pixelSize.width
+        || [level pixelsHigh] < 2 * pixelSize.height)
+        {
+          break;
+        }
+    }
+  if (repd->levels != nil)
+    {
+      touch_levels(repd);
+    }
+  AUTORELEASE(RETAIN(level));
+  [imageLock unlock];
+
+  return level;
+}
+
+/* Loads the representations of an image initialised with
+ * _useFromFile: and, if the image was created by reference, accounts
+ * for the decoded data so it can be released again under memory
+ * pressure.
+ */
+- (BOOL) _loadReferencedFile
+{
+  GSImageState *state;
+  NSUInteger count;
+  NSUInteger bytes = 0;
+  NSUInteger i;
+  BOOL ok;
+
+  ok = [self _loadFromFile: _fileName];
+  if (!ok || !_flags.purgeable)
+    {
+      return ok;
+    }
+
+  count = [_reps count];
+  for (i = 0; i < count; i++)
+    {
+      NSImageRep *rep = ((GSRepData*)[_reps objectAtIndex: i])->rep;
+
+      if ([rep isKindOfClass: bitmapClass])
+        {
+          bytes += bitmap_bytes((NSBitmapImageRep*)rep);
+        }
+      else if ([rep pixelsWide] > 0 && [rep pixelsHigh] > 0)
+        {
+          bytes += [rep pixelsWide] * [rep pixelsHigh] * 4;
+        }
+    }
+  if (bytes == 0)
+    {
+      return ok;
+    }
+
+  [imageLock lock];
+  state = image_state(self, YES);
+  forget_decoded_data(state);
+  state->mainThread = [NSThread isMainThread];
+  state->decodedBytes = bytes;
+  decodedBytes += bytes;
+  decodedLoads++;
+  lru_push(state);
+  request_purges();
+  [imageLock unlock];
+
+  return ok;
+}
+
+/* Marks the decoded data as most recently used, or purges it if that
+ * was asked for since the image was last used.
+ */
+- (void) _touchDecodedData
+{
+  GSImageState *state;
+  BOOL purge = NO;
+
+  [imageLock lock];
+  state = image_state(self, NO);
+  if (state != NULL && state->decodedBytes > 0)
+    {
+      if (state->purgeRequested)
+        {
+          purge = (_lockedView == nil);
+        }
+      else
+        {
+          decodedHits++;
+          if (lruHead != state)
+            {
+              lru_unlink(state);
+              lru_push(state);
+            }
+        }
+    }
+  [imageLock unlock];
+
+  if (purge)
+    {
+      [self _purgeDecodedData];
+    }
+}
+
+/* Stops accounting for the decoded data of the image.
+ */
+- (void) _forgetDecodedData
+{
+  GSImageState *state;
+
+  [imageLock lock];
+  state = image_state(self, NO);
+  if (state != NULL)
+    {
+      forget_decoded_data(state);
+    }
+  [imageLock unlock];
+}
+
+/* Drops all representations, they get loaded again from the file
+ * on next use. A cache drawn into with -lockFocus holds something
+ * that cannot be loaded again, so an image with one is kept and no
+ * longer counted as purgeable.
+ */
+- (void) _purgeDecodedData
+{
+  NSUInteger count = [_reps count];
+  NSUInteger i;
+
+  [self _forgetDecodedData];
+  for (i = 0; i < count; i++)
+    {
+      if (((GSRepData*)[_reps objectAtIndex: i])->drawn)
+        {
+          _flags.purgeable = NO;
+          return;
+        }
+    }
+
+  [self _invalidateBestRep];
+  /* Someone further up the stack may still be drawing one of these,
+   * so keep them alive until the current pool goes away.
+   */
+  AUTORELEASE([_reps copy]);
+  [_reps removeAllObjects];
+  _flags.syncLoad = YES;
+}
+
+- (void) _invalidateBestRep
+{
+  GSImageState *state;
+
+  [imageLock lock];
+  state = image_state(self, NO);
+  if (state != NULL)
+    {
+      state->bestRep = nil;
+      DESTROY(state->bestRepDevice);
+    }
+  [imageLock unlock];
+}
+
 - (BOOL) _resetAndUseFromFile: (NSString *)fileName
 {
+  [self _forgetDecodedData];
+  [self _invalidateBestRep];
   [_reps removeAllObjects];
   
   if (!_flags.sizeWasExplicitlySet)
@@ -2380,6 +3155,9 @@ iterate_reps_for_types(NSArray* imageReps, SEL method)
     {
       [self lockFocusOnRepresentation: cache];
       [self unlockFocus];
+      /* Only rendered from the original, so it can be rendered again.
+       */
+      repd->drawn = NO;
       
       NSDebugLLog(@"NSImage", @"Rendered rep %p on background %@",
                   cache, repd->bg);
@@ -2543,3 +3321,35 @@ iterate_reps_for_types(NSArray* imageReps, SEL method)
 }
 
 @end
+
+@implementation NSImage (GNUstep)
+
++ (void) setDecodedImageCacheLimit: (NSUInteger)bytes
+{
+  [imageLock lock];
+  decodedBytesLimit = bytes;
+  request_purges();
+  [imageLock unlock];
+}
+
++ (NSUInteger) decodedImageCacheLimit
+{
+  return decodedBytesLimit;
+}
+
++ (NSDictionary*) decodedImageCacheStatistics
+{
+  NSDictionary *stats;
+
+  [imageLock lock];
+  stats = [NSDictionary dictionaryWithObjectsAndKeys:
+    [NSNumber numberWithUnsignedInteger: decodedHits], @"Hits",
+    [NSNumber numberWithUnsignedInteger: decodedLoads], @"Loads",
+    [NSNumber numberWithUnsignedInteger: decodedEvictions], @"Evictions",
+    [NSNumber numberWithUnsignedInteger: decodedBytes], @"BytesResident",
+    nil];
+  [imageLock unlock];
+  return stats;
+}
+
+@end
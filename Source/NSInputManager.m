@@ -37,6 +37,11 @@
 #import "GSKeyBindingAction.h"
 #import "GSKeyBindingTable.h"
 
+/* Version of the compiled key bindings cached by compiledBindingsForFile.
+   Increase it whenever GSKeyBindingTable compiles bindings differently,
+   so older caches are not used.  */
+#define KEY_BINDINGS_CACHE_VERSION 1
+
 /* A table mapping character names to characters, used to interpret
    the character names found in KeyBindings dictionaries.  */
 
@@ -295,18 +300,105 @@ static NSInputManager *currentInputManager = nil;
   return AUTORELEASE(description);
 }
 
-- (void) loadBindingsFromFile: (NSString *)fullPath
+/* Returns the bindings of the KeyBindings file at fullPath, as
+ * compiled by GSKeyBindingTable, or nil if the file can't be read.
+ * The compiled bindings are cached in the user's caches directory,
+ * and used for as long as the file keeps its modification date and
+ * size, so that the file and its keys need not be parsed again.  */
+static NSArray *
+compiledBindingsForFile(NSString *fullPath)
 {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSDictionary *attributes;
   NSDictionary *bindings;
-      
+  NSDictionary *cache;
+  NSArray *compiled;
+  NSArray *dirs;
+  NSString *cachePath = nil;
+  NSNumber *date = nil;
+  NSNumber *size = nil;
+  NSData *data;
+
+  attributes = [fileManager fileAttributesAtPath: fullPath  traverseLink: YES];
+  dirs = NSSearchPathForDirectoriesInDomains (NSCachesDirectory,
+					      NSUserDomainMask, YES);
+  if (attributes != nil && [dirs count] > 0)
+    {
+      date = [NSNumber numberWithDouble:
+	[[attributes fileModificationDate] timeIntervalSinceReferenceDate]];
+      size = [NSNumber numberWithUnsignedLongLong: [attributes fileSize]];
+      cachePath = [[[dirs objectAtIndex: 0]
+	stringByAppendingPathComponent: @"KeyBindings"]
+	stringByAppendingPathComponent:
+	  [NSString stringWithFormat: @"%@-%08lx.cache",
+	    [[fullPath lastPathComponent] stringByDeletingPathExtension],
+	    (unsigned long)[fullPath hash]]];
+
+      data = [NSData dataWithContentsOfFile: cachePath];
+      if (data != nil)
+	{
+	  cache = [NSPropertyListSerialization
+		    propertyListFromData: data
+			mutabilityOption: NSPropertyListImmutable
+				  format: NULL
+			errorDescription: NULL];
+	  if ([cache isKindOfClass: [NSDictionary class]]
+	    && [[cache objectForKey: @"Version"] isEqual:
+	      [NSNumber numberWithInt: KEY_BINDINGS_CACHE_VERSION]]
+	    && [[cache objectForKey: @"Path"] isEqual: fullPath]
+	    && [[cache objectForKey: @"ModificationDate"] isEqual: date]
+	    && [[cache objectForKey: @"Size"] isEqual: size])
+	    {
+	      compiled = [cache objectForKey: @"Bindings"];
+	      if ([compiled isKindOfClass: [NSArray class]])
+		{
+		  return compiled;
+		}
+	    }
+	}
+    }
+
   bindings = [NSDictionary dictionaryWithContentsOfFile: fullPath];
+  if (bindings == nil)
+    {
+      return nil;
+    }
+  compiled = [GSKeyBindingTable compileBindingsFromDictionary: bindings];
+
+  if (cachePath != nil)
+    {
+      cache = [NSDictionary dictionaryWithObjectsAndKeys:
+	[NSNumber numberWithInt: KEY_BINDINGS_CACHE_VERSION], @"Version",
+	fullPath, @"Path",
+	date, @"ModificationDate",
+	size, @"Size",
+	compiled, @"Bindings", nil];
+      data = [NSPropertyListSerialization
+	       dataFromPropertyList: cache
+			     format: NSPropertyListGNUstepBinaryFormat
+		   errorDescription: NULL];
+      [fileManager createDirectoryAtPath:
+		     [cachePath stringByDeletingLastPathComponent]
+	     withIntermediateDirectories: YES
+			      attributes: nil
+				   error: NULL];
+      [data writeToFile: cachePath  atomically: YES];
+    }
+  return compiled;
+}
+
+- (void) loadBindingsFromFile: (NSString *)fullPath
+{
+  NSArray *bindings;
+      
+  bindings = compiledBindingsForFile (fullPath);
   if (bindings == nil)
     {
       NSLog (@"Unable to load KeyBindings from file %@", fullPath);
     }
   else
     {
-      [_rootBindingTable loadBindingsFromDictionary: bindings];
+      [_rootBindingTable loadCompiledBindings: bindings];
     }
 }
 
@@ -126,6 +126,20 @@ static NSRecursiveLock *bindingLock = nil;
 static NSMapTable *classTable = NULL;      //available bindings
 static NSMapTable *objectTable = NULL;     //bound bindings
 
+/* The number of objects in objectTable, counted by a hash of their
+ * address.  A zero count tells that an object has no bindings without
+ * taking the lock, which is the common case for the views and cells
+ * asking for their bindings or unbinding everything when deallocated.
+ * Counts only change with the lock held.  */
+#define BOUND_SLOTS 1024
+static volatile unsigned boundCounts[BOUND_SLOTS];
+
+static inline volatile unsigned *
+boundCount(id anObject)
+{
+  return &boundCounts[((gsaddr)anObject >> 4) % BOUND_SLOTS];
+}
+
 typedef enum {
   GSBindingOperationAnd = 0,
   GSBindingOperationOr
@@ -139,6 +153,124 @@ BOOL GSBindingResolveMultipleValueBool(NSString *key, NSDictionary *bindings,
 void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
     NSDictionary *bindings);
 
+/* Looks up the options which matter when a value goes through a
+ * binding.  The placeholders, transformer and transformer name are
+ * retained by options, which the caller keeps alive.  */
+static void
+resolveOptions(NSDictionary *options, GSBindingOptions *o)
+{
+  NSString *name;
+
+  memset(o, 0, sizeof(*o));
+  o->multipleValuesPlaceholder = [options objectForKey:
+    NSMultipleValuesPlaceholderBindingOption];
+  if (o->multipleValuesPlaceholder == nil)
+    {
+      o->multipleValuesPlaceholder = @"Multiple Values";
+    }
+  o->noSelectionPlaceholder = [options objectForKey:
+    NSNoSelectionPlaceholderBindingOption];
+  if (o->noSelectionPlaceholder == nil)
+    {
+      o->noSelectionPlaceholder = @"No Selection";
+    }
+  o->notApplicablePlaceholder = [options objectForKey:
+    NSNotApplicablePlaceholderBindingOption];
+  if (o->notApplicablePlaceholder == nil)
+    {
+      o->notApplicablePlaceholder = @"Not Applicable";
+    }
+  o->nullPlaceholder = [options objectForKey: NSNullPlaceholderBindingOption];
+  o->raisesForNotApplicable = [[options objectForKey:
+    NSRaisesForNotApplicableKeysBindingOption] boolValue];
+
+  name = [options objectForKey: NSValueTransformerNameBindingOption];
+  if (name != nil)
+    {
+      /* Looked up when it is needed, as another transformer may be
+         registered under the name later.  */
+      o->transformerName = name;
+    }
+  else
+    {
+      o->transformer = [options objectForKey: NSValueTransformerBindingOption];
+    }
+}
+
+static inline NSValueTransformer *
+optionsTransformer(GSBindingOptions *o)
+{
+  if (o->transformerName != nil)
+    {
+      return [NSValueTransformer valueTransformerForName: o->transformerName];
+    }
+  return o->transformer;
+}
+
+static id
+transformWithOptions(id value, GSBindingOptions *o)
+{
+  NSValueTransformer *valueTransformer;
+
+  if (value == NSMultipleValuesMarker)
+    {
+      return o->multipleValuesPlaceholder;
+    }
+  if (value == NSNoSelectionMarker)
+    {
+      return o->noSelectionPlaceholder;
+    }
+  if (value == NSNotApplicableMarker)
+    {
+      if (o->raisesForNotApplicable)
+        {
+          [NSException raise: NSGenericException
+                      format: @"This binding does not accept not applicable keys"];
+        }
+      return o->notApplicablePlaceholder;
+    }
+  if (value == nil)
+    {
+      return o->nullPlaceholder;
+    }
+
+  valueTransformer = optionsTransformer(o);
+  if (valueTransformer != nil)
+    {
+      if ([value isKindOfClass: [NSArray class]])
+        {
+          NSArray *oldValue = (NSArray *)value;
+          NSMutableArray *newValue = [[NSMutableArray alloc] initWithCapacity: [oldValue count]];
+          id<NSFastEnumeration> enumerator = oldValue;
+
+          FOR_IN (id, obj, enumerator)
+            [newValue addObject: [valueTransformer transformedValue: obj]];
+          END_FOR_IN(enumerator)
+          value = AUTORELEASE(newValue);
+        }
+      else
+        {
+          value = [valueTransformer transformedValue: value];
+        }
+    }
+
+  return value;
+}
+
+static id
+reverseTransformWithOptions(id value, GSBindingOptions *o)
+{
+  NSValueTransformer *valueTransformer = optionsTransformer(o);
+
+  if ((valueTransformer != nil) && [[valueTransformer class]
+                                       allowsReverseTransformation])
+    {
+      value = [valueTransformer reverseTransformedValue: value];
+    }
+
+  return value;
+}
+
 @implementation GSKeyValueBinding
 
 + (void) initialize
@@ -189,7 +321,7 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
   NSMutableDictionary *bindings;
   GSKeyValueBinding *theBinding = nil;
 
-  if (!objectTable)
+  if (!objectTable || *boundCount(anObject) == 0)
     return nil;
 
   [bindingLock lock];
@@ -223,7 +355,7 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
   NSString *keyPath;
   GSKeyValueBinding *theBinding;
 
-  if (!objectTable)
+  if (!objectTable || *boundCount(anObject) == 0)
     return;
 
   [bindingLock lock];
@@ -248,7 +380,7 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
   NSString *binding;
   NSDictionary *list;
 
-  if (!objectTable)
+  if (!objectTable || *boundCount(anObject) == 0)
     return;
 
   [bindingLock lock];
@@ -263,6 +395,7 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
           [anObject unbind: binding];
         }
       NSMapRemove(objectTable, (void *)anObject);
+      (*boundCount(anObject))--;
     }
   [bindingLock unlock];
 }
@@ -292,6 +425,10 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
         options, NSOptionsKey,
         nil];
     }
+  observedObject = dest;
+  observedKeyPath = [info objectForKey: NSObservedKeyPathKey];
+  bindingOptions = [info objectForKey: NSOptionsKey];
+  resolveOptions(bindingOptions, &resolved);
     
   [dest addObserver: self
         forKeyPath: keyPath
@@ -305,6 +442,7 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
       bindings = [NSMutableDictionary new];
       NSMapInsert(objectTable, (void*)source, (void*)bindings);
       RELEASE(bindings);
+      (*boundCount(source))++;
     }
   [bindings setObject: self forKey: name];
   [bindingLock unlock];
@@ -323,26 +461,14 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
 
 - (id) destinationValue
 {
-  id newValue;
-  id dest;
-  NSString *keyPath;
-  NSDictionary *options;
-
-  dest = [info objectForKey: NSObservedObjectKey];
-  keyPath = [info objectForKey: NSObservedKeyPathKey];
-  options = [info objectForKey: NSOptionsKey];
-  newValue = [dest valueForKeyPath: keyPath];
-  return [self transformValue: newValue withOptions: options];
+  return transformWithOptions([observedObject valueForKeyPath: observedKeyPath],
+                              &resolved);
 }
 
 - (id) sourceValueFor: (NSString *)binding
 {
-  id newValue;
-  NSDictionary *options;
-
-  options = [info objectForKey: NSOptionsKey];
-  newValue = [src valueForKeyPath: binding];
-  return [self reverseTransformValue: newValue withOptions: options];
+  return reverseTransformWithOptions([src valueForKeyPath: binding],
+                                     &resolved);
 }
 
 - (void) setValueFor: (NSString *)binding 
@@ -355,14 +481,9 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
 
 - (void) reverseSetValue: (id)value
 {
-  NSString *keyPath;
-  id dest;
-
-  keyPath = [info objectForKey: NSObservedKeyPathKey];
-  dest = [info objectForKey: NSObservedObjectKey];
-  NSDebugLLog(@"NSBinding", @"reverseSetValue: keyPath %@, dest %@ value %@", keyPath, dest, value);
+  NSDebugLLog(@"NSBinding", @"reverseSetValue: keyPath %@, dest %@ value %@", observedKeyPath, observedObject, value);
   inReverseSet = YES;
-  [dest setValue: value forKeyPath: keyPath];
+  [observedObject setValue: value forKeyPath: observedKeyPath];
   inReverseSet = NO;
 }
 
@@ -377,7 +498,6 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
                         context: (void *)context
 {
   NSString *binding = (NSString *)context;
-  NSDictionary *options;
   id newValue;
 
   if (inReverseSet)
@@ -387,122 +507,35 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
 
   if (change != nil)
     {
-      options = [info objectForKey: NSOptionsKey];
       newValue = [change objectForKey: NSKeyValueChangeNewKey];
-      newValue = [self transformValue: newValue withOptions: options];
+      newValue = transformWithOptions(newValue, &resolved);
       NSDebugLLog(@"NSBinding", @"observeValueForKeyPath: binding %@, keyPath %@, source %@ value %@", binding, keyPath, src, newValue);
       [src setValue: newValue forKey: binding];
     }
 }
 
-- (id) transformValue: (id)value withOptions: (NSDictionary *)options
+- (id) transformValue: (id)value withOptions: (NSDictionary *)opts
 {
-  NSString *valueTransformerName;
-  NSValueTransformer *valueTransformer;
-  NSString *placeholder;
-
-  if (value == NSMultipleValuesMarker)
-    {
-      placeholder = [options objectForKey: NSMultipleValuesPlaceholderBindingOption];
-      if (placeholder == nil)
-        {
-          placeholder = @"Multiple Values";
-        }
-      return placeholder;
-    }
-  if (value == NSNoSelectionMarker)
-    {
-      placeholder = [options objectForKey: NSNoSelectionPlaceholderBindingOption];
-      if (placeholder == nil)
-        {
-          placeholder = @"No Selection";
-        }
-      return placeholder;
-    }
-  if (value == NSNotApplicableMarker)
-    {
-      if ([[options objectForKey: NSRaisesForNotApplicableKeysBindingOption]
-          boolValue])
-        {
-          [NSException raise: NSGenericException
-                      format: @"This binding does not accept not applicable keys"];
-        }
-
-      placeholder = [options objectForKey:
-        NSNotApplicablePlaceholderBindingOption];
-      if (placeholder == nil)
-        {
-          placeholder = @"Not Applicable";
-        }
-      return placeholder;
-    }
-  if (value == nil)
-    {
-      placeholder = [options objectForKey:
-        NSNullPlaceholderBindingOption];
-      return placeholder;
-    }
-
-  valueTransformerName = [options objectForKey:
-    NSValueTransformerNameBindingOption];
-  if (valueTransformerName != nil)
-    {
-      valueTransformer = [NSValueTransformer valueTransformerForName:
-                                                 valueTransformerName];
-    }
-  else
-    {
-      valueTransformer = [options objectForKey:
-                                      NSValueTransformerBindingOption];
-    }
+  GSBindingOptions o;
 
-  if (valueTransformer != nil)
+  if (opts == bindingOptions)
     {
-      if ([value isKindOfClass: [NSArray class]])
-        {
-          NSArray *oldValue = (NSArray *)value;
-          NSMutableArray *newValue = [[NSMutableArray alloc] initWithCapacity: [oldValue count]];
-          id<NSFastEnumeration> enumerator = oldValue;
-
-          FOR_IN (id, obj, enumerator)
-            [newValue addObject: [valueTransformer transformedValue: obj]];
-          END_FOR_IN(enumerator)
-          value = AUTORELEASE(newValue);
-        }
-      else
-        {
-          value = [valueTransformer transformedValue: value];
-        }
+      return transformWithOptions(value, &resolved);
     }
-
-  return value;
+  resolveOptions(opts, &o);
+  return transformWithOptions(value, &o);
 }
 
-- (id) reverseTransformValue: (id)value withOptions: (NSDictionary *)options
+- (id) reverseTransformValue: (id)value withOptions: (NSDictionary *)opts
 {
-  NSString *valueTransformerName;
-  NSValueTransformer *valueTransformer;
-
-  valueTransformerName = [options objectForKey:
-    NSValueTransformerNameBindingOption];
-  if (valueTransformerName != nil)
-    {
-      valueTransformer = [NSValueTransformer valueTransformerForName:
-                                                 valueTransformerName];
-    }
-  else
-    {
-      valueTransformer = [options objectForKey:
-                                      NSValueTransformerBindingOption];
-    }
+  GSBindingOptions o;
 
-  if ((valueTransformer != nil) && [[valueTransformer class]
-                                       allowsReverseTransformation])
+  if (opts == bindingOptions)
     {
-      value = [valueTransformer reverseTransformedValue: value];
+      return reverseTransformWithOptions(value, &resolved);
     }
-
-  return value;
+  resolveOptions(opts, &o);
+  return reverseTransformWithOptions(value, &o);
 }
 
 - (NSString*) description
@@ -526,7 +559,10 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
  [bindingLock lock];
   bindings = (NSDictionary *)NSMapGet(objectTable, (void *)src);
   if (!bindings)
-    return;
+    {
+      [bindingLock unlock];
+      return;
+    }
 
   res = GSBindingResolveMultipleValueBool(binding, bindings,
                                           GSBindingOperationOr);
@@ -557,7 +593,10 @@ void GSBindingInvokeAction(NSString *targetKey, NSString *argumentKey,
   [bindingLock lock];
   bindings = (NSDictionary *)NSMapGet(objectTable, (void *)src);
   if (!bindings)
-    return;
+    {
+      [bindingLock unlock];
+      return;
+    }
 
   res = GSBindingResolveMultipleValueBool(binding, bindings,
                                           GSBindingOperationAnd);
@@ -118,6 +118,7 @@ first. Remaining cases, highest priority first:
 #import "AppKit/NSRulerMarker.h"
 #import "AppKit/NSTextContainer.h"
 #import "AppKit/NSTextStorage.h"
+#import "AppKit/NSTextTable.h"
 #import "AppKit/NSWindow.h"
 #import "AppKit/DPSOperators.h"
 
@@ -139,6 +140,11 @@ first. Remaining cases, highest priority first:
 -(void) _doLayoutToContainer: (int)cindex  point: (NSPoint)p;
 @end
 
+@interface NSTextTable (Private)
++ (void) _invalidateTablesInTextStorage: (NSTextStorage *)storage
+                                  range: (NSRange)range;
+@end
+
 @implementation NSLayoutManager (LayoutHelpers)
 -(void) _doLayoutToContainer: (int)cindex  point: (NSPoint)p
 {
@@ -1600,11 +1606,23 @@ attachmentSize(linefrag_t *lf, NSUInteger glyphIndex)
   NSColor *link_color = nil;
   id linkValue;
  
-#define GBUF_SIZE 16 /* TODO: tweak */
-  NSGlyph gbuf[GBUF_SIZE];
-  NSSize advancementbuf[GBUF_SIZE];
-  int gbuf_len, gbuf_size;
+  /* Glyphs are collected until the font, the color or the line
+   * fragment changes, and then shown with a single call.  The buffers
+   * start on the stack and move to the heap for long runs.
+   */
+#define GBUF_SIZE 256
+  NSGlyph gbuf_stack[GBUF_SIZE];
+  NSSize advancementbuf_stack[GBUF_SIZE];
+  NSGlyph *gbuf = gbuf_stack;
+  NSSize *advancementbuf = advancementbuf_stack;
+  unsigned int gbuf_len, gbuf_size = GBUF_SIZE;
   NSPoint gbuf_point = NSZeroPoint;
+  /* Printing contexts place glyphs with the advancements of the font
+   * and ignore the ones they are given, so there we also end a batch
+   * at each glyph positioned differently, eg. by kerning.
+   */
+  BOOL nominal_advances_only;
+  NSRange attributes_range;
 
   if (!range.length)
     return;
@@ -1625,10 +1643,7 @@ attachmentSize(linefrag_t *lf, NSUInteger glyphIndex)
     }
   selectedGlyphRange = NSIntersectionRange(selectedGlyphRange, range);
 
-  if ([ctxt isDrawingToScreen])
-    gbuf_size = GBUF_SIZE;
-  else
-    gbuf_size = 1;
+  nominal_advances_only = ![ctxt isDrawingToScreen];
 
   for (i = 0, tc = textcontainers; i < num_textcontainers; i++, tc++)
     if (tc->pos + tc->length > range.location)
@@ -1653,7 +1668,7 @@ attachmentSize(linefrag_t *lf, NSUInteger glyphIndex)
   currentGlyphIsSelected = NSLocationInRange(lp->pos, selectedGlyphRange);
   glyph = glyph_run->glyphs + lp->pos - glyph_pos;
   attributes = [_textStorage attributesAtIndex: char_pos
-				effectiveRange: NULL];
+				effectiveRange: &attributes_range];
   run_color = [attributes valueForKey: NSForegroundColorAttributeName];
   if (run_color == nil)
     run_color = defaultTextColor;
@@ -1758,25 +1773,31 @@ attachmentSize(linefrag_t *lf, NSUInteger glyphIndex)
 	  glyph_pos += glyph_run->head.glyph_length;
 	  char_pos += glyph_run->head.char_length;
 	  glyph_run = (glyph_run_t *)glyph_run->head.next;
-	  attributes = [_textStorage attributesAtIndex: char_pos
-				     effectiveRange: NULL];
-	  run_color = [attributes valueForKey: NSForegroundColorAttributeName];
-	  if (run_color == nil)
+	  /* Runs often only differ in font; the color is the same as long
+	   * as we are in the same attributes.
+	   */
+	  if (!NSLocationInRange(char_pos, attributes_range))
 	    {
-	      run_color = defaultTextColor;
-	    }
+	      attributes = [_textStorage attributesAtIndex: char_pos
+					 effectiveRange: &attributes_range];
+	      run_color = [attributes valueForKey: NSForegroundColorAttributeName];
+	      if (run_color == nil)
+		{
+		  run_color = defaultTextColor;
+		}
 
-	  linkValue = [attributes objectForKey: NSLinkAttributeName];
-	  if (linkValue != nil)
-	      {
-		if (link_color == nil)
+	      linkValue = [attributes objectForKey: NSLinkAttributeName];
+	      if (linkValue != nil)
 		  {
-		    NSDictionary *link_attributes = [[self firstTextView] linkTextAttributes];
-		    link_color = [link_attributes valueForKey: NSForegroundColorAttributeName];
+		    if (link_color == nil)
+		      {
+			NSDictionary *link_attributes = [[self firstTextView] linkTextAttributes];
+			link_color = [link_attributes valueForKey: NSForegroundColorAttributeName];
+		      }
+		    if (link_color != nil)
+		      run_color = link_color;
 		  }
-		if (link_color != nil)
-		  run_color = link_color;
-	      }
+	    }
 
 	  glyph = glyph_run->glyphs;
 
@@ -1850,27 +1871,42 @@ attachmentSize(linefrag_t *lf, NSUInteger glyphIndex)
 	    }
 	  if (g >= range.location)
 	    {
+	      if (gbuf_len && nominal_advances_only
+		&& !NSEqualSizes(advancementbuf[gbuf_len - 1],
+		  [f advancementForGlyph: gbuf[gbuf_len - 1]]))
+		{
+		  /* The previous glyph was not placed where the printing
+		   * context would put the next one.  */
+		  DPSmoveto(ctxt, gbuf_point.x, gbuf_point.y);
+		  GSShowGlyphsWithAdvances(ctxt, gbuf, advancementbuf, gbuf_len);
+		  DPSnewpath(ctxt);
+		  gbuf_len = 0;
+		}
 	      if (!gbuf_len)
 		{
-		  gbuf[0] = glyph->g;
-		  advancementbuf[0] = glyph->advancement;
 		  gbuf_point = p;
-		  gbuf_len = 1;
 		}
-	      else
+	      else if (gbuf_len == gbuf_size)
 		{
-		  if (gbuf_len == gbuf_size)
+		  gbuf_size *= 2;
+		  if (gbuf == gbuf_stack)
+		    {
+		      gbuf = malloc(sizeof(NSGlyph) * gbuf_size);
+		      advancementbuf = malloc(sizeof(NSSize) * gbuf_size);
+		      memcpy(gbuf, gbuf_stack, sizeof(NSGlyph) * gbuf_len);
+		      memcpy(advancementbuf, advancementbuf_stack,
+			sizeof(NSSize) * gbuf_len);
+		    }
+		  else
 		    {
-		      DPSmoveto(ctxt, gbuf_point.x, gbuf_point.y);
-		      GSShowGlyphsWithAdvances(ctxt, gbuf, advancementbuf, gbuf_size);
-		      DPSnewpath(ctxt);
-		      gbuf_len = 0;
-		      gbuf_point = p;
+		      gbuf = realloc(gbuf, sizeof(NSGlyph) * gbuf_size);
+		      advancementbuf = realloc(advancementbuf,
+			sizeof(NSSize) * gbuf_size);
 		    }
-		  gbuf[gbuf_len] = glyph->g;
-		  advancementbuf[gbuf_len] = glyph->advancement;
-		  gbuf_len++;
 		}
+	      gbuf[gbuf_len] = glyph->g;
+	      advancementbuf[gbuf_len] = glyph->advancement;
+	      gbuf_len++;
 	    }
 	  p.x += glyph->advancement.width;
 	}
@@ -1884,6 +1920,11 @@ for (i = 0; i < gbuf_len; i++) printf("   %3i : %04x\n", i, gbuf[i]); */
       GSShowGlyphsWithAdvances(ctxt, gbuf, advancementbuf, gbuf_len);
       DPSnewpath(ctxt);
     }
+  if (gbuf != gbuf_stack)
+    {
+      free(gbuf);
+      free(advancementbuf);
+    }
 
 #undef GBUF_SIZE
 
@@ -2557,6 +2598,10 @@ this file describes this.
   if (!(mask & NSTextStorageEditedCharacters))
     lengthChange = 0;
 
+  /* Tables only measure again the rows of cells that were edited. */
+  [NSTextTable _invalidateTablesInTextStorage: aTextStorage
+                                        range: invalidatedRange];
+
   if (_temporaryAttributes != nil && (mask & NSTextStorageEditedCharacters) != 0)
     {
       int i;
@@ -32,6 +32,8 @@
 #include "config.h"
 #import <Foundation/NSAutoreleasePool.h>
 #import <Foundation/NSArray.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDate.h>
 #import <Foundation/NSDebug.h>
 #import <Foundation/NSDictionary.h>
 #import <Foundation/NSString.h>
@@ -42,6 +44,7 @@
 #import <Foundation/NSException.h>
 #import <Foundation/NSFileManager.h>
 #import <Foundation/NSPathUtilities.h>
+#import <Foundation/NSPropertyList.h>
 #import <Foundation/NSScanner.h>
 #import <Foundation/NSSet.h>
 #import <Foundation/NSString.h>
@@ -57,20 +60,35 @@
 // Class variables:
 //
 
-//
-// Class variables used during scanning:
-//
-
-// Character sets used in scanning.
-static NSCharacterSet* newlineSet = nil;
-static NSCharacterSet* keyEndSet = nil;
-static NSCharacterSet* optKeyEndSet = nil;
-static NSCharacterSet* valueEndSet = nil;
-
 //Class variable to cache NSPrinters, without this they 
 //are created (and PPDs are parsed) ALL the time
 static NSMutableDictionary* printerCache;
 
+// The tables filled from a PPD file
+static NSString *ppdTableNames[] = {
+  @"PPD",
+  @"PPDOptionTranslation",
+  @"PPDArgumentTranslation",
+  @"PPDOrderDependency",
+  @"PPDUIConstraints"
+};
+#define PPD_TABLE_COUNT (sizeof(ppdTableNames) / sizeof(ppdTableNames[0]))
+
+// Version of the compiled PPD tables.  Increase it whenever the parser
+// or the layout of the tables changes, so older caches are not used.
+#define PPD_CACHE_VERSION 1
+
+//
+// State of the byte level scanner for PPD files.  Like the NSScanner
+// used before, every scan first skips spaces and tabs, but not newlines.
+//
+typedef struct {
+  const unsigned char *bytes;
+  NSUInteger length;
+  NSUInteger pos;
+  NSStringEncoding encoding;
+} GSPPDScanner;
+
 
 //
 // Private methods used for PPD Parsing
@@ -82,13 +100,13 @@ static NSMutableDictionary* printerCache;
          inclusionSet: (NSMutableSet*) includeSet;
 
 -(void) addPPDKeyword: (NSString*) mainKeyword
-          withScanner: (NSScanner*) PPDdata
+          withScanner: (GSPPDScanner*) PPDdata
           withPPDPath: (NSString*) ppdPath;
     
--(void) addPPDUIConstraint: (NSScanner*) constraint
+-(void) addPPDUIConstraint: (GSPPDScanner*) constraint
                withPPDPath: (NSString*) ppdPath;
 
--(void) addPPDOrderDependency: (NSScanner*) dependency
+-(void) addPPDOrderDependency: (GSPPDScanner*) dependency
                   withPPDPath: (NSString*) ppdPath;
 
 -(id) addString: (NSString*) string
@@ -146,31 +164,22 @@ static NSMutableDictionary* printerCache;
 {
   NSEnumerator *keyEnum;
   NSString *key;
+  NSSet *validNames;
   NSPrinter *printer;
   
   //First, the cache has to be managed.
   //Take into account any deleted printers.
-  keyEnum = [[printerCache allKeys] objectEnumerator];
-  while ((key = [keyEnum nextObject]))
+  if ([printerCache count] > 0)
     {
-      NSEnumerator *namesEnum;
-      NSString *validName;
-      BOOL stillValid = NO;
-
-      namesEnum = [[self printerNames] objectEnumerator];
-      while ((validName = [namesEnum nextObject]))
+      validNames = [NSSet setWithArray: [self printerNames]];
+      keyEnum = [[printerCache allKeys] objectEnumerator];
+      while ((key = [keyEnum nextObject]))
         {
-          if ([validName isEqualToString: key])
+          if ([validNames member: key] == nil)
             {
-              stillValid = YES;
-              break;
+              [printerCache removeObjectForKey: key];
             }
         }
-      
-      if (stillValid == NO)
-        {
-          [printerCache removeObjectForKey: key];
-        }
     }
 
   printer = [printerCache objectForKey: name];
@@ -562,14 +571,22 @@ static NSMutableDictionary* printerCache;
                   inTable: (NSString*) table
 {
   NSArray *results;
+  NSString *result;
+  NSUInteger count;
 
-  results = [self stringListForKey: key
-                           inTable: table];
-
-  if (results == nil)
+  // Same result as the first of -stringListForKey:inTable:, without
+  // copying the list
+  results = [[_tables objectForKey: table] objectForKey: key];
+  count = [results count];
+  if (count == 0)
     return nil;
 
-  return [results objectAtIndex: 0];
+  result = [results objectAtIndex: 0];
+  if ([result isEqual: @""])
+    {
+      return (count > 1) ? [results objectAtIndex: 1] : nil;
+    }
+  return result;
 }
 
 -(NSArray*) stringListForKey: (NSString*) key
@@ -718,61 +735,284 @@ static NSMutableDictionary* printerCache;
 
 
 
-@implementation NSPrinter (PPDParsing)
+//
+// Byte level scanning of PPD files
+//
+static inline BOOL
+ppdIsSpace(unsigned char c)
+{
+  return (c == ' ' || c == '\t');
+}
 
--(BOOL) parsePPDAtPath: (NSString*) ppdPath
+static inline BOOL
+ppdIsNewline(unsigned char c)
 {
-  NSAutoreleasePool* subpool;
-  NSMutableDictionary* ppdSymbolValues;
-  NSEnumerator* objEnum;
-  NSMutableArray* valArray;
+  return (c == '\n' || c == '\r');
+}
 
-  //make sure the class variables for scanning are created
-  if (!newlineSet)
+static inline void
+ppdSkipSpaces(GSPPDScanner *s)
+{
+  while (s->pos < s->length && ppdIsSpace(s->bytes[s->pos]))
+    s->pos++;
+}
+
+// Skips the rest of the line, but not the newline itself
+static inline void
+ppdSkipLine(GSPPDScanner *s)
+{
+  while (s->pos < s->length && !ppdIsNewline(s->bytes[s->pos]))
+    s->pos++;
+}
+
+// YES at the end of a line (or of the data) after skipping spaces
+static inline BOOL
+ppdAtNewline(GSPPDScanner *s)
+{
+  ppdSkipSpaces(s);
+  return (s->pos >= s->length || ppdIsNewline(s->bytes[s->pos]));
+}
+
+static BOOL
+ppdScanChar(GSPPDScanner *s, unsigned char c)
+{
+  ppdSkipSpaces(s);
+  if (s->pos < s->length && s->bytes[s->pos] == c)
     {
-      newlineSet = [NSCharacterSet characterSetWithCharactersInString: @"\n\r"];
-      RETAIN(newlineSet);
+      s->pos++;
+      return YES;
     }
+  return NO;
+}
+
+static BOOL
+ppdScanPrefix(GSPPDScanner *s, const char *prefix)
+{
+  NSUInteger len = strlen(prefix);
 
-  if (!keyEndSet)
+  ppdSkipSpaces(s);
+  if (s->pos + len <= s->length
+    && memcmp(s->bytes + s->pos, prefix, len) == 0)
     {
-      keyEndSet = [NSCharacterSet characterSetWithCharactersInString: @"\n\r\t: "];
-      RETAIN(keyEndSet);
+      s->pos += len;
+      return YES;
     }
+  return NO;
+}
+
+static NSString *
+ppdString(GSPPDScanner *s, NSUInteger start, NSUInteger end)
+{
+  NSString *str;
 
-  if (!optKeyEndSet)
+  str = [[NSString alloc] initWithBytes: s->bytes + start
+                                 length: end - start
+                               encoding: s->encoding];
+  if (str == nil)
     {
-      optKeyEndSet = [NSCharacterSet characterSetWithCharactersInString: @"\n\r:/"];
-      RETAIN(optKeyEndSet);
+      str = [[NSString alloc] initWithBytes: s->bytes + start
+                                     length: end - start
+                               encoding: NSISOLatin1StringEncoding];
     }
+  return AUTORELEASE(str);
+}
 
-  if (!valueEndSet)
+// Scans up to any of the stop characters, or nil if there is nothing
+static NSString *
+ppdScanUpTo(GSPPDScanner *s, const char *stops)
+{
+  NSUInteger start;
+  unsigned char c;
+
+  ppdSkipSpaces(s);
+  start = s->pos;
+  while (s->pos < s->length)
     {
-      valueEndSet = [NSCharacterSet characterSetWithCharactersInString: @"\n\r/"];
-      RETAIN(valueEndSet);
+      c = s->bytes[s->pos];
+      if (c != 0 && strchr(stops, c) != NULL)
+        break;
+      s->pos++;
     }
+  if (s->pos == start)
+    return nil;
+  return ppdString(s, start, s->pos);
+}
+
+// Scans up to the character c, which may be on a later line
+static NSString *
+ppdScanUpToChar(GSPPDScanner *s, unsigned char c)
+{
+  const unsigned char *found;
+  NSUInteger start;
+
+  ppdSkipSpaces(s);
+  start = s->pos;
+  found = memchr(s->bytes + start, c, s->length - start);
+  s->pos = (found == NULL) ? s->length : (NSUInteger)(found - s->bytes);
+  if (s->pos == start)
+    return nil;
+  return ppdString(s, start, s->pos);
+}
 
+//
+// Compiled PPD files.  The tables of a parsed PPD file are cached in the
+// user's caches directory, and used for as long as the file and the files
+// it includes keep their modification dates and sizes.
+//
+static NSDictionary *
+ppdFileStamp(NSString *path)
+{
+  NSDictionary *attributes;
 
+  attributes = [[NSFileManager defaultManager] fileAttributesAtPath: path
+                                                       traverseLink: YES];
+  if (attributes == nil)
+    return nil;
+  return [NSDictionary dictionaryWithObjectsAndKeys:
+    [NSNumber numberWithDouble:
+      [[attributes fileModificationDate] timeIntervalSinceReferenceDate]],
+    @"ModificationDate",
+    [NSNumber numberWithUnsignedLongLong: [attributes fileSize]],
+    @"Size",
+    nil];
+}
 
-  [_tables setObject: [NSMutableDictionary dictionary]
-              forKey: @"PPD"];
-      
-  [_tables setObject: [NSMutableDictionary dictionary]
-              forKey: @"PPDOptionTranslation"];
+static NSString *
+ppdCachePath(NSString *ppdPath)
+{
+  NSArray *dirs;
 
-  [_tables setObject: [NSMutableDictionary dictionary]
-              forKey: @"PPDArgumentTranslation"];
+  dirs = NSSearchPathForDirectoriesInDomains(NSCachesDirectory,
+                                             NSUserDomainMask, YES);
+  if ([dirs count] == 0)
+    return nil;
+  return [[[dirs objectAtIndex: 0]
+    stringByAppendingPathComponent: @"PPD"]
+    stringByAppendingPathComponent:
+      [NSString stringWithFormat: @"%@-%08lx.cache",
+        [[ppdPath lastPathComponent] stringByDeletingPathExtension],
+        (unsigned long)[ppdPath hash]]];
+}
 
-  [_tables setObject: [NSMutableDictionary dictionary]
-              forKey: @"PPDOrderDependency"];
+static NSDictionary *
+compiledPPDTables(NSString *ppdPath)
+{
+  NSString *cachePath = ppdCachePath(ppdPath);
+  NSDictionary *cache;
+  NSDictionary *files;
+  NSDictionary *tables;
+  NSEnumerator *enumerator;
+  NSString *path;
+  NSData *data;
+
+  if (cachePath == nil)
+    return nil;
+  data = [NSData dataWithContentsOfFile: cachePath];
+  if (data == nil)
+    return nil;
+  cache = [NSPropertyListSerialization
+            propertyListFromData: data
+                mutabilityOption: NSPropertyListMutableContainers
+                          format: NULL
+                errorDescription: NULL];
+  if (![cache isKindOfClass: [NSDictionary class]]
+    || ![[cache objectForKey: @"Version"] isEqual:
+      [NSNumber numberWithInt: PPD_CACHE_VERSION]]
+    || ![[cache objectForKey: @"Path"] isEqual: ppdPath])
+    return nil;
 
-  [_tables setObject: [NSMutableDictionary dictionary]
-              forKey: @"PPDUIConstraints"];
-  
+  files = [cache objectForKey: @"Files"];
+  tables = [cache objectForKey: @"Tables"];
+  if (![files isKindOfClass: [NSDictionary class]]
+    || ![tables isKindOfClass: [NSDictionary class]])
+    return nil;
+  enumerator = [files keyEnumerator];
+  while ((path = [enumerator nextObject]) != nil)
+    {
+      if (![[files objectForKey: path] isEqual: ppdFileStamp(path)])
+        return nil;
+    }
+  return tables;
+}
+
+static void
+storeCompiledPPDTables(NSString *ppdPath, NSDictionary *tables, NSSet *paths)
+{
+  NSString *cachePath = ppdCachePath(ppdPath);
+  NSMutableDictionary *files;
+  NSDictionary *cache;
+  NSEnumerator *enumerator;
+  NSString *path;
+  NSData *data;
+
+  if (cachePath == nil)
+    return;
+  files = [NSMutableDictionary dictionaryWithCapacity: [paths count]];
+  enumerator = [paths objectEnumerator];
+  while ((path = [enumerator nextObject]) != nil)
+    {
+      NSDictionary *stamp = ppdFileStamp(path);
+
+      if (stamp == nil)
+        return;
+      [files setObject: stamp forKey: path];
+    }
+  cache = [NSDictionary dictionaryWithObjectsAndKeys:
+    [NSNumber numberWithInt: PPD_CACHE_VERSION], @"Version",
+    ppdPath, @"Path",
+    files, @"Files",
+    tables, @"Tables", nil];
+  data = [NSPropertyListSerialization
+           dataFromPropertyList: cache
+                         format: NSPropertyListGNUstepBinaryFormat
+               errorDescription: NULL];
+  [[NSFileManager defaultManager] createDirectoryAtPath:
+                                    [cachePath stringByDeletingLastPathComponent]
+                            withIntermediateDirectories: YES
+                                             attributes: nil
+                                                  error: NULL];
+  [data writeToFile: cachePath atomically: YES];
+}
+
+
+@implementation NSPrinter (PPDParsing)
+
+-(BOOL) parsePPDAtPath: (NSString*) ppdPath
+{
+  NSAutoreleasePool* subpool;
+  NSMutableDictionary* ppdSymbolValues;
+  NSMutableDictionary* tables;
+  NSMutableSet* inclusionSet;
+  NSDictionary* compiled;
+  NSEnumerator* objEnum;
+  NSMutableArray* valArray;
+  unsigned i;
   
   // Create a temporary autorelease pool, as many temporary objects are used
   subpool = [[NSAutoreleasePool alloc] init];
 
+  // Use the compiled tables if the PPD has not changed since it was parsed
+  compiled = compiledPPDTables(ppdPath);
+  if (compiled != nil)
+    {
+      for (i = 0; i < PPD_TABLE_COUNT; i++)
+        {
+          NSMutableDictionary *table;
+
+          table = [compiled objectForKey: ppdTableNames[i]];
+          if (table == nil)
+            table = [NSMutableDictionary dictionary];
+          [_tables setObject: table forKey: ppdTableNames[i]];
+        }
+      [subpool drain];
+      return YES;
+    }
+
+  for (i = 0; i < PPD_TABLE_COUNT; i++)
+    {
+      [_tables setObject: [NSMutableDictionary dictionary]
+                  forKey: ppdTableNames[i]];
+    }
 
   // NB: There are some structure keywords (such as OpenUI/CloseUI) that may
   // be repeated, but as yet are not used. Since they are structure keywords,
@@ -785,9 +1025,10 @@ static NSMutableDictionary* printerCache;
   //The inclusion set keeps track of what PPD files have been *Include(d).
   //If one comes up twice recursion has occurred and we stop it.
   // And scan the PPD itself
+  inclusionSet = [NSMutableSet setWithCapacity: 10];
   [self loadPPDAtPath: ppdPath
          symbolValues: ppdSymbolValues
-         inclusionSet: [NSMutableSet setWithCapacity:10]];
+         inclusionSet: inclusionSet];
 
   // Search the PPD dictionary for symbolvalues and substitute them.
   objEnum = [[_tables objectForKey: @"PPD"] objectEnumerator];
@@ -795,15 +1036,14 @@ static NSMutableDictionary* printerCache;
     {
       NSString *oldValue;
       NSString *newValue;
-      int i, max;
+      int j, max;
 
       max = [valArray count];
-      for (i=0 ; i < max ; i++)
+      for (j = 0; j < max; j++)
         {
-          oldValue = [valArray objectAtIndex: i];
+          oldValue = [valArray objectAtIndex: j];
           if ([oldValue isKindOfClass: [NSString class]] 
-              && ![oldValue isEqual: @""] 
-              &&  [[oldValue substringToIndex: 1] isEqual: @"^"])
+              && [oldValue hasPrefix: @"^"])
               {
                 newValue = [ppdSymbolValues
                              objectForKey: [oldValue substringFromIndex: 1]];
@@ -815,13 +1055,11 @@ static NSMutableDictionary* printerCache;
                        oldValue, ppdPath];
                     }
 
-                  [valArray replaceObjectAtIndex: i 
+                  [valArray replaceObjectAtIndex: j
                                       withObject: newValue];
              }
         }
     }
-
-
   
   // Make sure all the required keys are present
   //Too many PPDs don't pass the test....
@@ -854,6 +1092,15 @@ static NSMutableDictionary* printerCache;
     }
   */
 
+  // Compile the tables for the next time this PPD is used
+  tables = [NSMutableDictionary dictionaryWithCapacity: PPD_TABLE_COUNT];
+  for (i = 0; i < PPD_TABLE_COUNT; i++)
+    {
+      [tables setObject: [_tables objectForKey: ppdTableNames[i]]
+                 forKey: ppdTableNames[i]];
+    }
+  storeCompiledPPDTables(ppdPath, tables, inclusionSet);
+
   // Release the local autoreleasePool
   [subpool drain];
 
@@ -893,8 +1140,9 @@ static NSMutableDictionary* printerCache;
          symbolValues: (NSMutableDictionary*) ppdSymbolValues
          inclusionSet: (NSMutableSet*) inclusionSet
 {
-  NSString* ppdString;
-  NSScanner* ppdData;
+  NSData* ppdContents;
+  GSPPDScanner scanner;
+  GSPPDScanner* ppdData = &scanner;
   NSString* keyword;
 
   
@@ -909,36 +1157,37 @@ static NSMutableDictionary* printerCache;
   
   [inclusionSet addObject: ppdPath];
 
-  ppdString = [NSString stringWithContentsOfFile: ppdPath];
-  if (nil == ppdString)
+  ppdContents = [NSData dataWithContentsOfFile: ppdPath];
+  if (nil == ppdContents)
     {
       // The file isn't readable
       [NSException raise: NSPPDParseException
                   format: @"PPD file '%@' isn't readable", ppdPath];
     }
 
-  // Set up the scanner - Appending a newline means that it should be
-  // able to process the last line correctly
-  ppdData = [NSScanner scannerWithString:
-			 [ppdString stringByAppendingString: @"\n"]];
-       
-  [ppdData setCharactersToBeSkipped: [NSCharacterSet whitespaceCharacterSet]];
+  // Set up the scanner.  The end of the data counts as the end of a line.
+  scanner.bytes = [ppdContents bytes];
+  scanner.length = [ppdContents length];
+  scanner.pos = 0;
+  scanner.encoding = [NSString defaultCStringEncoding];
   
   // Main processing starts here...
   while (YES)  //Only check for the end after accounting for whitespace
     {
       // Get to the start of a new keyword, skipping blank lines
-      [ppdData scanCharactersFromSet: 
-               [NSCharacterSet whitespaceAndNewlineCharacterSet]
-                          intoString: NULL];
+      while (ppdData->pos < ppdData->length
+        && (ppdIsSpace(ppdData->bytes[ppdData->pos])
+          || ppdIsNewline(ppdData->bytes[ppdData->pos])))
+        {
+          ppdData->pos++;
+        }
     
       //this could be the end...
-      if ([ppdData isAtEnd])
+      if (ppdData->pos >= ppdData->length)
         break;
         
       // All new entries should starts '*'
-      if (![ppdData scanString: @"*" 
-                    intoString: NULL])
+      if (!ppdScanChar(ppdData, '*'))
         {
           [NSException raise: NSPPDParseException
                       format: @"Line not starting with * in PPD file %@", 
@@ -946,43 +1195,37 @@ static NSMutableDictionary* printerCache;
         }
 
       // Skip lines starting '*%', '*End', '*SymbolLength', or '*SymbolEnd'
-      if ([ppdData scanString: @"%" 
-                      intoString: NULL]
-          || [ppdData scanString: @"End" //if we get this there is problem, yes?
-                      intoString: NULL]
-          || [ppdData scanString: @"SymbolLength" 
-                      intoString: NULL]
-          || [ppdData scanString: @"SymbolEnd" //if we get this there is problem, yes?
-                      intoString: NULL])
+      if (ppdScanChar(ppdData, '%')
+          || ppdScanPrefix(ppdData, "End") //if we get this there is problem, yes?
+          || ppdScanPrefix(ppdData, "SymbolLength")
+          || ppdScanPrefix(ppdData, "SymbolEnd")) //if we get this there is problem, yes?
         {
-          [ppdData scanUpToCharactersFromSet: newlineSet 
-                                  intoString: NULL];
+          ppdSkipLine(ppdData);
           continue;
         }
         
       // Read main keyword, up to a colon, space or newline
-      [ppdData scanUpToCharactersFromSet: keyEndSet 
-                              intoString: &keyword];
+      keyword = ppdScanUpTo(ppdData, "\n\r\t: ");
       
       // Loop if there is no value section, these keywords are ignored
-      if ([ppdData scanCharactersFromSet: newlineSet 
-                              intoString: NULL])
+      if (keyword == nil || ppdAtNewline(ppdData))
         {
+          ppdSkipLine(ppdData);
           continue;
         }
         
       // Add the line to the relevant table
-      if ([keyword isEqual: @"OrderDependency"])
+      if ([keyword isEqualToString: @"OrderDependency"])
         {
           [self addPPDOrderDependency: ppdData
                           withPPDPath: ppdPath];
         }
-      else if ([keyword isEqual: @"UIConstraints"])
+      else if ([keyword isEqualToString: @"UIConstraints"])
         {
           [self addPPDUIConstraint: ppdData
                        withPPDPath: ppdPath];
         }
-      else if ([keyword isEqual: @"Include"])
+      else if ([keyword isEqualToString: @"Include"])
         {
           NSFileManager *fileManager;
           NSString *fileName = nil;
@@ -990,28 +1233,22 @@ static NSMutableDictionary* printerCache;
 
           fileManager = [NSFileManager defaultManager];
           
-          [ppdData scanString: @":" 
-                   intoString: NULL];
-                  
-          // Find the filename between two "s"
-          [ppdData scanString: @"\""             /*"*/
-                   intoString: NULL];
+          ppdScanChar(ppdData, ':');
                   
-          [ppdData scanUpToString: @"\""         /*"*/ 
-                       intoString: &fileName];
-                      
-          [ppdData scanString: @"\""            /*"*/
-                   intoString: NULL];
+          // Find the filename between two "s
+          ppdScanChar(ppdData, '"');
+          fileName = ppdScanUpToChar(ppdData, '"');
+          ppdScanChar(ppdData, '"');
 
           //the fileName could be an absolute path or just a filename.
-          if ([fileManager fileExistsAtPath: fileName])
+          if (fileName != nil && [fileManager fileExistsAtPath: fileName])
             {
               //it was absolute, we are done
               path = fileName;
             }
           //it was not absolute.  Check to see if it exists in the 
           //directory of this ppd
-          else if ([fileManager fileExistsAtPath: 
+          else if (fileName != nil && [fileManager fileExistsAtPath:
                      [[ppdPath stringByDeletingLastPathComponent] 
                        stringByAppendingPathComponent: fileName] ])
             {
@@ -1021,44 +1258,39 @@ static NSMutableDictionary* printerCache;
           else  //could not find the *Include fileName
             {
               [NSException raise: NSPPDIncludeNotFoundException
-                         format: @"Could not find *Included PPD file %@", path];
+                         format: @"Could not find *Included PPD file %@",
+                         fileName];
             }
         
           [self loadPPDAtPath: path
                  symbolValues: ppdSymbolValues 
                  inclusionSet: inclusionSet];
         }
-      else if ([keyword isEqual: @"SymbolValue"])
+      else if ([keyword isEqualToString: @"SymbolValue"])
         {
           NSString *symbolName;
           NSString *symbolVal;
 
-          if (![ppdData scanString: @"^" 
-                        intoString: NULL])
+          if (!ppdScanChar(ppdData, '^'))
             {
               [NSException raise: NSPPDParseException
                format:@"Badly formatted *SymbolValue in PPD file %@",
                ppdPath];
             }	    
 
-          [ppdData scanUpToString: @":" 
-                       intoString: &symbolName];
-
-                      
-          [ppdData scanString: @":" 
-                   intoString: NULL];
-                  
-          [ppdData scanString: @"\""              /*"*/
-                   intoString: NULL];
-                 
-          [ppdData scanUpToString: @"\""          /*"*/
-                       intoString: &symbolVal];
-                 
+          symbolName = ppdScanUpToChar(ppdData, ':');
+          if (symbolName == nil)
+            {
+              [NSException raise: NSPPDParseException
+               format:@"Badly formatted *SymbolValue in PPD file %@",
+               ppdPath];
+            }
+          ppdScanChar(ppdData, ':');
+          ppdScanChar(ppdData, '"');
+          symbolVal = ppdScanUpToChar(ppdData, '"');
           if (!symbolVal)
             symbolVal = @"";
-      
-          [ppdData scanString: @"\""             /*"*/
-                   intoString: NULL];
+          ppdScanChar(ppdData, '"');
              
           [ppdSymbolValues setObject: symbolVal 
                               forKey: symbolName];                         
@@ -1072,25 +1304,26 @@ static NSMutableDictionary* printerCache;
 
 
       // Skip any other data that don't conform with the specification.
-      [ppdData scanUpToCharactersFromSet: newlineSet
-			      intoString: NULL];
+      ppdSkipLine(ppdData);
     }
 }
 
 
 -(void) addPPDKeyword: (NSString*) mainKeyword
-          withScanner: (NSScanner*) ppdData
+          withScanner: (GSPPDScanner*) ppdData
           withPPDPath: (NSString*) ppdPath
 { 
-  NSArray *repKeys;
+  static NSSet *repKeys = nil;
   NSString* optionKeyword = nil;
   NSString* optionTranslation = nil;
   NSString* value = nil;
   NSString* valueTranslation = nil;
 
-  // Array of Repeated Keywords (Appendix B of the PostScript Printer
+  // Set of Repeated Keywords (Appendix B of the PostScript Printer
   // Description File Format Specification).
-  repKeys = [NSArray arrayWithObjects:@"Emulators",
+  if (repKeys == nil)
+    {
+      repKeys = [[NSSet alloc] initWithObjects: @"Emulators",
 		     @"Extensions",
 		     @"FaxSupport",
 		   //@"Include", (handled separately)
@@ -1106,47 +1339,38 @@ static NSMutableDictionary* printerCache;
   // it's often repeated anyway, so I'm putting it here.
 		     @"InkName",
 		     nil];
+    }
 
 
   // Scan off any optionKeyword
-  [ppdData scanUpToCharactersFromSet: optKeyEndSet 
-                          intoString: &optionKeyword];
+  optionKeyword = ppdScanUpTo(ppdData, "\n\r:/");
 
-  if ([ppdData scanCharactersFromSet: newlineSet 
-                          intoString: NULL])
+  if (ppdAtNewline(ppdData))
     {
       [NSException raise: NSPPDParseException
        format: @"Keyword has optional keyword but no value in PPD file %@",
        ppdPath];
     }
 
-  if ([ppdData scanString: @"/" 
-               intoString: NULL])
+  if (ppdScanChar(ppdData, '/'))
     {
       // Option keyword translation exists - scan it
-      [ppdData scanUpToString: @":" 
-                   intoString: &optionTranslation];
+      optionTranslation = ppdScanUpToChar(ppdData, ':');
     }
 
-  [ppdData scanString: @":" 
-           intoString: NULL];
+  ppdScanChar(ppdData, ':');
 
   // Read the value part
   // Values starting with a " are read until the second ", ignoring \n etc.
   
-  if ([ppdData scanString: @"\""             /*"*/
-               intoString: NULL])
+  if (ppdScanChar(ppdData, '"'))
     {
-      [ppdData scanUpToString: @"\""         /*"*/
-                   intoString: &value];
-                   
-      [ppdData scanString: @"\""             /*"*/
-               intoString: NULL];
+      value = ppdScanUpToChar(ppdData, '"');
+      ppdScanChar(ppdData, '"');
                
       // It is a QuotedValue if it's in quotes, and there is no option
       // key, or the main key is a *JCL keyword
-      if (!optionKeyword || [[mainKeyword substringToIndex:3]
-                               isEqualToString: @"JCL"])
+      if (!optionKeyword || [mainKeyword hasPrefix: @"JCL"])
         {
           value = [self interpretQuotedValue: value];
         }
@@ -1154,8 +1378,7 @@ static NSMutableDictionary* printerCache;
   else
     {
       // Otherwise, scan up to the end of line or '/'
-      [ppdData scanUpToCharactersFromSet: valueEndSet 
-                              intoString: &value];
+      value = ppdScanUpTo(ppdData, "\n\r/");
     }
 
   if (!value)
@@ -1164,11 +1387,9 @@ static NSMutableDictionary* printerCache;
     }
 
   // If there is a value translation, scan it
-  if ([ppdData scanString: @"/" 
-               intoString: NULL])
+  if (ppdScanChar(ppdData, '/'))
     {
-      [ppdData scanUpToCharactersFromSet: newlineSet
-                              intoString: &valueTranslation];
+      valueTranslation = ppdScanUpTo(ppdData, "\n\r");
     }
 
   // The translations also have to have any hex substrings interpreted
@@ -1244,7 +1465,7 @@ static NSMutableDictionary* printerCache;
 }
 
 
--(void) addPPDUIConstraint: (NSScanner*) constraint
+-(void) addPPDUIConstraint: (GSPPDScanner*) constraint
                withPPDPath: (NSString*) ppdPath
 {
   NSString* mainKey1 = nil;
@@ -1253,8 +1474,7 @@ static NSMutableDictionary* printerCache;
   NSString* optionKey2 = nil;
 
   // UIConstraint should have no option keyword
-  if (![constraint scanString: @":" 
-                   intoString: NULL])
+  if (!ppdScanChar(constraint, ':'))
     {
       [NSException raise:NSPPDParseException
        format:@"UIConstraints has option keyword in PPD File %@",
@@ -1262,40 +1482,35 @@ static NSMutableDictionary* printerCache;
     }
     
   // Skip the '*'
-  [constraint scanString: @"*" 
-              intoString: NULL];
+  ppdScanChar(constraint, '*');
               
   // Scan the bits. Stuff not starting with * must be an optionKeyword
-  [constraint scanUpToCharactersFromSet: [NSCharacterSet whitespaceCharacterSet]
-                             intoString: &mainKey1];
+  mainKey1 = ppdScanUpTo(constraint, " \t\n\r");
 
-  if (![constraint scanString: @"*" 
-                   intoString: NULL])
+  if (!ppdScanChar(constraint, '*'))
     {
-      [constraint scanUpToCharactersFromSet: [NSCharacterSet whitespaceCharacterSet]
-		                     intoString: &optionKey1];
-                                 
-      [constraint scanString: @"*" 
-                  intoString: NULL];
-                  
+      optionKey1 = ppdScanUpTo(constraint, " \t\n\r");
+      ppdScanChar(constraint, '*');
     }
     
-  [constraint scanUpToCharactersFromSet: 
-              [NSCharacterSet whitespaceAndNewlineCharacterSet]
-                             intoString: &mainKey2];
+  mainKey2 = ppdScanUpTo(constraint, " \t\n\r");
                             
-  if (![constraint scanCharactersFromSet: newlineSet 
-                              intoString: NULL])
+  if (!ppdAtNewline(constraint))
     {
-      [constraint scanUpToCharactersFromSet: 
-                  [NSCharacterSet whitespaceAndNewlineCharacterSet]
-                                 intoString: &optionKey2];
+      optionKey2 = ppdScanUpTo(constraint, " \t\n\r");
     }
   else
     {
       optionKey2 = @"";
     }
 
+  if (mainKey1 == nil || mainKey2 == nil)
+    {
+      [NSException raise: NSPPDParseException
+       format: @"Badly formatted *UIConstraints in PPD File %@",
+       ppdPath];
+    }
+
   // Add to table
   if (optionKey1)
     mainKey1 = [mainKey1 stringByAppendingFormat: @"/%@", optionKey1];
@@ -1312,7 +1527,7 @@ static NSMutableDictionary* printerCache;
 
 
 
--(void) addPPDOrderDependency: (NSScanner*) dependency
+-(void) addPPDOrderDependency: (GSPPDScanner*) dependency
                   withPPDPath: (NSString*) ppdPath
 {
   NSString *realValue = nil;
@@ -1321,39 +1536,30 @@ static NSMutableDictionary* printerCache;
   NSString *optionKeyword = nil;
 
   // Order dependency should have no option keyword
-  if (![dependency scanString: @":" 
-                   intoString: NULL])
+  if (!ppdScanChar(dependency, ':'))
     {
       [NSException raise: NSPPDParseException
        format:@"OrderDependency has option keyword in PPD file %@",
        ppdPath];
     }
 
-  [dependency scanUpToCharactersFromSet: [NSCharacterSet whitespaceCharacterSet]
-                             intoString: &realValue];
+  realValue = ppdScanUpTo(dependency, " \t\n\r");
+  section = ppdScanUpTo(dependency, " \t\n\r");
+  ppdScanChar(dependency, '*');
+  keyword = ppdScanUpTo(dependency, " \t\n\r");
                              
-  [dependency scanUpToCharactersFromSet: [NSCharacterSet whitespaceCharacterSet]
-                             intoString: &section];
-                             
-  [dependency scanString: @"*" 
-              intoString: NULL];
-              
-  [dependency scanUpToCharactersFromSet: 
-              [NSCharacterSet whitespaceAndNewlineCharacterSet]
-                             intoString: &keyword];
-                            
-  if (![dependency scanCharactersFromSet: newlineSet 
-                              intoString: NULL])
+  if (!ppdAtNewline(dependency))
     {
       // Optional keyword exists
-      [dependency scanUpToCharactersFromSet: 
-                  [NSCharacterSet whitespaceAndNewlineCharacterSet]
-                                 intoString: &optionKeyword];
+      optionKeyword = ppdScanUpTo(dependency, " \t\n\r");
     }
 
-  // Go to next line of PPD file
-  [dependency scanCharactersFromSet: newlineSet 
-                         intoString: NULL];
+  if (realValue == nil || section == nil || keyword == nil)
+    {
+      [NSException raise: NSPPDParseException
+       format: @"Badly formatted *OrderDependency in PPD file %@",
+       ppdPath];
+    }
                          
   // Add to table
   if (optionKeyword)
@@ -1434,13 +1640,12 @@ static NSMutableDictionary* printerCache;
 // Function to convert hexadecimal substrings
 -(NSString*) interpretQuotedValue: (NSString*) qString
 {
-  NSScanner *scanner;
-  NSCharacterSet *emptySet;
-  NSString *value = nil;
-  NSString *part;
-  int stringLength;
-  int location;
-  NSRange range;
+  NSUInteger length;
+  NSUInteger pos;
+  NSUInteger count;
+  unichar *chars;
+  unichar *buffer;
+  NSString *value;
 
   if (!qString)
     {
@@ -1448,66 +1653,73 @@ static NSMutableDictionary* printerCache;
     }
 
   // Don't bother unless there's something to convert
-  range = [qString rangeOfString: @"<"];
-  if (!range.length)
+  if ([qString rangeOfString: @"<"].length == 0)
     return qString;
 
-  scanner = [NSScanner scannerWithString: qString];
-  emptySet = [NSCharacterSet characterSetWithCharactersInString: @""];
-  [scanner setCharactersToBeSkipped: emptySet];  
+  // The result is never longer than the quoted value, so one pass over
+  // a character buffer is enough.
+  length = [qString length];
+  chars = NSZoneMalloc(NSDefaultMallocZone(), 2 * length * sizeof(unichar));
+  buffer = chars + length;
+  [qString getCharacters: chars];
 
-  if (![scanner scanUpToString: @"<" 
-                    intoString: &value])
+  pos = 0;
+  count = 0;
+  NS_DURING
     {
-      value = [NSString string];
-    }
-
-  stringLength = [qString length];
+      while (pos < length)
+        {
+          if (chars[pos] != '<')
+            {
+              buffer[count++] = chars[pos++];
+              continue;
+            }
+          pos++;
 
-  while (![scanner isAtEnd]) 
-    {
-      [scanner scanString: @"<" 
-               intoString: NULL];
+          // "<<" is a valid part of a PS string
+          if (pos < length && chars[pos] == '<')
+            {
+              buffer[count++] = '<';
+              buffer[count++] = '<';
+              pos++;
+              continue;
+            }
 
-      // "<<" is a valid part of a PS string
-      if ([scanner scanString: @"<" 
-		   intoString: NULL])
-        {
-	  value = [value stringByAppendingString: @"<<"];	    
-	}
-      else 
-        {
-	  [scanner scanCharactersFromSet: [NSCharacterSet whitespaceAndNewlineCharacterSet]
-		   intoString: NULL];
-	  
-	  while (![scanner scanString: @">" 
-			   intoString: NULL])
-	    {
-	      location = [scanner scanLocation];
-	      if (location+2 > stringLength)
-	        {
-		  [NSException raise: NSPPDParseException
-			       format: @"Badly formatted hexadecimal substring '%@' in \
+          while (YES)
+            {
+              while (pos < length
+                && [[NSCharacterSet whitespaceAndNewlineCharacterSet]
+                     characterIsMember: chars[pos]])
+                {
+                  pos++;
+                }
+              if (pos < length && chars[pos] == '>')
+                {
+                  pos++;
+                  break;
+                }
+              if (pos + 2 > length)
+                {
+                  [NSException raise: NSPPDParseException
+                              format: @"Badly formatted hexadecimal substring '%@' in \
                                   PPD printer file.", qString];
-		  // NOT REACHED
-		}
-	      value = [value stringByAppendingFormat: @"%c",
-			     16 * [self gethex: [qString characterAtIndex: location]]
-			     + [self gethex: [qString characterAtIndex: location+1]]];
-	      
-	      [scanner setScanLocation: location+2];
-	      
-	      [scanner scanCharactersFromSet: [NSCharacterSet whitespaceAndNewlineCharacterSet]
-		       intoString: NULL];
-	    }
-	}
-      
-      if ([scanner scanUpToString:@"<" intoString:&part])
-        {
-	  value = [value stringByAppendingString: part];
-	}
+                  // NOT REACHED
+                }
+              buffer[count++] = 16 * [self gethex: chars[pos]]
+                + [self gethex: chars[pos + 1]];
+              pos += 2;
+            }
+        }
+    }
+  NS_HANDLER
+    {
+      NSZoneFree(NSDefaultMallocZone(), chars);
+      [localException raise];
     }
+  NS_ENDHANDLER
 
+  value = [NSString stringWithCharacters: buffer length: count];
+  NSZoneFree(NSDefaultMallocZone(), chars);
   return value;
 }
 
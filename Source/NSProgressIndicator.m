@@ -26,15 +26,12 @@
    Boston, MA 02110-1301, USA.
 */
 
-#import <Foundation/NSAutoreleasePool.h>
-#import <Foundation/NSRunLoop.h>
-#import <Foundation/NSThread.h>
-#import <Foundation/NSTimer.h>
 #import "AppKit/NSApplication.h"
 #import "AppKit/NSProgressIndicator.h"
 #import "AppKit/NSGraphics.h"
 #import "AppKit/NSImage.h"
 #import "AppKit/NSWindow.h"
+#import "GNUstepGUI/GSAnimator.h"
 #import "GNUstepGUI/GSTheme.h"
 #import "GNUstepGUI/GSNibLoading.h"
 
@@ -72,7 +69,10 @@
 
 - (void) dealloc
 {
-  [self stopAnimation: self];
+  /* -stopAnimation: does nothing for a determinate bar, which may have
+   * been started while it was indeterminate.
+   */
+  [[GSAnimationClock sharedClock] removeTarget: self];
   [super dealloc];
 }
 
@@ -108,18 +108,6 @@
     }
 }
 
-- (void) _animationLoop
-{
-  while (_isRunning)
-    {
-      CREATE_AUTORELEASE_POOL(pool);
-
-      [self animate: self];
-      [NSThread sleepForTimeInterval: _animationDelay];
-      [pool drain];
-    }
-}
-
 - (void) startAnimation: (id)sender
 {
   if (_isRunning || (!_isIndeterminate 
@@ -127,21 +115,12 @@
     return;
 
   _isRunning = YES;
-  if (!_usesThreadedAnimation)
-    {
-      ASSIGN(_timer, [NSTimer scheduledTimerWithTimeInterval: _animationDelay 
-                              target: self 
-                              selector: @selector(animate:)
-                              userInfo: nil
-                              repeats: YES]);
-      [[NSRunLoop currentRunLoop] addTimer: _timer forMode: NSModalPanelRunLoopMode];
-    }
-  else
-    {
-      [NSThread detachNewThreadSelector: @selector(_animationLoop) 
-                toTarget: self 
-                withObject: nil];
-    }
+  /* All indicators share the animation clock, threaded or not, so they
+   * are redrawn together in one display pass.
+   */
+  [[GSAnimationClock sharedClock] addTarget: self
+                                   selector: @selector(animate:)
+                                   interval: _animationDelay];
 }
 
 - (void) stopAnimation: (id)sender
@@ -150,15 +129,7 @@
                       && (_style == NSProgressIndicatorBarStyle)))
     return;
 
-  if (!_usesThreadedAnimation)
-    {
-      [_timer invalidate];
-      DESTROY(_timer);
-    }
-  else
-    {
-      // Done automatically
-    }
+  [[GSAnimationClock sharedClock] removeTarget: self];
 
   _isRunning = NO;
   _count = 0;
@@ -32,7 +32,9 @@
 
 #import <Foundation/NSDebug.h>
 #import <Foundation/NSException.h>
+#import <Foundation/NSMapTable.h>
 #import <Foundation/NSNotification.h>
+#import <Foundation/NSRunLoop.h>
 #import <Foundation/NSUserDefaults.h>
 
 #import "AppKit/NSColor.h"
@@ -51,6 +53,8 @@
 #import "AppKit/PSOperators.h"
 #import "GNUstepGUI/GSTheme.h"
 
+#include <math.h>
+
 @interface NSClipView (Private)
 - (void) _scrollToPoint: (NSPoint)aPoint;
 @end
@@ -106,6 +110,7 @@ typedef struct _scrollViewFlags
 /* GNUstep private methods */
 - (void) _synchronizeHeaderAndCornerView;
 - (void) _themeDidActivate: (NSNotification*)notification;
+- (void) _applyPendingScroll: (id)sender;
 @end
 
 @implementation NSScrollView
@@ -115,6 +120,16 @@ typedef struct _scrollViewFlags
  */
 static Class rulerViewClass = nil;
 static CGFloat scrollerWidth;
+static NSArray *scrollModes = nil;
+
+/* The scroll wheel distance still to be applied by each scroll view.
+   A scroll view only has an entry while it has a scroll pending.  */
+static NSMapTable *pendingScrolls = 0;
+
+/* Part of the remaining scroll wheel distance applied per frame when
+   smoothing, and the frame interval used meanwhile.  */
+#define GS_SCROLL_SMOOTHING 0.4
+#define GS_SCROLL_FRAME (1.0 / 60.0)
 
 /*
  * Class methods
@@ -125,6 +140,11 @@ static CGFloat scrollerWidth;
     {
       [self setRulerViewClass: [NSRulerView class]];
       scrollerWidth = [NSScroller scrollerWidth];
+      scrollModes = [[NSArray alloc] initWithObjects: NSDefaultRunLoopMode,
+                                     NSModalPanelRunLoopMode,
+                                     NSEventTrackingRunLoopMode, nil];
+      pendingScrolls = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                                        NSOwnedPointerMapValueCallBacks, 0);
       [self setVersion: 2];
     }
 }
@@ -243,6 +263,7 @@ static CGFloat scrollerWidth;
   DESTROY(_vertScroller);
   DESTROY(_horizRuler);
   DESTROY(_vertRuler);
+  NSMapRemove(pendingScrolls, self);
 
   [super dealloc];
 }
@@ -428,6 +449,7 @@ static CGFloat scrollerWidth;
   CGFloat deltaX = [theEvent deltaX];
   CGFloat amount;
   NSPoint point;
+  NSPoint *pending;
 
   if (_contentView == nil)
     {
@@ -482,9 +504,28 @@ static CGFloat scrollerWidth;
 
   point.y = clipViewBounds.origin.y + amount;
 
-  /* scrollToPoint: will call reflectScrolledClipView:, which will
-   * update rules, headers, and scrollers.  */
-  [_contentView _scrollToPoint: point];
+  /* Wheels and touchpads may send many events per frame, so only add
+   * up the distance here and scroll once before the window is next
+   * displayed, just like NSTextView updates its state.  */
+  if (_contentView == nil)
+    {
+      return;
+    }
+  pending = (NSPoint *)NSMapGet(pendingScrolls, self);
+  if (pending == 0)
+    {
+      pending = NSZoneMalloc(NSDefaultMallocZone(), sizeof(NSPoint));
+      *pending = NSZeroPoint;
+      NSMapInsert(pendingScrolls, self, pending);
+      [[NSRunLoop currentRunLoop]
+        performSelector: @selector(_applyPendingScroll:)
+                 target: self
+               argument: nil
+                  order: 599999
+                  modes: scrollModes];
+    }
+  pending->x += point.x - clipViewBounds.origin.x;
+  pending->y += point.y - clipViewBounds.origin.y;
 }
 
 - (void) keyDown: (NSEvent *)theEvent
@@ -1890,5 +1931,64 @@ GSOppositeEdge(NSRectEdge edge)
   [self tile];
 }
 
+/*
+ * Scrolls by the distance collected from scroll wheel events.  With the
+ * GSScrollWheelSmoothing user default set, only part of it is applied
+ * per frame, so the scroll speed follows the remaining distance.  The
+ * remainder along an axis is dropped when the clip view could not move
+ * as far as asked, e.g. at the end of the document.
+ */
+- (void) _applyPendingScroll: (id)sender
+{
+  NSPoint *pending = (NSPoint *)NSMapGet(pendingScrolls, self);
+  NSPoint origin;
+  NSPoint step;
+  NSPoint moved;
+
+  if (pending == 0)
+    {
+      return;
+    }
+  step = *pending;
+  if (_contentView == nil)
+    {
+      NSMapRemove(pendingScrolls, self);
+      return;
+    }
+
+  if ([[NSUserDefaults standardUserDefaults]
+        boolForKey: @"GSScrollWheelSmoothing"])
+    {
+      if (fabs(step.x) > 1.0)
+        step.x *= GS_SCROLL_SMOOTHING;
+      if (fabs(step.y) > 1.0)
+        step.y *= GS_SCROLL_SMOOTHING;
+    }
+
+  /* scrollToPoint: will call reflectScrolledClipView:, which will
+   * update rules, headers, and scrollers.  */
+  origin = [_contentView bounds].origin;
+  [_contentView _scrollToPoint: NSMakePoint(origin.x + step.x,
+                                            origin.y + step.y)];
+  moved.x = [_contentView bounds].origin.x - origin.x;
+  moved.y = [_contentView bounds].origin.y - origin.y;
+
+  pending->x = (fabs(step.x - moved.x) < 1.0) ? pending->x - moved.x : 0.0;
+  pending->y = (fabs(step.y - moved.y) < 1.0) ? pending->y - moved.y : 0.0;
+
+  if (fabs(pending->x) >= 1.0 || fabs(pending->y) >= 1.0)
+    {
+      [self performSelector: @selector(_applyPendingScroll:)
+                 withObject: nil
+                 afterDelay: GS_SCROLL_FRAME
+                    inModes: scrollModes];
+    }
+  else
+    {
+      /* Less than a pixel is left, which is dropped.  */
+      NSMapRemove(pendingScrolls, self);
+    }
+}
+
 @end
 
@@ -33,6 +33,7 @@
 #import "config.h"
 #import <Foundation/NSArray.h>
 #import <Foundation/NSBundle.h>
+#import <Foundation/NSCharacterSet.h>
 #import <Foundation/NSConnection.h>
 #import <Foundation/NSDictionary.h>
 #import <Foundation/NSDistantObject.h>
@@ -61,6 +62,10 @@
 #import "GSGuiPrivate.h"
 #import "GNUstepGUI/GSServicesManager.h"
 
+/* Number of characters, give or take a word, handed to a spell server
+ * which finds one misspelling per request. */
+#define MISSPELLING_WINDOW 1024
+
 // prototype for function to create name for server
 extern NSString *GSSpellServerName(NSString *checkerDictionary, NSString *language);
 
@@ -84,6 +89,18 @@ extern NSString *GSSpellServerName(NSString *checkerDictionary, NSString *langua
 			  inLanguage: (NSString *)language;
 @end
 
+// Servers which implement this return the ranges of all misspelled
+// words of a string in one call, rather than one misspelling per call.
+@protocol NSSpellServerBatchProtocol
+- (NSArray *) _findMisspelledWordsInString: (NSString *)stringToCheck
+				  language: (NSString *)language
+			      ignoredWords: (NSArray *)ignoredWords;
+@end
+
+@interface NSSpellChecker (Private)
+- (void)_setServerProxy: (id)server;
+@end
+
 // Methods needed to get the GSServicesManager
 @interface NSApplication(NSSpellCheckerMethods)
 - (GSServicesManager *)_listener;
@@ -245,13 +262,31 @@ static int __documentTag = 0;
       id<NSSpellServerPrivateProtocol> proxy = [self _startServerForLanguage: _language];
       if (proxy != nil)
 	{
-	  _serverProxy = proxy;
-	  RETAIN(_serverProxy);
+	  [self _setServerProxy: proxy];
 	}
     }
   return _serverProxy;
 }
 
+/* Uses server in place of the spell server process.  This also lets an
+ * object in the same process act as the server, e.g. for testing.
+ */
+- (void)_setServerProxy: (id)server
+{
+  ASSIGN(_serverProxy, server);
+  _serverFindsAllMisspellings = NO;
+  NS_DURING
+    {
+      _serverFindsAllMisspellings = [server respondsToSelector:
+	@selector(_findMisspelledWordsInString:language:ignoredWords:)];
+    }
+  NS_HANDLER
+    {
+      NSLog(@"%@",[localException reason]);
+    }
+  NS_ENDHANDLER
+}
+
 - (void)_populateDictionaryPulldown: (NSArray *)dictionaries
 {
   [_dictionaryPulldown removeAllItems];
@@ -439,6 +474,107 @@ static int __documentTag = 0;
   return NSMakeRange(0,0);
 }
 
+- (NSArray *) misspelledRangesInString: (NSString *)aString
+				 range: (NSRange)aRange
+			      language: (NSString *)language
+		inSpellDocumentWithTag: (int)tag
+{
+  NSMutableArray *ranges = [NSMutableArray array];
+  NSArray *ignored = [self ignoredWordsInSpellDocumentWithTag: tag];
+
+  if (aString == nil || aRange.length == 0)
+    {
+      return ranges;
+    }
+  if (language == nil)
+    {
+      language = _language;
+    }
+
+  NS_DURING
+    {
+      id proxy = [self _serverProxy];
+
+      if (proxy == nil)
+	{
+	  NS_VALUERETURN(ranges, NSArray *);
+	}
+
+      if (_serverFindsAllMisspellings)
+	{
+	  NSEnumerator *e;
+	  NSValue *v;
+
+	  e = [[proxy _findMisspelledWordsInString:
+			[aString substringWithRange: aRange]
+					  language: language
+				      ignoredWords: ignored] objectEnumerator];
+	  while ((v = [e nextObject]) != nil)
+	    {
+	      NSRange r = [v rangeValue];
+
+	      r.location += aRange.location;
+	      [ranges addObject: [NSValue valueWithRange: r]];
+	    }
+	}
+      else
+	{
+	  NSCharacterSet *breaks;
+	  NSUInteger start = aRange.location;
+	  NSUInteger end = NSMaxRange(aRange);
+
+	  breaks = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+
+	  // The server reports one misspelling per call and takes no
+	  // range, so ask again from the end of each one, with a window
+	  // of the text cut at white space rather than all that is left.
+	  while (start < end)
+	    {
+	      NSUInteger stop = end;
+	      int count = 0;
+	      NSRange r;
+
+	      if (end - start > MISSPELLING_WINDOW)
+		{
+		  NSRange space;
+
+		  space = [aString rangeOfCharacterFromSet: breaks
+						   options: 0
+						     range: NSMakeRange(start + MISSPELLING_WINDOW,
+									end - start - MISSPELLING_WINDOW)];
+		  if (space.length > 0)
+		    {
+		      stop = space.location;
+		    }
+		}
+
+	      r = [proxy _findMisspelledWordInString:
+			   [aString substringWithRange:
+				      NSMakeRange(start, stop - start)]
+					    language: language
+					ignoredWords: ignored
+					   wordCount: &count
+					   countOnly: NO];
+	      if (r.length == 0)
+		{
+		  start = stop;
+		  continue;
+		}
+	      r.location += start;
+	      start = NSMaxRange(r);
+	      [ranges addObject: [NSValue valueWithRange: r]];
+	    }
+	}
+    }
+  NS_HANDLER
+    {
+      NSLog(@"%@",[localException reason]);
+    }
+  NS_ENDHANDLER
+
+  return ranges;
+}
+
 - (NSArray *)guessesForWord:(NSString *)word
 {
   NSArray   *guesses;
@@ -229,19 +229,21 @@
         {
         case NSMinXEdge:
         case NSMaxXEdge:
-          return _widthType[layer][edge]*size.width;
+          return _width[layer][edge]*size.width;
         case NSMinYEdge:
         case NSMaxYEdge:
-          return _widthType[layer][edge]*size.height;
+          return _width[layer][edge]*size.height;
         }
     }
   return 0.0;	
 }
 
-- (NSRect) boundsRectForContentRect: (NSRect)cont
-                             inRect: (NSRect)rect
-                      textContainer: (NSTextContainer *)container
-                     characterRange: (NSRange)range
+/* Returns cont grown by the padding, border and margin of the receiver.
+ * Percentages are relative to rect.  Shared with NSTextTable, which
+ * decorates its cells the same way.
+ */
+- (NSRect) _boundsRectForContentRect: (NSRect)cont
+                              inRect: (NSRect)rect
 {
   CGFloat minx = [self _scaledWidthValue: NSTextBlockPadding : NSMinXEdge: rect.size] 
     + [self _scaledWidthValue: NSTextBlockBorder : NSMinXEdge : rect.size]
@@ -265,6 +267,14 @@
   return cont;
 }
 
+- (NSRect) boundsRectForContentRect: (NSRect)cont
+                             inRect: (NSRect)rect
+                      textContainer: (NSTextContainer *)container
+                     characterRange: (NSRange)range
+{
+  return [self _boundsRectForContentRect: cont inRect: rect];
+}
+
 /**
  * POINT is the point in NSTextContainer where the TextBlock should be laid out.
  * RECT is the bounding rect (e.g. the rect of the container or the rect of the 
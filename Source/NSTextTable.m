@@ -26,13 +26,258 @@
    Boston, MA 02110-1301, USA.
 */
 
+#import <Foundation/NSCharacterSet.h>
 #import <Foundation/NSCoder.h>
+#import <Foundation/NSMapTable.h>
 #import <Foundation/NSString.h>
 
+#import "AppKit/NSAttributedString.h"
+#import "AppKit/NSLayoutManager.h"
+#import "AppKit/NSParagraphStyle.h"
+#import "AppKit/NSStringDrawing.h"
+#import "AppKit/NSTextContainer.h"
+#import "AppKit/NSTextStorage.h"
 #import "AppKit/NSTextTable.h"
+#import "GSGuiPrivate.h"
+
+@interface NSTextBlock (Private)
+- (NSRect) _boundsRectForContentRect: (NSRect)cont
+                              inRect: (NSRect)rect;
+- (CGFloat) _scaledValue: (NSTextBlockDimension)dimension : (NSSize)size;
+@end
+
+/*
+ * The column widths of a table, and the per row measurements of cell
+ * contents they are solved from.  A table caches one of these for the
+ * text storage it was last laid out in.  Edits invalidate the rows they
+ * touch, and only those rows are measured again; solving the widths from
+ * the measurements is cheap and redone whenever the available width
+ * changes.
+ */
+@interface GSTextTableLayout : NSObject
+{
+@public
+  NSTextStorage	*storage;	// Not retained, only compared
+  NSUInteger	columns;
+  NSUInteger	rows;
+  NSUInteger	rowCapacity;
+  CGFloat	*minWidths;	// rows * columns, narrowest cell widths
+  CGFloat	*maxWidths;	// rows * columns, unwrapped cell widths
+  NSUInteger	*rowLengths;	// characters in each row when measured
+  unsigned char	*rowValid;
+  CGFloat	*specWidths;	// columns, widths given by the first row
+  NSTextBlockValueType *specTypes;
+  CGFloat	solvedFor;	// available width, or -1 if not solved
+  CGFloat	*offsets;	// columns + 1, left edge of each column
+}
+- (id) initWithColumns: (NSUInteger)count storage: (NSTextStorage *)text;
+- (void) setRows: (NSUInteger)count;
+- (void) invalidateRows: (NSRange)range;
+@end
+
+@implementation GSTextTableLayout
+
+- (id) initWithColumns: (NSUInteger)count storage: (NSTextStorage *)text
+{
+  if ((self = [super init]) != nil)
+    {
+      storage = text;
+      columns = count;
+      specWidths = NSZoneCalloc(NSDefaultMallocZone(), count, sizeof(CGFloat));
+      specTypes = NSZoneCalloc(NSDefaultMallocZone(), count,
+                               sizeof(NSTextBlockValueType));
+      offsets = NSZoneCalloc(NSDefaultMallocZone(), count + 1, sizeof(CGFloat));
+      solvedFor = -1.0;
+    }
+  return self;
+}
+
+- (void) dealloc
+{
+  NSZoneFree(NSDefaultMallocZone(), minWidths);
+  NSZoneFree(NSDefaultMallocZone(), maxWidths);
+  NSZoneFree(NSDefaultMallocZone(), rowLengths);
+  NSZoneFree(NSDefaultMallocZone(), rowValid);
+  NSZoneFree(NSDefaultMallocZone(), specWidths);
+  NSZoneFree(NSDefaultMallocZone(), specTypes);
+  NSZoneFree(NSDefaultMallocZone(), offsets);
+  [super dealloc];
+}
+
+- (void) setRows: (NSUInteger)count
+{
+  if (count > rowCapacity)
+    {
+      NSUInteger capacity = MAX(count, 2 * rowCapacity);
+
+      minWidths = NSZoneRealloc(NSDefaultMallocZone(), minWidths,
+                                capacity * columns * sizeof(CGFloat));
+      maxWidths = NSZoneRealloc(NSDefaultMallocZone(), maxWidths,
+                                capacity * columns * sizeof(CGFloat));
+      rowLengths = NSZoneRealloc(NSDefaultMallocZone(), rowLengths,
+                                 capacity * sizeof(NSUInteger));
+      rowValid = NSZoneRealloc(NSDefaultMallocZone(), rowValid, capacity);
+      rowCapacity = capacity;
+    }
+  if (count > rows)
+    {
+      memset(rowLengths + rows, 0, (count - rows) * sizeof(NSUInteger));
+      memset(rowValid + rows, 0, count - rows);
+    }
+  rows = count;
+}
+
+- (void) invalidateRows: (NSRange)range
+{
+  NSUInteger r;
+
+  for (r = range.location; r < NSMaxRange(range) && r < rows; r++)
+    {
+      rowValid[r] = 0;
+    }
+  solvedFor = -1.0;
+}
+
+@end
+
+/* The layout of each table that has been laid out.  It is kept out of
+ * the instance variables, as subclasses are compiled against them.
+ */
+static NSMapTable *tableLayouts = 0;
+
+static inline GSTextTableLayout *
+cachedLayout(NSTextTable *table)
+{
+  if (tableLayouts == 0)
+    {
+      return nil;
+    }
+  return (GSTextTableLayout *)NSMapGet(tableLayouts, table);
+}
+
+static inline void
+discardLayout(NSTextTable *table)
+{
+  if (tableLayouts != 0)
+    {
+      NSMapRemove(tableLayouts, table);
+    }
+}
+
+/* Returns the block of table in the paragraph style, or nil if the
+ * paragraph is not in one of its cells.  Nested blocks come last, so the
+ * search starts from the end.
+ */
+static NSTextTableBlock *
+tableBlockForStyle(NSParagraphStyle *style, NSTextTable *table)
+{
+  NSArray *blocks = [style textBlocks];
+  NSUInteger i = [blocks count];
+
+  while (i-- > 0)
+    {
+      NSTextBlock *block = [blocks objectAtIndex: i];
+
+      if ([block isKindOfClass: [NSTextTableBlock class]]
+        && [(NSTextTableBlock *)block table] == table)
+        {
+          return (NSTextTableBlock *)block;
+        }
+    }
+  return nil;
+}
+
+/* Widens *minWidth to the longest word and *maxWidth to the longest
+ * paragraph of text in range, when laid out without wrapping.
+ */
+static void
+measureText(NSAttributedString *text, NSRange range,
+  CGFloat *minWidth, CGFloat *maxWidth)
+{
+  static NSCharacterSet *white = nil;
+  NSString *string = [text string];
+  NSUInteger end = NSMaxRange(range);
+  NSUInteger pos = range.location;
+
+  if (white == nil)
+    {
+      white = RETAIN([NSCharacterSet whitespaceAndNewlineCharacterSet]);
+    }
+
+  while (pos < end)
+    {
+      NSUInteger paraEnd;
+      NSUInteger contentsEnd;
+      NSRange longest = NSMakeRange(pos, 0);
+      NSUInteger i;
+      CGFloat width;
+
+      [string getLineStart: NULL
+                       end: &paraEnd
+               contentsEnd: &contentsEnd
+                  forRange: NSMakeRange(pos, 0)];
+      contentsEnd = MIN(contentsEnd, end);
+      if (contentsEnd <= pos)
+        {
+          pos = paraEnd;
+          continue;
+        }
+
+      width = [[text attributedSubstringFromRange:
+        NSMakeRange(pos, contentsEnd - pos)] size].width;
+      *maxWidth = MAX(*maxWidth, width);
+
+      i = pos;
+      while (i < contentsEnd)
+        {
+          NSRange space = [string rangeOfCharacterFromSet: white
+                                                  options: 0
+                                                    range: NSMakeRange(i, contentsEnd - i)];
+
+          if (space.location == NSNotFound)
+            {
+              space.location = contentsEnd;
+            }
+          if (space.location - i > longest.length)
+            {
+              longest = NSMakeRange(i, space.location - i);
+            }
+          i = space.location + 1;
+        }
+      if (longest.location != pos || NSMaxRange(longest) != contentsEnd)
+        {
+          width = [[text attributedSubstringFromRange: longest] size].width;
+        }
+      *minWidth = MAX(*minWidth, width);
+      pos = paraEnd;
+    }
+}
+
+@interface NSTextTable (Private)
++ (void) _invalidateTablesInTextStorage: (NSTextStorage *)storage
+                                  range: (NSRange)range;
+- (void) _invalidateRows: (NSRange)rows inTextStorage: (NSTextStorage *)storage;
+- (NSRect) _contentRectInRect: (NSRect)rect;
+- (GSTextTableLayout *) _layoutForContentRect: (NSRect)tableRect
+                                textContainer: (NSTextContainer *)container
+                                      atIndex: (NSUInteger)index;
+- (void) _measureRows: (GSTextTableLayout *)layout atIndex: (NSUInteger)index;
+- (void) _solveColumns: (GSTextTableLayout *)layout forWidth: (CGFloat)width;
+- (BOOL) _cellRect: (NSRect *)cell
+          forBlock: (NSTextTableBlock *)block
+            inRect: (NSRect)rect
+     textContainer: (NSTextContainer *)container
+    characterRange: (NSRange)range;
+@end
 
 @implementation NSTextTable
 
+- (void) dealloc
+{
+  discardLayout(self);
+  [super dealloc];
+}
+
 - (BOOL) collapsesBorders
 {
   return _collapsesBorders;	// if true: ???
@@ -60,7 +305,11 @@
 
 - (void) setLayoutAlgorithm: (NSTextTableLayoutAlgorithm)algorithm
 {
-  _layoutAlgorithm = algorithm;
+  if (_layoutAlgorithm != algorithm)
+    {
+      _layoutAlgorithm = algorithm;
+      discardLayout(self);
+    }
 }
 
 - (NSUInteger) numberOfColumns
@@ -70,7 +319,11 @@
 
 - (void) setNumberOfColumns: (NSUInteger)numCols
 {
-  _numberOfColumns = numCols;
+  if (_numberOfColumns != numCols)
+    {
+      _numberOfColumns = numCols;
+      discardLayout(self);
+    }
 }
 
 - (NSRect) boundsRectForBlock: (NSTextTableBlock *)block
@@ -79,8 +332,22 @@
                 textContainer: (NSTextContainer *)container
                characterRange: (NSRange)range
 {
-  // FIXME
-  return NSZeroRect;
+  NSRect bounds = [block _boundsRectForContentRect: content inRect: rect];
+  NSRect cell;
+
+  /* Cells span the whole width of their columns, so that the
+   * backgrounds of a column line up.
+   */
+  if ([self _cellRect: &cell
+             forBlock: block
+               inRect: rect
+        textContainer: container
+       characterRange: range])
+    {
+      bounds.origin.x = cell.origin.x;
+      bounds.size.width = cell.size.width;
+    }
+  return bounds;
 }
 
 - (NSRect) rectForBlock: (NSTextTableBlock *)block
@@ -89,8 +356,29 @@
           textContainer: (NSTextContainer *)container
          characterRange: (NSRange)range
 {
-  // FIXME
-  return NSZeroRect;
+  NSRect cell;
+  NSRect decoration;
+
+  if (![self _cellRect: &cell
+              forBlock: block
+                inRect: rect
+         textContainer: container
+        characterRange: range])
+    {
+      return NSZeroRect;
+    }
+
+  cell.origin.y = start.y;
+  cell.size.height = MAX(NSMaxY(rect) - start.y, 0.0);
+
+  /* Lay the text out inside the padding, border and margin of the cell.
+   */
+  decoration = [block _boundsRectForContentRect: NSZeroRect inRect: rect];
+  cell.origin.x -= decoration.origin.x;
+  cell.size.width = MAX(cell.size.width - decoration.size.width, 0.0);
+  cell.origin.y -= decoration.origin.y;
+  cell.size.height = MAX(cell.size.height - decoration.size.height, 0.0);
+  return cell;
 }
 
 - (void) drawBackgroundForBlock: (NSTextTableBlock *)block
@@ -139,3 +427,414 @@
 }
 
 @end
+
+@implementation NSTextTable (Private)
+
+/* Called by the layout manager when the characters or attributes in
+ * range of storage have changed.  Tables with cells in the range forget
+ * the measurements of the rows affected.  An empty range is where text
+ * was deleted, which may have been the last rows of the table before it,
+ * so both sides of it are looked at.
+ */
++ (void) _invalidateTablesInTextStorage: (NSTextStorage *)storage
+                                  range: (NSRange)range
+{
+  NSUInteger length = [storage length];
+  NSUInteger pos = range.location;
+  NSUInteger end = MIN(NSMaxRange(range), length);
+
+  if (range.length == 0)
+    {
+      end = MIN(pos + 1, length);
+      if (pos > 0)
+        {
+          pos--;
+        }
+    }
+  while (pos < end)
+    {
+      NSRange run;
+      NSParagraphStyle *style;
+      NSArray *blocks;
+      NSUInteger i;
+
+      style = [storage attribute: NSParagraphStyleAttributeName
+                         atIndex: pos
+                  effectiveRange: &run];
+      blocks = [style textBlocks];
+      for (i = 0; i < [blocks count]; i++)
+        {
+          NSTextTableBlock *block = [blocks objectAtIndex: i];
+
+          if ([block isKindOfClass: [NSTextTableBlock class]])
+            {
+              [[block table] _invalidateRows:
+                NSMakeRange([block startingRow], MAX([block rowSpan], 1))
+                               inTextStorage: storage];
+            }
+        }
+      pos = NSMaxRange(run);
+    }
+}
+
+- (void) _invalidateRows: (NSRange)rows inTextStorage: (NSTextStorage *)storage
+{
+  GSTextTableLayout *layout = cachedLayout(self);
+
+  if (layout != nil && layout->storage == storage)
+    {
+      [layout invalidateRows: rows];
+    }
+}
+
+/* The rect the columns of the table are laid out in: rect inset by the
+ * decoration of the table, and narrowed to its width if it has one.
+ */
+- (NSRect) _contentRectInRect: (NSRect)rect
+{
+  NSRect decoration = [self _boundsRectForContentRect: NSZeroRect
+                                               inRect: rect];
+  NSRect content = rect;
+  CGFloat width = [self _scaledValue: NSTextBlockWidth : rect.size];
+
+  content.origin.x -= decoration.origin.x;
+  content.size.width = MAX(content.size.width - decoration.size.width, 0.0);
+  if (width > 0.0)
+    {
+      content.size.width = MIN(content.size.width, width);
+    }
+  return content;
+}
+
+- (GSTextTableLayout *) _layoutForContentRect: (NSRect)tableRect
+                                textContainer: (NSTextContainer *)container
+                                      atIndex: (NSUInteger)index
+{
+  NSTextStorage *storage = [[container layoutManager] textStorage];
+  GSTextTableLayout *layout = cachedLayout(self);
+
+  if (layout == nil || layout->storage != storage)
+    {
+      layout = [[GSTextTableLayout alloc] initWithColumns: _numberOfColumns
+                                                  storage: storage];
+      if (tableLayouts == 0)
+        {
+          tableLayouts = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                                          NSObjectMapValueCallBacks, 0);
+        }
+      NSMapInsert(tableLayouts, self, layout);
+      RELEASE(layout);
+    }
+
+  if (layout->solvedFor != tableRect.size.width)
+    {
+      if (storage != nil && index < [storage length])
+        {
+          [self _measureRows: layout atIndex: index];
+        }
+      [self _solveColumns: layout forWidth: tableRect.size.width];
+    }
+  return layout;
+}
+
+/* Walks the cells of the table containing index.  Rows whose length
+ * changed or that were invalidated are measured again; in the fixed
+ * layout nothing is measured, and only the widths given by the cells of
+ * the first row are collected.
+ */
+- (void) _measureRows: (GSTextTableLayout *)layout atIndex: (NSUInteger)index
+{
+  NSTextStorage *storage = layout->storage;
+  NSUInteger length = [storage length];
+  NSUInteger columns = layout->columns;
+  BOOL automatic = (_layoutAlgorithm == NSTextTableAutomaticLayoutAlgorithm);
+  NSUInteger start = index;
+  NSUInteger pos;
+  NSUInteger maxRow = 0;
+  NSUInteger *lengths = NULL;
+  NSUInteger capacity = 0;
+  NSTextTableBlock *cellBlock = nil;
+  CGFloat cellMin = 0.0;
+  CGFloat cellMax = 0.0;
+  NSUInteger r;
+  BOOL allValid = YES;
+
+  /* Find the start of the table. */
+  while (start > 0)
+    {
+      NSRange run;
+      NSParagraphStyle *style;
+
+      style = [storage attribute: NSParagraphStyleAttributeName
+                         atIndex: start - 1
+                  effectiveRange: &run];
+      if (tableBlockForStyle(style, self) == nil)
+        {
+          break;
+        }
+      start = run.location;
+    }
+
+  /* Count the characters of each row, and pick up the widths given by
+   * the cells of the first row.
+   */
+  memset(layout->specWidths, 0, columns * sizeof(CGFloat));
+  for (pos = start; pos < length; )
+    {
+      NSRange run;
+      NSTextTableBlock *block;
+      NSInteger row;
+      NSInteger col;
+
+      block = tableBlockForStyle([storage attribute: NSParagraphStyleAttributeName
+                                            atIndex: pos
+                                     effectiveRange: &run], self);
+      if (block == nil)
+        {
+          break;
+        }
+      row = [block startingRow];
+      col = [block startingColumn];
+      if (row >= 0)
+        {
+          if ((NSUInteger)row >= capacity)
+            {
+              NSUInteger more = MAX(2 * capacity, (NSUInteger)row + 16);
+
+              lengths = NSZoneRealloc(NSDefaultMallocZone(), lengths,
+                                      more * sizeof(NSUInteger));
+              memset(lengths + capacity, 0,
+                     (more - capacity) * sizeof(NSUInteger));
+              capacity = more;
+            }
+          lengths[row] += run.length;
+          maxRow = MAX(maxRow, (NSUInteger)row + 1);
+          if (row == 0 && col >= 0 && (NSUInteger)col < columns
+            && [block columnSpan] <= 1)
+            {
+              layout->specWidths[col] = [block valueForDimension: NSTextBlockWidth];
+              layout->specTypes[col] = [block valueTypeForDimension: NSTextBlockWidth];
+            }
+        }
+      pos = NSMaxRange(run);
+    }
+
+  [layout setRows: maxRow];
+  for (r = 0; r < maxRow; r++)
+    {
+      if (layout->rowLengths[r] != lengths[r])
+        {
+          layout->rowLengths[r] = lengths[r];
+          layout->rowValid[r] = 0;
+        }
+      if (!layout->rowValid[r])
+        {
+          allValid = NO;
+          memset(layout->minWidths + r * columns, 0, columns * sizeof(CGFloat));
+          memset(layout->maxWidths + r * columns, 0, columns * sizeof(CGFloat));
+        }
+    }
+  NSZoneFree(NSDefaultMallocZone(), lengths);
+
+  if (!automatic || allValid || columns == 0)
+    {
+      memset(layout->rowValid, 1, maxRow);
+      return;
+    }
+
+  /* Measure the cells of the invalid rows.  A cell may be made of several
+   * runs, so its widths are only recorded when the next cell starts.
+   */
+  for (pos = start; ; )
+    {
+      NSRange run = NSMakeRange(pos, 0);
+      NSTextTableBlock *block = nil;
+
+      if (pos < length)
+        {
+          block = tableBlockForStyle([storage attribute: NSParagraphStyleAttributeName
+                                                atIndex: pos
+                                         effectiveRange: &run], self);
+        }
+
+      if (block != cellBlock && cellBlock != nil)
+        {
+          NSInteger row = [cellBlock startingRow];
+          NSInteger col = [cellBlock startingColumn];
+          NSInteger span = MAX([cellBlock columnSpan], 1);
+          CGFloat decoration;
+          CGFloat minShare;
+          CGFloat maxShare;
+          NSInteger c;
+
+          if ([cellBlock valueTypeForDimension: NSTextBlockWidth]
+            == NSTextBlockAbsoluteValueType
+            && [cellBlock valueForDimension: NSTextBlockWidth] > 0.0)
+            {
+              cellMin = MAX(cellMin, [cellBlock valueForDimension: NSTextBlockWidth]);
+              cellMax = cellMin;
+            }
+          decoration = [cellBlock _boundsRectForContentRect: NSZeroRect
+                                                     inRect: NSZeroRect].size.width;
+          /* A cell spanning several columns asks each for a share. */
+          minShare = (cellMin + decoration) / span;
+          maxShare = (MAX(cellMin, cellMax) + decoration) / span;
+          for (c = MAX(col, 0); c < col + span && (NSUInteger)c < columns; c++)
+            {
+              CGFloat *minWidth = layout->minWidths + row * columns + c;
+              CGFloat *maxWidth = layout->maxWidths + row * columns + c;
+
+              *minWidth = MAX(*minWidth, minShare);
+              *maxWidth = MAX(*maxWidth, maxShare);
+            }
+          cellMin = 0.0;
+          cellMax = 0.0;
+        }
+      if (block == nil)
+        {
+          break;
+        }
+
+      cellBlock = nil;
+      if ([block startingRow] >= 0 && !layout->rowValid[[block startingRow]])
+        {
+          cellBlock = block;
+          measureText(storage, run, &cellMin, &cellMax);
+        }
+      pos = NSMaxRange(run);
+    }
+
+  memset(layout->rowValid, 1, maxRow);
+}
+
+/* Solves the column widths from the measurements.  As in HTML, columns
+ * get their unwrapped widths when they all fit, their narrowest widths
+ * when not even those fit, and something in between otherwise.
+ */
+- (void) _solveColumns: (GSTextTableLayout *)layout forWidth: (CGFloat)width
+{
+  NSUInteger columns = layout->columns;
+  CGFloat widths[columns > 0 ? columns : 1];
+  NSUInteger c;
+
+  if (_layoutAlgorithm == NSTextTableFixedLayoutAlgorithm
+    || layout->rows == 0)
+    {
+      CGFloat remaining = width;
+      NSUInteger unset = 0;
+
+      for (c = 0; c < columns; c++)
+        {
+          widths[c] = layout->specWidths[c];
+          if (layout->specTypes[c] == NSTextBlockPercentageValueType)
+            {
+              widths[c] *= width;
+            }
+          if (widths[c] > 0.0)
+            {
+              remaining -= widths[c];
+            }
+          else
+            {
+              unset++;
+            }
+        }
+      for (c = 0; c < columns; c++)
+        {
+          if (widths[c] <= 0.0)
+            {
+              widths[c] = MAX(remaining, 0.0) / unset;
+            }
+        }
+    }
+  else
+    {
+      CGFloat colMin[columns];
+      CGFloat colMax[columns];
+      CGFloat sumMin = 0.0;
+      CGFloat sumMax = 0.0;
+      NSUInteger r;
+
+      for (c = 0; c < columns; c++)
+        {
+          colMin[c] = 0.0;
+          colMax[c] = 0.0;
+          for (r = 0; r < layout->rows; r++)
+            {
+              colMin[c] = MAX(colMin[c], layout->minWidths[r * columns + c]);
+              colMax[c] = MAX(colMax[c], layout->maxWidths[r * columns + c]);
+            }
+          colMax[c] = MAX(colMax[c], colMin[c]);
+          sumMin += colMin[c];
+          sumMax += colMax[c];
+        }
+
+      for (c = 0; c < columns; c++)
+        {
+          if (sumMax <= width)
+            {
+              widths[c] = colMax[c];
+              /* A table with a width of its own fills it. */
+              if ([self _scaledValue: NSTextBlockWidth : NSMakeSize(width, 0)] > 0.0)
+                {
+                  if (sumMax > 0.0)
+                    {
+                      widths[c] += (width - sumMax) * colMax[c] / sumMax;
+                    }
+                  else
+                    {
+                      widths[c] = width / columns;
+                    }
+                }
+            }
+          else if (sumMin >= width)
+            {
+              widths[c] = colMin[c];
+            }
+          else
+            {
+              widths[c] = colMin[c] + (colMax[c] - colMin[c])
+                * (width - sumMin) / (sumMax - sumMin);
+            }
+        }
+    }
+
+  layout->offsets[0] = 0.0;
+  for (c = 0; c < columns; c++)
+    {
+      layout->offsets[c + 1] = layout->offsets[c] + widths[c];
+    }
+  layout->solvedFor = width;
+}
+
+/* Sets *cell to the rect of the columns spanned by block, or returns NO
+ * if the table has no columns.
+ */
+- (BOOL) _cellRect: (NSRect *)cell
+          forBlock: (NSTextTableBlock *)block
+            inRect: (NSRect)rect
+     textContainer: (NSTextContainer *)container
+    characterRange: (NSRange)range
+{
+  NSRect tableRect;
+  GSTextTableLayout *layout;
+  NSInteger col = [block startingColumn];
+  NSInteger span = MAX([block columnSpan], 1);
+
+  if (_numberOfColumns == 0 || col < 0 || (NSUInteger)col >= _numberOfColumns)
+    {
+      return NO;
+    }
+  span = MIN(span, (NSInteger)_numberOfColumns - col);
+
+  tableRect = [self _contentRectInRect: rect];
+  layout = [self _layoutForContentRect: tableRect
+                         textContainer: container
+                               atIndex: range.location];
+  *cell = tableRect;
+  cell->origin.x += layout->offsets[col];
+  cell->size.width = layout->offsets[col + span] - layout->offsets[col];
+  return YES;
+}
+
+@end
@@ -57,7 +57,10 @@
 #import <Foundation/NSDebug.h>
 #import <Foundation/NSEnumerator.h>
 #import <Foundation/NSException.h>
+#import <Foundation/NSIndexSet.h>
 #import <Foundation/NSKeyedArchiver.h>
+#import <Foundation/NSLock.h>
+#import <Foundation/NSMapTable.h>
 #import <Foundation/NSNotification.h>
 #import <Foundation/NSRunLoop.h>
 #import <Foundation/NSString.h>
@@ -99,6 +102,7 @@
 #import "GSToolTips.h"
 #import "GSFastEnumeration.h"
 #import "GSAutocompleteWindow.h"
+#import "GSTextWordIndex.h"
 
 
 /*
@@ -131,6 +135,9 @@ a new internal method called from NSLayoutManager when text has changed.
     attributedString: (NSAttributedString *)aString;
 - (NSRange) range;
 - (void) setRange: (NSRange)aRange;
+- (void) mergeChangeInRange: (NSRange)aRange
+	  replacementLength: (NSUInteger)length
+		   fromText: (NSAttributedString *)text;
 - (void) performUndo: (NSTextStorage *)aTextStorage;
 - (NSTextView *) bestTextViewForTextStorage: (NSTextStorage *)aTextStorage;
 @end
@@ -165,6 +172,7 @@ Interface for a bunch of internal methods that need to be cleaned up.
  * Text checking
  */
 - (void) _scheduleTextCheckingInVisibleRectIfNeeded;
+- (void) _forgetCheckedText;
 - (void) _textDidChange: (NSNotification*)notif;
 - (void) _textCheckingTimerFired: (NSTimer *)t;
 
@@ -324,6 +332,72 @@ Interface for a bunch of internal methods that need to be cleaned up.
 - (void) _undoTextChange: (NSTextViewUndoObject *)anObject;
 @end
 
+
+/*
+ * State for features added after the instance variables of NSTextView
+ * became part of the ABI. It lives in a table holding only the text views
+ * using one of these features, so that subclasses compiled against older
+ * headers keep their layout.
+ */
+@interface GSTextViewExtras : NSObject
+{
+@public
+  GSTextWordIndex *wordIndex;
+  NSMutableIndexSet *checkedRanges;	// Characters checked, whole paragraphs
+  NSRange staleSpellingRange;	// Edited paragraphs still to be unmarked
+  NSUInteger editTransactionDepth;
+  NSTextViewUndoObject *transactionUndo;	// Single undo record for it
+  BOOL transactionChanged;	// -didChangeText deferred to its end
+}
+@end
+
+@implementation GSTextViewExtras
+- (void) dealloc
+{
+  RELEASE(wordIndex);
+  RELEASE(checkedRanges);
+  RELEASE(transactionUndo);
+  [super dealloc];
+}
+@end
+
+static NSMapTable *textViewExtras = 0;
+static NSLock *textViewExtrasLock = nil;
+
+/* Returns the extra state of tv, creating it if create is YES.
+ */
+static GSTextViewExtras *
+extrasForTextView(NSTextView *tv, BOOL create)
+{
+  GSTextViewExtras *extras;
+
+  [textViewExtrasLock lock];
+  extras = NSMapGet(textViewExtras, tv);
+  if (extras == nil && create)
+    {
+      extras = [GSTextViewExtras new];
+      NSMapInsert(textViewExtras, tv, extras);
+      RELEASE(extras);
+    }
+  [textViewExtrasLock unlock];
+  return extras;
+}
+
+static void
+destroyExtrasForTextView(NSTextView *tv)
+{
+  GSTextViewExtras *extras;
+
+  [textViewExtrasLock lock];
+  extras = RETAIN((GSTextViewExtras *)NSMapGet(textViewExtras, tv));
+  if (extras != nil)
+    {
+      NSMapRemove(textViewExtras, tv);
+    }
+  [textViewExtrasLock unlock];
+  RELEASE(extras);
+}
+
 /**** Misc. helpers and stuff ****/
 
 static const int currentVersion = 4;
@@ -606,6 +680,9 @@ static NSMenu *textViewMenu;
 
       [self setVersion: currentVersion];
       notificationCenter = [NSNotificationCenter defaultCenter];
+      textViewExtras = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                                        NSObjectMapValueCallBacks, 0);
+      textViewExtrasLock = [NSLock new];
 
       /* The sets smartLeftChars and smartRightChars were derived from OS X. */
       temp = [[NSCharacterSet whitespaceAndNewlineCharacterSet] mutableCopy];
@@ -1129,7 +1206,11 @@ that makes decoding and encoding compatible with the old code.
   [notificationCenter removeObserver: self
     name: NSTextDidChangeNotification
     object: self];
+  [notificationCenter removeObserver: self
+    name: NSTextStorageDidProcessEditingNotification
+    object: nil];
   [_textCheckingTimer invalidate];
+  destroyExtrasForTextView(self);
   [self _stopInsertionTimer];
 
   [[NSRunLoop currentRunLoop] cancelPerformSelector: @selector(_updateState:)
@@ -1173,6 +1254,8 @@ to this method from the text container or layout manager.
   NSUInteger i, c;
   NSArray *tcs;
   NSTextView *other;
+  NSTextStorage *oldTextStorage = _textStorage;
+  GSTextViewExtras *extras;
 
   /* Any of these three might be nil. */
   _textContainer = container;
@@ -1186,6 +1269,18 @@ to this method from the text container or layout manager.
       _textStorage = [_layoutManager textStorage];
     }
 
+  /* Whatever we know about the words and the spelling of the old text
+   * storage does not apply to the new one.  The word index does not
+   * retain its text storage, so it must go before the old one can.
+   */
+  extras = extrasForTextView(self, NO);
+  if (extras != nil && _textStorage != oldTextStorage)
+    {
+      DESTROY(extras->wordIndex);
+      [self _forgetCheckedText];
+      _lastCheckedRect = NSZeroRect;
+    }
+
   /* Search for an existing text view attached to this layout manager. */
   tcs = [_layoutManager textContainers];
   c = [tcs count];
@@ -1583,6 +1678,28 @@ to make sure syncing is handled properly in all cases.
   return _tf.continuous_spell_checking;
 }
 
+/* Document word completion */
+
+- (BOOL) usesDocumentWordCompletion
+{
+  return _tf.uses_document_word_completion;
+}
+
+- (void) setUsesDocumentWordCompletion: (BOOL)flag
+{
+  NSTEXTVIEW_SYNC;
+  _tf.uses_document_word_completion = flag;
+  if (!flag)
+    {
+      GSTextViewExtras *extras = extrasForTextView(self, NO);
+
+      if (extras != nil)
+        {
+          DESTROY(extras->wordIndex);
+        }
+    }
+}
+
 - (void) setContinuousSpellCheckingEnabled: (BOOL)flag
 {
   NSTEXTVIEW_SYNC;
@@ -1593,11 +1710,10 @@ to make sure syncing is handled properly in all cases.
 
       _tf.continuous_spell_checking = 0;
       
-      [_layoutManager removeTemporaryAttribute: @"NSTextChecked"
-			     forCharacterRange: allRange];
       [_layoutManager removeTemporaryAttribute: NSSpellingStateAttributeName
 			     forCharacterRange: allRange];
       _lastCheckedRect = NSZeroRect;
+      [self _forgetCheckedText];
 
       [_textCheckingTimer invalidate];
       _textCheckingTimer = nil;
@@ -2338,6 +2454,42 @@ attributes.
     }
 }
 
+- (void) beginEditTransaction
+{
+  GSTextViewExtras *extras = extrasForTextView(self, YES);
+
+  if (extras->editTransactionDepth++ == 0)
+    {
+      /* Typing before the transaction must not coalesce with its changes. */
+      DESTROY(_undoObject);
+      extras->transactionChanged = NO;
+      [_textStorage beginEditing];
+    }
+}
+
+- (void) endEditTransaction
+{
+  GSTextViewExtras *extras = extrasForTextView(self, NO);
+
+  if (extras == nil || extras->editTransactionDepth == 0)
+    {
+      [NSException raise: NSInternalInconsistencyException
+		  format: @"endEditTransaction without corresponding "
+			  @"beginEditTransaction"];
+    }
+  if (--extras->editTransactionDepth == 0)
+    {
+      DESTROY(extras->transactionUndo);
+      /* Lets the layout manager invalidate the union of all edits. */
+      [_textStorage endEditing];
+      if (extras->transactionChanged)
+	{
+	  extras->transactionChanged = NO;
+	  [self didChangeText];
+	}
+    }
+}
+
 
 /*
 Some attribute-modification methods.
@@ -2705,6 +2857,7 @@ TextDidEndEditing notification _without_ asking the delegate
       NSRange undoRange;
       NSAttributedString *undoString;
       NSTextViewUndoObject *undoObject;
+      GSTextViewExtras *extras;
       BOOL isTyping;
       NSEvent *event;
       static BOOL undoManagerCanCoalesce = NO;
@@ -2731,6 +2884,45 @@ TextDidEndEditing notification _without_ asking the delegate
       }
 
       undo = [self undoManager];
+      extras = extrasForTextView(self, NO);
+
+      /* All changes of an edit transaction go into one undo action, which
+	 is registered with the first change and grows to cover the later
+	 ones. */
+      if (extras != nil && extras->editTransactionDepth > 0)
+	{
+	  NSUInteger length;
+
+	  /* A nil replacement only changes attributes, the text stays. */
+	  if (replacementString != nil)
+	    {
+	      length = [replacementString length];
+	    }
+	  else
+	    {
+	      length = affectedCharRange.length;
+	    }
+
+	  if (extras->transactionUndo != nil)
+	    {
+	      [extras->transactionUndo mergeChangeInRange: affectedCharRange
+					 replacementLength: length
+						  fromText: _textStorage];
+	    }
+	  else
+	    {
+	      undoString = [_textStorage attributedSubstringFromRange:
+		affectedCharRange];
+	      undoString = AUTORELEASE([undoString mutableCopy]);
+	      extras->transactionUndo = [[NSTextViewUndoObject alloc]
+		initWithRange: NSMakeRange(affectedCharRange.location, length)
+		attributedString: undoString];
+	      [undo registerUndoWithTarget: _textStorage
+				  selector: @selector(_undoTextChange:)
+				    object: extras->transactionUndo];
+	    }
+	  return result;
+	}
 
       /* Coalesce consecutive typing events into a single undo action using
 	 currently private undo manager functionality. An event is considered
@@ -2803,6 +2995,13 @@ After each user-induced change, this method should be called.
 */
 - (void) didChangeText
 {
+  GSTextViewExtras *extras = extrasForTextView(self, NO);
+
+  if (extras != nil && extras->editTransactionDepth > 0)
+    {
+      extras->transactionChanged = YES;
+      return;
+    }
   [self scrollRangeToVisible: [self selectedRange]];
   [notificationCenter postNotificationName: NSTextDidChangeNotification
     object: _notifObject];
@@ -6021,15 +6220,38 @@ configuation! */
 - (NSArray *) completionsForPartialWordRange: (NSRange)range
                          indexOfSelectedItem: (NSInteger *)index
 {
+  NSArray *words = [[GSAutocompleteWindow defaultWindow] words];
+
+  if (_tf.uses_document_word_completion)
+    {
+      GSTextViewExtras *extras = extrasForTextView(self, YES);
+
+      if (extras->wordIndex == nil)
+        {
+          extras->wordIndex = [[GSTextWordIndex alloc]
+            initWithTextStorage: _textStorage];
+        }
+      words = [extras->wordIndex wordsWithPrefix:
+        [[_textStorage string] substringWithRange: range]];
+      if (index != NULL)
+        {
+          *index = 0;
+        }
+    }
+
   if ([_delegate respondsToSelector:
       @selector(textView:completions:forPartialWordRange:indexOfSelectedItem:)])
     {
       return [_delegate textView: self
-		     completions: [[GSAutocompleteWindow defaultWindow] words]
+		     completions: words
      	     forPartialWordRange: range
 	     indexOfSelectedItem: index];
     }
 
+  if (_tf.uses_document_word_completion)
+    {
+      return words;
+    }
   return nil;
 }
 
@@ -6372,96 +6594,205 @@ or add guards
 
 - (void) _checkTextInRange: (NSRange)aRange
 {
-  NSRange longestRange;
-  id value = [_layoutManager temporaryAttribute: @"NSTextChecked" 
-			       atCharacterIndex: aRange.location
-			  longestEffectiveRange: &longestRange
-					inRange: aRange];
-  longestRange = NSIntersectionRange(longestRange, aRange);
-  
-  if ([value boolValue] && NSEqualRanges(longestRange, aRange))
+  NSSpellChecker *sp = [NSSpellChecker sharedSpellChecker];
+  NSEnumerator *e;
+  NSValue *v;
+
+  if (sp == nil)
     {
-      //NSLog(@"No need to check in range %@", NSStringFromRange(aRange));
       return;
     }
-  
-  // Check all of aRange
 
   [_layoutManager removeTemporaryAttribute: NSSpellingStateAttributeName
 			 forCharacterRange: aRange];
-  
-  {
-    NSSpellChecker *sp = [NSSpellChecker sharedSpellChecker];
-    NSInteger start = 0;
-    int count;
-    // FIXME: doing the spellcheck on this substring could create false-positives
-    // if a word is split in half.. so the range should be expanded to the 
-    // nearest word boundary
-    NSString *substring = [[self string] substringWithRange: aRange];
-    
-    if (sp == nil)
-      {
-        return;
-      }
 
-    do {
-      NSRange errorRange = [sp checkSpellingOfString: substring
-					  startingAt: start
-					    language: [sp language]
-						wrap: YES
-			      inSpellDocumentWithTag: [self spellCheckerDocumentTag]
-					   wordCount: &count];
-      
-      if (errorRange.location < start)
-	{
-	  break;
-	}
-      
-      if (errorRange.length > 0)
-	{
-	  start = NSMaxRange(errorRange);
-	}
-      else
-	{
-	  break;
-	}
-      
-      errorRange = NSMakeRange(aRange.location + errorRange.location, errorRange.length);
-      
-      //NSLog(@"highlighting mistake: %@", [[self string] substringWithRange: errorRange]);
-      
+  // aRange covers whole paragraphs, so no word is split at its ends.
+  e = [[sp misspelledRangesInString: [_textStorage string]
+			      range: aRange
+			   language: [sp language]
+	     inSpellDocumentWithTag: [self spellCheckerDocumentTag]]
+	objectEnumerator];
+  while ((v = [e nextObject]) != nil)
+    {
       [_layoutManager addTemporaryAttribute: NSSpellingStateAttributeName
 				      value: [NSNumber numberWithInteger: NSSpellingStateSpellingFlag]
-			  forCharacterRange: errorRange];
-      
-    } while (1);
-    
-    [_layoutManager addTemporaryAttribute: @"NSTextChecked"
-				    value: [NSNumber numberWithBool: YES]
-			forCharacterRange: aRange];
-  }
+			  forCharacterRange: [v rangeValue]];
+    }
+
+  [extrasForTextView(self, YES)->checkedRanges addIndexesInRange: aRange];
+}
+
+/* Removes the spelling marks from the paragraphs edited since the last
+ * call.  This can't be done while the text storage processes its
+ * editing, as the layout manager has not been told about the edit yet.
+ */
+- (void) _removeStaleSpellingState
+{
+  GSTextViewExtras *extras = extrasForTextView(self, NO);
+  NSRange r;
+
+  if (extras == nil)
+    {
+      return;
+    }
+  r = NSIntersectionRange(extras->staleSpellingRange,
+			  NSMakeRange(0, [_textStorage length]));
+  extras->staleSpellingRange = NSMakeRange(0, 0);
+  if (r.length > 0)
+    {
+      [_layoutManager removeTemporaryAttribute: NSSpellingStateAttributeName
+			     forCharacterRange: r];
+    }
+}
+
+/* Keeps the checked range map in step with the edits of the text
+ * storage.  The paragraphs touched by an edit are forgotten, everything
+ * after them is moved by the change in length.
+ */
+- (void) _textStorageDidProcessEditing: (NSNotification *)notif
+{
+  NSTextStorage *ts = [notif object];
+  NSUInteger length = [ts length];
+  NSInteger delta = [ts changeInLength];
+  NSRange edited = [ts editedRange];
+  GSTextViewExtras *extras;
+  NSMutableIndexSet *checkedRanges;
+  NSRange para;
+  NSUInteger oldEnd;
+
+  if (([ts editedMask] & NSTextStorageEditedCharacters) == 0
+    || (extras = extrasForTextView(self, NO)) == nil
+    || (checkedRanges = extras->checkedRanges) == nil)
+    {
+      return;
+    }
+
+  if (edited.location > length)
+    {
+      edited.location = length;
+    }
+  if (NSMaxRange(edited) > length)
+    {
+      edited.length = length - edited.location;
+    }
+  if (delta > (NSInteger)edited.length)
+    {
+      delta = edited.length;
+    }
+  oldEnd = NSMaxRange(edited) - delta;
+
+  [checkedRanges removeIndexesInRange:
+    NSMakeRange(edited.location, oldEnd - edited.location)];
+  if (delta != 0)
+    {
+      [checkedRanges shiftIndexesStartingAtIndex: oldEnd by: delta];
+    }
+  para = [[ts string] paragraphRangeForRange: edited];
+  [checkedRanges removeIndexesInRange: para];
+
+  if (extras->staleSpellingRange.length > 0)
+    {
+      NSUInteger from = extras->staleSpellingRange.location;
+      NSUInteger to = NSMaxRange(extras->staleSpellingRange);
+
+      if (from >= oldEnd)
+	from += delta;
+      else if (from > edited.location)
+	from = edited.location;
+      if (to >= oldEnd)
+	to += delta;
+      else if (to > edited.location)
+	to = NSMaxRange(edited);
+      para = NSUnionRange(para, NSMakeRange(from, to - from));
+    }
+  extras->staleSpellingRange = para;
+
+  [self _scheduleTextCheckingTimer];
+}
+
+/* Forgets which text has been checked, and stops following the edits of
+ * the text storage for it.
+ */
+- (void) _forgetCheckedText
+{
+  GSTextViewExtras *extras = extrasForTextView(self, NO);
+
+  [notificationCenter removeObserver: self
+    name: NSTextStorageDidProcessEditingNotification
+    object: nil];
+  if (extras != nil)
+    {
+      DESTROY(extras->checkedRanges);
+      extras->staleSpellingRange = NSMakeRange(0, 0);
+    }
 }
 
 - (void) _textCheckingTimerFired: (NSTimer *)t
 {
+  GSTextViewExtras *extras;
+  NSString *string;
+  NSRange visibleRange;
+  NSRange run;
+  NSUInteger i;
+  NSUInteger end;
+
   _textCheckingTimer = nil;
 
   if (nil == _layoutManager)
     return;
 
+  extras = extrasForTextView(self, YES);
+  if (extras->checkedRanges == nil)
+    {
+      extras->checkedRanges = [NSMutableIndexSet new];
+      [notificationCenter addObserver: self
+			     selector: @selector(_textStorageDidProcessEditing:)
+				 name: NSTextStorageDidProcessEditingNotification
+			       object: _textStorage];
+    }
+  [self _removeStaleSpellingState];
+
   {
     const NSRect visibleRect = [self visibleRect];
     
     NSRange visibleGlyphRange = [_layoutManager glyphRangeForBoundingRect: visibleRect
 							  inTextContainer: _textContainer];
     
-    NSRange visibleRange = [_layoutManager characterRangeForGlyphRange: visibleGlyphRange
-						      actualGlyphRange: NULL];
-    
-    [self _checkTextInRange: visibleRange];
-    
+    visibleRange = [_layoutManager characterRangeForGlyphRange: visibleGlyphRange
+					      actualGlyphRange: NULL];
     _lastCheckedRect = visibleRect;
   }
+
+  /* Check the visible paragraphs which have not been checked since
+   * they were last edited.  Adjacent ones go to the spell checker as
+   * one range.
+   */
+  string = [_textStorage string];
+  visibleRange = [string paragraphRangeForRange: visibleRange];
+  end = NSMaxRange(visibleRange);
+  run = NSMakeRange(visibleRange.location, 0);
+  for (i = visibleRange.location; i < end; )
+    {
+      NSRange para = [string paragraphRangeForRange: NSMakeRange(i, 0)];
+
+      if ([extras->checkedRanges containsIndexesInRange: para])
+	{
+	  if (run.length > 0)
+	    {
+	      [self _checkTextInRange: run];
+	    }
+	  run = NSMakeRange(NSMaxRange(para), 0);
+	}
+      else
+	{
+	  run.length = NSMaxRange(para) - run.location;
+	}
+      i = NSMaxRange(para);
+    }
+  if (run.length > 0)
+    {
+      [self _checkTextInRange: run];
+    }
 }
 
 - (void) _scheduleTextCheckingTimer
@@ -6492,73 +6823,11 @@ or add guards
     }
 }
 
-/**
- * If selected has a nonzero length, return it unmodified.
- * If selected is touching a word, expand it to cover the entire word
- * Otherwise return selected unmodified
- */
-- (NSRange) _rangeToInvalidateSpellingForSelectionRange: (NSRange)selected
-{
-  if (selected.length > 0)
-    {
-      return selected;
-    }
-  else
-    {
-      NSRange prevNonCharacter;
-      NSRange nextNonCharacter;
-      NSRange range;
-      NSCharacterSet *boundary = [[NSCharacterSet letterCharacterSet] invertedSet];
-  
-      if (selected.location == [[self string] length] && selected.location > 0)
-	{
-	  selected.location--;
-	}
-
-      prevNonCharacter = [[self string] rangeOfCharacterFromSet: boundary options: NSBackwardsSearch range: NSMakeRange(0, selected.location)];
-      nextNonCharacter = [[self string] rangeOfCharacterFromSet: boundary options: 0 range: NSMakeRange(NSMaxRange(selected), [[self string] length] - NSMaxRange(selected))];
-  
-      if (prevNonCharacter.length == 0)
-	{
-	  range.location = 0;
-	}
-      else
-	{
-	  range.location = prevNonCharacter.location + 1;
-	}
-
-      if (nextNonCharacter.length == 0)
-	{
-	  range.length = [[self string] length] - range.location;
-	}
-      else
-	{
-	  range.length = nextNonCharacter.location - range.location;
-	}
-
-      return range;
-    }
-}
-
 - (void) _textDidChange: (NSNotification*)notif
 {
   if (_tf.continuous_spell_checking)
     {
-      // FIXME: This uses the caret position to guess what change caused
-      // the NSTextDidChangeNotification and mark that range of the text as requiring re-checking.
-      //
-      // It would be better to use accurate information to decide what range
-      // need its spelling state invalidated.
-
-      NSRange range = [self _rangeToInvalidateSpellingForSelectionRange: [self selectedRange]];
-      if (range.length > 0)
-	{
-	  [_layoutManager removeTemporaryAttribute: @"NSTextChecked"
-				 forCharacterRange: range];
-	  [_layoutManager removeTemporaryAttribute: NSSpellingStateAttributeName
-				 forCharacterRange: range];
-	}
-
+      [self _removeStaleSpellingState];
       [self _scheduleTextCheckingTimer];
     }
 }
@@ -6620,6 +6889,34 @@ or add guards
   range = aRange;
 }
 
+/* Grows the record to also undo replacing aRange (in the current text)
+ * with length characters.  The text between the two changes has not been
+ * edited, so it is copied from the current text.  The string must be
+ * mutable, and appending is cheap, so edits moving forwards through the
+ * text stay linear.
+ */
+- (void) mergeChangeInRange: (NSRange)aRange
+	  replacementLength: (NSUInteger)length
+		   fromText: (NSAttributedString *)text
+{
+  NSMutableAttributedString *s = (NSMutableAttributedString *)string;
+  NSUInteger start = MIN(range.location, aRange.location);
+  NSUInteger end = MAX(NSMaxRange(range), NSMaxRange(aRange));
+
+  if (end > NSMaxRange(range))
+    {
+      [s appendAttributedString: [text attributedSubstringFromRange:
+	NSMakeRange(NSMaxRange(range), end - NSMaxRange(range))]];
+    }
+  if (start < range.location)
+    {
+      [s insertAttributedString: [text attributedSubstringFromRange:
+	NSMakeRange(start, range.location - start)]
+			atIndex: 0];
+    }
+  range = NSMakeRange(start, end - start - aRange.length + length);
+}
+
 - (void) performUndo: (NSTextStorage *)aTextStorage
 {
   NSTextView *tv = [self bestTextViewForTextStorage: aTextStorage];
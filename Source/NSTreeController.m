@@ -56,15 +56,714 @@
 */ 
 
 #import <Foundation/NSArray.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSException.h>
 #import <Foundation/NSIndexPath.h>
+#import <Foundation/NSIndexSet.h>
+#import <Foundation/NSKeyValueCoding.h>
+#import <Foundation/NSKeyValueObserving.h>
+#import <Foundation/NSMapTable.h>
+#import <Foundation/NSSet.h>
 #import <Foundation/NSString.h>
 #import <Foundation/NSSortDescriptor.h>
+#import <Foundation/NSValue.h>
 
 #import <AppKit/NSTreeController.h>
 #import <AppKit/NSTreeNode.h>
 
+@interface NSTreeController (Private)
+- (NSMutableArray*) _mutableContent;
+- (void) _adjustSelectionBelow: (NSTreeNode*)node
+                       indexes: (NSIndexSet*)indexes
+                      inserted: (BOOL)inserted;
+- (void) _node: (NSTreeNode*)node didInsertAtIndexes: (NSIndexSet*)indexes;
+- (void) _node: (NSTreeNode*)node didRemoveAtIndexes: (NSIndexSet*)indexes;
+- (void) _nodeDidReload: (NSTreeNode*)node;
+@end
+
+static NSComparisonResult
+compareObjects(id a, id b, NSArray *sortDescs)
+{
+  NSUInteger count = [sortDescs count];
+  NSUInteger i;
+
+  for (i = 0; i < count; i++)
+    {
+      NSComparisonResult result;
+
+      result = [[sortDescs objectAtIndex: i] compareObject: a toObject: b];
+      if (result != NSOrderedSame)
+        {
+          return result;
+        }
+    }
+  return NSOrderedSame;
+}
+
+/* The nodes of the arranged objects tree.  The children of a node are
+ * only fetched from its represented object when they are first asked
+ * for.  The node then observes the children key path of the represented
+ * object, so that insertions and removals in the model are applied to
+ * the existing child nodes instead of rebuilding them.
+ * Each node remembers its position in its parent, so finding the index
+ * path of a node does not need to search the siblings at every level.
+ */
+@interface GSTreeControllerNode : NSTreeNode
+{
+  NSTreeController *_controller;	// Not retained
+  NSString *_observedPath;
+  NSUInteger _index;			// Position in the parent node
+  NSUInteger _firstStale;		// First child with an unknown _index
+  NSUInteger _changes;			// Number of model changes seen
+  BOOL _isRoot;
+  BOOL _loaded;
+}
+
+- (id) initRootWithController: (NSTreeController*)controller;
+- (id) initWithRepresentedObject: (id)repObj
+                      controller: (NSTreeController*)controller;
+- (NSUInteger) _changeCount;
+- (NSUInteger) _childCount;
+- (void) _detach;
+- (NSUInteger) _indexOfChild: (GSTreeControllerNode*)child;
+- (NSUInteger) _indexOfObject: (id)object;
+- (void) _insertNodes: (NSArray*)nodes atIndexes: (NSIndexSet*)indexes;
+- (void) _insertObjects: (NSArray*)objects atIndexes: (NSIndexSet*)indexes;
+- (void) _loadChildren;
+- (NSArray*) _modelChildren;
+- (GSTreeControllerNode*) _nodeForObject: (id)object;
+- (void) _reload;
+- (void) _removeNodesAtIndexes: (NSIndexSet*)indexes;
+- (void) _removeObjects: (NSArray*)objects atIndexes: (NSIndexSet*)indexes;
+@end
+
+@implementation GSTreeControllerNode
+
+- (id) initRootWithController: (NSTreeController*)controller
+{
+  if ((self = [self initWithRepresentedObject: nil
+                                   controller: controller]) != nil)
+    {
+      _isRoot = YES;
+    }
+  return self;
+}
+
+- (id) initWithRepresentedObject: (id)repObj
+                      controller: (NSTreeController*)controller
+{
+  if ((self = [super initWithRepresentedObject: repObj]) != nil)
+    {
+      _controller = controller;
+    }
+  return self;
+}
+
+- (void) dealloc
+{
+  [self _detach];
+  [super dealloc];
+}
+
+- (NSArray*) childNodes
+{
+  [self _loadChildren];
+  return [super childNodes];
+}
+
+- (NSTreeNode*) descendantNodeAtIndexPath: (NSIndexPath*)path
+{
+  NSUInteger len = [path length];
+  NSUInteger i;
+  GSTreeControllerNode *node = self;
+
+  for (i = 0; i < len; i++)
+    {
+      NSUInteger index = [path indexAtPosition: i];
+
+      [node _loadChildren];
+      if (index >= [node->_childNodes count])
+        {
+          return nil;
+        }
+      node = [node->_childNodes objectAtIndex: index];
+    }
+
+  return node;
+}
+
+- (NSIndexPath*) indexPath
+{
+  GSTreeControllerNode *node;
+  NSUInteger depth = 0;
+
+  for (node = self; node->_parentNode != nil;
+    node = (GSTreeControllerNode*)node->_parentNode)
+    {
+      depth++;
+    }
+  if (depth == 0)
+    {
+      return nil;
+    }
+  else
+    {
+      NSUInteger indexes[depth];
+      NSUInteger i = depth;
+
+      for (node = self; node->_parentNode != nil;
+        node = (GSTreeControllerNode*)node->_parentNode)
+        {
+          GSTreeControllerNode *parent;
+
+          parent = (GSTreeControllerNode*)node->_parentNode;
+          indexes[--i] = [parent _indexOfChild: node];
+          if (indexes[i] == NSNotFound)
+            {
+              return nil;
+            }
+        }
+      return [NSIndexPath indexPathWithIndexes: indexes length: depth];
+    }
+}
+
+- (BOOL) isLeaf
+{
+  NSString *path;
+
+  if (_isRoot)
+    {
+      return NO;
+    }
+  path = [_controller leafKeyPathForNode: self];
+  if (path != nil)
+    {
+      return [[_representedObject valueForKeyPath: path] boolValue];
+    }
+  path = [_controller countKeyPathForNode: self];
+  if (path != nil && _loaded == NO)
+    {
+      return [[_representedObject valueForKeyPath: path] intValue] == 0;
+    }
+  return [self _childCount] == 0;
+}
+
+- (NSMutableArray*) mutableChildNodes
+{
+  [self _loadChildren];
+  /* The returned array may change our children without telling us,
+   * so we cannot trust the positions we know any more.
+   */
+  _firstStale = 0;
+  return [super mutableChildNodes];
+}
+
+- (void) sortWithSortDescriptors: (NSArray*)sortDescs recursively: (BOOL)flag
+{
+  /* Children which are not loaded yet get sorted when they are loaded.
+   */
+  if (_loaded == NO)
+    {
+      return;
+    }
+  [super sortWithSortDescriptors: sortDescs recursively: NO];
+  _firstStale = 0;
+  if (flag)
+    {
+      NSUInteger count = [_childNodes count];
+      NSUInteger i;
+
+      for (i = 0; i < count; i++)
+        {
+          [[_childNodes objectAtIndex: i] sortWithSortDescriptors: sortDescs
+                                                      recursively: YES];
+        }
+    }
+}
+
+- (void) observeValueForKeyPath: (NSString*)keyPath
+                       ofObject: (id)object
+                         change: (NSDictionary*)change
+                        context: (void*)context
+{
+  NSKeyValueChange kind;
+  NSIndexSet *indexes;
+  id old;
+  id new;
+
+  kind = [[change objectForKey: NSKeyValueChangeKindKey] intValue];
+  indexes = [change objectForKey: NSKeyValueChangeIndexesKey];
+  old = [change objectForKey: NSKeyValueChangeOldKey];
+  new = [change objectForKey: NSKeyValueChangeNewKey];
+  if (indexes == nil)
+    {
+      kind = NSKeyValueChangeSetting;
+    }
+
+  switch (kind)
+    {
+      case NSKeyValueChangeInsertion:
+        if ([new isKindOfClass: [NSArray class]])
+          {
+            [self _insertObjects: new atIndexes: indexes];
+            return;
+          }
+        break;
+
+      case NSKeyValueChangeRemoval:
+        if ([old isKindOfClass: [NSArray class]])
+          {
+            [self _removeObjects: old atIndexes: indexes];
+            return;
+          }
+        break;
+
+      case NSKeyValueChangeReplacement:
+        if ([old isKindOfClass: [NSArray class]]
+          && [new isKindOfClass: [NSArray class]])
+          {
+            [self _removeObjects: old atIndexes: indexes];
+            [self _insertObjects: new atIndexes: indexes];
+            return;
+          }
+        break;
+
+      default:
+        break;
+    }
+  [self _reload];
+}
+
+- (NSUInteger) _changeCount
+{
+  return _changes;
+}
+
+- (NSUInteger) _childCount
+{
+  [self _loadChildren];
+  return [_childNodes count];
+}
+
+/* Stop observing the model for this node and all its loaded
+ * descendants.  Called when the nodes are removed from the tree.
+ */
+- (void) _detach
+{
+  NSUInteger count = [_childNodes count];
+  NSUInteger i;
+
+  if (_observedPath != nil)
+    {
+      [_representedObject removeObserver: self forKeyPath: _observedPath];
+      DESTROY(_observedPath);
+    }
+  for (i = 0; i < count; i++)
+    {
+      [[_childNodes objectAtIndex: i] _detach];
+    }
+  _controller = nil;
+}
+
+- (NSUInteger) _indexOfChild: (GSTreeControllerNode*)child
+{
+  NSUInteger count = [_childNodes count];
+
+  if (child->_index >= _firstStale || child->_index >= count
+    || [_childNodes objectAtIndex: child->_index] != child)
+    {
+      NSUInteger i = _firstStale;
+
+      /* A position we thought was valid is wrong, so the children
+       * have been changed behind our back.
+       */
+      if (child->_index < _firstStale || i > count)
+        {
+          i = 0;
+        }
+      for (; i < count; i++)
+        {
+          ((GSTreeControllerNode*)[_childNodes objectAtIndex: i])->_index = i;
+        }
+      _firstStale = count;
+      if (child->_index >= count
+        || [_childNodes objectAtIndex: child->_index] != child)
+        {
+          return NSNotFound;
+        }
+    }
+  return child->_index;
+}
+
+- (NSUInteger) _indexOfObject: (id)object
+{
+  NSUInteger count = [_childNodes count];
+  NSUInteger i;
+
+  for (i = 0; i < count; i++)
+    {
+      if ([[_childNodes objectAtIndex: i] representedObject] == object)
+        {
+          return i;
+        }
+    }
+  return NSNotFound;
+}
+
+- (void) _insertNodes: (NSArray*)nodes atIndexes: (NSIndexSet*)indexes
+{
+  [self willChange: NSKeyValueChangeInsertion
+   valuesAtIndexes: indexes
+            forKey: @"childNodes"];
+  [_childNodes insertObjects: nodes atIndexes: indexes];
+  [self didChange: NSKeyValueChangeInsertion
+  valuesAtIndexes: indexes
+           forKey: @"childNodes"];
+  if ([indexes firstIndex] < _firstStale)
+    {
+      _firstStale = [indexes firstIndex];
+    }
+  [_controller _node: self didInsertAtIndexes: indexes];
+}
+
+/* The objects were inserted into the model children at indexes.
+ * Create nodes for them, keeping the children sorted if the controller
+ * has sort descriptors.
+ */
+- (void) _insertObjects: (NSArray*)objects atIndexes: (NSIndexSet*)indexes
+{
+  NSUInteger count = [objects count];
+  NSArray *sortDescs;
+  NSMutableArray *nodes;
+  NSUInteger i;
+
+  _changes++;
+  if (_loaded == NO || count == 0)
+    {
+      return;
+    }
+
+  sortDescs = [_controller sortDescriptors];
+  if ([sortDescs count] > 0)
+    {
+      for (i = 0; i < count; i++)
+        {
+          id object = [objects objectAtIndex: i];
+          NSUInteger low = 0;
+          NSUInteger high = [_childNodes count];
+
+          while (low < high)
+            {
+              NSUInteger mid = (low + high) / 2;
+              id other = [[_childNodes objectAtIndex: mid] representedObject];
+
+              if (compareObjects(other, object, sortDescs)
+                == NSOrderedDescending)
+                {
+                  high = mid;
+                }
+              else
+                {
+                  low = mid + 1;
+                }
+            }
+          [self _insertNodes: [NSArray arrayWithObject:
+                                 [self _nodeForObject: object]]
+                   atIndexes: [NSIndexSet indexSetWithIndex: low]];
+        }
+      return;
+    }
+
+  nodes = [NSMutableArray arrayWithCapacity: count];
+  for (i = 0; i < count; i++)
+    {
+      [nodes addObject: [self _nodeForObject: [objects objectAtIndex: i]]];
+    }
+  if ([indexes count] != count
+    || [indexes lastIndex] >= [_childNodes count] + count)
+    {
+      indexes = [NSIndexSet indexSetWithIndexesInRange:
+                              NSMakeRange([_childNodes count], count)];
+    }
+  [self _insertNodes: nodes atIndexes: indexes];
+}
+
+- (void) _loadChildren
+{
+  NSArray *objects;
+  NSArray *sortDescs;
+  NSUInteger count;
+  NSUInteger i;
+
+  if (_loaded)
+    {
+      return;
+    }
+  _loaded = YES;
+
+  objects = [self _modelChildren];
+  count = [objects count];
+  for (i = 0; i < count; i++)
+    {
+      [_childNodes addObject: [self _nodeForObject: [objects objectAtIndex: i]]];
+    }
+  sortDescs = [_controller sortDescriptors];
+  if ([sortDescs count] > 0)
+    {
+      [super sortWithSortDescriptors: sortDescs recursively: NO];
+    }
+  _firstStale = 0;
+
+  if (_isRoot == NO && _observedPath == nil)
+    {
+      NSString *path = [_controller childrenKeyPathForNode: self];
+
+      if (path != nil)
+        {
+          ASSIGNCOPY(_observedPath, path);
+          [_representedObject addObserver: self
+                               forKeyPath: _observedPath
+                                  options: NSKeyValueObservingOptionNew
+                                    | NSKeyValueObservingOptionOld
+                                  context: NULL];
+        }
+    }
+}
+
+- (NSArray*) _modelChildren
+{
+  id children;
+
+  if (_isRoot)
+    {
+      children = [_controller content];
+    }
+  else
+    {
+      NSString *path = [_controller childrenKeyPathForNode: self];
+
+      if (path == nil)
+        {
+          return nil;
+        }
+      children = [_representedObject valueForKeyPath: path];
+    }
+
+  if (children == nil || [children isKindOfClass: [NSArray class]])
+    {
+      return children;
+    }
+  else if ([children isKindOfClass: [NSSet class]])
+    {
+      return [children allObjects];
+    }
+  else
+    {
+      return [NSArray arrayWithObject: children];
+    }
+}
+
+- (GSTreeControllerNode*) _nodeForObject: (id)object
+{
+  GSTreeControllerNode *node;
+
+  node = [[GSTreeControllerNode alloc] initWithRepresentedObject: object
+                                                      controller: _controller];
+  node->_parentNode = self;
+  return AUTORELEASE(node);
+}
+
+/* The model children were replaced as a whole; drop our children and
+ * load them again when they are next asked for.
+ */
+- (void) _reload
+{
+  NSUInteger count = [_childNodes count];
+  NSUInteger i;
+
+  _changes++;
+  if (_loaded == NO)
+    {
+      return;
+    }
+  [self willChangeValueForKey: @"childNodes"];
+  for (i = 0; i < count; i++)
+    {
+      GSTreeControllerNode *child = [_childNodes objectAtIndex: i];
+
+      child->_parentNode = nil;
+      [child _detach];
+    }
+  [_childNodes removeAllObjects];
+  _loaded = NO;
+  [self didChangeValueForKey: @"childNodes"];
+  [_controller _nodeDidReload: self];
+}
+
+- (void) _removeNodesAtIndexes: (NSIndexSet*)indexes
+{
+  NSArray *removed = [_childNodes objectsAtIndexes: indexes];
+  NSUInteger count = [removed count];
+  NSUInteger i;
+
+  [self willChange: NSKeyValueChangeRemoval
+   valuesAtIndexes: indexes
+            forKey: @"childNodes"];
+  [_childNodes removeObjectsAtIndexes: indexes];
+  [self didChange: NSKeyValueChangeRemoval
+  valuesAtIndexes: indexes
+           forKey: @"childNodes"];
+  for (i = 0; i < count; i++)
+    {
+      GSTreeControllerNode *child = [removed objectAtIndex: i];
+
+      child->_parentNode = nil;
+      [child _detach];
+    }
+  if ([indexes firstIndex] < _firstStale)
+    {
+      _firstStale = [indexes firstIndex];
+    }
+  [_controller _node: self didRemoveAtIndexes: indexes];
+}
+
+/* The objects were removed from the model children at indexes.  When
+ * the children are not sorted the indexes are normally also those of
+ * the nodes, otherwise the nodes are looked up by their object.
+ */
+- (void) _removeObjects: (NSArray*)objects atIndexes: (NSIndexSet*)indexes
+{
+  NSUInteger count = [objects count];
+  NSMutableIndexSet *found;
+  NSUInteger i;
+
+  _changes++;
+  if (_loaded == NO || count == 0)
+    {
+      return;
+    }
+
+  if ([[_controller sortDescriptors] count] == 0 && [indexes count] == count
+    && [indexes lastIndex] < [_childNodes count])
+    {
+      NSUInteger index = [indexes firstIndex];
+
+      for (i = 0; i < count; i++)
+        {
+          if ([[_childNodes objectAtIndex: index] representedObject]
+            != [objects objectAtIndex: i])
+            {
+              break;
+            }
+          index = [indexes indexGreaterThanIndex: index];
+        }
+      if (i == count)
+        {
+          [self _removeNodesAtIndexes: indexes];
+          return;
+        }
+    }
+
+  found = [NSMutableIndexSet indexSet];
+  for (i = 0; i < count; i++)
+    {
+      id object = [objects objectAtIndex: i];
+      NSUInteger n = [_childNodes count];
+      NSUInteger j;
+
+      for (j = 0; j < n; j++)
+        {
+          if ([[_childNodes objectAtIndex: j] representedObject] == object
+            && [found containsIndex: j] == NO)
+            {
+              [found addIndex: j];
+              break;
+            }
+        }
+    }
+  if ([found count] > 0)
+    {
+      [self _removeNodesAtIndexes: found];
+    }
+}
+
+@end
+
+/* The arranged objects tree and the selection of a controller.  They
+ * are kept out of the instance variables, which are fixed by the
+ * compiled subclasses.
+ */
+@interface GSTreeControllerState : NSObject
+{
+@public
+  GSTreeControllerNode *arrangedObjects;
+  NSArray *selectionIndexPaths;
+}
+@end
+
+@implementation GSTreeControllerState
+- (void) dealloc
+{
+  [arrangedObjects _detach];
+  RELEASE(arrangedObjects);
+  RELEASE(selectionIndexPaths);
+  [super dealloc];
+}
+@end
+
+static NSMapTable *treeStates = 0;
+
+static GSTreeControllerState *
+stateForController(NSTreeController *controller, BOOL create)
+{
+  GSTreeControllerState *state;
+
+  state = (GSTreeControllerState *)NSMapGet(treeStates, controller);
+  if (state == nil && create == YES)
+    {
+      state = [GSTreeControllerState new];
+      NSMapInsert(treeStates, controller, state);
+      RELEASE(state);
+    }
+  return state;
+}
+
+static inline GSTreeControllerNode *
+arrangedRoot(NSTreeController *controller)
+{
+  GSTreeControllerState *state = stateForController(controller, NO);
+
+  return (state == nil) ? nil : state->arrangedObjects;
+}
+
+static inline NSArray *
+selectionPaths(NSTreeController *controller)
+{
+  GSTreeControllerState *state = stateForController(controller, NO);
+
+  return (state == nil) ? nil : state->selectionIndexPaths;
+}
+
+
 @implementation NSTreeController
 
++ (void) initialize
+{
+  if (self == [NSTreeController class])
+    {
+      NSArray *keys = [NSArray arrayWithObject: @"selectionIndexPaths"];
+
+      [self setKeys: keys
+            triggerChangeNotificationsForDependentKey: @"selectionIndexPath"];
+      [self setKeys: keys
+            triggerChangeNotificationsForDependentKey: @"selectedNodes"];
+      [self setKeys: keys
+            triggerChangeNotificationsForDependentKey: @"selectedObjects"];
+      treeStates = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                                    NSObjectMapValueCallBacks, 0);
+    }
+}
+
 - (id) initWithContent: (id)content
 {
   if ((self = [super initWithContent: content]) != nil)
@@ -76,6 +775,7 @@
 
 - (void) dealloc
 {
+  NSMapRemove(treeStates, self);
   RELEASE(_childrenKeyPath);
   RELEASE(_countKeyPath);
   RELEASE(_leafKeyPath);
@@ -85,8 +785,10 @@
 
 - (BOOL) addSelectionIndexPaths: (NSArray*)indexPaths
 {
-  // FIXME
-  return NO;
+  NSMutableArray *paths = [NSMutableArray arrayWithArray: [self selectionIndexPaths]];
+
+  [paths addObjectsFromArray: indexPaths];
+  return [self setSelectionIndexPaths: paths];
 }
 
 - (BOOL) alwaysUsesMultipleValuesMarker
@@ -101,20 +803,18 @@
 
 - (BOOL) canAddChid
 {
-  // FIXME
-  return NO;
+  return [self canInsertChild];
 }
 
 - (BOOL) canInsert
 {
-  // FIXME
-  return NO;
+  return [self isEditable];
 }
 
 - (BOOL) canInsertChild
 {
-  // FIXME
-  return NO;
+  return [self isEditable] && _childrenKeyPath != nil
+    && [selectionPaths(self) count] == 1;
 }
 
 - (BOOL) preservesSelection
@@ -129,44 +829,81 @@
 
 - (BOOL) setSelectionIndexPath: (NSIndexPath*)indexPath
 {
-  // FIXME
-  return NO;
+  NSArray *paths = (indexPath == nil) ? [NSArray array]
+    : [NSArray arrayWithObject: indexPath];
+
+  return [self setSelectionIndexPaths: paths];
 }
 
 - (BOOL) setSelectionIndexPaths: (NSArray*)indexPaths
 {
-  // FIXME
-  return NO;
+  GSTreeControllerState *state;
+  NSArray *paths;
+
+  paths = [[[NSSet setWithArray: indexPaths] allObjects]
+            sortedArrayUsingSelector: @selector(compare:)];
+  if ([selectionPaths(self) isEqual: paths])
+    {
+      return NO;
+    }
+  [self willChangeValueForKey: @"selectionIndexPaths"];
+  state = stateForController(self, YES);
+  ASSIGN(state->selectionIndexPaths, paths);
+  [self didChangeValueForKey: @"selectionIndexPaths"];
+  return YES;
 }
 
 - (id) arrangedObjects
 {
-  // FIXME
-  return nil;
+  GSTreeControllerState *state = stateForController(self, YES);
+
+  if (state->arrangedObjects == nil)
+    {
+      state->arrangedObjects = [[GSTreeControllerNode alloc]
+                                 initRootWithController: self];
+    }
+  return state->arrangedObjects;
 }
 
 - (id) content
 {
-  // FIXME
   return [super content];
 }
 
 - (NSArray*) selectedObjects
 {
-  // FIXME
-  return [super selectedObjects];
+  NSArray *nodes = [self selectedNodes];
+  NSUInteger count = [nodes count];
+  NSMutableArray *objects = [NSMutableArray arrayWithCapacity: count];
+  NSUInteger i;
+
+  for (i = 0; i < count; i++)
+    {
+      [objects addObject: [[nodes objectAtIndex: i] representedObject]];
+    }
+  return objects;
 }
 
 - (NSIndexPath*) selectionIndexPath
 {
-  // FIXME
-  return nil;
+  NSArray *paths = selectionPaths(self);
+
+  if ([paths count] == 0)
+    {
+      return nil;
+    }
+  return [paths objectAtIndex: 0];
 }
 
 - (NSArray*) selectionIndexPaths
 {
-  // FIXME
-  return nil;
+  NSArray *paths = selectionPaths(self);
+
+  if (paths == nil)
+    {
+      return [NSArray array];
+    }
+  return paths;
 }
 
 - (NSArray*) sortDescriptors
@@ -191,59 +928,280 @@
 
 - (void) addChild: (id)sender
 {
-  // FIXME
+  if ([self canInsertChild])
+    {
+      NSIndexPath *path = [self selectionIndexPath];
+      GSTreeControllerNode *node;
+      id new;
+
+      node = (GSTreeControllerNode*)[[self arrangedObjects]
+                                      descendantNodeAtIndexPath: path];
+      new = [self newObject];
+      [self insertObject: new
+        atArrangedObjectIndexPath: [path indexPathByAddingIndex:
+                                           [node _childCount]]];
+      RELEASE(new);
+    }
 }
 
 - (void) add: (id)sender
 {
-  // FIXME
-  [super add: sender];
+  if ([self canAdd])
+    {
+      NSIndexPath *path = [self selectionIndexPath];
+      GSTreeControllerNode *parent;
+      id new;
+
+      /* Add at the end of the level of the selection. */
+      path = [path indexPathByRemovingLastIndex];
+      parent = (GSTreeControllerNode*)[[self arrangedObjects]
+                                        descendantNodeAtIndexPath: path];
+      if (parent == nil)
+        {
+          parent = [self arrangedObjects];
+          path = nil;
+        }
+      if (path == nil)
+        {
+          path = [NSIndexPath indexPathWithIndex: [parent _childCount]];
+        }
+      else
+        {
+          path = [path indexPathByAddingIndex: [parent _childCount]];
+        }
+      new = [self newObject];
+      [self insertObject: new atArrangedObjectIndexPath: path];
+      RELEASE(new);
+    }
 }
 
 - (void) insertChild: (id)sender
 {
-  // FIXME
+  if ([self canInsertChild])
+    {
+      id new = [self newObject];
+
+      [self insertObject: new
+        atArrangedObjectIndexPath: [[self selectionIndexPath]
+                                     indexPathByAddingIndex: 0]];
+      RELEASE(new);
+    }
 }
 
 - (void) insertObject: (id)object atArrangedObjectIndexPath: (NSIndexPath*)indexPath
 {
-  // FIXME
+  NSUInteger length = [indexPath length];
+  GSTreeControllerNode *parent;
+  NSUInteger changes;
+  NSUInteger index;
+
+  if (object == nil || length == 0)
+    {
+      return;
+    }
+  index = [indexPath indexAtPosition: length - 1];
+  parent = (GSTreeControllerNode*)[[self arrangedObjects]
+             descendantNodeAtIndexPath: [indexPath indexPathByRemovingLastIndex]];
+  if (parent == nil || [parent isKindOfClass: [GSTreeControllerNode class]] == NO)
+    {
+      [NSException raise: NSRangeException
+                  format: @"No node for index path %@", indexPath];
+    }
+
+  changes = [parent _changeCount];
+  if (parent == arrangedRoot(self))
+    {
+      NSMutableArray *content = [self _mutableContent];
+
+      if (index > [content count])
+        {
+          index = [content count];
+        }
+      [content insertObject: object atIndex: index];
+    }
+  else
+    {
+      NSString *path = [self childrenKeyPathForNode: parent];
+      NSMutableArray *children;
+
+      if (path == nil)
+        {
+          return;
+        }
+      children = [[parent representedObject] mutableArrayValueForKeyPath: path];
+      if (index > [children count])
+        {
+          index = [children count];
+        }
+      [children insertObject: object atIndex: index];
+    }
+
+  if ([parent _changeCount] == changes)
+    {
+      /* The model did not tell us about the change, so apply it.
+       */
+      [parent _insertObjects: [NSArray arrayWithObject: object]
+                   atIndexes: [NSIndexSet indexSetWithIndex: index]];
+    }
+
+  if (_selectsInsertedObjects)
+    {
+      NSUInteger i;
+
+      [parent _loadChildren];
+      i = [parent _indexOfObject: object];
+      if (i != NSNotFound)
+        {
+          NSIndexPath *path = [indexPath indexPathByRemovingLastIndex];
+
+          [self setSelectionIndexPath: [path indexPathByAddingIndex: i]];
+        }
+    }
 }
 
 - (void) insertObjects: (NSArray*)objects atArrangedObjectIndexPaths: (NSArray*)indexPaths
 {
-  // FIXME
+  NSUInteger count = [objects count];
+  NSUInteger i;
+
+  if ([indexPaths count] != count)
+    {
+      [NSException raise: NSInvalidArgumentException
+                  format: @"Number of objects and index paths differ"];
+    }
+  for (i = 0; i < count; i++)
+    {
+      [self insertObject: [objects objectAtIndex: i]
+        atArrangedObjectIndexPath: [indexPaths objectAtIndex: i]];
+    }
 }
 
 - (void) insert: (id)sender
 {
-  // FIXME
+  if ([self canInsert])
+    {
+      NSIndexPath *path = [self selectionIndexPath];
+      id new = [self newObject];
+
+      if (path == nil)
+        {
+          path = [NSIndexPath indexPathWithIndex: 0];
+        }
+      [self insertObject: new atArrangedObjectIndexPath: path];
+      RELEASE(new);
+    }
 }
 
 - (void) rearrangeObjects
 {
-  // FIXME
+  NSArray *nodes = [self selectedNodes];
+  NSUInteger count = [nodes count];
+
+  [self willChangeValueForKey: @"arrangedObjects"];
+  if ([_sortDescriptors count] > 0)
+    {
+      [arrangedRoot(self) sortWithSortDescriptors: _sortDescriptors
+                                      recursively: YES];
+    }
+  [self didChangeValueForKey: @"arrangedObjects"];
+
+  if (count > 0)
+    {
+      NSMutableArray *paths = [NSMutableArray arrayWithCapacity: count];
+      NSUInteger i;
+
+      for (i = 0; i < count; i++)
+        {
+          NSIndexPath *path = [[nodes objectAtIndex: i] indexPath];
+
+          if (path != nil)
+            {
+              [paths addObject: path];
+            }
+        }
+      [self setSelectionIndexPaths: paths];
+    }
 }
 
 - (void) removeObjectAtArrangedObjectIndexPath: (NSIndexPath*)indexPath
 {
-  // FIXME
+  GSTreeControllerNode *node;
+  GSTreeControllerNode *parent;
+  NSUInteger changes;
+  NSUInteger index;
+  id object;
+
+  node = (GSTreeControllerNode*)[[self arrangedObjects]
+                                  descendantNodeAtIndexPath: indexPath];
+  parent = (GSTreeControllerNode*)[node parentNode];
+  if (node == nil || parent == nil)
+    {
+      return;
+    }
+
+  object = AUTORELEASE(RETAIN([node representedObject]));
+  changes = [parent _changeCount];
+  if (parent == arrangedRoot(self))
+    {
+      NSMutableArray *content = [self _mutableContent];
+
+      index = [content indexOfObjectIdenticalTo: object];
+      if (index != NSNotFound)
+        {
+          [content removeObjectAtIndex: index];
+        }
+    }
+  else
+    {
+      NSString *path = [self childrenKeyPathForNode: parent];
+      NSMutableArray *children;
+
+      children = [[parent representedObject] mutableArrayValueForKeyPath: path];
+      index = [children indexOfObjectIdenticalTo: object];
+      if (index != NSNotFound)
+        {
+          [children removeObjectAtIndex: index];
+        }
+    }
+
+  if ([parent _changeCount] == changes && index != NSNotFound)
+    {
+      /* The model did not tell us about the change, so apply it.
+       */
+      [parent _removeObjects: [NSArray arrayWithObject: object]
+                   atIndexes: [NSIndexSet indexSetWithIndex: index]];
+    }
 }
 
 - (void) removeObjectsAtArrangedObjectIndexPaths: (NSArray*)indexPaths
 {
-  // FIXME
+  NSArray *paths;
+  NSUInteger i;
+
+  /* Remove the last paths first, so the others stay valid.
+   */
+  paths = [indexPaths sortedArrayUsingSelector: @selector(compare:)];
+  i = [paths count];
+  while (i-- > 0)
+    {
+      [self removeObjectAtArrangedObjectIndexPath: [paths objectAtIndex: i]];
+    }
 }
 
 - (void) removeSelectionIndexPaths: (NSArray*)indexPaths
 {
-  // FIXME
+  NSMutableArray *paths = [NSMutableArray arrayWithArray: [self selectionIndexPaths]];
+
+  [paths removeObjectsInArray: indexPaths];
+  [self setSelectionIndexPaths: paths];
 }
 
 - (void) remove: (id)sender
 {
-  // FIXME
-  [super remove: sender];
+  if ([self canRemove])
+    {
+      [self removeObjectsAtArrangedObjectIndexPaths: [self selectionIndexPaths]];
+    }
 }
 
 - (void) setAlwaysUsesMultipleValuesMarker: (BOOL)flag
@@ -263,8 +1221,17 @@
 
 - (void) setContent: (id)content
 {
-  // FIXME
+  GSTreeControllerState *state = stateForController(self, NO);
+
+  [self willChangeValueForKey: @"arrangedObjects"];
+  if (state != nil)
+    {
+      [state->arrangedObjects _detach];
+      DESTROY(state->arrangedObjects);
+    }
   [super setContent: content];
+  [self didChangeValueForKey: @"arrangedObjects"];
+  [self setSelectionIndexPaths: [NSArray array]];
 }
 
 - (void) setCountKeyPath: (NSString*)path
@@ -290,40 +1257,91 @@
 - (void) setSortDescriptors: (NSArray*)descriptors
 {
   ASSIGN(_sortDescriptors, descriptors);
+  if (arrangedRoot(self) != nil)
+    {
+      [self rearrangeObjects];
+    }
 }
 
 - (NSString*) childrenKeyPathForNode: (NSTreeNode*)node
 {
-  // FIXME
-  return nil;
+  return _childrenKeyPath;
 }
 
 - (NSString*) countKeyPathForNode: (NSTreeNode*)node
 {
-  // FIXME
-  return nil;
+  return _countKeyPath;
 }
 
 - (NSString*) leafKeyPathForNode: (NSTreeNode*)node
 {
-  // FIXME
-  return nil;
+  return _leafKeyPath;
 }
 
 - (void) moveNode: (NSTreeNode*)node toIndexPath: (NSIndexPath*)indexPath
 {
-  // FIXME
+  [self moveNodes: [NSArray arrayWithObject: node]
+      toIndexPath: indexPath];
 }
 
 - (void) moveNodes: (NSArray*)nodes toIndexPath: (NSIndexPath*)startingIndexPath
 {
-  // FIXME
+  NSUInteger count = [nodes count];
+  NSMutableArray *objects = [NSMutableArray arrayWithCapacity: count];
+  NSMutableArray *paths = [NSMutableArray arrayWithCapacity: count];
+  NSIndexPath *parentPath;
+  NSUInteger index;
+  NSUInteger i;
+
+  if ([startingIndexPath length] == 0)
+    {
+      return;
+    }
+  /* The destination index path is interpreted after the nodes have
+   * been removed from their old places.
+   */
+  for (i = 0; i < count; i++)
+    {
+      NSTreeNode *node = [nodes objectAtIndex: i];
+      NSIndexPath *path = [node indexPath];
+
+      if (path != nil)
+        {
+          [objects addObject: [node representedObject]];
+          [paths addObject: path];
+        }
+    }
+  [self removeObjectsAtArrangedObjectIndexPaths: paths];
+
+  parentPath = [startingIndexPath indexPathByRemovingLastIndex];
+  index = [startingIndexPath indexAtPosition: [startingIndexPath length] - 1];
+  count = [objects count];
+  for (i = 0; i < count; i++)
+    {
+      [self insertObject: [objects objectAtIndex: i]
+        atArrangedObjectIndexPath: [parentPath indexPathByAddingIndex: index + i]];
+    }
 }
 
 - (NSArray*) selectedNodes
 {
-  // FIXME
-  return nil;
+  NSArray *paths = selectionPaths(self);
+  NSUInteger count = [paths count];
+  NSMutableArray *nodes = [NSMutableArray arrayWithCapacity: count];
+  NSUInteger i;
+
+  for (i = 0; i < count; i++)
+    {
+      NSTreeNode *node;
+
+      node = [[self arrangedObjects] descendantNodeAtIndexPath:
+                               [paths objectAtIndex: i]];
+      if (node != nil)
+        {
+          [nodes addObject: node];
+        }
+    }
+  return nodes;
 }
 
 - (id) initWithCoder: (NSCoder*)coder
@@ -342,3 +1360,144 @@
 }
 
 @end
+
+@implementation NSTreeController (Private)
+
+/* Return the content as a mutable array, replacing it by one if
+ * needed, for insertions and removals at the top level.
+ */
+- (NSMutableArray*) _mutableContent
+{
+  if ([_content isKindOfClass: [NSMutableArray class]] == NO)
+    {
+      NSMutableArray *content;
+
+      if ([_content isKindOfClass: [NSArray class]])
+        {
+          content = [_content mutableCopy];
+        }
+      else if (_content != nil)
+        {
+          content = [[NSMutableArray alloc] initWithObjects: &_content
+                                                      count: 1];
+        }
+      else
+        {
+          content = [[NSMutableArray alloc] init];
+        }
+      /* The objects stay the same, so keep the arranged objects.
+       */
+      [super setContent: content];
+      RELEASE(content);
+    }
+  return _content;
+}
+
+/* Update the selection after the children of node at indexes were
+ * inserted or removed.  Selected paths through a removed child are
+ * dropped and the others are moved to the new positions.
+ */
+- (void) _adjustSelectionBelow: (NSTreeNode*)node
+                       indexes: (NSIndexSet*)indexes
+                      inserted: (BOOL)inserted
+{
+  NSArray *selection = selectionPaths(self);
+  NSUInteger count = [selection count];
+  NSIndexPath *parentPath;
+  NSUInteger depth;
+  NSMutableArray *paths;
+  BOOL changed = NO;
+  NSUInteger i;
+
+  if (count == 0 || [indexes count] == 0)
+    {
+      return;
+    }
+  parentPath = [node indexPath];
+  if (parentPath == nil && node != arrangedRoot(self))
+    {
+      return;
+    }
+  depth = [parentPath length];
+
+  paths = [NSMutableArray arrayWithCapacity: count];
+  for (i = 0; i < count; i++)
+    {
+      NSIndexPath *path = [selection objectAtIndex: i];
+      NSUInteger length = [path length];
+
+      if (length > depth)
+        {
+          NSUInteger buf[length];
+          NSUInteger j;
+
+          [path getIndexes: buf];
+          for (j = 0; j < depth; j++)
+            {
+              if (buf[j] != [parentPath indexAtPosition: j])
+                {
+                  break;
+                }
+            }
+          if (j == depth)
+            {
+              NSUInteger old = buf[depth];
+              NSUInteger new = old;
+
+              if (inserted)
+                {
+                  NSUInteger index = [indexes firstIndex];
+
+                  while (index != NSNotFound && index <= new)
+                    {
+                      new++;
+                      index = [indexes indexGreaterThanIndex: index];
+                    }
+                }
+              else if ([indexes containsIndex: old])
+                {
+                  changed = YES;
+                  continue;
+                }
+              else
+                {
+                  new = old - [indexes countOfIndexesInRange:
+                                         NSMakeRange(0, old)];
+                }
+              if (new != old)
+                {
+                  buf[depth] = new;
+                  path = [NSIndexPath indexPathWithIndexes: buf
+                                                    length: length];
+                  changed = YES;
+                }
+            }
+        }
+      [paths addObject: path];
+    }
+  if (changed)
+    {
+      [self setSelectionIndexPaths: paths];
+    }
+}
+
+- (void) _node: (NSTreeNode*)node didInsertAtIndexes: (NSIndexSet*)indexes
+{
+  [self _adjustSelectionBelow: node indexes: indexes inserted: YES];
+}
+
+- (void) _node: (NSTreeNode*)node didRemoveAtIndexes: (NSIndexSet*)indexes
+{
+  [self _adjustSelectionBelow: node indexes: indexes inserted: NO];
+}
+
+- (void) _nodeDidReload: (NSTreeNode*)node
+{
+  /* Drop the selection of all the old children. */
+  [self _adjustSelectionBelow: node
+                      indexes: [NSIndexSet indexSetWithIndexesInRange:
+                                             NSMakeRange(0, NSIntegerMax)]
+                     inserted: NO];
+}
+
+@end
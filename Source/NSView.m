@@ -147,6 +147,43 @@ static void	(*invalidateImp)(NSView*, SEL);
 static NSMapTable	*typesMap = 0;
 static NSLock		*typesLock = nil;
 
+/*
+ *	Rectangles marked as needing display by secondary threads, joined
+ *	per view, until the main thread hands them to their views.  The
+ *	views are retained while they are in the table, which only exists
+ *	while something is pending.
+ */
+static NSMapTable	*pendingInvalidations = 0;
+static NSLock		*pendingLock = nil;
+
+/*
+ *	The geometry of views in a live resize, which the rectangles they
+ *	preserve are worked out against.  Views only have an entry from the
+ *	start to the end of a live resize, so the table is empty otherwise.
+ *	Live resizing is done in the main thread, so there is no lock.
+ */
+typedef struct {
+  NSRect	bounds;
+  NSPoint	origin;
+  NSRect	frame;
+} GSLiveResizeState;
+
+static NSMapTable	*liveResizeStates = 0;
+
+static GSLiveResizeState*
+GSGetLiveResizeState(NSView *obj, BOOL create)
+{
+  GSLiveResizeState	*state;
+
+  state = (GSLiveResizeState*)NSMapGet(liveResizeStates, (void*)obj);
+  if (state == 0 && create == YES)
+    {
+      state = NSZoneMalloc(NSDefaultMallocZone(), sizeof(GSLiveResizeState));
+      NSMapInsert(liveResizeStates, (void*)obj, (void*)state);
+    }
+  return state;
+}
+
 /*
  * This is the only external interface to the drag types info.
  */
@@ -543,6 +580,9 @@ GSSetDragTypes(NSView* obj, NSArray *types)
       typesMap = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
                 NSObjectMapValueCallBacks, 0);
       typesLock = [NSLock new];
+      pendingLock = [NSLock new];
+      liveResizeStates = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+                NSOwnedPointerMapValueCallBacks, 0);
 
       preSel = @selector(prependTransform:);
       invalidateSel = @selector(_invalidateCoordinates);
@@ -760,6 +800,10 @@ GSSetDragTypes(NSView* obj, NSArray *types)
     }
   TEST_RELEASE(_cursor_rects);
   TEST_RELEASE(_tracking_rects);
+  if (NSCountMapTable(liveResizeStates) > 0)
+    {
+      NSMapRemove(liveResizeStates, (void*)self);
+    }
   [self unregisterDraggedTypes];
   [self releaseGState];
 
@@ -2351,8 +2395,29 @@ static void autoresize(CGFloat oldContainerSize,
 {
 }
 
+/* A view drawing outside of the display machinery changes pixels that
+ * were never marked as needing display, so ancestors keeping copies of
+ * them have to drop these.  The view itself is left alone, as a view
+ * caching its drawing locks focus to fill and use its own cache.
+ */
+static void
+GSDiscardAncestorDrawingCaches(NSView *view)
+{
+  NSView	*currentView = view->_super_view;
+
+  while (currentView != nil)
+    {
+      if (currentView->_rFlags.caches_drawing)
+        {
+          [currentView _discardDrawingCache];
+        }
+      currentView = currentView->_super_view;
+    }
+}
+
 - (void) lockFocusInRect: (NSRect)rect
 {
+  GSDiscardAncestorDrawingCaches(self);
   [self _lockFocusInContext: nil inRect: rect];
 }
 
@@ -2375,6 +2440,7 @@ static void autoresize(CGFloat oldContainerSize,
 {
   if ([self canDraw])
     {
+      GSDiscardAncestorDrawingCaches(self);
       [self _lockFocusInContext: context inRect: [self visibleRect]];
       return YES;
     }
@@ -2530,6 +2596,7 @@ static void autoresize(CGFloat oldContainerSize,
  */
 - (void) displayRect: (NSRect)aRect
 {
+  GSDiscardAncestorDrawingCaches(self);
   if ([self isOpaque] == YES)
     {
       [self displayRectIgnoringOpacity: aRect];
@@ -2766,6 +2833,43 @@ static void autoresize(CGFloat oldContainerSize,
 
 extern NSThread *GSAppKitThread; /* TODO */
 
+/* May be called from any thread.  Only the first rectangle added to an
+ * empty table wakes the main thread up, however many follow.
+ */
+static void
+GSAddPendingInvalidation(NSView *view, NSRect rect)
+{
+  NSRect	*pending;
+  BOOL		schedule = NO;
+
+  [pendingLock lock];
+  if (pendingInvalidations == 0)
+    {
+      pendingInvalidations = NSCreateMapTable(NSNonOwnedPointerMapKeyCallBacks,
+        NSNonOwnedPointerMapValueCallBacks, 0);
+      schedule = YES;
+    }
+  pending = (NSRect*)NSMapGet(pendingInvalidations, view);
+  if (pending != NULL)
+    {
+      *pending = NSUnionRect(*pending, rect);
+    }
+  else
+    {
+      pending = malloc(sizeof(NSRect));
+      *pending = rect;
+      NSMapInsert(pendingInvalidations, RETAIN(view), pending);
+    }
+  [pendingLock unlock];
+
+  if (schedule)
+    {
+      [NSView performSelectorOnMainThread: @selector(_flushPendingInvalidations)
+                               withObject: nil
+                            waitUntilDone: NO];
+    }
+}
+
 /*
 For -setNeedsDisplay*, the real work is done in the ..._real methods, and
 the actual public method simply calls it, but makes sure that the call is
@@ -2796,28 +2900,45 @@ in the main thread.
  */
 - (void) setNeedsDisplay: (BOOL)flag
 {
-  NSNumber *n = [[NSNumber alloc] initWithBool: flag];
   if (GSCurrentThread() != GSAppKitThread)
     {
       NSDebugMLLog (@"MacOSXCompatibility", 
                     @"setNeedsDisplay: called on secondary thread");
-      [self performSelectorOnMainThread: @selector(_setNeedsDisplay_real:)
-            withObject: n
-            waitUntilDone: NO];
+      if (flag)
+        {
+          GSAddPendingInvalidation(self, _bounds);
+        }
+      else
+        {
+          NSNumber *n = [[NSNumber alloc] initWithBool: flag];
+
+          [self performSelectorOnMainThread: @selector(_setNeedsDisplay_real:)
+                withObject: n
+                waitUntilDone: NO];
+          DESTROY(n);
+        }
+    }
+  else if (flag)
+    {
+      [self setNeedsDisplayInRect: _bounds];
     }
   else
     {
-      [self _setNeedsDisplay_real: n];
+      _rFlags.needs_display = NO;
+      _invalidRect = NSZeroRect;
     }
-  DESTROY(n);
 }
 
 
-- (void) _setNeedsDisplayInRect_real: (NSValue *)v
+- (void) _invalidateRect: (NSRect)invalidRect
 {
-  NSRect invalidRect = [v rectValue];
   NSView *currentView = _super_view;
 
+  if (_rFlags.caches_drawing)
+    {
+      [self _discardDrawingCache];
+    }
+
   /*
    *	Limit to bounds, combine with old _invalidRect, and then check to see
    *	if the result is the same as the old _invalidRect - if it isn't then
@@ -2857,12 +2978,21 @@ in the main thread.
   while (currentView)
     {
       currentView->_rFlags.needs_display = YES;
+      if (currentView->_rFlags.caches_drawing)
+        {
+          [currentView _discardDrawingCache];
+        }
       currentView = currentView->_super_view;
     }
   // Also mark the window, as this may not happen above
   [_window setViewsNeedDisplay: YES];
 }
 
+- (void) _setNeedsDisplayInRect_real: (NSValue *)v
+{
+  [self _invalidateRect: [v rectValue]];
+}
+
 /**
  * Inform the view system that the specified rectangle is invalid and
  * requires updating.  This automatically informs any superviews of
@@ -2873,31 +3003,24 @@ in the main thread.
  * will always be done in the main thread. (Note that other methods are
  * in general not thread-safe; if you want to access other properties of
  * views from multiple threads, you need to provide the synchronization.)
+ * Rectangles invalidated from other threads are joined per view and
+ * handed over to the main thread once per run loop pass.
  */
 - (void) setNeedsDisplayInRect: (NSRect)invalidRect
 {
-  NSValue *v;
-
   if (NSIsEmptyRect(invalidRect))
     return; // avoid unnecessary work when rectangle is empty
-	
-  v = [[NSValue alloc]
-		 initWithBytes: &invalidRect
-		 objCType: @encode(NSRect)];
 
   if (GSCurrentThread() != GSAppKitThread)
     {
       NSDebugMLLog (@"MacOSXCompatibility", 
                     @"setNeedsDisplayInRect: called on secondary thread");
-      [self performSelectorOnMainThread: @selector(_setNeedsDisplayInRect_real:)
-            withObject: v
-            waitUntilDone: NO];
+      GSAddPendingInvalidation(self, invalidRect);
     }
   else
     {
-      [self _setNeedsDisplayInRect_real: v];
+      [self _invalidateRect: invalidRect];
     }
-  DESTROY(v);
 }
 
 + (NSFocusRingType) defaultFocusRingType
@@ -3003,13 +3126,11 @@ in the main thread.
 
 - (void) viewWillStartLiveResize
 {
-  // FIXME
   _in_live_resize = YES; 
 }
 
 - (void) viewDidEndLiveResize
 {
-  // FIXME
   _in_live_resize = NO; 
 }
 
@@ -3020,17 +3141,52 @@ in the main thread.
 
 - (void) getRectsExposedDuringLiveResize: (NSRect[4])exposedRects count: (NSInteger *)count
 {
-  // FIXME
+  NSRect kept = [self rectPreservedDuringLiveResize];
+  NSInteger n = 0;
+
+  if (NSIsEmptyRect(kept))
+    {
+      exposedRects[n++] = _bounds;
+    }
+  else
+    {
+      /* The preserved rectangle shares its origin with the bounds, so
+       * at most a strip on the right and one at the far end of the y
+       * axis are new.  */
+      if (NSMaxX(_bounds) > NSMaxX(kept))
+        {
+          exposedRects[n++] = NSMakeRect(NSMaxX(kept), NSMinY(_bounds),
+                                         NSMaxX(_bounds) - NSMaxX(kept),
+                                         NSHeight(_bounds));
+        }
+      if (NSMaxY(_bounds) > NSMaxY(kept))
+        {
+          exposedRects[n++] = NSMakeRect(NSMinX(_bounds), NSMaxY(kept),
+                                         NSWidth(kept),
+                                         NSMaxY(_bounds) - NSMaxY(kept));
+        }
+    }
   if (count != NULL)
     {
-      *count = 1;
+      *count = n;
     }
-  exposedRects[0] = _bounds;
 }
 
 - (NSRect) rectPreservedDuringLiveResize
 {
-  return NSZeroRect;
+  GSLiveResizeState	*state;
+
+  if (_in_live_resize == NO
+    || _is_rotated_or_scaled_from_base
+    || (state = GSGetLiveResizeState(self, NO)) == 0
+    || [self preservesContentDuringLiveResize] == NO
+    || [_window preservesContentDuringLiveResize] == NO
+    || NSEqualPoints(_bounds.origin, state->bounds.origin) == NO
+    || NSEqualPoints([self _liveResizeOrigin], state->origin) == NO)
+    {
+      return NSZeroRect;
+    }
+  return NSIntersectionRect(_bounds, state->bounds);
 }
 
 /*
@@ -5133,6 +5289,175 @@ static NSView* findByTag(NSView *view, NSInteger aTag, NSUInteger *level)
 
 @implementation NSView (__NSViewPrivateMethods__)
 
+/*
+ * Hands the rectangles marked as needing display by secondary threads
+ * to their views.  Called in the main thread.
+ */
++ (void) _flushPendingInvalidations
+{
+  NSMapTable		*table;
+  NSMapEnumerator	e;
+  NSView		*view;
+  NSRect		*rect;
+
+  if (pendingInvalidations == 0)
+    {
+      return;
+    }
+  [pendingLock lock];
+  table = pendingInvalidations;
+  pendingInvalidations = 0;
+  [pendingLock unlock];
+  if (table == 0)
+    {
+      return;
+    }
+
+  e = NSEnumerateMapTable(table);
+  while (NSNextMapEnumeratorPair(&e, (void**)&view, (void**)&rect))
+    {
+      [view setNeedsDisplayInRect: *rect];
+      RELEASE(view);
+      free(rect);
+    }
+  NSEndMapTableEnumeration(&e);
+  NSFreeMapTable(table);
+}
+
+/*
+ * Called when the view or one of its subviews is marked as needing
+ * display, and when one of its subviews draws directly with -lockFocus
+ * or -displayRect:, for views setting the caches_drawing flag.
+ */
+- (void) _discardDrawingCache
+{
+}
+
+/*
+ * The position of the bounds origin relative to the top left corner of
+ * the window, which is the corner that stays in place while the window
+ * is live resized.  The content of a view can only be preserved while
+ * this position does not change.
+ */
+- (NSPoint) _liveResizeOrigin
+{
+  NSPoint p;
+
+  if (_window == nil)
+    {
+      return _bounds.origin;
+    }
+  p = [self convertPoint: _bounds.origin toView: nil];
+  p.y = NSHeight([_window frame]) - p.y;
+  return p;
+}
+
+/*
+ * The bounds recorded by the last -_saveLiveResizeState, or the current
+ * bounds when the view is not in a live resize.
+ */
+- (NSRect) _liveResizeBounds
+{
+  GSLiveResizeState	*state = GSGetLiveResizeState(self, NO);
+
+  return (state == 0) ? _bounds : state->bounds;
+}
+
+/*
+ * Records the geometry the exposed rectangles of the next live resize
+ * step are computed against.  Called by the window before it changes
+ * its frame.
+ */
+- (void) _saveLiveResizeState
+{
+  if (_in_live_resize)
+    {
+      GSLiveResizeState	*state = GSGetLiveResizeState(self, YES);
+
+      state->bounds = _bounds;
+      state->origin = [self _liveResizeOrigin];
+      state->frame = _frame;
+    }
+  if (_rFlags.has_subviews)
+    {
+      [_sub_views makeObjectsPerformSelector: @selector(_saveLiveResizeState)];
+    }
+}
+
+- (void) _viewWillStartLiveResize
+{
+  GSLiveResizeState	*state = GSGetLiveResizeState(self, YES);
+
+  state->bounds = _bounds;
+  state->origin = [self _liveResizeOrigin];
+  state->frame = _frame;
+  _in_live_resize = YES;
+  [self viewWillStartLiveResize];
+  if (_rFlags.has_subviews)
+    {
+      [_sub_views makeObjectsPerformSelector:
+        @selector(_viewWillStartLiveResize)];
+    }
+}
+
+- (void) _viewDidEndLiveResize
+{
+  /* Clear the flag first, so that a view redrawn from its
+   * -viewDidEndLiveResize no longer draws its placeholder.  */
+  _in_live_resize = NO;
+  NSMapRemove(liveResizeStates, (void*)self);
+  [self viewDidEndLiveResize];
+  if (_rFlags.has_subviews)
+    {
+      [_sub_views makeObjectsPerformSelector: @selector(_viewDidEndLiveResize)];
+    }
+}
+
+/*
+ * Marks what has to be redrawn after a live resize step.  Views which
+ * do not preserve their content are redrawn completely, including their
+ * subviews, otherwise only the exposed rectangles are marked, and the
+ * old and new places of subviews moved or resized by autoresizing.
+ */
+- (void) _setNeedsDisplayForLiveResize
+{
+  if ([self preservesContentDuringLiveResize]
+    && [_window preservesContentDuringLiveResize])
+    {
+      NSRect exposed[4];
+      NSInteger count;
+      NSInteger i;
+
+      [self getRectsExposedDuringLiveResize: exposed count: &count];
+      for (i = 0; i < count; i++)
+        {
+          [self setNeedsDisplayInRect: exposed[i]];
+        }
+      if (_rFlags.has_subviews)
+        {
+          NSEnumerator	*e = [_sub_views objectEnumerator];
+          NSView	*sub;
+
+          while ((sub = [e nextObject]) != nil)
+            {
+              GSLiveResizeState	*state = GSGetLiveResizeState(sub, NO);
+
+              if (state != 0 && NSEqualRects(state->frame, sub->_frame) == NO)
+                {
+                  [self setNeedsDisplayInRect:
+                    NSUnionRect(state->frame, sub->_frame)];
+                }
+            }
+          [_sub_views makeObjectsPerformSelector:
+            @selector(_setNeedsDisplayForLiveResize)];
+        }
+    }
+  else
+    {
+      [self setNeedsDisplay: YES];
+    }
+}
+
 /*
  * This method inserts a view at a given place in the view hierarchy.
  */
@@ -35,7 +35,15 @@
 @end
 
 @interface NSView (__NSViewPrivateMethods__)
++ (void) _flushPendingInvalidations;
 - (void) _insertSubview: (NSView *)sv atIndex: (NSUInteger)idx;
+- (void) _discardDrawingCache;
+- (NSPoint) _liveResizeOrigin;
+- (NSRect) _liveResizeBounds;
+- (void) _saveLiveResizeState;
+- (void) _viewWillStartLiveResize;
+- (void) _viewDidEndLiveResize;
+- (void) _setNeedsDisplayForLiveResize;
 @end
 
 #endif // _GNUstep_H_NSViewPrivate
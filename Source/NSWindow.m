@@ -168,10 +168,75 @@ static GSWindowAnimationDelegate *animationDelegate;
 - (NSView *) _windowView;
 - (NSView *) _borderView;
 - (NSScreen *) _screenForFrame: (NSRect)frame;
+- (BOOL) _wantsPeriodicDraggingUpdates;
+- (void) _startLiveResize;
+- (void) _endLiveResize;
 @end
 
 @implementation NSWindow (GNUstepPrivate)
 
+/* Whether the view the current drag is over wants dragging updates
+ * even when nothing has changed.  As in Cocoa, destinations that do not
+ * implement -wantsPeriodicDraggingUpdates get them.
+ */
+- (BOOL) _wantsPeriodicDraggingUpdates
+{
+  id target = _lastDragView;
+
+  if (target == nil || !_f.accepts_drag)
+    {
+      return NO;
+    }
+  if (target == _wv)
+    {
+      if (_delegate != nil
+        && [_delegate respondsToSelector: @selector(draggingUpdated:)])
+        {
+          target = _delegate;
+        }
+      else
+        {
+          target = self;
+        }
+    }
+  if ([target respondsToSelector: @selector(wantsPeriodicDraggingUpdates)])
+    {
+      return [target wantsPeriodicDraggingUpdates];
+    }
+  return YES;
+}
+
+/*
+ * Live resize sessions are started and ended by whoever tracks the
+ * mouse while the user resizes the window.  In between, every frame
+ * change only marks the areas of the views that need to be redrawn, see
+ * -[NSView preservesContentDuringLiveResize].
+ */
+- (void) _startLiveResize
+{
+  if (_f.in_live_resize)
+    {
+      return;
+    }
+  _f.in_live_resize = YES;
+  [nc postNotificationName: NSWindowWillStartLiveResizeNotification
+                    object: self];
+  [_wv _viewWillStartLiveResize];
+}
+
+- (void) _endLiveResize
+{
+  if (!_f.in_live_resize)
+    {
+      return;
+    }
+  _f.in_live_resize = NO;
+  [_wv _viewDidEndLiveResize];
+  [nc postNotificationName: NSWindowDidEndLiveResizeNotification
+                    object: self];
+  [self displayIfNeeded];
+}
+
 + (void) _setToolTipVisible: (GSToolTips*)t
 {
   toolTipVisible = t;
@@ -185,6 +250,7 @@ static GSWindowAnimationDelegate *animationDelegate;
 /* Window autodisplay machinery. */
 - (void) _handleAutodisplay
 {
+  [NSView _flushPendingInvalidations];
   if (_f.is_autodisplay && _f.views_need_display)
     {
       [self disableFlushWindow];
@@ -2128,6 +2194,11 @@ titleWithRepresentedFilename(NSString *representedFilename)
   _f.preserves_content_during_live_resize = flag;
 }
 
+- (BOOL) inLiveResize
+{
+  return _f.in_live_resize;
+}
+
 - (void) setFrame: (NSRect)frameRect
           display: (BOOL)displayFlag
           animate: (BOOL)animationFlag
@@ -2342,9 +2413,17 @@ titleWithRepresentedFilename(NSString *representedFilename)
     }
   else
     {
+      if (_f.in_live_resize)
+        {
+          [_wv _saveLiveResizeState];
+        }
       _frame = frameRect;
       frameRect.origin = NSZeroPoint;
       [_wv setFrame: frameRect];
+      if (_f.in_live_resize)
+        {
+          [_wv _setNeedsDisplayForLiveResize];
+        }
     }
 }
 
@@ -2394,7 +2473,14 @@ titleWithRepresentedFilename(NSString *representedFilename)
 
   if (flag)
     {
-      [self display];
+      if (_f.in_live_resize)
+        {
+          [self displayIfNeeded];
+        }
+      else
+        {
+          [self display];
+        }
     }
 }
 
@@ -4394,10 +4480,21 @@ checkCursorRectanglesExited(NSView *theView,  NSEvent *theEvent, NSPoint lastPoi
                 /* FIXME: For a user resize we should call windowWillResize:toSize:
                    on the delegate.
                  */
+                if (_f.in_live_resize)
+                  {
+                    [_wv _saveLiveResizeState];
+                  }
                 _frame = newFrame;
                 newFrame.origin = NSZeroPoint;
                 [_wv setFrame: newFrame];
-                [_wv setNeedsDisplay: YES];
+                if (_f.in_live_resize)
+                  {
+                    [_wv _setNeedsDisplayForLiveResize];
+                  }
+                else
+                  {
+                    [_wv setNeedsDisplay: YES];
+                  }
 
                 if (_autosaveName != nil)
                   {
@@ -6126,6 +6223,7 @@ current key view.<br />
   _f.is_opaque = YES;
   _f.views_need_display = YES;
   _f.selectionDirection = NSDirectSelection;
+  _f.preserves_content_during_live_resize = YES;
 }
 
 @end
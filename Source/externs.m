@@ -512,6 +512,8 @@ NSString *NSWindowWillBeginSheetNotification = @"NSWindowWillBeginSheetNotificat
 NSString *NSWindowWillCloseNotification = @"NSWindowWillCloseNotification";
 NSString *NSWindowWillMiniaturizeNotification = @"NSWindowWillMiniaturizeNotification";
 NSString *NSWindowWillMoveNotification = @"NSWindowWillMoveNotification";
+NSString *NSWindowWillStartLiveResizeNotification = @"NSWindowWillStartLiveResizeNotification";
+NSString *NSWindowDidEndLiveResizeNotification = @"NSWindowDidEndLiveResizeNotification";
 
 // Workspace File Type Globals
 NSString *NSPlainFileType = @"NSPlainFileType";
@@ -0,0 +1,84 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSThread.h>
+#include <AppKit/NSAnimation.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSProgressIndicator.h>
+#include <GNUstepGUI/GSAnimator.h>
+
+@interface BlockingRunner : NSObject
+{
+@public
+  volatile BOOL done;
+}
+- (void) run: (id)arg;
+@end
+
+@implementation BlockingRunner
+- (void) run: (id)arg
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  NSAnimation *animation;
+
+  animation = [[NSAnimation alloc] initWithDuration: 0.2
+                                     animationCurve: NSAnimationLinear];
+  [animation setAnimationBlockingMode: NSAnimationBlocking];
+  [animation startAnimation];
+  RELEASE(animation);
+  done = YES;
+  [pool drain];
+}
+@end
+
+int main(int argc, char **argv)
+{
+  GSAnimationClock *clock;
+  NSProgressIndicator *indicator;
+  BlockingRunner *runner;
+  int i;
+
+  START_SET("NSAnimation animation clock")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  clock = [GSAnimationClock sharedClock];
+
+  indicator = [[NSProgressIndicator alloc]
+                initWithFrame: NSMakeRect(0, 0, 100, 20)];
+  [indicator startAnimation: nil];
+  pass([clock isRunning], "running indicator uses the clock");
+  [indicator setIndeterminate: NO];
+  RELEASE(indicator);
+  pass(![clock isRunning],
+       "deallocated determinate indicator is removed from the clock");
+
+  /* The main thread does not run its run loop while it waits, so the
+   * blocking animation has to tick in the loop of its own thread.
+   */
+  runner = [BlockingRunner new];
+  [NSThread detachNewThreadSelector: @selector(run:)
+                           toTarget: runner
+                         withObject: nil];
+  for (i = 0; i < 50 && !runner->done; i++)
+    {
+      [NSThread sleepForTimeInterval: 0.1];
+    }
+  pass(runner->done,
+       "blocking animation on another thread ends while the main thread waits");
+
+  DESTROY(arp);
+  END_SET("NSAnimation animation clock")
+
+  return 0;
+}
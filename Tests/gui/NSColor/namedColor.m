@@ -0,0 +1,44 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <AppKit/NSColor.h>
+#import <AppKit/NSColorList.h>
+
+int main()
+{
+  NSAutoreleasePool *arp = [NSAutoreleasePool new];
+  NSColorList *list;
+  NSColor *old;
+  NSColor *a;
+  NSColor *b;
+
+  a = [NSColor colorWithCatalogName: @"System" colorName: @"controlColor"];
+  b = [NSColor colorWithCatalogName: @"System" colorName: @"controlColor"];
+  pass(a != nil && a == b, "named colours are interned");
+
+  list = [NSColorList colorListNamed: @"System"];
+  if ([list isEditable])
+    {
+      old = [[list colorWithKey: @"controlColor"] retain];
+      [list setColor: [NSColor colorWithCalibratedRed: 1.0
+                                                green: 0.0
+                                                 blue: 0.0
+                                                alpha: 1.0]
+              forKey: @"controlColor"];
+      pass([[a colorUsingColorSpaceName: NSCalibratedRGBColorSpace]
+        redComponent] == 1.0, "named colour resolves to the new colour");
+
+      [list setColor: [NSColor colorWithCalibratedRed: 0.0
+                                                green: 0.0
+                                                 blue: 1.0
+                                                alpha: 1.0]
+              forKey: @"controlColor"];
+      pass([[a colorUsingColorSpaceName: NSCalibratedRGBColorSpace]
+        blueComponent] == 1.0, "changing the list invalidates the cache");
+
+      [list setColor: old forKey: @"controlColor"];
+      [old release];
+    }
+
+  [arp release];
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSArray.h>
+
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSComboBoxCell.h>
+
+int main()
+{
+  CREATE_AUTORELEASE_POOL(arp);
+  NSComboBoxCell *cell;
+
+  START_SET("NSComboBoxCell GNUstep itemIndex")
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  cell = [[NSComboBoxCell alloc] initTextCell: @""];
+  [cell addItemsWithObjectValues: [NSArray arrayWithObjects:
+    @"Norway", @"Nepal", @"Netherlands", @"New Zealand", @"Niger",
+    @"Nigeria", @"Namibia", @"Nauru", @"Nicaragua", @"North Korea",
+    @"North Macedonia", @"Niue", @"Norfolk Island", @"Panama",
+    @"Paraguay", @"Peru", @"Nepal", nil]];
+
+  pass([[cell completedString: @"Ne"] isEqual: @"Nepal"],
+       "completion returns the first matching item of the list");
+  pass([[cell completedString: @"Nor"] isEqual: @"Norway"],
+       "completion ignores later matching items");
+  pass([[cell completedString: @"Panama"] isEqual: @"Panama"],
+       "completion of a whole item returns the string itself");
+  pass([[cell completedString: @"X"] isEqual: @"X"],
+       "completion without a match returns the string itself");
+  pass([cell indexOfItemWithObjectValue: @"Nepal"] == 1,
+       "the lowest index of a value is found");
+  pass([cell indexOfItemWithObjectValue: @"Chad"] == NSNotFound,
+       "missing values are not found");
+
+  [cell addItemWithObjectValue: @"Nablus"];
+  pass([[cell completedString: @"Nab"] isEqual: @"Nablus"],
+       "added items are completed");
+  pass([cell indexOfItemWithObjectValue: @"Nablus"] == 17,
+       "added items are found");
+
+  [cell insertItemWithObjectValue: @"Nepalese" atIndex: 0];
+  pass([[cell completedString: @"Nep"] isEqual: @"Nepalese"],
+       "inserted items are completed in list order");
+  pass([cell indexOfItemWithObjectValue: @"Nepal"] == 2,
+       "indexes follow insertions");
+
+  [cell removeItemAtIndex: 0];
+  pass([[cell completedString: @"Nep"] isEqual: @"Nepal"],
+       "removed items are not completed");
+
+  [cell removeItemWithObjectValue: @"Nepal"];
+  pass([cell indexOfItemWithObjectValue: @"Nepal"] == NSNotFound,
+       "all items equal to a removed value are gone");
+  pass([cell indexOfItemWithObjectValue: @"Norway"] == 0,
+       "indexes follow removals");
+
+  /* Replace an item behind the back of the cell, keeping the count. */
+  [(NSMutableArray *)[cell objectValues] replaceObjectAtIndex: 0
+                                                   withObject: @"Oman"];
+  [cell noteNumberOfItemsChanged];
+  pass([cell indexOfItemWithObjectValue: @"Oman"] == 0
+    && [cell indexOfItemWithObjectValue: @"Norway"] == NSNotFound,
+       "the index is rebuilt after the list changed in place");
+  [(NSMutableArray *)[cell objectValues] replaceObjectAtIndex: 0
+                                                   withObject: @"Qatar"];
+  [cell reloadData];
+  pass([[cell completedString: @"Qa"] isEqual: @"Qatar"],
+       "the index is rebuilt when the data is reloaded");
+
+  [cell release];
+
+  END_SET("NSComboBoxCell GNUstep itemIndex")
+
+  DESTROY(arp);
+  return 0;
+}
@@ -0,0 +1,139 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSData.h>
+#import <Foundation/NSDate.h>
+#import <Foundation/NSFileManager.h>
+#import <Foundation/NSFileWrapper.h>
+#import <Foundation/NSPathUtilities.h>
+#import <Foundation/NSRunLoop.h>
+#import <Foundation/NSURL.h>
+#import <AppKit/NSApplication.h>
+#import <AppKit/NSDocument.h>
+
+/* A document of a native type which only provides its contents, so it
+ * is autosaved in the background.
+ */
+@interface TestDocument : NSDocument
+@end
+
+@implementation TestDocument
++ (BOOL) isNativeType: (NSString *)type
+{
+  return YES;
+}
+
+- (NSFileWrapper *) fileWrapperOfType: (NSString *)type
+                                error: (NSError **)error
+{
+  NSData *data = [@"contents" dataUsingEncoding: NSUTF8StringEncoding];
+
+  return AUTORELEASE([[NSFileWrapper alloc]
+                       initRegularFileWithContents: data]);
+}
+@end
+
+/* Remembers the outcome of each autosave by its context. */
+@interface AutosaveDelegate : NSObject
+{
+@public
+  int calls[2];
+  BOOL saved[2];
+}
+- (void) document: (NSDocument *)doc
+      didAutosave: (BOOL)didAutosave
+      contextInfo: (void *)context;
+@end
+
+@implementation AutosaveDelegate
+- (void) document: (NSDocument *)doc
+      didAutosave: (BOOL)didAutosave
+      contextInfo: (void *)context
+{
+  int i = (context == NULL) ? 0 : 1;
+
+  calls[i]++;
+  saved[i] = didAutosave;
+}
+@end
+
+int
+main(int argc, char **argv)
+{
+  TestDocument *doc;
+  AutosaveDelegate *delegate;
+  NSString *path;
+  SEL sel = @selector(document:didAutosave:contextInfo:);
+  int i;
+
+  START_SET("NSDocument background autosave")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  path = [NSTemporaryDirectory()
+           stringByAppendingPathComponent: @"backgroundAutosave.test"];
+  [[NSFileManager defaultManager] removeFileAtPath: path handler: nil];
+
+  doc = [TestDocument new];
+  delegate = [AutosaveDelegate new];
+  [doc setFileType: @"TestType"];
+  [doc setAutosavedContentsFileURL: [NSURL fileURLWithPath: path]];
+  pass([doc canAsynchronouslyWriteToURL: [doc autosavedContentsFileURL]
+                                 ofType: @"TestType"
+                       forSaveOperation: NSAutosaveOperation],
+       "the document can be autosaved in the background");
+
+  [doc autosaveDocumentWithDelegate: delegate
+                didAutosaveSelector: sel
+                        contextInfo: NULL];
+  [doc autosaveDocumentWithDelegate: delegate
+                didAutosaveSelector: sel
+                        contextInfo: (void *)delegate];
+  pass(delegate->calls[0] == 0,
+       "the first autosave finishes later");
+  pass(delegate->calls[1] == 1 && delegate->saved[1] == NO,
+       "an autosave asked for while one is in flight is refused at once");
+
+  for (i = 0; i < 50 && delegate->calls[0] == 0; i++)
+    {
+      [[NSRunLoop currentRunLoop]
+        runMode: NSDefaultRunLoopMode
+        beforeDate: [NSDate dateWithTimeIntervalSinceNow: 0.1]];
+    }
+  pass(delegate->calls[0] == 1 && delegate->saved[0] == YES,
+       "the first autosave reports success");
+  pass([[NSData dataWithContentsOfFile: path] isEqual:
+    [@"contents" dataUsingEncoding: NSUTF8StringEncoding]],
+       "the autosave file holds the contents");
+  pass(delegate->calls[1] == 1, "the refused autosave is reported once");
+
+  [doc autosaveDocumentWithDelegate: delegate
+                didAutosaveSelector: sel
+                        contextInfo: (void *)delegate];
+  for (i = 0; i < 50 && delegate->calls[1] == 1; i++)
+    {
+      [[NSRunLoop currentRunLoop]
+        runMode: NSDefaultRunLoopMode
+        beforeDate: [NSDate dateWithTimeIntervalSinceNow: 0.1]];
+    }
+  pass(delegate->calls[1] == 2 && delegate->saved[1] == YES,
+       "an autosave after the first one finished is made");
+
+  [doc setAutosavedContentsFileURL: nil];
+  [[NSFileManager defaultManager] removeFileAtPath: path handler: nil];
+  DESTROY(delegate);
+  DESTROY(doc);
+  DESTROY(arp);
+  END_SET("NSDocument background autosave")
+
+  return 0;
+}
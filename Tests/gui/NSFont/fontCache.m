@@ -0,0 +1,59 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSValue.h>
+#import <AppKit/NSApplication.h>
+#import <AppKit/NSFont.h>
+
+static NSUInteger
+counter(NSString *key)
+{
+  return [[[NSFont fontCacheStatistics] objectForKey: key]
+    unsignedIntegerValue];
+}
+
+int
+main(int argc, char **argv)
+{
+  NSAutoreleasePool *pool;
+  NSFont *font;
+  NSUInteger creations;
+  NSUInteger hits;
+
+  START_SET("NSFont font cache")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  pool = [NSAutoreleasePool new];
+  font = [NSFont userFontOfSize: 13.5];
+  pass(font == [NSFont userFontOfSize: 13.5], "equal fonts are shared");
+  [pool release];
+
+  creations = counter(@"FontInfoCreations");
+  hits = counter(@"Hits");
+  pool = [NSAutoreleasePool new];
+  font = [NSFont userFontOfSize: 13.5];
+  [pool release];
+  pass(counter(@"FontInfoCreations") == creations,
+       "a released font is reused from the cache");
+  pass(counter(@"Hits") > hits, "the reuse is counted as a hit");
+
+  [NSFont setFontCacheLimit: 0];
+  pass([NSFont fontCacheLimit] == 0, "cache limit can be changed");
+  [NSFont setFontCacheLimit: 64];
+
+  DESTROY(arp);
+  END_SET("NSFont font cache")
+
+  return 0;
+}
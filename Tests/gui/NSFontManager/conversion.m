@@ -0,0 +1,81 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSArray.h>
+#import <AppKit/NSApplication.h>
+#import <AppKit/NSFont.h>
+#import <AppKit/NSFontManager.h>
+
+/* Counts the weight lookups, which a conversion only makes when it is
+ * not known yet.
+ */
+@interface CountingFontManager : NSFontManager
+{
+@public
+  int lookups;
+}
+@end
+
+@implementation CountingFontManager
+- (int) weightOfFont: (NSFont*)fontObject
+{
+  lookups++;
+  return [super weightOfFont: fontObject];
+}
+@end
+
+int
+main(int argc, char **argv)
+{
+  CountingFontManager *fm;
+  NSFont *font;
+  NSFont *bold;
+  NSArray *names;
+  int lookups;
+
+  START_SET("NSFontManager conversions")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  [NSFontManager setFontManagerFactory: [CountingFontManager class]];
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  fm = (CountingFontManager*)[NSFontManager sharedFontManager];
+  pass([fm isKindOfClass: [CountingFontManager class]],
+       "the font manager factory is used");
+  font = [NSFont userFontOfSize: 12];
+  font = [fm convertFont: font toNotHaveTrait: NSBoldFontMask];
+
+  bold = [fm convertFont: font toHaveTrait: NSBoldFontMask];
+  pass(bold != nil, "font can be converted to bold");
+  lookups = fm->lookups;
+  pass([fm convertFont: font toHaveTrait: NSBoldFontMask] == bold
+    && fm->lookups == lookups,
+       "repeated conversion gives the same font without looking it up");
+  bold = [fm convertWeight: YES ofFont: font];
+  lookups = fm->lookups;
+  pass([fm convertWeight: YES ofFont: font] == bold
+    && fm->lookups == lookups,
+       "repeated weight conversion gives the same font without looking it up");
+
+  pass([fm fontNamed: [font fontName] hasTraits: [fm traitsOfFont: font]],
+       "font has its own traits");
+  pass(![fm fontNamed: @"NoSuchFont-Anywhere" hasTraits: 0],
+       "unknown font has no traits");
+
+  names = [fm availableFontNamesWithTraits: NSBoldFontMask];
+  pass([names isEqual: [fm availableFontNamesWithTraits: NSBoldFontMask]],
+       "font names with traits are stable");
+
+  DESTROY(arp);
+  END_SET("NSFontManager conversions")
+
+  return 0;
+}
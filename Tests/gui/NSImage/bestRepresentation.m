@@ -0,0 +1,60 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSValue.h>
+#import <AppKit/NSBitmapImageRep.h>
+#import <AppKit/NSGraphics.h>
+#import <AppKit/NSImage.h>
+
+static NSBitmapImageRep *
+makeRep(NSInteger pixels, CGFloat points)
+{
+  NSBitmapImageRep *rep;
+
+  rep = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes: NULL
+                                                pixelsWide: pixels
+                                                pixelsHigh: pixels
+                                             bitsPerSample: 8
+                                           samplesPerPixel: 4
+                                                  hasAlpha: YES
+                                                  isPlanar: NO
+                                            colorSpaceName: NSCalibratedRGBColorSpace
+                                               bytesPerRow: 0
+                                              bitsPerPixel: 0];
+  [rep setSize: NSMakeSize(points, points)];
+  return [rep autorelease];
+}
+
+int main()
+{
+  NSAutoreleasePool *arp = [NSAutoreleasePool new];
+  NSDictionary *device;
+  NSImage *image;
+  NSBitmapImageRep *small, *large;
+  NSRect rect = NSMakeRect(0, 0, 32, 32);
+
+  device = [NSDictionary dictionaryWithObject:
+    [NSValue valueWithSize: NSMakeSize(72, 72)]
+                                       forKey: NSDeviceResolution];
+  small = makeRep(16, 16);
+  large = makeRep(64, 64);
+
+  image = [[NSImage alloc] initWithSize: NSMakeSize(64, 64)];
+  [image addRepresentation: small];
+  pass([image bestRepresentationForRect: rect context: nil hints: device]
+    == small, "only representation is chosen");
+  pass([image bestRepresentationForRect: rect context: nil hints: device]
+    == small, "repeated lookup returns the same representation");
+
+  [image addRepresentation: large];
+  pass([image bestRepresentationForRect: rect context: nil hints: device]
+    == large, "adding a representation updates the choice");
+
+  [image removeRepresentation: large];
+  pass([image bestRepresentationForRect: rect context: nil hints: device]
+    == small, "removing a representation updates the choice");
+
+  [image release];
+  [arp release];
+  return 0;
+}
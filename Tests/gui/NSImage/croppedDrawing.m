@@ -0,0 +1,103 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSBitmapImageRep.h>
+#include <AppKit/NSGraphics.h>
+#include <AppKit/NSGraphicsContext.h>
+#include <AppKit/NSImage.h>
+
+static NSBitmapImageRep *
+makeRep(NSInteger pixels)
+{
+  NSBitmapImageRep *rep;
+
+  rep = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes: NULL
+                                                pixelsWide: pixels
+                                                pixelsHigh: pixels
+                                             bitsPerSample: 8
+                                           samplesPerPixel: 4
+                                                  hasAlpha: YES
+                                                  isPlanar: NO
+                                            colorSpaceName: NSCalibratedRGBColorSpace
+                                               bytesPerRow: 0
+                                              bitsPerPixel: 0];
+  return [rep autorelease];
+}
+
+/* Grey level of the pixel at x in the first row of a bitmap. */
+static NSInteger
+grey(NSBitmapImageRep *rep, NSInteger x)
+{
+  return [rep bitmapData][4 * x];
+}
+
+int main(int argc, char **argv)
+{
+  NSBitmapImageRep *stripes;
+  NSBitmapImageRep *dest;
+  NSGraphicsContext *ctxt;
+  NSImage *image;
+  unsigned char *data;
+  NSInteger x, y;
+
+  START_SET("NSImage cropped drawing")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  /* One pixel wide black and white stripes, which average to grey in
+   * any reduction of the bitmap.
+   */
+  stripes = makeRep(512);
+  data = [stripes bitmapData];
+  for (y = 0; y < 512; y++)
+    {
+      for (x = 0; x < 512; x++)
+        {
+          unsigned char *p = data + y * [stripes bytesPerRow] + 4 * x;
+
+          p[0] = p[1] = p[2] = (x % 2) ? 255 : 0;
+          p[3] = 255;
+        }
+    }
+  image = [[NSImage alloc] initWithSize: NSMakeSize(512, 512)];
+  [image addRepresentation: stripes];
+
+  dest = makeRep(64);
+  ctxt = [NSGraphicsContext graphicsContextWithBitmapImageRep: dest];
+  if (ctxt == nil)
+    SKIP("The backend cannot draw into bitmaps")
+
+  /* Draw 16 by 16 pixels of the image into 64 by 64, four pixels
+   * for each stripe.
+   */
+  [NSGraphicsContext saveGraphicsState];
+  [NSGraphicsContext setCurrentContext: ctxt];
+  [image drawInRect: NSMakeRect(0, 0, 64, 64)
+           fromRect: NSMakeRect(0, 0, 16, 16)
+          operation: NSCompositeCopy
+           fraction: 1.0
+     respectFlipped: NO
+              hints: nil];
+  [ctxt flushGraphics];
+  [NSGraphicsContext restoreGraphicsState];
+
+  pass(grey(dest, 2) < 64 && grey(dest, 6) > 192,
+       "cropped part of a large bitmap is drawn from its full pixels");
+
+  RELEASE(image);
+  DESTROY(arp);
+  END_SET("NSImage cropped drawing")
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSData.h>
+#include <Foundation/NSDate.h>
+#include <Foundation/NSDictionary.h>
+#include <Foundation/NSFileManager.h>
+#include <Foundation/NSPathUtilities.h>
+#include <Foundation/NSRunLoop.h>
+#include <Foundation/NSValue.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSBitmapImageRep.h>
+#include <AppKit/NSGraphics.h>
+#include <AppKit/NSImage.h>
+
+/* Writes a 64 by 64 RGBA TIFF file, which decodes to 16384 bytes. */
+static NSString *
+writeImage(NSString *name)
+{
+  NSString *path;
+  NSBitmapImageRep *rep;
+
+  path = [NSTemporaryDirectory() stringByAppendingPathComponent: name];
+  rep = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes: NULL
+                                                pixelsWide: 64
+                                                pixelsHigh: 64
+                                             bitsPerSample: 8
+                                           samplesPerPixel: 4
+                                                  hasAlpha: YES
+                                                  isPlanar: NO
+                                            colorSpaceName: NSCalibratedRGBColorSpace
+                                               bytesPerRow: 0
+                                              bitsPerPixel: 0];
+  [[rep TIFFRepresentation] writeToFile: path atomically: YES];
+  [rep release];
+  return path;
+}
+
+static NSUInteger
+cacheStat(NSString *key)
+{
+  return [[[NSImage decodedImageCacheStatistics] objectForKey: key]
+           unsignedIntegerValue];
+}
+
+int main(int argc, char **argv)
+{
+  NSString *pathA, *pathB, *pathC;
+  NSImage *a, *b, *c;
+  NSUInteger limit, resident, loads, evictions;
+
+  START_SET("NSImage decoded data cache")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  pathA = writeImage(@"decodedCacheA.tiff");
+  pathB = writeImage(@"decodedCacheB.tiff");
+  pathC = writeImage(@"decodedCacheC.tiff");
+
+  /* Ask any image loaded so far to purge itself, so that only the
+   * images of this test count against the limit.
+   */
+  limit = [NSImage decodedImageCacheLimit];
+  [NSImage setDecodedImageCacheLimit: 0];
+  [NSImage setDecodedImageCacheLimit: 40000];
+  pass([NSImage decodedImageCacheLimit] == 40000, "limit is set");
+  resident = cacheStat(@"BytesResident");
+
+  a = [[NSImage alloc] initByReferencingFile: pathA];
+  b = [[NSImage alloc] initByReferencingFile: pathB];
+  c = [[NSImage alloc] initByReferencingFile: pathC];
+  [a isValid];
+  [b isValid];
+  pass(cacheStat(@"BytesResident") - resident == 2 * 16384,
+       "decoded data of loaded images is counted");
+
+  loads = cacheStat(@"Loads");
+  evictions = cacheStat(@"Evictions");
+  [c isValid];
+  pass(cacheStat(@"Evictions") - evictions == 1,
+       "loading past the limit evicts the least recently used image");
+  pass(cacheStat(@"BytesResident") - resident == 3 * 16384,
+       "evicted image keeps its data until it is used again");
+
+  pass([[a representations] count] == 1
+    && cacheStat(@"Loads") - loads == 2,
+       "evicted image loads its file again when next used");
+  pass(cacheStat(@"Evictions") - evictions == 2,
+       "loading it again evicts the next least recently used image");
+
+  evictions = cacheStat(@"Evictions");
+  [NSImage setDecodedImageCacheLimit: 16384];
+  pass(cacheStat(@"Evictions") - evictions == 1,
+       "lowering the limit evicts down to the new limit");
+
+  [[NSRunLoop currentRunLoop]
+    runMode: NSDefaultRunLoopMode
+    beforeDate: [NSDate dateWithTimeIntervalSinceNow: 0.1]];
+  pass(cacheStat(@"BytesResident") == 16384,
+       "evicted images release their data once the main thread is idle");
+
+  [b release];
+  [a release];
+  [c release];
+  pass(cacheStat(@"BytesResident") == 0,
+       "deallocated images release their accounting");
+
+  [NSImage setDecodedImageCacheLimit: limit];
+  [[NSFileManager defaultManager] removeFileAtPath: pathA handler: nil];
+  [[NSFileManager defaultManager] removeFileAtPath: pathB handler: nil];
+  [[NSFileManager defaultManager] removeFileAtPath: pathC handler: nil];
+
+  DESTROY(arp);
+  END_SET("NSImage decoded data cache")
+
+  return 0;
+}
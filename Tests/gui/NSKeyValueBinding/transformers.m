@@ -0,0 +1,146 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSString.h>
+#import <Foundation/NSValueTransformer.h>
+#import <AppKit/NSKeyValueBinding.h>
+
+@interface Model : NSObject
+{
+  NSString *name;
+}
+- (NSString *) name;
+- (void) setName: (NSString *)aName;
+@end
+
+@implementation Model
+- (void) dealloc
+{
+  [name release];
+  [super dealloc];
+}
+- (NSString *) name
+{
+  return name;
+}
+- (void) setName: (NSString *)aName
+{
+  ASSIGN(name, aName);
+}
+@end
+
+@interface Target : NSObject
+{
+  NSString *title;
+}
+- (NSString *) title;
+- (void) setTitle: (NSString *)aTitle;
+@end
+
+@implementation Target
++ (void) initialize
+{
+  if (self == [Target class])
+    {
+      [self exposeBinding: @"title"];
+    }
+}
+- (void) dealloc
+{
+  [self unbind: @"title"];
+  [title release];
+  [super dealloc];
+}
+- (NSString *) title
+{
+  return title;
+}
+- (void) setTitle: (NSString *)aTitle
+{
+  ASSIGN(title, aTitle);
+}
+@end
+
+@interface UpperTransformer : NSValueTransformer
+@end
+
+@implementation UpperTransformer
++ (Class) transformedValueClass
+{
+  return [NSString class];
+}
++ (BOOL) allowsReverseTransformation
+{
+  return NO;
+}
+- (id) transformedValue: (id)value
+{
+  return [value uppercaseString];
+}
+@end
+
+@interface LowerTransformer : UpperTransformer
+@end
+
+@implementation LowerTransformer
+- (id) transformedValue: (id)value
+{
+  return [value lowercaseString];
+}
+@end
+
+int
+main(int argc, char **argv)
+{
+  Model *model;
+  Target *target;
+  Target *other;
+
+  START_SET("NSKeyValueBinding transformers and placeholders")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  model = [Model new];
+  target = [Target new];
+  other = [Target new];
+
+  [NSValueTransformer setValueTransformer: AUTORELEASE([UpperTransformer new])
+                                  forName: @"TestCase"];
+  [target bind: @"title"
+      toObject: model
+   withKeyPath: @"name"
+       options: [NSDictionary dictionaryWithObjectsAndKeys:
+                   @"TestCase", NSValueTransformerNameBindingOption,
+                   @"Nothing", NSNullPlaceholderBindingOption,
+                   nil]];
+  pass([target infoForBinding: @"title"] != nil, "the binding is made");
+  pass([other infoForBinding: @"title"] == nil,
+       "an object without bindings has none");
+
+  [model setName: @"abc"];
+  pass([[target title] isEqualToString: @"ABC"],
+       "the named transformer is used");
+
+  [NSValueTransformer setValueTransformer: AUTORELEASE([LowerTransformer new])
+                                  forName: @"TestCase"];
+  [model setName: @"DeF"];
+  pass([[target title] isEqualToString: @"def"],
+       "a transformer registered again under the name replaces the old one");
+
+  [model setName: nil];
+  pass([[target title] isEqualToString: @"Nothing"],
+       "the null placeholder is used for nil");
+
+  [target unbind: @"title"];
+  pass([target infoForBinding: @"title"] == nil, "the binding is removed");
+  [model setName: @"ghi"];
+  pass([[target title] isEqualToString: @"Nothing"],
+       "an unbound target no longer follows the model");
+
+  DESTROY(other);
+  DESTROY(target);
+  DESTROY(model);
+  DESTROY(arp);
+  END_SET("NSKeyValueBinding transformers and placeholders")
+
+  return 0;
+}
@@ -0,0 +1,156 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSBundle.h>
+#include <Foundation/NSData.h>
+#include <Foundation/NSDictionary.h>
+#include <Foundation/NSFileManager.h>
+#include <Foundation/NSPathUtilities.h>
+#include <Foundation/NSPropertyList.h>
+#include <Foundation/NSString.h>
+#include <Foundation/NSValue.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSPrinter.h>
+
+static NSPrinter *
+makePrinter(void)
+{
+  return [[NSPrinter alloc] initWithName: @"Sample"
+                                withType: @"GNUstep Sample"
+                                withHost: @"localhost"
+                                withNote: @""];
+}
+
+/* The file the compiled tables of the PPD at path are kept in. */
+static NSString *
+cachePathForPPD(NSString *path)
+{
+  NSString *dir;
+
+  dir = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory,
+    NSUserDomainMask, YES) objectAtIndex: 0];
+  return [[dir stringByAppendingPathComponent: @"PPD"]
+    stringByAppendingPathComponent:
+      [NSString stringWithFormat: @"%@-%08lx.cache",
+        [[path lastPathComponent] stringByDeletingPathExtension],
+        (unsigned long)[path hash]]];
+}
+
+int main(int argc, char **argv)
+{
+  NSFileManager *fm;
+  NSString *path;
+  NSString *cachePath;
+  NSString *cacheDir;
+  BOOL hadCacheDir;
+  NSPrinter *first = nil;
+  NSPrinter *second = nil;
+  NSPrinter *third = nil;
+  NSMutableDictionary *cache;
+  NSArray *sizes;
+
+  START_SET("NSPrinter PPD parsing")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+    first = makePrinter();
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  if (first == nil)
+    SKIP("Printers can not be created")
+
+  path = [[[[[NSBundle mainBundle] bundlePath]
+    stringByDeletingLastPathComponent] stringByDeletingLastPathComponent]
+    stringByAppendingPathComponent: @"sample.ppd"];
+
+  /* Start without compiled tables, and remove what this test adds to the
+   * caches directory when done.
+   */
+  fm = [NSFileManager defaultManager];
+  cachePath = cachePathForPPD(path);
+  cacheDir = [cachePath stringByDeletingLastPathComponent];
+  hadCacheDir = [fm fileExistsAtPath: cacheDir];
+  [fm removeFileAtPath: cachePath handler: nil];
+
+  pass([first parsePPDAtPath: path], "sample PPD is parsed");
+  pass([[first stringForKey: @"NickName" inTable: @"PPD"]
+    isEqualToString: @"GNUstep Sample Printer"], "quoted value is read");
+  pass([[first stringForKey: @"DefaultPageSize" inTable: @"PPD"]
+    isEqualToString: @"A4"], "unquoted value is read");
+  pass([[first stringListForKey: @"Product" inTable: @"PPD"] count] == 2,
+       "repeated keyword keeps every value");
+  pass([[first stringForKey: @"ResetCode" inTable: @"PPD"]
+    isEqualToString: @"reset"], "symbol value is substituted");
+  pass([[first stringForKey: @"JCLBegin" inTable: @"PPD"]
+    isEqualToString: @"\033%-12345X"], "hexadecimal substring is converted");
+  pass([[first stringForKey: @"PageSize/A4" inTable: @"PPD"]
+    isEqualToString: @"<</PageSize [595 842]>>setpagedevice"],
+       "option value keeps the PostScript dictionary");
+  pass([[first stringForKey: @"PageSize/A4" inTable: @"PPDOptionTranslation"]
+    isEqualToString: @"A4 210 x 297 mm"], "first instance of an option wins");
+  sizes = [first stringListForKey: @"PageSize" inTable: @"PPD"];
+  pass([sizes count] == 2 && [[sizes objectAtIndex: 1]
+    isEqualToString: @"Letter"], "option keywords are listed");
+  pass([[first stringForKey: @"PageSize" inTable: @"PPDOrderDependency"]
+    isEqualToString: @"10"], "order dependency is read");
+  pass([[first stringListForKey: @"PageSize/Letter"
+                        inTable: @"PPDUIConstraints"]
+    isEqual: [NSArray arrayWithObjects: @"Duplex", @"", nil]],
+       "UI constraint is read");
+
+  second = makePrinter();
+  pass([second parsePPDAtPath: path], "sample PPD is parsed again");
+  pass([[second stringListForKey: @"Product" inTable: @"PPD"]
+    isEqual: [first stringListForKey: @"Product" inTable: @"PPD"]]
+    && [[second stringForKey: @"ResetCode" inTable: @"PPD"]
+      isEqualToString: @"reset"]
+    && [[second stringListForKey: @"PageSize/Letter"
+                         inTable: @"PPDUIConstraints"]
+      isEqual: [first stringListForKey: @"PageSize/Letter"
+                               inTable: @"PPDUIConstraints"]],
+       "compiled PPD gives the same tables");
+
+  /* Compiled tables of another version must not be used. */
+  cache = [NSPropertyListSerialization
+            propertyListFromData: [NSData dataWithContentsOfFile: cachePath]
+                mutabilityOption: NSPropertyListMutableContainers
+                          format: NULL
+                errorDescription: NULL];
+  pass([cache objectForKey: @"Version"] != nil,
+       "compiled PPD records its version");
+  [cache setObject: [NSNumber numberWithInt: 0] forKey: @"Version"];
+  [[[cache objectForKey: @"Tables"] objectForKey: @"PPD"]
+    setObject: [NSMutableArray arrayWithObject: @"Stale"]
+       forKey: @"NickName"];
+  [[NSPropertyListSerialization
+     dataFromPropertyList: cache
+                   format: NSPropertyListGNUstepBinaryFormat
+         errorDescription: NULL] writeToFile: cachePath atomically: YES];
+  third = makePrinter();
+  pass([third parsePPDAtPath: path]
+    && [[third stringForKey: @"NickName" inTable: @"PPD"]
+      isEqualToString: @"GNUstep Sample Printer"],
+       "compiled PPD of another version is parsed again");
+
+  [fm removeFileAtPath: cachePath handler: nil];
+  if (!hadCacheDir)
+    {
+      [fm removeFileAtPath: cacheDir handler: nil];
+    }
+
+  DESTROY(first);
+  DESTROY(second);
+  DESTROY(third);
+  DESTROY(arp);
+  END_SET("NSPrinter PPD parsing")
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSClipView.h>
+#include <AppKit/NSColor.h>
+#include <AppKit/NSGraphics.h>
+#include <AppKit/NSWindow.h>
+
+/* A flipped document view remembering the area it was asked to draw. */
+@interface DrawnView : NSView
+{
+@public
+  NSRect drawn;
+}
+@end
+
+@implementation DrawnView
+- (BOOL) isFlipped
+{
+  return YES;
+}
+
+- (void) drawRect: (NSRect)rect
+{
+  drawn = NSUnionRect(drawn, rect);
+  [[NSColor whiteColor] set];
+  NSRectFill(rect);
+}
+@end
+
+/* Scrolls clip to y and has the window draw what this left to draw. */
+static void
+scrollTo(NSClipView *clip, CGFloat y)
+{
+  [clip scrollToPoint: NSMakePoint(0, y)];
+  [[clip window] displayIfNeeded];
+}
+
+int main(int argc, char **argv)
+{
+  NSWindow *window;
+  NSClipView *clip;
+  DrawnView *doc;
+  NSRect top = NSMakeRect(0, 0, 100, 50);
+
+  START_SET("NSClipView overdraw margin")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  window = [[NSWindow alloc] initWithContentRect: NSMakeRect(0, 0, 100, 100)
+                                       styleMask: NSBorderlessWindowMask
+                                         backing: NSBackingStoreBuffered
+                                           defer: NO];
+  [window setReleasedWhenClosed: NO];
+  clip = [[NSClipView alloc] initWithFrame: NSMakeRect(0, 0, 100, 100)];
+  doc = [[DrawnView alloc] initWithFrame: NSMakeRect(0, 0, 100, 1000)];
+  [clip setDocumentView: doc];
+  [clip setOverdrawMargin: 200.0];
+  [[window contentView] addSubview: clip];
+  [window display];
+
+  /* Scrolling down keeps the top of the document, scrolling back up
+   * puts it back without asking the document view for it. */
+  scrollTo(clip, 50);
+  doc->drawn = NSZeroRect;
+  scrollTo(clip, 0);
+  pass(NSIsEmptyRect(NSIntersectionRect(doc->drawn, top)),
+       "an area scrolled back in is drawn from the kept copy");
+
+  /* The document view marked as needing display drops the copy. */
+  scrollTo(clip, 50);
+  [doc setNeedsDisplayInRect: NSMakeRect(0, 60, 100, 10)];
+  [window displayIfNeeded];
+  doc->drawn = NSZeroRect;
+  scrollTo(clip, 0);
+  pass(NSContainsRect(doc->drawn, top),
+       "an area scrolled back in is drawn again after a change");
+
+  /* The document view drawing directly drops the copy too. */
+  scrollTo(clip, 50);
+  [doc lockFocus];
+  [[NSColor blackColor] set];
+  NSRectFill(NSMakeRect(0, 60, 1, 10));
+  [doc unlockFocus];
+  doc->drawn = NSZeroRect;
+  scrollTo(clip, 0);
+  pass(NSContainsRect(doc->drawn, top),
+       "an area scrolled back in is drawn again after drawing with lockFocus");
+
+  scrollTo(clip, 50);
+  [doc displayRect: NSMakeRect(0, 60, 100, 10)];
+  doc->drawn = NSZeroRect;
+  scrollTo(clip, 0);
+  pass(NSContainsRect(doc->drawn, top),
+       "an area scrolled back in is drawn again after displayRect:");
+
+  /* Without a margin nothing is kept. */
+  [clip setOverdrawMargin: 0.0];
+  scrollTo(clip, 50);
+  doc->drawn = NSZeroRect;
+  scrollTo(clip, 0);
+  pass(NSContainsRect(doc->drawn, top),
+       "an area scrolled back in is drawn again without a margin");
+
+  [window close];
+  DESTROY(doc);
+  DESTROY(clip);
+  DESTROY(window);
+  DESTROY(arp);
+  END_SET("NSClipView overdraw margin")
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSDate.h>
+#include <Foundation/NSRunLoop.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSClipView.h>
+#include <AppKit/NSEvent.h>
+#include <AppKit/NSScrollView.h>
+
+@interface FlippedView : NSView
+@end
+
+@implementation FlippedView
+- (BOOL) isFlipped
+{
+  return YES;
+}
+@end
+
+static NSEvent *
+wheelEvent(CGFloat deltaY)
+{
+  return [NSEvent mouseEventWithType: NSScrollWheel
+                            location: NSMakePoint(10.0, 10.0)
+                       modifierFlags: 0
+                           timestamp: 0
+                        windowNumber: 0
+                             context: nil
+                         eventNumber: 0
+                          clickCount: 0
+                            pressure: 0.0
+                        buttonNumber: 0
+                              deltaX: 0.0
+                              deltaY: deltaY
+                              deltaZ: 0.0];
+}
+
+static void
+runFrames(int count)
+{
+  while (count-- > 0)
+    {
+      [[NSRunLoop currentRunLoop]
+        runMode: NSDefaultRunLoopMode
+        beforeDate: [NSDate dateWithTimeIntervalSinceNow: 0.05]];
+    }
+}
+
+int main(int argc, char **argv)
+{
+  NSScrollView *sv;
+  NSView *doc;
+  NSClipView *clip;
+
+  START_SET("NSScrollView scroll wheel")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  sv = [[NSScrollView alloc] initWithFrame: NSMakeRect(0, 0, 100, 100)];
+  [sv setHasVerticalScroller: YES];
+  [sv setVerticalLineScroll: 10];
+  doc = [[FlippedView alloc] initWithFrame: NSMakeRect(0, 0, 80, 1000)];
+  [sv setDocumentView: doc];
+  clip = [sv contentView];
+
+  [sv scrollWheel: wheelEvent(-1.0)];
+  [sv scrollWheel: wheelEvent(-1.0)];
+  [sv scrollWheel: wheelEvent(-1.0)];
+  pass([clip bounds].origin.y == 0.0, "wheel events are not applied at once");
+
+  runFrames(1);
+  pass([clip bounds].origin.y == 30.0,
+       "wheel events are applied together in the next frame");
+
+  [sv scrollWheel: wheelEvent(100.0)];
+  runFrames(1);
+  pass([clip bounds].origin.y == 0.0, "scrolling stops at the document start");
+  [sv scrollWheel: wheelEvent(-1.0)];
+  runFrames(1);
+  pass([clip bounds].origin.y == 10.0,
+       "distance past the document start is not kept");
+
+  pass([clip overdrawMargin] == 0.0, "no overdraw margin by default");
+  [clip setOverdrawMargin: 200.0];
+  pass([clip overdrawMargin] == 200.0, "overdraw margin is set");
+  [clip setOverdrawMargin: -5.0];
+  pass([clip overdrawMargin] == 0.0, "negative overdraw margin is ignored");
+
+  DESTROY(doc);
+  DESTROY(sv);
+  DESTROY(arp);
+  END_SET("NSScrollView scroll wheel")
+
+  return 0;
+}
@@ -0,0 +1,173 @@
+#import "ObjectTesting.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSCharacterSet.h>
+#import <Foundation/NSSet.h>
+#import <Foundation/NSValue.h>
+#import <AppKit/NSApplication.h>
+#import <AppKit/NSSpellChecker.h>
+
+@interface NSSpellChecker (Private)
+- (void) _setServerProxy: (id)server;
+@end
+
+/* A spell server living in this process, which knows a few words and
+ * answers one misspelling per request, like the real one does.
+ */
+@interface LocalSpellServer : NSObject
+{
+  NSSet *words;
+@public
+  int requests;
+  NSString *language;
+}
+@end
+
+@implementation LocalSpellServer
+- (id) init
+{
+  self = [super init];
+  words = [[NSSet alloc] initWithObjects: @"the", @"quick", @"fox", nil];
+  return self;
+}
+
+- (void) dealloc
+{
+  [words release];
+  [language release];
+  [super dealloc];
+}
+
+- (NSRange) _findMisspelledWordInString: (NSString *)stringToCheck
+			       language: (NSString *)language
+			   ignoredWords: (NSArray *)ignoredWords
+			      wordCount: (int *)wordCount
+			      countOnly: (BOOL)countOnly
+{
+  NSCharacterSet *letters = [NSCharacterSet letterCharacterSet];
+  NSUInteger length = [stringToCheck length];
+  NSUInteger i = 0;
+
+  requests++;
+  ASSIGN(self->language, language);
+  while (i < length)
+    {
+      NSRange r = [stringToCheck rangeOfCharacterFromSet: letters
+					         options: 0
+					           range: NSMakeRange(i, length - i)];
+      NSRange end;
+
+      if (r.length == 0)
+	break;
+      end = [stringToCheck rangeOfCharacterFromSet: [letters invertedSet]
+					   options: 0
+					     range: NSMakeRange(r.location,
+						 length - r.location)];
+      r.length = (end.length == 0 ? length : end.location) - r.location;
+      if (![words containsObject: [stringToCheck substringWithRange: r]])
+	return r;
+      i = NSMaxRange(r);
+    }
+  return NSMakeRange(0, 0);
+}
+@end
+
+/* The same server, answering all misspellings in one request.
+ */
+@interface LocalBatchSpellServer : LocalSpellServer
+@end
+
+@implementation LocalBatchSpellServer
+- (NSArray *) _findMisspelledWordsInString: (NSString *)stringToCheck
+				  language: (NSString *)language
+			      ignoredWords: (NSArray *)ignoredWords
+{
+  NSMutableArray *result = [NSMutableArray array];
+  NSUInteger start = 0;
+  int before = requests;
+  int count;
+
+  while (start < [stringToCheck length])
+    {
+      NSRange r = [super _findMisspelledWordInString:
+			   [stringToCheck substringFromIndex: start]
+					    language: language
+					ignoredWords: ignoredWords
+					   wordCount: &count
+					   countOnly: NO];
+      if (r.length == 0)
+	break;
+      r.location += start;
+      [result addObject: [NSValue valueWithRange: r]];
+      start = NSMaxRange(r);
+    }
+  // One request, however many times the lookup above ran
+  requests = before + 1;
+  return result;
+}
+@end
+
+int main()
+{
+  NSAutoreleasePool *arp = [NSAutoreleasePool new];
+  NSString *text = @"the quikc brown fox jmups";
+  NSSpellChecker *sp = nil;
+  LocalSpellServer *server;
+  NSArray *ranges;
+
+  START_SET("NSSpellChecker misspelledRanges")
+
+  NS_DURING
+    {
+      [NSApplication sharedApplication];
+      sp = [NSSpellChecker sharedSpellChecker];
+    }
+  NS_HANDLER
+    {
+      if ([[localException name] isEqualToString: NSInternalInconsistencyException])
+	SKIP("It looks like GNUstep backend is not yet installed")
+    }
+  NS_ENDHANDLER
+  if (sp == nil)
+    SKIP("The spelling panel could not be loaded")
+
+  server = [[LocalSpellServer new] autorelease];
+  [sp _setServerProxy: server];
+  ranges = [sp misspelledRangesInString: text
+				  range: NSMakeRange(0, [text length])
+			       language: nil
+		 inSpellDocumentWithTag: 0];
+  pass([ranges count] == 3, "finds every misspelling");
+  pass(NSEqualRanges([[ranges objectAtIndex: 1] rangeValue],
+    NSMakeRange(10, 5)), "ranges are relative to the string");
+
+  ranges = [sp misspelledRangesInString: text
+				  range: NSMakeRange(4, 11)
+			       language: nil
+		 inSpellDocumentWithTag: 0];
+  pass([ranges count] == 2
+    && NSEqualRanges([[ranges objectAtIndex: 0] rangeValue],
+      NSMakeRange(4, 5)), "only looks in the given range");
+  pass([server->language isEqual: [sp language]],
+    "the language of the checker is used when none is given");
+
+  [sp misspelledRangesInString: text
+			 range: NSMakeRange(0, [text length])
+		      language: @"Esperanto"
+	inSpellDocumentWithTag: 0];
+  pass([server->language isEqual: @"Esperanto"],
+    "the given language is used");
+
+  server = [[LocalBatchSpellServer new] autorelease];
+  [sp _setServerProxy: server];
+  ranges = [sp misspelledRangesInString: text
+				  range: NSMakeRange(0, [text length])
+			       language: nil
+		 inSpellDocumentWithTag: 0];
+  pass([ranges count] == 3 && server->requests == 1,
+    "a batch server is asked once");
+
+  END_SET("NSSpellChecker misspelledRanges")
+
+  [arp release];
+  return 0;
+}
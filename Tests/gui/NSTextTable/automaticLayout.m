@@ -0,0 +1,122 @@
+#include "Testing.h"
+
+#include <Foundation/NSArray.h>
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSDictionary.h>
+#include <Foundation/NSString.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSAttributedString.h>
+#include <AppKit/NSLayoutManager.h>
+#include <AppKit/NSParagraphStyle.h>
+#include <AppKit/NSTextContainer.h>
+#include <AppKit/NSTextStorage.h>
+#include <AppKit/NSTextTable.h>
+
+/* Appends text as the cell of table at row and column, and returns the
+ * block of the cell. */
+static NSTextTableBlock *
+appendCell(NSTextStorage *text, NSTextTable *table, int row, int col,
+  NSString *string)
+{
+  NSTextTableBlock *block;
+  NSMutableParagraphStyle *style;
+  NSAttributedString *cell;
+
+  block = [[NSTextTableBlock alloc] initWithTable: table
+                                      startingRow: row
+                                          rowSpan: 1
+                                   startingColumn: col
+                                       columnSpan: 1];
+  style = [[NSMutableParagraphStyle alloc] init];
+  [style setTextBlocks: [NSArray arrayWithObject: block]];
+  cell = [[NSAttributedString alloc]
+           initWithString: [string stringByAppendingString: @"\n"]
+               attributes: [NSDictionary dictionaryWithObject: style
+                                                       forKey: NSParagraphStyleAttributeName]];
+  [text appendAttributedString: cell];
+  RELEASE(cell);
+  RELEASE(style);
+  return AUTORELEASE(block);
+}
+
+/* The width of the first column, as laid out in tc. */
+static CGFloat
+firstColumnWidth(NSTextTableBlock *block, NSTextContainer *tc)
+{
+  return [block rectForLayoutAtPoint: NSZeroPoint
+                              inRect: NSMakeRect(0, 0, 1000, 1000)
+                       textContainer: tc
+                      characterRange: NSMakeRange(0, 2)].size.width;
+}
+
+int main(int argc, char **argv)
+{
+  NSTextStorage *text;
+  NSLayoutManager *lm;
+  NSTextContainer *tc;
+  NSTextTable *table;
+  NSTextTableBlock *first;
+  NSAttributedString *after;
+  CGFloat width;
+  NSRange r;
+
+  START_SET("NSTextTable automatic layout")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  text = [[NSTextStorage alloc] init];
+  lm = [[NSLayoutManager alloc] init];
+  tc = [[NSTextContainer alloc] initWithContainerSize: NSMakeSize(1000, 1000)];
+  [lm addTextContainer: tc];
+  [text addLayoutManager: lm];
+
+  table = [[NSTextTable alloc] init];
+  [table setNumberOfColumns: 2];
+  pass([table layoutAlgorithm] == NSTextTableAutomaticLayoutAlgorithm,
+       "tables use the automatic layout by default");
+
+  first = appendCell(text, table, 0, 0, @"a");
+  appendCell(text, table, 0, 1, @"b");
+  appendCell(text, table, 1, 0, @"c");
+  appendCell(text, table, 1, 1, @"d");
+  after = [[NSAttributedString alloc] initWithString: @"after\n"];
+  [text appendAttributedString: after];
+  RELEASE(after);
+
+  width = firstColumnWidth(first, tc);
+  pass(width > 0.0 && width < 500.0,
+       "a column with short cells is as wide as its text");
+
+  r = [[text string] rangeOfString: @"c\n"];
+  [text replaceCharactersInRange: NSMakeRange(r.location + 1, 0)
+                      withString: @"cccccccccccccccccccc"];
+  pass(firstColumnWidth(first, tc) > width,
+       "a column widens when the text of one of its cells grows");
+
+  r = [[text string] rangeOfString: @"after"];
+  r = NSMakeRange(4, r.location - 4);
+  [text deleteCharactersInRange: r];
+  pass([[text string] isEqualToString: @"a\nb\nafter\n"],
+       "the last row is deleted");
+  pass(firstColumnWidth(first, tc) == width,
+       "a column narrows again when its widest cell is deleted");
+
+  DESTROY(table);
+  DESTROY(tc);
+  DESTROY(lm);
+  DESTROY(text);
+  DESTROY(arp);
+  END_SET("NSTextTable automatic layout")
+
+  return 0;
+}
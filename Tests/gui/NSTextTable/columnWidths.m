@@ -0,0 +1,72 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+
+#include <AppKit/NSTextTable.h>
+
+int main()
+{
+  CREATE_AUTORELEASE_POOL(arp);
+  NSTextTable *table;
+  NSTextTableBlock *first, *spanning;
+  NSRect bounds = NSMakeRect(0, 0, 400, 1000);
+  NSRect r;
+
+  table = [[NSTextTable alloc] init];
+  [table setNumberOfColumns: 4];
+  [table setLayoutAlgorithm: NSTextTableFixedLayoutAlgorithm];
+  first = [[NSTextTableBlock alloc] initWithTable: table
+                                      startingRow: 0
+                                          rowSpan: 1
+                                   startingColumn: 0
+                                       columnSpan: 1];
+  spanning = [[NSTextTableBlock alloc] initWithTable: table
+                                         startingRow: 1
+                                             rowSpan: 1
+                                      startingColumn: 1
+                                          columnSpan: 2];
+
+  r = [first rectForLayoutAtPoint: NSMakePoint(0, 20)
+                           inRect: bounds
+                    textContainer: nil
+                   characterRange: NSMakeRange(0, 0)];
+  pass(NSEqualRects(r, NSMakeRect(0, 20, 100, 980)),
+       "fixed layout divides the width between the columns");
+
+  r = [spanning rectForLayoutAtPoint: NSMakePoint(0, 40)
+                              inRect: bounds
+                       textContainer: nil
+                      characterRange: NSMakeRange(0, 0)];
+  pass(NSEqualRects(r, NSMakeRect(100, 40, 200, 960)),
+       "a cell spans the width of its columns");
+
+  r = [spanning rectForLayoutAtPoint: NSMakePoint(0, 40)
+                              inRect: NSMakeRect(0, 0, 800, 1000)
+                       textContainer: nil
+                      characterRange: NSMakeRange(0, 0)];
+  pass(NSEqualRects(r, NSMakeRect(200, 40, 400, 960)),
+       "columns are solved again for a new width");
+
+  [spanning setWidth: 5 type: NSTextBlockAbsoluteValueType
+            forLayer: NSTextBlockPadding];
+  r = [spanning rectForLayoutAtPoint: NSMakePoint(0, 40)
+                              inRect: bounds
+                       textContainer: nil
+                      characterRange: NSMakeRange(0, 0)];
+  pass(NSEqualRects(r, NSMakeRect(105, 45, 190, 950)),
+       "text is laid out inside the padding of the cell");
+
+  [table setNumberOfColumns: 5];
+  r = [first rectForLayoutAtPoint: NSMakePoint(0, 20)
+                           inRect: bounds
+                    textContainer: nil
+                   characterRange: NSMakeRange(0, 0)];
+  pass(NSEqualRects(r, NSMakeRect(0, 20, 80, 980)),
+       "changing the number of columns discards the cached widths");
+
+  RELEASE(first);
+  RELEASE(spanning);
+  RELEASE(table);
+  DESTROY(arp);
+  return 0;
+}
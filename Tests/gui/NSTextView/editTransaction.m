@@ -0,0 +1,136 @@
+#import "Testing.h"
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSNotification.h>
+#import <Foundation/NSUndoManager.h>
+#import <AppKit/NSApplication.h>
+#import <AppKit/NSAttributedString.h>
+#import <AppKit/NSColor.h>
+#import <AppKit/NSTextStorage.h>
+#import <AppKit/NSTextView.h>
+
+@interface Watcher : NSObject
+{
+@public
+  NSUndoManager *undo;
+  int changes;
+}
+@end
+
+@implementation Watcher
+- (NSUndoManager *) undoManagerForTextView: (NSTextView *)aTextView
+{
+  return undo;
+}
+- (void) textDidChange: (NSNotification *)aNotification
+{
+  changes++;
+}
+@end
+
+static void
+replace(NSTextView *tv, NSRange r, NSString *s)
+{
+  if ([tv shouldChangeTextInRange: r replacementString: s])
+    {
+      [tv replaceCharactersInRange: r withString: s];
+      [tv didChangeText];
+    }
+}
+
+static void
+colour(NSTextView *tv, NSRange r)
+{
+  if ([tv shouldChangeTextInRange: r replacementString: nil])
+    {
+      [[tv textStorage] addAttribute: NSForegroundColorAttributeName
+                               value: [NSColor redColor]
+                               range: r];
+      [tv didChangeText];
+    }
+}
+
+static BOOL
+coloured(NSTextView *tv, NSUInteger index)
+{
+  return [[tv textStorage] attribute: NSForegroundColorAttributeName
+                             atIndex: index
+                      effectiveRange: NULL] != nil;
+}
+
+int
+main(int argc, char **argv)
+{
+  NSTextView *tv;
+  Watcher *w;
+
+  START_SET("NSTextView edit transactions")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  w = [Watcher new];
+  w->undo = [NSUndoManager new];
+  [w->undo setGroupsByEvent: NO];
+
+  tv = [[NSTextView alloc] initWithFrame: NSMakeRect(0, 0, 200, 100)];
+  [tv setString: @"one two three four"];
+  [tv setAllowsUndo: YES];
+  [tv setDelegate: w];
+
+  [w->undo beginUndoGrouping];
+  [tv beginEditTransaction];
+  replace(tv, NSMakeRange(0, 3), @"1");
+  replace(tv, NSMakeRange(2, 3), @"2");
+  [tv beginEditTransaction];
+  replace(tv, NSMakeRange(4, 5), @"3");
+  [tv endEditTransaction];
+  replace(tv, NSMakeRange(0, 0), @">");
+  pass(w->changes == 0, "text change notification is deferred");
+  [tv endEditTransaction];
+  [w->undo endUndoGrouping];
+
+  pass([[tv string] isEqualToString: @">1 2 3 four"], "edits are applied");
+  pass(w->changes == 1, "one text change notification per transaction");
+
+  [w->undo undo];
+  pass([[tv string] isEqualToString: @"one two three four"],
+       "a single undo reverts the whole transaction");
+  [w->undo redo];
+  pass([[tv string] isEqualToString: @">1 2 3 four"],
+       "redo reapplies the whole transaction");
+
+  /* An attribute change keeps the length of the text it changes. */
+  [tv setString: @"one two three four"];
+  [w->undo removeAllActions];
+  [w->undo beginUndoGrouping];
+  [tv beginEditTransaction];
+  colour(tv, NSMakeRange(4, 3));
+  replace(tv, NSMakeRange(0, 3), @"1");
+  [tv endEditTransaction];
+  [w->undo endUndoGrouping];
+  pass([[tv string] isEqualToString: @"1 two three four"] && coloured(tv, 2),
+       "attribute and text changes are applied");
+
+  [w->undo undo];
+  pass([[tv string] isEqualToString: @"one two three four"],
+       "undoing a transaction with an attribute change restores the text");
+  pass(!coloured(tv, 4), "undoing it restores the attributes");
+
+  [tv setDelegate: nil];
+  DESTROY(tv);
+  DESTROY(w->undo);
+  DESTROY(w);
+  DESTROY(arp);
+  END_SET("NSTextView edit transactions")
+
+  return 0;
+}
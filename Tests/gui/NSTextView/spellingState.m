@@ -0,0 +1,166 @@
+#import "Testing.h"
+#import <Foundation/NSArray.h>
+#import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSCharacterSet.h>
+#import <Foundation/NSSet.h>
+#import <AppKit/NSApplication.h>
+#import <AppKit/NSLayoutManager.h>
+#import <AppKit/NSSpellChecker.h>
+#import <AppKit/NSTextView.h>
+
+@interface NSSpellChecker (Private)
+- (void) _setServerProxy: (id)server;
+@end
+
+@interface NSTextView (Private)
+- (void) _textCheckingTimerFired: (NSTimer *)t;
+@end
+
+/* A spell server in this process which knows a few words, answers one
+ * misspelling per request and remembers the strings it was asked about.
+ */
+@interface RecordingSpellServer : NSObject
+{
+  NSSet *words;
+@public
+  NSMutableArray *checked;
+}
+@end
+
+@implementation RecordingSpellServer
+- (id) init
+{
+  self = [super init];
+  words = [[NSSet alloc] initWithObjects: @"the", @"quick", @"fox", nil];
+  checked = [NSMutableArray new];
+  return self;
+}
+
+- (void) dealloc
+{
+  [words release];
+  [checked release];
+  [super dealloc];
+}
+
+- (NSRange) _findMisspelledWordInString: (NSString *)stringToCheck
+			       language: (NSString *)language
+			   ignoredWords: (NSArray *)ignoredWords
+			      wordCount: (int *)wordCount
+			      countOnly: (BOOL)countOnly
+{
+  NSCharacterSet *letters = [NSCharacterSet letterCharacterSet];
+  NSUInteger length = [stringToCheck length];
+  NSUInteger i = 0;
+
+  [checked addObject: stringToCheck];
+  while (i < length)
+    {
+      NSRange r = [stringToCheck rangeOfCharacterFromSet: letters
+					         options: 0
+					           range: NSMakeRange(i, length - i)];
+      NSRange end;
+
+      if (r.length == 0)
+	break;
+      end = [stringToCheck rangeOfCharacterFromSet: [letters invertedSet]
+					   options: 0
+					     range: NSMakeRange(r.location,
+						 length - r.location)];
+      r.length = (end.length == 0 ? length : end.location) - r.location;
+      if (![words containsObject: [stringToCheck substringWithRange: r]])
+	return r;
+      i = NSMaxRange(r);
+    }
+  return NSMakeRange(0, 0);
+}
+@end
+
+static BOOL
+marked(NSTextView *tv, NSString *word)
+{
+  NSRange r = [[tv string] rangeOfString: word];
+
+  return [[tv layoutManager] temporaryAttribute: NSSpellingStateAttributeName
+			       atCharacterIndex: r.location
+				 effectiveRange: NULL] != nil;
+}
+
+int
+main(int argc, char **argv)
+{
+  NSSpellChecker *sp = nil;
+  RecordingSpellServer *server;
+  NSTextView *tv;
+
+  START_SET("NSTextView continuous spell checking")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+    sp = [NSSpellChecker sharedSpellChecker];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+  if (sp == nil)
+    SKIP("The spelling panel could not be loaded")
+
+  server = [[RecordingSpellServer new] autorelease];
+  [sp _setServerProxy: server];
+
+  tv = [[NSTextView alloc] initWithFrame: NSMakeRect(0, 0, 400, 400)];
+  [tv setString: @"the quikc fox\nthe fox jmups\nthe quick fox\n"];
+  [tv setContinuousSpellCheckingEnabled: YES];
+
+  [tv _textCheckingTimerFired: nil];
+  pass(marked(tv, @"quikc") && marked(tv, @"jmups")
+    && !marked(tv, @"quick"), "misspelled words are marked");
+
+  [server->checked removeAllObjects];
+  [tv _textCheckingTimerFired: nil];
+  pass([server->checked count] == 0, "checked text is not checked again");
+
+  /* Edit the last paragraph, only it needs checking again. */
+  [tv replaceCharactersInRange: NSMakeRange(28, 0) withString: @"zzz "];
+  [tv didChangeText];
+  [tv _textCheckingTimerFired: nil];
+  pass([server->checked count] > 0 && [[server->checked objectAtIndex: 0]
+    isEqualToString: @"zzz the quick fox\n"],
+       "only the edited paragraph is checked again");
+  pass(marked(tv, @"zzz") && marked(tv, @"jmups"),
+       "marks of the edited and the other paragraphs are kept");
+
+  /* Edit the first paragraph, which moves the checked ones after it. */
+  [server->checked removeAllObjects];
+  [tv replaceCharactersInRange: NSMakeRange(0, 0) withString: @"ab "];
+  [tv didChangeText];
+  [tv _textCheckingTimerFired: nil];
+  pass([server->checked count] > 0 && [[server->checked objectAtIndex: 0]
+    isEqualToString: @"ab the quikc fox\n"],
+       "checked paragraphs after an edit move with the text");
+
+  /* Join the first two paragraphs, both go stale. */
+  [server->checked removeAllObjects];
+  [tv replaceCharactersInRange: [[tv string] rangeOfString: @"\n"]
+		    withString: @" "];
+  [tv didChangeText];
+  [tv _textCheckingTimerFired: nil];
+  pass([server->checked count] > 0 && [[server->checked objectAtIndex: 0]
+    isEqualToString: @"ab the quikc fox the fox jmups\n"],
+       "joined paragraphs are checked again as one");
+  pass(marked(tv, @"jmups"), "the joined paragraph is marked again");
+
+  [tv setContinuousSpellCheckingEnabled: NO];
+  pass(!marked(tv, @"jmups"), "turning checking off removes the marks");
+
+  DESTROY(tv);
+  DESTROY(arp);
+  END_SET("NSTextView continuous spell checking")
+
+  return 0;
+}
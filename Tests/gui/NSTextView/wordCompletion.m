@@ -0,0 +1,97 @@
+#import "Testing.h"
+#import <Foundation/NSArray.h>
+#import <Foundation/NSAutoreleasePool.h>
+#import <AppKit/NSApplication.h>
+#import <AppKit/NSTextView.h>
+
+/* Returns the document word completions of the first occurrence of
+ * prefix in the text. */
+static NSArray *
+completions(NSTextView *tv, NSString *prefix)
+{
+  NSInteger index;
+
+  return [tv completionsForPartialWordRange:
+    [[tv string] rangeOfString: prefix]
+                        indexOfSelectedItem: &index];
+}
+
+static BOOL
+same(NSArray *a, NSArray *b)
+{
+  return [a isEqualToArray: b];
+}
+
+int
+main(int argc, char **argv)
+{
+  NSTextView *tv;
+  NSArray *words;
+
+  START_SET("NSTextView document word completion")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  tv = [[NSTextView alloc] initWithFrame: NSMakeRect(0, 0, 200, 100)];
+  [tv setString: @"app apple apply apple banana"];
+  [tv setUsesDocumentWordCompletion: YES];
+  pass([tv usesDocumentWordCompletion], "document word completion is on");
+
+  words = completions(tv, @"app");
+  pass(same(words, [NSArray arrayWithObjects: @"apple", @"apply", nil]),
+       "words with the prefix come most frequent first");
+  pass(same(completions(tv, @"app"), words),
+       "asking again gives the same words");
+
+  [tv replaceCharactersInRange: NSMakeRange([[tv string] length], 0)
+                    withString: @" apply apply"];
+  pass(same(completions(tv, @"app"),
+            [NSArray arrayWithObjects: @"apply", @"apple", nil]),
+       "inserted words are counted");
+
+  [tv replaceCharactersInRange: NSMakeRange(4, 5) withString: @"grape"];
+  [tv replaceCharactersInRange: NSMakeRange(16, 5) withString: @"grape"];
+  pass(same(completions(tv, @"app"), [NSArray arrayWithObject: @"apply"]),
+       "replaced words are no longer offered");
+  pass(same(completions(tv, @"gra"), [NSArray arrayWithObject: @"grape"]),
+       "replacing words are offered");
+
+  /* Split banana in two inside the word. */
+  [tv replaceCharactersInRange:
+        NSMakeRange([[tv string] rangeOfString: @"banana"].location + 3, 0)
+                    withString: @" "];
+  pass(same(completions(tv, @"ban"), [NSArray array]),
+       "a word split by an insertion is taken back");
+  pass(same(completions(tv, @"ba"), [NSArray arrayWithObject: @"ban"]),
+       "the parts of a split word are counted");
+
+  /* Join the parts again by deleting the space. */
+  [tv replaceCharactersInRange:
+        NSMakeRange([[tv string] rangeOfString: @" ana"].location, 1)
+                    withString: @""];
+  pass(same(completions(tv, @"ban"), [NSArray arrayWithObject: @"banana"]),
+       "words joined by a deletion are counted");
+
+  [tv setString: @"app apricot"];
+  pass(same(completions(tv, @"ap"), [NSArray arrayWithObjects:
+    @"app", @"apricot", nil]),
+       "replacing the whole text replaces the words");
+  pass(same(completions(tv, @"apr"), [NSArray arrayWithObject: @"apricot"]),
+       "a longer prefix narrows the last result");
+
+  DESTROY(tv);
+  DESTROY(arp);
+  END_SET("NSTextView document word completion")
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSArray.h>
+#include <Foundation/NSIndexPath.h>
+#include <Foundation/NSIndexSet.h>
+#include <Foundation/NSKeyValueObserving.h>
+#include <Foundation/NSString.h>
+
+#include <AppKit/NSTreeController.h>
+#include <AppKit/NSTreeNode.h>
+
+/* A model object posting its own change notifications for children.
+ */
+@interface Item : NSObject
+{
+@public
+  NSString *name;
+  NSMutableArray *children;
+}
+@end
+
+@implementation Item
++ (BOOL) automaticallyNotifiesObserversForKey: (NSString*)key
+{
+  return NO;
+}
+- (void) dealloc
+{
+  [name release];
+  [children release];
+  [super dealloc];
+}
+- (NSArray*) children
+{
+  return children;
+}
+- (NSUInteger) countOfChildren
+{
+  return [children count];
+}
+- (id) objectInChildrenAtIndex: (NSUInteger)index
+{
+  return [children objectAtIndex: index];
+}
+- (void) insertObject: (id)object inChildrenAtIndex: (NSUInteger)index
+{
+  NSIndexSet *set = [NSIndexSet indexSetWithIndex: index];
+
+  [self willChange: NSKeyValueChangeInsertion
+   valuesAtIndexes: set
+            forKey: @"children"];
+  [children insertObject: object atIndex: index];
+  [self didChange: NSKeyValueChangeInsertion
+  valuesAtIndexes: set
+           forKey: @"children"];
+}
+- (void) removeObjectFromChildrenAtIndex: (NSUInteger)index
+{
+  NSIndexSet *set = [NSIndexSet indexSetWithIndex: index];
+
+  [self willChange: NSKeyValueChangeRemoval
+   valuesAtIndexes: set
+            forKey: @"children"];
+  [children removeObjectAtIndex: index];
+  [self didChange: NSKeyValueChangeRemoval
+  valuesAtIndexes: set
+           forKey: @"children"];
+}
+@end
+
+static Item *
+item(NSString *name, NSArray *children)
+{
+  Item *i = [[Item new] autorelease];
+
+  i->name = [name copy];
+  i->children = [[NSMutableArray alloc] initWithArray: children];
+  return i;
+}
+
+static NSString *
+nameOf(NSTreeNode *node)
+{
+  return ((Item*)[node representedObject])->name;
+}
+
+static NSIndexPath *
+path2(NSUInteger a, NSUInteger b)
+{
+  NSUInteger indexes[2] = {a, b};
+
+  return [NSIndexPath indexPathWithIndexes: indexes length: 2];
+}
+
+int main()
+{
+  CREATE_AUTORELEASE_POOL(arp);
+  NSTreeController *tc;
+  NSMutableArray *content;
+  NSTreeNode *root;
+  NSTreeNode *node;
+
+  content = [NSMutableArray arrayWithObjects:
+    item(@"a", [NSArray arrayWithObjects: item(@"a0", nil),
+                        item(@"a1", nil), nil]),
+    item(@"b", nil), nil];
+
+  tc = [[NSTreeController alloc] initWithContent: content];
+  [tc setChildrenKeyPath: @"children"];
+
+  root = [tc arrangedObjects];
+  pass([[root childNodes] count] == 2, "arranged objects has the content");
+  node = [root descendantNodeAtIndexPath: path2(0, 1)];
+  pass([nameOf(node) isEqual: @"a1"],
+       "descendant node is found by index path");
+  pass([[node indexPath] isEqual: path2(0, 1)],
+       "node knows its index path");
+  pass([[[root childNodes] objectAtIndex: 1] isLeaf],
+       "node without children is a leaf");
+
+  [tc setSelectionIndexPath: path2(0, 1)];
+  [tc insertObject: item(@"new", nil) atArrangedObjectIndexPath: path2(0, 0)];
+  node = [root descendantNodeAtIndexPath: path2(0, 0)];
+  pass([nameOf(node) isEqual: @"new"], "inserted object is in the tree");
+  pass([((Item*)[content objectAtIndex: 0])->children count] == 3,
+       "inserted object is in the model");
+  pass([[tc selectionIndexPath] isEqual: path2(0, 2)],
+       "selection moves with the inserted object");
+
+  [tc removeObjectAtArrangedObjectIndexPath: path2(0, 2)];
+  pass([[[root descendantNodeAtIndexPath:
+                 [NSIndexPath indexPathWithIndex: 0]] childNodes] count] == 2,
+       "removed object is gone from the tree");
+  pass([[tc selectionIndexPaths] count] == 0,
+       "selection of the removed object is dropped");
+
+  [tc insertObject: item(@"c", nil)
+    atArrangedObjectIndexPath: [NSIndexPath indexPathWithIndex: 2]];
+  pass([content count] == 3 && [[root childNodes] count] == 3,
+       "top level insertion updates content and tree");
+
+  DESTROY(tc);
+  DESTROY(arp);
+  return 0;
+}
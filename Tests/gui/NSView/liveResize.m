@@ -0,0 +1,181 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSGeometry.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSView.h>
+#include <AppKit/NSWindow.h>
+
+@interface NSWindow (LiveResize)
+- (void) _startLiveResize;
+- (void) _endLiveResize;
+@end
+
+@interface PreservingView : NSView
+{
+@public
+  BOOL flipped;
+  int started;
+  int ended;
+  NSRect marked[8];
+  int markCount;
+}
+@end
+
+@implementation PreservingView
+- (BOOL) isFlipped
+{
+  return flipped;
+}
+
+- (BOOL) preservesContentDuringLiveResize
+{
+  return YES;
+}
+
+- (void) viewWillStartLiveResize
+{
+  [super viewWillStartLiveResize];
+  started++;
+}
+
+- (void) viewDidEndLiveResize
+{
+  [super viewDidEndLiveResize];
+  ended++;
+}
+
+- (void) setNeedsDisplayInRect: (NSRect)rect
+{
+  if (markCount < 8)
+    {
+      marked[markCount++] = rect;
+    }
+  [super setNeedsDisplayInRect: rect];
+}
+@end
+
+/* Whether one of the rectangles marked in view contains rect, or with
+ * whole NO, intersects it.  */
+static BOOL
+wasMarked(PreservingView *view, NSRect rect, BOOL whole)
+{
+  int i;
+
+  for (i = 0; i < view->markCount; i++)
+    {
+      if (whole ? NSContainsRect(view->marked[i], rect)
+        : NSIntersectsRect(view->marked[i], rect))
+        {
+          return YES;
+        }
+    }
+  return NO;
+}
+
+int main(int argc, char **argv)
+{
+  NSWindow *window;
+  PreservingView *content;
+  PreservingView *sub;
+  NSView *plain;
+  NSRect frame;
+  NSRect old;
+  NSRect rects[4];
+  NSInteger count;
+
+  START_SET("NSView live resize")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  window = [[NSWindow alloc] initWithContentRect: NSMakeRect(100,100,200,200)
+                                       styleMask: NSClosableWindowMask
+                                         backing: NSBackingStoreRetained
+                                           defer: YES];
+  content = [[PreservingView alloc] initWithFrame: NSMakeRect(0,0,200,200)];
+  content->flipped = YES;
+  [window setContentView: content];
+  sub = [[PreservingView alloc] initWithFrame: NSMakeRect(10,10,50,50)];
+  [sub setAutoresizingMask: NSViewHeightSizable];
+  [content addSubview: sub];
+  plain = [[NSView alloc] initWithFrame: NSMakeRect(100,10,50,50)];
+  [content addSubview: plain];
+
+  pass([window preservesContentDuringLiveResize],
+       "windows preserve content by default");
+
+  [window _startLiveResize];
+  pass([window inLiveResize] && [content inLiveResize] && [sub inLiveResize]
+    && [plain inLiveResize], "window and views are in live resize");
+  pass(content->started == 1 && sub->started == 1,
+       "views are told that the live resize starts");
+
+  // Grow the window to the right and downwards, keeping its top left corner
+  old = [content bounds];
+  frame = [window frame];
+  frame.origin.y -= 30;
+  frame.size.width += 50;
+  frame.size.height += 30;
+  content->markCount = 0;
+  [window setFrame: frame display: NO];
+
+  pass(NSEqualRects([content rectPreservedDuringLiveResize], old),
+       "old area of a flipped view is preserved");
+  [content getRectsExposedDuringLiveResize: rects count: &count];
+  pass(count == 2
+    && NSEqualRects(rects[0], NSMakeRect(NSWidth(old), 0,
+      NSWidth([content bounds]) - NSWidth(old), NSHeight([content bounds])))
+    && NSEqualRects(rects[1], NSMakeRect(0, NSHeight(old),
+      NSWidth(old), NSHeight([content bounds]) - NSHeight(old))),
+       "only the new strips of a flipped view are exposed");
+
+  pass(NSIsEmptyRect([sub rectPreservedDuringLiveResize]),
+       "view whose origin moved preserves nothing");
+  [sub getRectsExposedDuringLiveResize: rects count: &count];
+  pass(count == 1 && NSEqualRects(rects[0], [sub bounds]),
+       "view whose origin moved is exposed completely");
+
+  [plain getRectsExposedDuringLiveResize: rects count: &count];
+  pass(count == 1 && NSEqualRects(rects[0], [plain bounds]),
+       "view not preserving its content is exposed completely");
+
+  pass(NSEqualRects([sub frame], NSMakeRect(10, 10, 50, 80)),
+       "autoresizing has resized the subview");
+  pass(wasMarked(content, NSMakeRect(10, 10, 50, 80), YES),
+       "old and new place of an autoresized subview are redrawn");
+  pass(!wasMarked(content, [plain frame], NO),
+       "place of a subview which did not move is not redrawn");
+
+  [window setPreservesContentDuringLiveResize: NO];
+  pass(NSIsEmptyRect([content rectPreservedDuringLiveResize]),
+       "nothing is preserved when the window does not preserve content");
+  [window setPreservesContentDuringLiveResize: YES];
+
+  [window _endLiveResize];
+  pass(![window inLiveResize] && ![content inLiveResize] && ![sub inLiveResize],
+       "live resize ends");
+  pass(content->ended == 1 && sub->ended == 1,
+       "views are told that the live resize ended");
+  [content getRectsExposedDuringLiveResize: rects count: &count];
+  pass(count == 1 && NSEqualRects(rects[0], [content bounds]),
+       "outside a live resize the whole view is exposed");
+
+  DESTROY(plain);
+  DESTROY(sub);
+  DESTROY(content);
+  DESTROY(window);
+  DESTROY(arp);
+  END_SET("NSView live resize")
+
+  return 0;
+}
@@ -0,0 +1,145 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSDate.h>
+#include <Foundation/NSRunLoop.h>
+#include <Foundation/NSThread.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSView.h>
+#include <AppKit/NSWindow.h>
+
+/* Counts the rectangles handed to it in the main thread. */
+@interface CountingView : NSView
+{
+@public
+  int calls;
+  NSRect dirty;
+  volatile BOOL done;
+}
+- (void) invalidate: (id)arg;
+- (void) invalidateAll: (id)arg;
+@end
+
+@implementation CountingView
+- (void) setNeedsDisplayInRect: (NSRect)rect
+{
+  if ([NSThread isMainThread])
+    {
+      calls++;
+      dirty = NSUnionRect(dirty, rect);
+    }
+  [super setNeedsDisplayInRect: rect];
+}
+
+- (void) invalidate: (id)arg
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  int i;
+
+  for (i = 0; i < 100; i++)
+    {
+      [self setNeedsDisplayInRect: NSMakeRect(i, 0, 1, 1)];
+    }
+  done = YES;
+  [pool drain];
+}
+
+- (void) invalidateAll: (id)arg
+{
+  CREATE_AUTORELEASE_POOL(pool);
+  int i;
+
+  for (i = 0; i < 100; i++)
+    {
+      [self setNeedsDisplay: YES];
+    }
+  done = YES;
+  [pool drain];
+}
+@end
+
+static void
+runInThread(CountingView *view, SEL selector)
+{
+  int i;
+
+  view->calls = 0;
+  view->dirty = NSZeroRect;
+  view->done = NO;
+  [NSThread detachNewThreadSelector: selector
+                           toTarget: view
+                         withObject: nil];
+  for (i = 0; i < 50 && !view->done; i++)
+    {
+      [NSThread sleepForTimeInterval: 0.1];
+    }
+}
+
+static void
+invalidateInThread(CountingView *view)
+{
+  runInThread(view, @selector(invalidate:));
+}
+
+static void
+runLoopOnce(void)
+{
+  [[NSRunLoop currentRunLoop]
+    runMode: NSDefaultRunLoopMode
+    beforeDate: [NSDate dateWithTimeIntervalSinceNow: 0.1]];
+}
+
+int main(int argc, char **argv)
+{
+  CountingView *view;
+  NSWindow *window;
+
+  START_SET("NSView invalidation from other threads")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  view = [[CountingView alloc] initWithFrame: NSMakeRect(0, 0, 100, 100)];
+  invalidateInThread(view);
+  pass(view->done, "the secondary thread finished");
+  pass(view->calls == 0, "nothing is handed over before the main thread runs");
+  runLoopOnce();
+  pass(view->calls == 1, "the rectangles of a view are handed over at once");
+  pass(NSEqualRects(view->dirty, NSMakeRect(0, 0, 100, 1)),
+       "the handed over rectangle covers all of them");
+
+  runInThread(view, @selector(invalidateAll:));
+  pass(view->done && view->calls == 0,
+       "marking the whole view is not handed over at once either");
+  runLoopOnce();
+  pass(view->calls == 1 && NSEqualRects(view->dirty, [view bounds]),
+       "marking the whole view is handed over once as its bounds");
+
+  window = [[NSWindow alloc] initWithContentRect: NSMakeRect(0, 0, 100, 100)
+                                       styleMask: NSBorderlessWindowMask
+                                         backing: NSBackingStoreBuffered
+                                           defer: YES];
+  [window setReleasedWhenClosed: NO];
+  [[window contentView] addSubview: view];
+  invalidateInThread(view);
+  [view removeFromSuperview];
+  DESTROY(window);
+  runLoopOnce();
+  pass(view->calls == 1,
+       "rectangles are handed over after the window went away");
+
+  DESTROY(view);
+  DESTROY(arp);
+  END_SET("NSView invalidation from other threads")
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include "Testing.h"
+
+#include <Foundation/NSAutoreleasePool.h>
+#include <Foundation/NSString.h>
+#include <AppKit/NSApplication.h>
+#include <AppKit/NSView.h>
+
+@interface NSObject (GSToolTipsPrivate)
++ (id) tipsForView: (NSView*)aView;
+- (id) _regionAtPoint: (NSPoint)aPoint;
+- (void) removeToolTipsInRect: (NSRect)aRect;
+- (id) object;
+@end
+
+/* Returns the owner string of the tool tip region shown at x, y. */
+static NSString *
+tipAt(NSView *v, CGFloat x, CGFloat y)
+{
+  id tips = [NSClassFromString(@"GSToolTips") tipsForView: v];
+
+  return [[tips _regionAtPoint: NSMakePoint(x, y)] object];
+}
+
+static BOOL
+tipIs(NSView *v, CGFloat x, CGFloat y, NSString *owner)
+{
+  NSString *tip = tipAt(v, x, y);
+
+  return (owner == nil) ? (tip == nil) : [tip isEqualToString: owner];
+}
+
+int main(int argc, char **argv)
+{
+  NSView *v;
+  NSToolTipTag a, b, c, t;
+
+  START_SET("NSView tool tips")
+  CREATE_AUTORELEASE_POOL(arp);
+
+  NS_DURING
+  {
+    [NSApplication sharedApplication];
+  }
+  NS_HANDLER
+  {
+    if ([[localException name] isEqualToString: NSInternalInconsistencyException ])
+       SKIP("It looks like GNUstep backend is not yet installed")
+  }
+  NS_ENDHANDLER
+
+  v = [[NSView alloc] initWithFrame: NSMakeRect(0, 0, 200, 1000)];
+
+  a = [v addToolTipRect: NSMakeRect(0, 0, 200, 20)
+                  owner: @"first"
+               userData: NULL];
+  b = [v addToolTipRect: NSMakeRect(0, 900, 200, 20)
+                  owner: @"second"
+               userData: NULL];
+  pass(a != -1 && b != -1 && a != b, "tool tip rects get distinct tags");
+  pass([v addToolTipRect: NSMakeRect(300, 0, 10, 10)
+                   owner: @"outside"
+                userData: NULL] == -1,
+       "tool tip rect outside the bounds is rejected");
+
+  [v setToolTip: @"view"];
+  pass([[v toolTip] isEqualToString: @"view"], "view tool tip is kept");
+  [v setToolTip: @"changed"];
+  pass([[v toolTip] isEqualToString: @"changed"], "view tool tip is replaced");
+
+  [v removeToolTip: a];
+  pass([[v toolTip] isEqualToString: @"changed"],
+       "removing a rect keeps the view tool tip");
+  [v setToolTip: nil];
+  pass([v toolTip] == nil, "view tool tip is removed");
+
+  [v removeAllToolTips];
+  pass([v toolTip] == nil, "all tool tips are removed");
+
+  DESTROY(v);
+
+  /* Regions are indexed in bands 64 high, those covering more than 32
+   * bands are kept apart as tall regions.
+   */
+  v = [[NSView alloc] initWithFrame: NSMakeRect(0, 0, 200, 4000)];
+  [v addToolTipRect: NSMakeRect(0, 0, 200, 64) owner: @"a" userData: NULL];
+  [v addToolTipRect: NSMakeRect(0, 64, 200, 64) owner: @"b" userData: NULL];
+  c = [v addToolTipRect: NSMakeRect(0, 60, 100, 8) owner: @"c" userData: NULL];
+  t = [v addToolTipRect: NSMakeRect(150, 0, 50, 3000)
+                  owner: @"tall"
+               userData: NULL];
+  [v addToolTipRect: NSMakeRect(160, 100, 20, 20) owner: @"d" userData: NULL];
+
+  pass(tipIs(v, 10, 30, @"a") && tipIs(v, 10, 63.5, @"a")
+    && tipIs(v, 10, 64.5, @"b") && tipIs(v, 10, 100, @"b"),
+       "regions are found on either side of a band edge");
+  pass(tipIs(v, 50, 61, @"c") && tipIs(v, 50, 66, @"c"),
+       "a region across a band edge is found in both bands");
+  pass(tipIs(v, 170, 30, @"tall") && tipIs(v, 170, 2000, @"tall"),
+       "a tall region is found over its whole height");
+  pass(tipIs(v, 170, 110, @"d"),
+       "a region added after a tall one it overlaps is found first");
+  pass(tipIs(v, 10, 2000, nil) && tipIs(v, 10, 3500, nil),
+       "no region is found where there is none");
+
+  [v removeToolTip: c];
+  pass(tipIs(v, 50, 61, @"a") && tipIs(v, 50, 66, @"b"),
+       "a removed region is taken out of every band");
+  [v removeToolTip: t];
+  pass(tipIs(v, 170, 30, @"a") && tipIs(v, 170, 2000, nil)
+    && tipIs(v, 170, 110, @"d"),
+       "a removed tall region is no longer found");
+
+  [[NSClassFromString(@"GSToolTips") tipsForView: v]
+    removeToolTipsInRect: NSMakeRect(0, 0, 200, 64)];
+  pass(tipIs(v, 10, 30, nil) && tipIs(v, 10, 100, @"b")
+    && tipIs(v, 170, 110, @"d"),
+       "only the regions inside a rect are removed with it");
+
+  [v addToolTipRect: NSMakeRect(0, 90, 200, 10) owner: @"e" userData: NULL];
+  pass(tipIs(v, 10, 95, @"e") && tipIs(v, 10, 80, @"b"),
+       "a region added after lookups is found first");
+
+  [v removeAllToolTips];
+  pass(tipIs(v, 10, 95, nil), "no region is found once all are removed");
+
+  DESTROY(v);
+  DESTROY(arp);
+  END_SET("NSView tool tips")
+
+  return 0;
+}